@@ -0,0 +1,63 @@
+/**
+ * Tests $approxCountDistinct and $percentile, on one shard and merged across two.
+ */
+
+function runTest(coll) {
+    // 20000 documents, 2500 distinct values of 'v' per group, 'x' uniform over [0, 20000).
+    var res = coll.aggregate([{$group: {_id: "$g",
+                                        distinct: {$approxCountDistinct: "$v"},
+                                        median: {$percentile: {input: "$x", p: 0.5}},
+                                        tails: {$percentile: {input: "$x", p: [0, 0.99, 1]}}}},
+                              {$sort: {_id: 1}}]).toArray();
+    assert.eq(2, res.length, tojson(res));
+    res.forEach(function(group) {
+        assert.lt(Math.abs(group.distinct - 2500), 100, tojson(group));
+        assert.lt(Math.abs(group.median - 10000), 100, tojson(group));
+        assert.eq(3, group.tails.length, tojson(group));
+        assert.eq(group._id, group.tails[0], tojson(group));
+        assert.lt(Math.abs(group.tails[1] - 19800), 50, tojson(group));
+        assert.eq(19998 + group._id, group.tails[2], tojson(group));
+    });
+
+    // Small counts are exact, and non-numeric input to $percentile is ignored.
+    res = coll.aggregate([{$match: {x: {$lt: 10}}},
+                          {$group: {_id: null,
+                                    distinct: {$approxCountDistinct: "$x"},
+                                    max: {$percentile: {input: "$s", p: 1}}}}]).toArray();
+    assert.eq([{_id: null, distinct: 10, max: null}], res);
+
+    assert.commandFailed(coll.runCommand("aggregate", {pipeline: [
+        {$group: {_id: null, p: {$percentile: {input: "$x", p: 2}}}}]}));
+    assert.commandFailed(coll.runCommand("aggregate", {pipeline: [
+        {$group: {_id: null, p: {$percentile: {input: "$x"}}}}]}));
+    assert.commandFailed(coll.runCommand("aggregate", {pipeline: [
+        {$group: {_id: null, p: {$percentile: "$x"}}}]}));
+}
+
+function load(coll) {
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < 20000; i++) {
+        bulk.insert({_id: i, g: i % 2, v: i % 5000, x: i, s: "a"});
+    }
+    assert.writeOK(bulk.execute());
+}
+
+var coll = db.approx_accumulators;
+coll.drop();
+load(coll);
+runTest(coll);
+
+// Each shard sends its sketches to the merger.
+var st = new ShardingTest({shards: 2, mongos: 1});
+var testDB = st.s.getDB('test');
+coll = testDB.approx_accumulators;
+assert.commandWorked(testDB.adminCommand({enableSharding: 'test'}));
+st.ensurePrimaryShard('test', 'shard0000');
+assert.commandWorked(testDB.adminCommand({shardCollection: coll.getFullName(), key: {_id: 1}}));
+assert.commandWorked(testDB.adminCommand({split: coll.getFullName(), middle: {_id: 7000}}));
+assert.commandWorked(testDB.adminCommand({moveChunk: coll.getFullName(),
+                                          find: {_id: 7000},
+                                          to: 'shard0001'}));
+load(coll);
+runTest(coll);
+st.stop();
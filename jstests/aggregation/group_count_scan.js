@@ -0,0 +1,90 @@
+// Tests $group and $sort+$limit pushed down into the query layer.
+
+var coll = db.agg_group_count_scan;
+coll.drop();
+
+coll.insert({_id: 0, a: 1});
+coll.insert({_id: 1, a: 1.0});
+coll.insert({_id: 2, a: NumberLong(2)});
+coll.insert({_id: 3, a: "x"});
+coll.insert({_id: 4, a: null});
+coll.insert({_id: 5});
+coll.insert({_id: 6, a: {b: 1}});
+coll.insert({_id: 7, a: "x"});
+coll.insert({_id: 8, b: 3});
+
+function winningStage(pipeline) {
+    var explain = coll.runCommand("aggregate", {pipeline: pipeline, explain: true});
+    assert.commandWorked(explain);
+    var cursor = explain.stages[0].$cursor;
+    return cursor ? cursor.queryPlanner.winningPlan : null;
+}
+
+function sortById(docs) {
+    return docs.sort(function(x, y) {
+        return bsonWoCompare({v: x._id}, {v: y._id});
+    });
+}
+
+// Compares a pipeline against the same pipeline with an added $project in front, which keeps
+// anything from being pushed down.
+function assertSameGroups(group) {
+    var pushed = sortById(coll.aggregate([group]).toArray());
+    var unpushed = sortById(coll.aggregate([{$project: {a: 1}}, group]).toArray());
+    assert.eq(unpushed, pushed);
+}
+
+var countByA = {$group: {_id: "$a", n: {$sum: 1}}};
+var distinctA = {$group: {_id: "$a"}};
+
+assertSameGroups(countByA);
+assertSameGroups(distinctA);
+
+coll.ensureIndex({a: 1, b: 1});
+assert.eq("GROUP_COUNT_SCAN", winningStage([countByA]).stage);
+assert.eq("GROUP_COUNT_SCAN", winningStage([distinctA]).stage);
+assertSameGroups(countByA);
+assertSameGroups(distinctA);
+
+// An empty $match in front doesn't keep the $group from being pushed down.
+assert.eq("GROUP_COUNT_SCAN", winningStage([{$match: {}}, countByA]).stage);
+assert.eq(sortById(coll.aggregate([countByA]).toArray()),
+          sortById(coll.aggregate([{$match: {}}, countByA]).toArray()));
+
+// Only {$sum: 1} can be answered by counting keys.
+assert.neq("GROUP_COUNT_SCAN", winningStage([{$group: {_id: "$a", n: {$sum: 2}}}]).stage);
+assert.neq("GROUP_COUNT_SCAN", winningStage([{$group: {_id: "$b", n: {$sum: 1}}}]).stage);
+
+// A multikey index has more than one key per document.
+coll.insert({_id: 9, a: [1, 2]});
+assert.neq("GROUP_COUNT_SCAN", winningStage([countByA]).stage);
+assertSameGroups(countByA);
+coll.remove({_id: 9});
+
+// $sort+$limit on a field no index can sort by becomes a top-K sort in the query layer, as long
+// as a non-multikey index shows the field holds no arrays. With the default 32MB limit of the
+// SORT stage, only a $limit of 1 is sure to fit whatever the document sizes.
+coll.drop();
+for (var i = 0; i < 100; i++) {
+    coll.insert({_id: i, a: i % 7, s: (i * 37) % 100});
+}
+coll.ensureIndex({a: 1, s: 1});
+
+var topK = [{$match: {a: {$gte: 0}}}, {$sort: {s: -1}}, {$limit: 1}];
+var plan = winningStage(topK);
+assert.eq("SORT", plan.stage, tojson(plan));
+assert.eq(1, plan.limitAmount, tojson(plan));
+assert.eq([99], coll.aggregate(topK).toArray().map(function(z) { return z.s; }));
+
+// The SORT stage has a lower memory limit than $sort, so a top-K that may not fit under it stays
+// in the pipeline.
+var bigTopK = [{$match: {a: {$gte: 0}}}, {$sort: {s: -1}}, {$limit: 2}];
+plan = winningStage(bigTopK);
+assert.neq("SORT", plan.stage, tojson(plan));
+assert.eq([99, 98], coll.aggregate(bigTopK).toArray().map(function(z) { return z.s; }));
+
+// Arrays sort differently in the query layer, so multikey fields stay in the pipeline.
+coll.insert({_id: 100, a: 0, s: [200, -1]});
+plan = winningStage(topK);
+assert.neq("SORT", plan.stage, tojson(plan));
+assert.eq([[200, -1]], coll.aggregate(topK).toArray().map(function(z) { return z.s; }));
@@ -0,0 +1,65 @@
+// Tests $lookup with each of its join strategies.
+
+var local = db.agg_lookup_local;
+var foreign = db.agg_lookup_foreign;
+local.drop();
+foreign.drop();
+
+local.insert({_id: 0, a: 1});
+local.insert({_id: 1, a: 2});
+local.insert({_id: 2, a: [1, 3]});
+local.insert({_id: 3});
+local.insert({_id: 4, a: 5});
+
+foreign.insert({_id: 0, b: 1});
+foreign.insert({_id: 1, b: 1});
+foreign.insert({_id: 2, b: [2, 3]});
+foreign.insert({_id: 3, b: null});
+foreign.insert({_id: 4});
+
+function foreignIds(doc) {
+    return doc.matches.map(function(z) { return z._id; }).sort();
+}
+
+function runTest(options) {
+    var pipeline = [{$lookup: {from: foreign.getName(),
+                               localField: "a",
+                               foreignField: "b",
+                               as: "matches"}},
+                    {$sort: {_id: 1}}];
+    var res = local.aggregate(pipeline, options).toArray();
+    assert.eq(5, res.length);
+    assert.eq([0, 1], foreignIds(res[0]));
+    assert.eq([2], foreignIds(res[1]));
+    assert.eq([0, 1, 2], foreignIds(res[2]));
+    assert.eq([3, 4], foreignIds(res[3])); // missing matches null and missing
+    assert.eq([], foreignIds(res[4]));
+
+    var explain = local.runCommand("aggregate", {pipeline: pipeline, explain: true});
+    assert.commandWorked(explain);
+}
+
+// No index on foreignField, the foreign collection is hashed in memory.
+runTest();
+
+// When the foreign collection doesn't fit in memory it is joined on disk, or without disk use
+// probed once per input batch.
+assert.commandWorked(db.adminCommand({setParameter: 1, aggregationLookupMaxMemoryBytes: 64}));
+runTest({allowDiskUse: true});
+runTest();
+assert.commandWorked(db.adminCommand({setParameter: 1,
+                                      aggregationLookupMaxMemoryBytes: 100 * 1024 * 1024}));
+
+// With an index on foreignField each input batch becomes one index probe.
+assert.commandWorked(foreign.ensureIndex({b: 1}));
+runTest();
+
+// Bad specifications.
+assert.commandFailed(local.runCommand("aggregate",
+                                      {pipeline: [{$lookup: {from: foreign.getName()}}]}));
+assert.commandFailed(local.runCommand("aggregate",
+                                      {pipeline: [{$lookup: {from: foreign.getName(),
+                                                             localField: "a",
+                                                             foreignField: "b",
+                                                             as: "c",
+                                                             extra: "d"}}]}));
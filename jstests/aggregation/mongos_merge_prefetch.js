@@ -0,0 +1,57 @@
+/**
+ * Tests that the merging shard reads ahead from every shard cursor without reordering or losing
+ * documents, including when the per-shard read-ahead buffer is tiny.
+ */
+
+var st = new ShardingTest({shards: 3, mongos: 1});
+var testDB = st.s.getDB('test');
+var coll = testDB.merge_prefetch;
+
+assert.commandWorked(testDB.adminCommand({enableSharding: 'test'}));
+st.ensurePrimaryShard('test', 'shard0000');
+assert.commandWorked(testDB.adminCommand({shardCollection: coll.getFullName(), key: {_id: 1}}));
+assert.commandWorked(testDB.adminCommand({split: coll.getFullName(), middle: {_id: 1000}}));
+assert.commandWorked(testDB.adminCommand({split: coll.getFullName(), middle: {_id: 2000}}));
+assert.commandWorked(testDB.adminCommand({moveChunk: coll.getFullName(),
+                                          find: {_id: 1000},
+                                          to: 'shard0001'}));
+assert.commandWorked(testDB.adminCommand({moveChunk: coll.getFullName(),
+                                          find: {_id: 2000},
+                                          to: 'shard0002'}));
+
+var bulk = coll.initializeUnorderedBulkOp();
+for (var i = 0; i < 3000; i++) {
+    bulk.insert({_id: i, k: (i * 7) % 3000, pad: new Array(200).join('x')});
+}
+assert.writeOK(bulk.execute());
+
+function runTest() {
+    // Sorted merge: the merging shard merges the presorted shard streams.
+    var res = coll.aggregate([{$match: {_id: {$gte: 0}}}, {$sort: {k: -1}}],
+                             {cursor: {batchSize: 100}}).toArray();
+    assert.eq(3000, res.length);
+    for (var i = 0; i < res.length; i++) {
+        assert.eq(2999 - i, res[i].k);
+    }
+
+    // Unsorted merge: every document arrives exactly once.
+    res = coll.aggregate([{$match: {_id: {$gte: 0}}}, {$project: {_id: 1}}],
+                         {cursor: {batchSize: 100}}).toArray();
+    assert.eq(3000, res.length);
+    var seen = {};
+    res.forEach(function(doc) {
+        assert(!seen[doc._id], tojson(doc));
+        seen[doc._id] = true;
+    });
+}
+
+runTest();
+
+// With a one byte bound every shard has at most one batch read ahead.
+st._connections.forEach(function(conn) {
+    assert.commandWorked(conn.adminCommand({setParameter: 1,
+                                            aggregationMergeCursorsBufferBytes: 1}));
+});
+runTest();
+
+st.stop();
@@ -0,0 +1,52 @@
+// Tests the per-collection and per-index 'compression' option and the sampleCompression command.
+
+var coll = db.collection_compression;
+coll.drop();
+
+// Only known compressors are accepted, and 'prefix' only applies to indexes.
+assert.commandFailed(db.createCollection(coll.getName(), {compression: "lz4"}));
+assert.commandFailed(db.createCollection(coll.getName(), {compression: "prefix"}));
+assert.commandFailed(db.createCollection(coll.getName(), {compression: 1}));
+
+assert.commandWorked(db.createCollection(coll.getName(), {compression: "zlib"}));
+var res = db.runCommand({listCollections: 1, filter: {name: coll.getName()}});
+assert.commandWorked(res);
+assert.eq("zlib", res.cursor.firstBatch[0].options.compression, tojson(res));
+
+// collMod records the new setting.
+res = assert.commandWorked(db.runCommand({collMod: coll.getName(), compression: "snappy"}));
+assert.eq("zlib", res.compression_old, tojson(res));
+assert.eq("snappy", res.compression_new, tojson(res));
+assert.commandFailed(db.runCommand({collMod: coll.getName(), compression: "bogus"}));
+res = db.runCommand({listCollections: 1, filter: {name: coll.getName()}});
+assert.eq("snappy", res.cursor.firstBatch[0].options.compression, tojson(res));
+
+// Indexes take their own setting.
+assert.commandWorked(coll.ensureIndex({a: 1}, {compression: "prefix"}));
+assert.commandWorked(coll.ensureIndex({b: 1}, {compression: "zlib"}));
+assert.commandFailed(coll.ensureIndex({c: 1}, {compression: "bogus"}));
+
+for (var i = 0; i < 500; i++) {
+    assert.writeOK(coll.insert({a: i, b: "some text that repeats itself " + (i % 10)}));
+}
+assert.eq(500, coll.find({a: {$gte: 0}}).hint({a: 1}).itcount());
+
+// sampleCompression is only available with WiredTiger.
+res = db.runCommand({sampleCompression: coll.getName(), sampleSize: 100});
+if (res.ok) {
+    assert.eq(100, res.sampledDocuments, tojson(res));
+    assert.between(100, res.scannedRecords, 500, tojson(res));
+    assert.eq("snappy", res.current, tojson(res));
+    ["none", "snappy", "zlib"].forEach(function(compressor) {
+        assert(res.compressors[compressor], tojson(res));
+    });
+    assert.contains(res.recommended, ["none", "snappy", "zlib"], tojson(res));
+
+    assert.commandFailed(db.runCommand({sampleCompression: coll.getName(), sampleSize: 0}));
+    assert.commandFailed(db.runCommand({sampleCompression: "collection_compression_missing"}));
+}
+else {
+    assert.eq(59, res.code, tojson(res));  // CommandNotFound
+}
+
+coll.drop();
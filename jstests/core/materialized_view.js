@@ -0,0 +1,73 @@
+// Tests incremental maintenance of materialized views.
+
+var source = db.mv_source;
+var view = db.mv_view;
+source.drop();
+view.drop();
+db.runCommand({dropMaterializedView: view.getName()});
+
+// Only decomposable pipelines are accepted.
+assert.commandFailed(db.runCommand({createMaterializedView: view.getName(),
+                                    viewOn: source.getName(),
+                                    pipeline: [{$sort: {a: 1}}]}));
+assert.commandFailed(db.runCommand({createMaterializedView: view.getName(),
+                                    viewOn: source.getName(),
+                                    pipeline: [{$group: {_id: "$a", s: {$avg: "$b"}}}]}));
+assert.commandFailed(db.runCommand({createMaterializedView: view.getName(),
+                                    viewOn: source.getName(),
+                                    pipeline: [{$group: {_id: "$a"}}, {$match: {_id: 1}}]}));
+// View documents are stored under the _id of the final $group, so there must be one.
+assert.commandFailed(db.runCommand({createMaterializedView: view.getName(),
+                                    viewOn: source.getName(),
+                                    pipeline: [{$unwind: "$b"}]}));
+assert.commandFailed(db.runCommand({createMaterializedView: view.getName(),
+                                    viewOn: source.getName(),
+                                    pipeline: [{$project: {_id: 0, a: 1}}]}));
+
+source.insert({a: 1, b: 5});
+source.insert({a: 2, b: 1});
+source.insert({a: 1, b: 2, skip: true});
+
+assert.commandWorked(db.runCommand({
+    createMaterializedView: view.getName(),
+    viewOn: source.getName(),
+    pipeline: [{$match: {skip: {$exists: false}}},
+               {$group: {_id: "$a", total: {$sum: "$b"}, n: {$sum: 1},
+                         lo: {$min: "$b"}, hi: {$max: "$b"}}}]
+}));
+
+function checkView() {
+    var expected = source.aggregate([{$match: {skip: {$exists: false}}},
+                                     {$group: {_id: "$a", total: {$sum: "$b"}, n: {$sum: 1},
+                                               lo: {$min: "$b"}, hi: {$max: "$b"}}},
+                                     {$sort: {_id: 1}}]).toArray();
+    var actual = view.find().sort({_id: 1}).toArray();
+    assert.eq(expected.length, actual.length, tojson(actual));
+    for (var i = 0; i < expected.length; i++) {
+        // Incremental upserts don't preserve the $group field order.
+        ["_id", "total", "n", "lo", "hi"].forEach(function(field) {
+            assert.eq(expected[i][field], actual[i][field], tojson(actual[i]));
+        });
+    }
+}
+checkView();
+
+// Inserts are folded in incrementally.
+source.insert({a: 1, b: 10});
+source.insert({a: 3, b: -1});
+source.insert({a: 3, b: 7, skip: true});
+assert.commandWorked(db.runCommand({refreshMaterializedView: view.getName()}));
+checkView();
+
+// Other writes force a recomputation.
+source.remove({a: 1, b: 5});
+assert.commandWorked(db.runCommand({refreshMaterializedView: view.getName()}));
+checkView();
+
+source.update({a: 2}, {$set: {b: 100}});
+assert.commandWorked(db.runCommand({refreshMaterializedView: view.getName(), full: true}));
+checkView();
+
+assert.commandWorked(db.runCommand({dropMaterializedView: view.getName()}));
+assert.commandFailed(db.runCommand({refreshMaterializedView: view.getName()}));
+assert.eq(0, db.system.materializedViews.count({_id: view.getName()}));
@@ -0,0 +1,39 @@
+// Tests that j:true writers get commits ahead of the commit interval, that the interval goes back
+// to the configured value once nobody waits, and that acknowledged writes survive kill -9 with
+// the journal writer running ahead of the apply.
+
+var path = MongoRunner.dataPath + "group_commit";
+var options = {dbpath: path, journal: "", smallfiles: "", journalCommitInterval: 300};
+
+var conn = MongoRunner.runMongod(options);
+var coll = conn.getDB("test").group_commit;
+var adminDB = conn.getDB("admin");
+
+// Durability stats are reported for the last completed period of a few seconds, so keep the
+// j:true writes coming until one shows up.
+var nextId = 0;
+assert.soon(function() {
+    for (var i = 0; i < 20; i++) {
+        assert.writeOK(coll.insert({_id: nextId++, pad: new Array(1024).join("x")},
+                                   {writeConcern: {j: true}}));
+    }
+    return adminDB.serverStatus().dur.earlyCommits > 0;
+});
+
+// Without j:true writers the interval grows back.
+for (var i = 0; i < 100; i++) {
+    coll.insert({_id: nextId++});
+}
+assert.soon(function() {
+    var dur = adminDB.serverStatus().dur;
+    return dur.journalCommitIntervalMs == 300 && dur.adaptiveCommitIntervalMs == 300;
+});
+
+assert.writeOK(coll.insert({_id: nextId++}, {writeConcern: {j: true}}));
+
+MongoRunner.stopMongod(conn, /*signal*/9);
+
+conn = MongoRunner.runMongod(Object.extend({restart: true, cleanData: false}, options));
+coll = conn.getDB("test").group_commit;
+assert.eq(nextId, coll.count());
+MongoRunner.stopMongod(conn);
@@ -0,0 +1,86 @@
+/**
+ * This test is only for WiredTiger storageEngine
+ * Test that find and aggregate with readAtSnapshotMS see a single point in time across
+ * getMores, and that the snapshot is given up once it expires.
+ */
+
+if ( typeof(TestData) != "object" ||
+     !TestData.storageEngine ||
+     TestData.storageEngine != "wiredTiger" ) {
+    jsTestLog("Skipping test because storageEngine is not wiredTiger");
+}
+else {
+    var conn = MongoRunner.runMongod({storageEngine: "wiredTiger"});
+    var testDB = conn.getDB("test");
+    var coll = testDB.wt_read_at_snapshot;
+
+    for (var i = 0; i < 10; i++) {
+        assert.writeOK(coll.insert({_id: i, x: 0}));
+    }
+
+    function snapshotStats() {
+        return testDB.serverStatus().wiredTiger.snapshotReads;
+    }
+
+    function drain(cursor) {
+        var docs = cursor.firstBatch;
+        while (cursor.id != 0) {
+            var res = assert.commandWorked(testDB.runCommand({getMore: cursor.id,
+                                                               collection: coll.getName(),
+                                                               batchSize: 2}));
+            docs = docs.concat(res.cursor.nextBatch);
+            cursor = {id: res.cursor.id};
+        }
+        return docs;
+    }
+
+    // Writes done between getMores are not seen.
+    var res = assert.commandWorked(testDB.runCommand({find: coll.getName(),
+                                                      batchSize: 2,
+                                                      readAtSnapshotMS: 60 * 1000}));
+    assert.neq(0, res.cursor.id);
+    assert.eq(1, snapshotStats().pinned);
+
+    assert.writeOK(coll.insert({_id: 10, x: 0}));
+    assert.writeOK(coll.update({}, {$set: {x: 1}}, {multi: true}));
+
+    var docs = drain(res.cursor);
+    assert.eq(10, docs.length, tojson(docs));
+    docs.forEach(function(doc) { assert.eq(0, doc.x, tojson(doc)); });
+    assert.eq(0, snapshotStats().pinned);
+
+    // Same for aggregation cursors.
+    res = assert.commandWorked(testDB.runCommand({aggregate: coll.getName(),
+                                                  pipeline: [{$match: {}}],
+                                                  cursor: {batchSize: 2},
+                                                  readAtSnapshotMS: 60 * 1000}));
+    assert.writeOK(coll.remove({_id: {$gte: 5}}));
+    assert.eq(11, drain(res.cursor).length);
+
+    // Once the snapshot expires, getMore fails rather than reading from a newer one. The cursor
+    // may already have been timed out, in which case it fails with CursorNotFound instead.
+    res = assert.commandWorked(testDB.runCommand({find: coll.getName(),
+                                                  batchSize: 2,
+                                                  readAtSnapshotMS: 500}));
+    sleep(1000);
+    assert.commandFailed(testDB.runCommand({getMore: res.cursor.id,
+                                            collection: coll.getName()}));
+    assert.eq(0, snapshotStats().pinned);
+
+    // The lifetime is capped by a server parameter.
+    assert.commandWorked(testDB.adminCommand({setParameter: 1,
+                                              wiredTigerMaxSnapshotReadMillis: 1000}));
+    assert.commandFailed(testDB.runCommand({find: coll.getName(),
+                                            readAtSnapshotMS: 2000}));
+
+    // $out would end the snapshot with its first write, and a tailable cursor could never see
+    // anything new, so both are rejected.
+    assert.commandFailed(testDB.runCommand({aggregate: coll.getName(),
+                                            pipeline: [{$out: "wt_read_at_snapshot_out"}],
+                                            readAtSnapshotMS: 500}));
+    assert.commandFailed(testDB.runCommand({find: coll.getName(),
+                                            tailable: true,
+                                            readAtSnapshotMS: 500}));
+
+    MongoRunner.stopMongod(conn);
+}
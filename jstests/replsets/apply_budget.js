@@ -0,0 +1,47 @@
+// Tests that a secondary configured with an applyBudget reports it in replSetGetStatus, keeps
+// replicating, and that the budget can only be set on members that can't become primary.
+
+var name = "apply_budget";
+var replTest = new ReplSetTest({name: name, nodes: 2});
+var nodes = replTest.startSet();
+var config = replTest.getReplSetConfig();
+config.members[1].priority = 0;
+config.members[1].hidden = true;
+config.members[1].applyBudget = {maxLagSecs: 30, readerShare: 0.5};
+replTest.initiate(config);
+
+var primary = replTest.getMaster();
+var secondary = replTest.liveNodes.slaves[0];
+replTest.awaitSecondaryNodes();
+
+var coll = primary.getDB("test").apply_budget;
+for (var i = 0; i < 100; i++) {
+    assert.writeOK(coll.insert({_id: i}));
+}
+replTest.awaitReplication();
+assert.eq(100, secondary.getDB("test").apply_budget.find().itcount());
+
+var status = assert.commandWorked(secondary.adminCommand({replSetGetStatus: 1}));
+assert.eq(30, status.applyBudget.maxLagSecs, tojson(status));
+assert.eq(0.5, status.applyBudget.readerShare, tojson(status));
+assert.lte(status.applyBudget.currentReaderShare, 0.5, tojson(status));
+assert(!primary.adminCommand({replSetGetStatus: 1}).applyBudget);
+
+config = primary.getDB("local").system.replset.findOne();
+assert.eq(30, config.members[1].applyBudget.maxLagSecs, tojson(config));
+
+// An electable member can't have a budget.
+config.version++;
+config.members[1].priority = 1;
+config.members[1].hidden = false;
+assert.commandFailed(primary.adminCommand({replSetReconfig: config}));
+
+// Taking the budget out of the config turns it off.
+config.members[1].priority = 0;
+delete config.members[1].applyBudget;
+assert.commandWorked(primary.adminCommand({replSetReconfig: config}));
+assert.soon(function() {
+    return !secondary.adminCommand({replSetGetStatus: 1}).applyBudget;
+});
+
+replTest.stopSet();
@@ -0,0 +1,47 @@
+// Tests that initial sync copying several collections at once ends up with the same documents and
+// indexes as the primary, including collections added or dropped while it runs.
+
+var name = "initial_sync_parallel_clone";
+var replTest = new ReplSetTest({name: name, nodes: 1});
+replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var testDB = primary.getDB("test");
+
+var numColls = 10;
+for (var c = 0; c < numColls; c++) {
+    var coll = testDB["coll" + c];
+    assert.commandWorked(coll.ensureIndex({x: 1}));
+    var bulk = coll.initializeUnorderedBulkOp();
+    // Collections of different sizes, so the workers don't all finish together.
+    for (var i = 0; i < 500 * (c + 1); i++) {
+        bulk.insert({_id: i, x: i % 17, pad: new Array(100).join("x")});
+    }
+    assert.writeOK(bulk.execute());
+}
+assert.commandWorked(testDB.createCollection("capped", {capped: true, size: 4096}));
+assert.writeOK(testDB.capped.insert({a: 1}));
+
+var secondary = replTest.add({setParameter: "initialSyncCloneThreadCount=4"});
+replTest.reInitiate();
+
+assert.writeOK(testDB.coll0.insert({_id: "during sync", x: 1}));
+testDB.coll1.drop();
+
+replTest.awaitSecondaryNodes();
+replTest.awaitReplication();
+
+var secondaryDB = secondary.getDB("test");
+secondary.setSlaveOk();
+for (var c = 0; c < numColls; c++) {
+    var collName = "coll" + c;
+    assert.eq(testDB[collName].find().itcount(), secondaryDB[collName].find().itcount(), collName);
+    assert.eq(testDB[collName].getIndexes().length,
+              secondaryDB[collName].getIndexes().length,
+              collName);
+}
+assert.eq(1, secondaryDB.coll0.find({_id: "during sync"}).itcount());
+assert(secondaryDB.capped.isCapped());
+
+replTest.stopSet();
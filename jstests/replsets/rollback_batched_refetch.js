@@ -0,0 +1,60 @@
+// Tests rolling back more documents than are refetched from the sync source with a single query,
+// spread over several collections and including inserts, updates and deletes.
+
+var name = "rollback_batched_refetch";
+var replTest = new ReplSetTest({name: name, nodes: 3});
+var nodes = replTest.nodeList();
+var conns = replTest.startSet();
+replTest.initiate({_id: name,
+                   members: [{_id: 0, host: nodes[0], priority: 3},
+                             {_id: 1, host: nodes[1]},
+                             {_id: 2, host: nodes[2], arbiterOnly: true}]});
+
+replTest.waitForState(replTest.nodes[0], replTest.PRIMARY, 60 * 1000);
+var a_conn = conns[0];
+var b_conn = conns[1];
+a_conn.setSlaveOk();
+b_conn.setSlaveOk();
+var A = a_conn.getDB("test");
+var B = b_conn.getDB("test");
+var AID = replTest.getNodeId(a_conn);
+var BID = replTest.getNodeId(b_conn);
+
+var numDocs = 2500;
+["x", "y"].forEach(function(collName) {
+    var bulk = A[collName].initializeUnorderedBulkOp();
+    for (var i = 0; i < numDocs; i++) {
+        bulk.insert({_id: i, v: "common"});
+    }
+    assert.writeOK(bulk.execute({w: 2, wtimeout: 60000}));
+});
+replTest.stop(AID);
+
+// B diverges: these writes get rolled back.
+replTest.waitForState(b_conn, replTest.PRIMARY, 60 * 1000);
+assert.writeOK(B.x.update({}, {$set: {v: "rolled back"}}, {multi: true}));
+assert.writeOK(B.y.remove({_id: {$lt: numDocs / 2}}));
+var bulk = B.y.initializeUnorderedBulkOp();
+for (var i = numDocs; i < 2 * numDocs; i++) {
+    bulk.insert({_id: i, v: "rolled back"});
+}
+assert.writeOK(bulk.execute());
+replTest.stop(BID);
+
+replTest.restart(AID);
+replTest.waitForState(a_conn, replTest.PRIMARY, 60 * 1000);
+assert.writeOK(A.x.update({_id: 0}, {$set: {v: "kept"}}));
+
+replTest.restart(BID);
+replTest.awaitSecondaryNodes();
+replTest.awaitReplication();
+
+B = b_conn.getDB("test");
+b_conn.setSlaveOk();
+assert.eq(numDocs, B.x.count());
+assert.eq(0, B.x.count({v: "rolled back"}));
+assert.eq("kept", B.x.findOne({_id: 0}).v);
+assert.eq(numDocs, B.y.count());
+assert.eq(0, B.y.count({v: "rolled back"}));
+
+replTest.stopSet(15);
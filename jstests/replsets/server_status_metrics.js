@@ -10,6 +10,11 @@ function testSecondaryMetrics(secondary, opCount, offset) {
     assert(ss.metrics.repl.network.getmores.totalMillis > 0, "no getmores time")
     assert.eq(ss.metrics.repl.network.ops, opCount + offset, "wrong number of ops retrieved")
     assert(ss.metrics.repl.network.bytes > 0, "zero or missing network bytes")
+    assert(ss.metrics.repl.network.getmoresRequestedAhead >= 0, "getmoresRequestedAhead missing")
+    assert(ss.metrics.repl.network.updatePosition.sent > 0, "no position updates sent")
+    assert(ss.metrics.repl.network.updatePosition.coalesced >= 0, "coalesced updates missing")
+    assert(ss.metrics.repl.waiters.replication >= 0, "replication waiters missing")
+    assert(ss.metrics.repl.waiters.replicationWaitMillis.lt1 >= 0, "wait times missing")
 
     assert(ss.metrics.repl.buffer.count >= 0, "buffer count missing")
     assert(ss.metrics.repl.buffer.sizeBytes >= 0, "size (bytes)] missing")
@@ -23,9 +28,28 @@ function testSecondaryMetrics(secondary, opCount, offset) {
     assert(ss.metrics.repl.apply.batches.num > 0, "no batches")
     assert(ss.metrics.repl.apply.batches.totalMillis > 0, "no batch time")
     assert.eq(ss.metrics.repl.apply.ops, opCount + offset, "wrong number of applied ops")
+
+    assert(ss.metrics.repl.apply.prefetch.num >= 0, "prefetch num missing")
+    assert(ss.metrics.repl.apply.prefetchDuringApply.ops >= 0, "prefetchDuringApply ops missing")
+    assert(ss.metrics.repl.apply.prefetchDuringApply.skipped >= 0,
+           "prefetchDuringApply skipped missing")
+    assert(ss.metrics.repl.apply.oplogWrites.num > 0, "no oplog writes")
+    assert(ss.metrics.repl.apply.writers.chains > 0, "no chains applied")
+    assert(ss.metrics.repl.apply.writers.longestChainOps > 0, "no longest chain ops")
+    assert(ss.metrics.repl.apply.writers.idleMillis >= 0, "writer idle time missing")
+
+    var pipeline = ss.repl.pipeline;
+    assert(pipeline.fetch.queueOps >= 0, "fetch queue depth missing")
+    assert(pipeline.fetch.ops > 0, "nothing fetched")
+    assert(pipeline.apply.num > 0, "no batches applied")
+    assert(pipeline.apply.ops > 0, "no ops applied")
+    assert(pipeline.write.queueBatches >= 0, "write queue depth missing")
+    assert(pipeline.write.num > 0, "no batches written to the oplog")
+    assert(pipeline.write.ops > 0, "no ops written to the oplog")
 }
 
-var rt = new ReplSetTest( { name : "server_status_metrics" , nodes: 2, oplogSize: 100 } );
+var rt = new ReplSetTest( { name : "server_status_metrics" , nodes: 2, oplogSize: 100,
+                            nodeOptions: {setParameter: "replWriterThreadCount=4"} } );
 rt.startSet()
 rt.initiate()
 
@@ -55,6 +79,19 @@ assert.writeOK(testDB.a.update({}, { $set: { d: new Date() }}, options));
 
 testSecondaryMetrics(secondary, 2000, secondaryBaseOplogInserts );
 
+// Engines with document locking can prefetch a batch while applying it.
+assert.commandWorked(secondary.adminCommand({setParameter: 1, replPrefetchDuringApply: true}));
+assert.writeOK(testDB.a.update({}, { $set: { e: 1 }}, options));
+testSecondaryMetrics(secondary, 3000, secondaryBaseOplogInserts );
+var prefetchDuringApply =
+    secondary.getDB("test").serverStatus().metrics.repl.apply.prefetchDuringApply;
+if (TestData.storageEngine == "wiredTiger") {
+    assert.gt(prefetchDuringApply.ops + prefetchDuringApply.skipped, 0);
+}
+else if (!TestData.storageEngine || TestData.storageEngine == "mmapv1") {
+    assert.eq(0, prefetchDuringApply.ops + prefetchDuringApply.skipped);
+}
+
 // Test getLastError.wtime and that it only records stats for w > 1, see SERVER-9005
 var startMillis = testDB.serverStatus().metrics.getLastError.wtime.totalMillis
 var startNum = testDB.serverStatus().metrics.getLastError.wtime.num
@@ -122,6 +122,7 @@ var db;
                                                     'logpath|' +
                                                     'notablescan|' +
                                                     'collection_truncate|' + // relies on emptycapped test command which isn't in mongos
+                                                    'materialized_view|' + // materialized view commands aren't in mongos
                                                     'compact.*|' +
                                                     'check_shard_index|' +
                                                     'bench_test.*|' +
@@ -183,6 +183,15 @@ namespace mongo {
         */
         BSONObj getOwned() const;
 
+        /** make this object, which points into 'buffer', keep 'buffer' alive. this way several
+            objects in one buffer, e.g. the documents of a query reply, can share a single copy.
+        */
+        BSONObj& shareOwnershipWith(SharedBuffer buffer) {
+            dassert(!isOwned());
+            _ownedBuffer = std::move(buffer);
+            return *this;
+        }
+
         /** @return a new full (and owned) copy of the object. */
         BSONObj copy() const;
 
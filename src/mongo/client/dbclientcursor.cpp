@@ -156,18 +156,18 @@ namespace mongo {
     void DBClientCursor::requestMore() {
         verify( cursorId && batch.pos == batch.nReturned );
 
+        if (_requestedAheadId) {
+            receiveRequestedAhead();
+            return;
+        }
+
         if (haveLimit) {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
         }
-        BufBuilder b;
-        b.appendNum(opts);
-        b.appendStr(ns);
-        b.appendNum(nextBatchSize());
-        b.appendNum(cursorId);
 
         Message toSend;
-        toSend.setData(dbGetMore, b.buf(), b.len());
+        _assembleGetMore(toSend);
         auto_ptr<Message> response(new Message());
 
         if ( _client ) {
@@ -360,9 +360,54 @@ namespace mongo {
         _lazyHost = "";
     }
 
+    void DBClientCursor::_assembleGetMore(Message& toSend) {
+        BufBuilder b;
+        b.appendNum(opts);
+        b.appendStr(ns);
+        b.appendNum(nextBatchSize());
+        b.appendNum(cursorId);
+        toSend.setData(dbGetMore, b.buf(), b.len());
+    }
+
+    bool DBClientCursor::requestMoreAhead() {
+        if (!_client || !cursorId || haveLimit || _requestedAheadId) {
+            return false;
+        }
+
+        Message toSend;
+        _assembleGetMore(toSend);
+        _client->say(toSend);
+        _requestedAheadId = toSend.header().getId();
+        return true;
+    }
+
+    void DBClientCursor::receiveRequestedAhead() {
+        const MSGID requestId = _requestedAheadId;
+        _requestedAheadId = 0;
+
+        auto_ptr<Message> response(new Message());
+        uassert(28724,
+                str::stream() << "error receiving the next batch of cursor " << cursorId
+                              << " from " << _originalHost,
+                _client->recv(*response));
+        massert(28725,
+                str::stream() << "reply to getMore " << requestId << " expected, got a reply to "
+                              << response->header().getResponseTo(),
+                response->header().getResponseTo() == requestId);
+        batch.m = response;
+        dataReceived();
+    }
+
     DBClientCursor::~DBClientCursor() {
         DESTRUCTOR_GUARD (
 
+        if (_requestedAheadId && !inShutdown()) {
+            // The reply is on its way; read it so the connection can be used again.
+            Message discarded;
+            _requestedAheadId = 0;
+            _client->recv(discarded);
+        }
+
         if ( cursorId && _ownCursor && ! inShutdown() ) {
             BufBuilder b;
             b.appendNum( (int)0 ); // reserved
@@ -135,6 +135,15 @@ namespace mongo {
         /// Change batchSize after construction. Can change after requesting first batch.
         void setBatchSize(int newBatchSize) { batchSize = newBatchSize; }
 
+        /**
+         * Sends the getMore for the batch after the current one without waiting for the reply,
+         * which the next requestMore() reads instead of sending its own request. This hides the
+         * round trip while the current batch is processed. Only for cursors on a
+         * DBClientConnection; nothing else may be sent on the connection until the reply is read.
+         * Returns false if there is nothing to request.
+         */
+        bool requestMoreAhead();
+
         DBClientCursor( DBClientBase* client, const std::string &_ns, BSONObj _query, int _nToReturn,
                         int _nToSkip, const BSONObj *_fieldsToReturn, int queryOptions , int bs ) :
             _client(client),
@@ -149,7 +158,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(),
             _ownCursor( true ),
-            wasError( false ) {
+            wasError( false ),
+            _requestedAheadId(0) {
             _finishConsInit();
         }
 
@@ -165,7 +175,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(_cursorId),
             _ownCursor(true),
-            wasError(false) {
+            wasError(false),
+            _requestedAheadId(0) {
             _finishConsInit();
         }
 
@@ -239,10 +250,12 @@ namespace mongo {
         std::string _scopedHost;
         std::string _lazyHost;
         bool wasError;
+        MSGID _requestedAheadId; // the outstanding getMore, see requestMoreAhead()
 
         void dataReceived() { bool retry; std::string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, std::string& lazyHost );
         void requestMore();
+        void receiveRequestedAhead();
         void exhaustReceiveMore(); // for exhaust
 
         // Don't call from a virtual function
@@ -254,6 +267,7 @@ namespace mongo {
 
         // init pieces
         void _assembleInit( Message& toSend );
+        void _assembleGetMore( Message& toSend );
     };
 
     /** iterate over objects in current batch only - will not cause a network call
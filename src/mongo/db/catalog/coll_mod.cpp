@@ -136,6 +136,22 @@ namespace mongo {
                 if (!status.isOK())
                     errorStatus = std::move(status);
             }
+            else if (str::equals("compression", e.fieldName())) {
+                Status status = CollectionOptions::validateCompression(e, false);
+                if (!status.isOK()) {
+                    errorStatus = status;
+                    continue;
+                }
+
+                // Only recorded here. The storage engine applies it when the collection is next
+                // rebuilt, for example by an initial sync or a restore.
+                CollectionCatalogEntry* cce = coll->getCatalogEntry();
+                const std::string oldCompression = cce->getCollectionOptions(txn).compression;
+                result->append("compression_old", oldCompression.empty() ? "default"
+                                                                         : oldCompression);
+                result->append("compression_new", e.str());
+                cce->updateCompression(txn, e.str());
+            }
             else {
                 // As of SERVER-17312 we only support these two options. When SERVER-17320 is
                 // resolved this will need to be enhanced to handle other options.
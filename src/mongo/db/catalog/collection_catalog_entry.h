@@ -112,6 +112,12 @@ namespace mongo {
          */
         virtual void updateValidator(OperationContext* txn, const BSONObj& validator) = 0;
 
+        /**
+         * Updates the compression setting recorded for this collection. Data already written
+         * keeps its compression until the collection is rebuilt.
+         */
+        virtual void updateCompression(OperationContext* txn, const std::string& compression) = 0;
+
     private:
         NamespaceString _ns;
     };
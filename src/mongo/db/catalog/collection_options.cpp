@@ -50,6 +50,27 @@ namespace mongo {
         return false;
     }
 
+    // static
+    Status CollectionOptions::validateCompression( const BSONElement& compression,
+                                                   bool forIndex ) {
+        if ( compression.type() != mongo::String ) {
+            return Status( ErrorCodes::BadValue, "'compression' has to be a string." );
+        }
+
+        const StringData value = compression.valueStringData();
+        if ( value == "none" || value == "snappy" || value == "zlib" ) {
+            return Status::OK();
+        }
+        if ( forIndex && value == "prefix" ) {
+            return Status::OK();
+        }
+
+        return Status( ErrorCodes::BadValue,
+                       str::stream() << "unknown compression '" << value << "', must be one of "
+                                     << ( forIndex ? "none, snappy, zlib or prefix"
+                                                   : "none, snappy or zlib" ) );
+    }
+
     void CollectionOptions::reset() {
         capped = false;
         cappedSize = 0;
@@ -64,6 +85,7 @@ namespace mongo {
         temp = false;
         storageEngine = BSONObj();
         validator = BSONObj();
+        compression.clear();
     }
 
     bool CollectionOptions::isValid() const {
@@ -171,6 +193,14 @@ namespace mongo {
 
                 validator = e.Obj().getOwned();
             }
+            else if (fieldName == "compression") {
+                Status status = validateCompression(e, false);
+                if (!status.isOK()) {
+                    return status;
+                }
+
+                compression = e.str();
+            }
         }
 
         return Status::OK();
@@ -208,6 +238,10 @@ namespace mongo {
             b.append("validator", validator);
         }
 
+        if (!compression.empty()) {
+            b.append("compression", compression);
+        }
+
         return b.obj();
     }
 
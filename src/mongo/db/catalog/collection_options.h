@@ -65,6 +65,12 @@ namespace mongo {
          */
         static bool validMaxCappedDocs( long long* max );
 
+        /**
+         * Checks a value of the 'compression' option: "none", "snappy" or "zlib", or for indexes
+         * also "prefix", which compresses only the common leading bytes of adjacent keys.
+         */
+        static Status validateCompression( const BSONElement& compression, bool forIndex );
+
         // ----
 
         bool capped;
@@ -98,6 +104,9 @@ namespace mongo {
 
         // Always owned or empty.
         BSONObj validator;
+
+        // Empty to use the storage engine's default. Engines without compression ignore it.
+        std::string compression;
     };
 
 }
@@ -87,6 +87,23 @@ namespace mongo {
         ASSERT(!options.toBSON()["validator"]);
     }
 
+    TEST(CollectionOptions, Compression) {
+        CollectionOptions options;
+
+        ASSERT_NOT_OK(options.parse(fromjson("{compression: 1}")));
+        ASSERT_NOT_OK(options.parse(fromjson("{compression: 'lz4'}")));
+        // Prefix compression only applies to index keys.
+        ASSERT_NOT_OK(options.parse(fromjson("{compression: 'prefix'}")));
+
+        ASSERT_OK(options.parse(fromjson("{compression: 'zlib'}")));
+        ASSERT_EQ(options.compression, "zlib");
+        ASSERT_EQ(options.toBSON()["compression"].str(), "zlib");
+
+        options.reset();
+        ASSERT_EQ(options.compression, "");
+        ASSERT(!options.toBSON()["compression"]);
+    }
+
     TEST( CollectionOptions, ErrorBadSize ) {
         ASSERT_NOT_OK( CollectionOptions().parse( fromjson( "{capped: true, size: -1}" ) ) );
         ASSERT_NOT_OK( CollectionOptions().parse( fromjson( "{capped: false, size: -1}" ) ) );
@@ -610,6 +610,15 @@ namespace {
             }
         }
 
+        BSONElement compressionElement = spec.getField("compression");
+        if (!compressionElement.eoo()) {
+            Status compressionStatus = CollectionOptions::validateCompression(compressionElement,
+                                                                              true);
+            if (!compressionStatus.isOK()) {
+                return Status(ErrorCodes::CannotCreateIndex, compressionStatus.reason());
+            }
+        }
+
         // --- only storage engine checks allowed below this ----
 
         BSONElement storageEngineElement = spec.getField("storageEngine");
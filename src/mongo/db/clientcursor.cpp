@@ -171,7 +171,14 @@ namespace mongo {
 
     bool ClientCursor::shouldTimeout(int millis) {
         _idleAgeMillis += millis;
-        if (_isNoTimeout || _isPinned) {
+        if (_isPinned) {
+            return false;
+        }
+        // Don't let an abandoned cursor hold its snapshot, and the history behind it, open.
+        if (_ownedRU.get() && _ownedRU->isReadAtSnapshotExpired()) {
+            return true;
+        }
+        if (_isNoTimeout) {
             return false;
         }
         return _idleAgeMillis > cursorTimeoutMillis;
@@ -34,18 +34,28 @@
 
 #include "mongo/db/cloner.h"
 
+#include <algorithm>
+#include <boost/make_shared.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
 
 #include "mongo/base/status.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
+#include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/internal_user_auth.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/document_validation.h"
 #include "mongo/db/catalog/index_create.h"
+#include "mongo/db/client.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/copydb.h"
 #include "mongo/db/commands/rename_collection.h"
@@ -57,6 +67,7 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/op_observer.h"
+#include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/isself.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/server_parameters.h"
@@ -64,6 +75,7 @@
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -116,27 +128,237 @@ namespace mongo {
 
     Cloner::Cloner() { }
 
+namespace {
+
+    // Documents inserted per WriteUnitOfWork while copying a collection.
+    const size_t kInsertGroupSize = 128;
+
+    const unsigned long long kProgressLogIntervalMillis = 60 * 1000;
+
+    Status createCollectionForClone(OperationContext* txn,
+                                    Database* db,
+                                    const NamespaceString& ns,
+                                    const BSONObj& options) {
+        MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+            WriteUnitOfWork wunit(txn);
+
+            // we defer building id index for performance - building it in batch is much
+            // faster
+            Status createStatus = userCreateNS(txn, db, ns.ns(), options, false);
+            if (!createStatus.isOK()) {
+                return createStatus;
+            }
+            wunit.commit();
+        } MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createUser", ns.ns());
+        return Status::OK();
+    }
+
+    /**
+     * Builds the _id index of a collection that was copied without one, dropping documents with
+     * duplicate _ids.
+     */
+    void buildIdIndexAfterClone(OperationContext* txn, Collection* c, bool mayBeInterrupted) {
+        if (c->getIndexCatalog()->haveIdIndex(txn)) {
+            return;
+        }
+
+        // We need to drop objects with duplicate _ids because we didn't do a true
+        // snapshot and this is before applying oplog operations that occur during the
+        // initial sync.
+        set<RecordId> dups;
+
+        MultiIndexBlock indexer(txn, c);
+        if (mayBeInterrupted)
+            indexer.allowInterruption();
+
+        uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
+        uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
+
+        // This must be done before we commit the indexer. See the comment about
+        // dupsAllowed in IndexCatalog::_unindexRecord and SERVER-17487.
+        for (set<RecordId>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
+            WriteUnitOfWork wunit(txn);
+            BSONObj id;
+
+            c->deleteDocument(txn,
+                              *it,
+                              true,
+                              true,
+                              txn->writesAreReplicated() ? &id : nullptr);
+            wunit.commit();
+        }
+
+        if (!dups.empty()) {
+            log() << "index build dropped: " << dups.size() << " dups";
+        }
+
+        WriteUnitOfWork wunit(txn);
+        indexer.commit();
+        if (txn->writesAreReplicated()) {
+            getGlobalServiceContext()->getOpObserver()->onCreateIndex(
+                    txn,
+                    c->ns().getSystemIndexesCollection().c_str(),
+                    c->getIndexCatalog()->getDefaultIdIndexSpec());
+        }
+        wunit.commit();
+    }
+
+} // namespace
+
+    /**
+     * How far the copy of a database has got, for the progress log lines, and the first error hit
+     * by the workers of a parallel clone so that the others can stop early.
+     */
+    class Cloner::Progress {
+        MONGO_DISALLOW_COPYING(Progress);
+    public:
+        /**
+         * 'totalBytes' is the size of the source collections, or 0 if unknown, in which case no
+         * estimate of the time left is logged.
+         */
+        Progress(const string& dbName, size_t numCollections, long long totalBytes)
+            : _dbName(dbName),
+              _numCollections(numCollections),
+              _totalBytes(totalBytes),
+              _startMillis(curTimeMillis64()),
+              _lastLogMillis(_startMillis),
+              _collectionsDone(0),
+              _docs(0),
+              _bytes(0),
+              _status(Status::OK()),
+              _failed(false) {}
+
+        void addDocuments(long long docs, long long bytes) {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            _docs += docs;
+            _bytes += bytes;
+
+            const unsigned long long now = curTimeMillis64();
+            if (now - _lastLogMillis >= kProgressLogIntervalMillis) {
+                _lastLogMillis = now;
+                _log_inlock(now);
+            }
+        }
+
+        void collectionDone(const NamespaceString& ns) {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            _collectionsDone++;
+            log() << "clone " << _dbName << ": finished " << ns;
+            _log_inlock(curTimeMillis64());
+        }
+
+        /**
+         * Records 'status' unless an earlier failure was recorded already.
+         */
+        void fail(const Status& status) {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            if (!_failed.load()) {
+                _status = status;
+                _failed.store(true);
+            }
+        }
+
+        bool failed() const {
+            return _failed.load();
+        }
+
+        Status getStatus() const {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            return _status;
+        }
+
+    private:
+        void _log_inlock(unsigned long long now) const {
+            LogstreamBuilder out = log();
+            out << "clone " << _dbName << ": " << _collectionsDone << " of " << _numCollections
+                << " collections, " << _docs << " documents, " << _bytes / (1024 * 1024) << "MB";
+            if (_totalBytes <= 0 || _bytes <= 0) {
+                return;
+            }
+
+            out << " of " << _totalBytes / (1024 * 1024) << "MB ("
+                << std::min(100LL, _bytes * 100 / _totalBytes) << "%)";
+
+            // Documents written to the source since its size was read can take the copy past it.
+            const long long elapsedMillis = now - _startMillis;
+            const long long bytesLeft = std::max(0LL, _totalBytes - _bytes);
+            out << ", about " << static_cast<long long>(
+                    static_cast<double>(bytesLeft) * elapsedMillis / _bytes / 1000)
+                << " seconds left";
+        }
+
+        const string _dbName;
+        const size_t _numCollections;
+        const long long _totalBytes;
+        const unsigned long long _startMillis;
+
+        // Protects everything below, and is held while logging so that progress lines from
+        // different workers don't interleave.
+        mutable boost::mutex _mutex;
+        unsigned long long _lastLogMillis;
+        size_t _collectionsDone;
+        long long _docs;
+        long long _bytes;
+        Status _status;
+
+        // Set once _status holds an error. Read without the mutex by the copying workers.
+        AtomicWord<bool> _failed;
+    };
+
     struct Cloner::Fun {
         Fun(OperationContext* txn, const string& dbName)
             :lastLog(0),
              txn(txn),
-             _dbName(dbName)
+             _dbName(dbName),
+             _parallel(false),
+             _progress(NULL)
         {}
 
+        /**
+         * The locks held while inserting into the target collection. The copies of a parallel
+         * clone only take an intent lock on the database, so they can insert at the same time.
+         */
+        class WriteLocks {
+            MONGO_DISALLOW_COPYING(WriteLocks);
+        public:
+            WriteLocks(OperationContext* txn, const NamespaceString& ns, bool parallel)
+                : _transaction(txn, parallel ? MODE_IX : MODE_X) {
+                if (parallel) {
+                    _dbLock.reset(new Lock::DBLock(txn->lockState(), ns.db(), MODE_IX));
+                    _collectionLock.reset(
+                            new Lock::CollectionLock(txn->lockState(), ns.ns(), MODE_X));
+                }
+                else {
+                    // XXX: can probably take dblock instead
+                    _globalWriteLock.reset(new Lock::GlobalWrite(txn->lockState()));
+                }
+            }
+
+        private:
+            ScopedTransaction _transaction;
+            scoped_ptr<Lock::GlobalWrite> _globalWriteLock;
+            scoped_ptr<Lock::DBLock> _dbLock;
+            scoped_ptr<Lock::CollectionLock> _collectionLock;
+        };
+
         void operator()( DBClientCursorBatchIterator &i ) {
             invariant(from_collection.coll() != "system.indexes");
 
-            // XXX: can probably take dblock instead
-            scoped_ptr<ScopedTransaction> scopedXact(new ScopedTransaction(txn, MODE_X));
-            scoped_ptr<Lock::GlobalWrite> globalWriteLock(new Lock::GlobalWrite(txn->lockState()));
+            scoped_ptr<WriteLocks> locks(new WriteLocks(txn, to_collection, _parallel));
             uassert(ErrorCodes::NotMaster,
                     str::stream() << "Not primary while cloning collection " << from_collection.ns()
                                   << " to " << to_collection.ns(),
                     !txn->writesAreReplicated() ||
                     repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(_dbName));
 
-            // Make sure database still exists after we resume from the temp release
-            Database* db = dbHolder().openDb(txn, _dbName);
+            // Make sure database still exists after we resume from the temp release. A parallel
+            // clone creates the database and its collections before starting the copies, and
+            // can't create anything under its intent lock.
+            Database* db = _parallel ? dbHolder().get(txn, _dbName)
+                                     : dbHolder().openDb(txn, _dbName);
+            uassert(28720,
+                    str::stream() << "Database " << _dbName << " dropped while cloning",
+                    db != NULL);
 
             bool createdCollection = false;
             Collection* collection = NULL;
@@ -147,7 +369,7 @@ namespace mongo {
                          str::stream()
                          << "collection dropped during clone ["
                          << to_collection.ns() << "]",
-                         !createdCollection );
+                         !createdCollection && !_parallel );
                 MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
                     WriteUnitOfWork wunit(txn);
                     collection = db->createCollection(txn, to_collection.ns(), CollectionOptions());
@@ -156,85 +378,107 @@ namespace mongo {
                 } MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createCollection", to_collection.ns());
             }
 
+            // The target collection has no indexes yet, so documents go in without any index
+            // maintenance, a group per WriteUnitOfWork.
+            vector<BSONObj> docs;
+            docs.reserve(kInsertGroupSize);
             while( i.moreInCurrentBatch() ) {
-                if ( numSeen % 128 == 127 ) {
-                    time_t now = time(0);
-                    if( now - lastLog >= 60 ) {
-                        // report progress
-                        if( lastLog )
-                            log() << "clone " << to_collection << ' ' << numSeen << endl;
-                        lastLog = now;
-                    }
-
-                    if (_mayBeInterrupted) {
-                        txn->checkForInterrupt();
-                    }
-
-                    if (_mayYield) {
-                        scopedXact.reset();
-                        globalWriteLock.reset();
-
-                        txn->getCurOp()->yielded();
-
-                        scopedXact.reset(new ScopedTransaction(txn, MODE_X));
-                        globalWriteLock.reset(new Lock::GlobalWrite(txn->lockState()));
-
-                        // Check if everything is still all right.
-                        if (txn->writesAreReplicated()) {
-                            uassert(28592,
-                                    str::stream() << "Cannot write to db: " << _dbName
-                                                  << " after yielding",
-                                    repl::getGlobalReplicationCoordinator()->
-                                        canAcceptWritesForDatabase(_dbName));
+                docs.clear();
+                long long bytes = 0;
+                while (docs.size() < kInsertGroupSize && i.moreInCurrentBatch()) {
+                    BSONObj tmp = i.nextSafe();
+
+                    /* assure object is valid.  note this will slow us down a little. */
+                    const Status status = validateBSON(tmp.objdata(), tmp.objsize());
+                    if (!status.isOK()) {
+                        str::stream ss;
+                        ss << "Cloner: found corrupt document in " << from_collection.toString()
+                              << ": " << status.reason();
+                        if (skipCorruptDocumentsWhenCloning) {
+                            warning() << ss.ss.str() << "; skipping";
+                            continue;
                         }
-
-                        // TODO: SERVER-16598 abort if original db or collection is gone.
-                        db = dbHolder().get(txn, _dbName);
-                        uassert(28593,
-                                str::stream() << "Database " << _dbName
-                                              << " dropped while cloning",
-                                db != NULL);
-
-                        collection = db->getCollection(to_collection);
-                        uassert(28594,
-                                str::stream() << "Collection " << to_collection.ns()
-                                              << " dropped while cloning",
-                                collection != NULL);
+                        msgasserted(28531, ss);
                     }
-                }
 
-                BSONObj tmp = i.nextSafe();
-
-                /* assure object is valid.  note this will slow us down a little. */
-                const Status status = validateBSON(tmp.objdata(), tmp.objsize());
-                if (!status.isOK()) {
-                    str::stream ss;
-                    ss << "Cloner: found corrupt document in " << from_collection.toString()
-                          << ": " << status.reason();
-                    if (skipCorruptDocumentsWhenCloning) {
-                        warning() << ss.ss.str() << "; skipping";
-                        continue;
-                    }
-                    msgasserted(28531, ss);
+                    docs.push_back(tmp);
+                    bytes += tmp.objsize();
                 }
 
-                ++numSeen;
                 MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
                     WriteUnitOfWork wunit(txn);
 
-                    BSONObj doc = tmp;
-                    StatusWith<RecordId> loc = collection->insertDocument( txn, doc, true );
-                    if ( !loc.isOK() ) {
-                        error() << "error: exception cloning object in " << from_collection
-                                << ' ' << loc.getStatus() << " obj:" << doc;
+                    for (vector<BSONObj>::const_iterator it = docs.begin();
+                            it != docs.end(); ++it) {
+                        StatusWith<RecordId> loc = collection->insertDocument( txn, *it, true );
+                        if ( !loc.isOK() ) {
+                            error() << "error: exception cloning object in " << from_collection
+                                    << ' ' << loc.getStatus() << " obj:" << *it;
+                        }
+                        uassertStatusOK( loc.getStatus() );
                     }
-                    uassertStatusOK( loc.getStatus() );
                     wunit.commit();
                 } MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "cloner insert", to_collection.ns());
+
+                numSeen += docs.size();
+                if (_progress) {
+                    _progress->addDocuments(docs.size(), bytes);
+                }
                 RARELY if ( time( 0 ) - saveLast > 60 ) {
                     log() << numSeen << " objects cloned so far from collection " << from_collection;
                     saveLast = time( 0 );
                 }
+
+                if (!i.moreInCurrentBatch()) {
+                    break;
+                }
+
+                time_t now = time(0);
+                if( now - lastLog >= 60 ) {
+                    // report progress
+                    if( lastLog )
+                        log() << "clone " << to_collection << ' ' << numSeen << endl;
+                    lastLog = now;
+                }
+
+                if (_mayBeInterrupted) {
+                    txn->checkForInterrupt();
+                }
+
+                uassert(28719,
+                        str::stream() << "Stopped cloning " << to_collection.ns()
+                                      << " because the clone of another collection failed",
+                        !_progress || !_progress->failed());
+
+                if (_mayYield) {
+                    locks.reset();
+
+                    txn->getCurOp()->yielded();
+
+                    locks.reset(new WriteLocks(txn, to_collection, _parallel));
+
+                    // Check if everything is still all right.
+                    if (txn->writesAreReplicated()) {
+                        uassert(28592,
+                                str::stream() << "Cannot write to db: " << _dbName
+                                              << " after yielding",
+                                repl::getGlobalReplicationCoordinator()->
+                                    canAcceptWritesForDatabase(_dbName));
+                    }
+
+                    // TODO: SERVER-16598 abort if original db or collection is gone.
+                    db = dbHolder().get(txn, _dbName);
+                    uassert(28593,
+                            str::stream() << "Database " << _dbName
+                                          << " dropped while cloning",
+                            db != NULL);
+
+                    collection = db->getCollection(to_collection);
+                    uassert(28594,
+                            str::stream() << "Collection " << to_collection.ns()
+                                          << " dropped while cloning",
+                            collection != NULL);
+                }
             }
         }
 
@@ -248,6 +492,12 @@ namespace mongo {
         time_t saveLast;
         bool _mayYield;
         bool _mayBeInterrupted;
+
+        // Copy of one of the collections of a parallel clone, see WriteLocks.
+        bool _parallel;
+
+        // Not owned, may be NULL.
+        Progress* _progress;
     };
 
     /* copy the specified collection
@@ -260,7 +510,8 @@ namespace mongo {
                       bool slaveOk,
                       bool mayYield,
                       bool mayBeInterrupted,
-                      Query query) {
+                      Query query,
+                      Progress* progress) {
         LOG(2) << "\t\tcloning collection " << from_collection << " to " << to_collection << " on " << _conn->getServerAddress() << " with filter " << query.toString() << endl;
 
         Fun f(txn, toDBName);
@@ -270,6 +521,7 @@ namespace mongo {
         f.saveLast = time( 0 );
         f._mayYield = mayYield;
         f._mayBeInterrupted = mayBeInterrupted;
+        f._progress = progress;
 
         int options = QueryOption_NoCursorTimeout | ( slaveOk ? QueryOption_SlaveOk : 0 );
         {
@@ -286,6 +538,88 @@ namespace mongo {
                 repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(toDBName));
     }
 
+    void Cloner::copyCollectionsWorker(int workerId,
+                                       const ConnectionString& cs,
+                                       const string& toDBName,
+                                       const CloneOptions& opts,
+                                       bool writesAreReplicated,
+                                       bool validationDisabled,
+                                       const vector<BSONObj>& toClone,
+                                       AtomicUInt32* nextCollection,
+                                       Progress* progress) {
+        const string threadName = str::stream() << "clone " << toDBName << " worker " << workerId;
+        Client::initThread(threadName.c_str());
+        AuthorizationSession::get(cc())->grantInternalAuthorization();
+
+        try {
+            string errmsg;
+            scoped_ptr<DBClientBase> conn(cs.connect(errmsg));
+            uassert(ErrorCodes::HostUnreachable, errmsg, conn);
+            uassert(ErrorCodes::AuthenticationFailed,
+                    str::stream() << "failed to authenticate to " << cs.toString(),
+                    !getGlobalAuthorizationManager()->isAuthEnabled() ||
+                    authenticateInternalUser(conn.get()));
+
+            OperationContextImpl txn;
+            txn.setReplicatedWrites(writesAreReplicated);
+            documentValidationDisabled(&txn) = validationDisabled;
+
+            while (!progress->failed()) {
+                const unsigned i = nextCollection->fetchAndAdd(1);
+                if (i >= toClone.size()) {
+                    break;
+                }
+
+                const char* collectionName = toClone[i]["name"].valuestr();
+                const NamespaceString from_name(opts.fromDB, collectionName);
+                const NamespaceString to_name(toDBName, collectionName);
+                LOG(1) << "\t\t cloning " << from_name << " -> " << to_name;
+
+                Fun f(&txn, toDBName);
+                f.numSeen = 0;
+                f.from_collection = from_name;
+                f.to_collection = to_name;
+                f.saveLast = time(0);
+                f._mayYield = opts.mayYield;
+                f._mayBeInterrupted = opts.mayBeInterrupted;
+                f._parallel = true;
+                f._progress = progress;
+
+                Query q;
+                if (opts.snapshot)
+                    q.snapshot();
+                conn->query(stdx::function<void(DBClientCursorBatchIterator &)>(f), from_name,
+                            q, 0,
+                            QueryOption_NoCursorTimeout |
+                                (opts.slaveOk ? QueryOption_SlaveOk : 0));
+
+                // Building an index changes the database catalog, which needs the database lock
+                // even on engines with collection locking. The other workers keep fetching
+                // meanwhile.
+                {
+                    ScopedTransaction transaction(&txn, MODE_IX);
+                    Lock::DBLock dbLock(txn.lockState(), toDBName, MODE_X);
+
+                    Database* db = dbHolder().get(&txn, toDBName);
+                    uassert(28722,
+                            str::stream() << "database " << toDBName << " dropped during clone",
+                            db);
+                    Collection* c = db->getCollection(to_name);
+                    uassert(28721,
+                            str::stream() << "Collection " << to_name.ns()
+                                          << " dropped while cloning",
+                            c);
+                    buildIdIndexAfterClone(&txn, c, opts.mayBeInterrupted);
+                }
+
+                progress->collectionDone(to_name);
+            }
+        }
+        catch (const DBException& e) {
+            progress->fail(e.toStatus());
+        }
+    }
+
     void Cloner::copyIndexes(OperationContext* txn,
                              const string& toDBName,
                              const NamespaceString& from_collection,
@@ -408,7 +742,7 @@ namespace mongo {
         copy(txn, dbname,
              nss, nss,
              false, true, mayYield, mayBeInterrupted,
-             Query(query).snapshot());
+             Query(query).snapshot(), NULL);
 
         /* TODO : copyIndexes bool does not seem to be implemented! */
         if(!shouldCopyIndexes) {
@@ -491,6 +825,8 @@ namespace mongo {
 
         // Gather the list of collections to clone
         list<BSONObj> toClone;
+        std::map<string, long long> sourceSizes;
+        long long totalBytes = 0;
         if (clonedColls) {
             clonedColls->clear();
         }
@@ -552,6 +888,17 @@ namespace mongo {
                 }
 
                 toClone.push_back( collection.getOwned() );
+
+                // Only used for the progress estimates, so failing to get it is fine.
+                BSONObj stats;
+                if (opts.syncData &&
+                    _conn->runCommand(opts.fromDB,
+                                      BSON("collStats" << ns.coll()),
+                                      stats,
+                                      opts.slaveOk ? QueryOption_SlaveOk : 0)) {
+                    sourceSizes[ns.coll().toString()] = stats["size"].safeNumberLong();
+                    totalBytes += stats["size"].safeNumberLong();
+                }
             }
         }
 
@@ -562,6 +909,9 @@ namespace mongo {
                 repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(toDBName));
 
         if ( opts.syncData ) {
+            Progress progress(toDBName, toClone.size(), totalBytes);
+            const bool parallel = opts.cloneThreads > 1 && toClone.size() > 1 && !masterSameProcess;
+
             for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ) {
                 BSONObj collection = *i;
                 LOG(2) << "  really will clone: " << collection << endl;
@@ -573,23 +923,18 @@ namespace mongo {
 
                 Database* db = dbHolder().openDb(txn, toDBName);
 
-                {
-                    MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
-                        WriteUnitOfWork wunit(txn);
-
-                        // we defer building id index for performance - building it in batch is much
-                        // faster
-                        Status createStatus = userCreateNS(txn, db, to_name.ns(), options, false);
-                        if ( !createStatus.isOK() ) {
-                            errmsg = str::stream() << "failed to create collection \""
-                                                   << to_name.ns() << "\": "
-                                                   << createStatus.reason();
-                            return false;
-                        }
-                        wunit.commit();
-                    } MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createUser", to_name.ns());
+                Status createStatus = createCollectionForClone(txn, db, to_name, options);
+                if ( !createStatus.isOK() ) {
+                    errmsg = str::stream() << "failed to create collection \""
+                                           << to_name.ns() << "\": "
+                                           << createStatus.reason();
+                    return false;
                 }
 
+                // A parallel clone creates all the collections first, see below.
+                if (parallel)
+                    continue;
+
                 LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
                 Query q;
                 if( opts.snapshot )
@@ -603,7 +948,8 @@ namespace mongo {
                      opts.slaveOk,
                      opts.mayYield,
                      opts.mayBeInterrupted,
-                     q);
+                     q,
+                     &progress);
 
                 // Copy releases the lock, so we need to re-load the database. This should
                 // probably throw if the database has changed in between, but for now preserve
@@ -614,47 +960,65 @@ namespace mongo {
                         db);
 
                 Collection* c = db->getCollection( to_name );
-                if ( c && !c->getIndexCatalog()->haveIdIndex( txn ) ) {
-                    // We need to drop objects with duplicate _ids because we didn't do a true
-                    // snapshot and this is before applying oplog operations that occur during the
-                    // initial sync.
-                    set<RecordId> dups;
-
-                    MultiIndexBlock indexer(txn, c);
-                    if (opts.mayBeInterrupted)
-                        indexer.allowInterruption();
-
-                    uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
-                    uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
-
-                    // This must be done before we commit the indexer. See the comment about
-                    // dupsAllowed in IndexCatalog::_unindexRecord and SERVER-17487.
-                    for (set<RecordId>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
-                        WriteUnitOfWork wunit(txn);
-                        BSONObj id;
-
-                        c->deleteDocument(txn,
-                                          *it,
-                                          true,
-                                          true,
-                                          txn->writesAreReplicated() ? &id : nullptr);
-                        wunit.commit();
-                    }
+                if ( c ) {
+                    buildIdIndexAfterClone(txn, c, opts.mayBeInterrupted);
+                }
+                progress.collectionDone(to_name);
+            }
 
-                    if (!dups.empty()) {
-                        log() << "index build dropped: " << dups.size() << " dups";
+            if (parallel) {
+                // Start with the biggest collections so that a large one copied last doesn't
+                // leave the other workers idle.
+                vector<BSONObj> ordered(toClone.begin(), toClone.end());
+                std::stable_sort(ordered.begin(), ordered.end(),
+                                 [&sourceSizes](const BSONObj& a, const BSONObj& b) {
+                                     return sourceSizes[a["name"].str()] >
+                                            sourceSizes[b["name"].str()];
+                                 });
+
+                const int numThreads = std::min(opts.cloneThreads,
+                                                static_cast<int>(ordered.size()));
+                log() << "clone " << toDBName << ": copying " << ordered.size()
+                      << " collections with " << numThreads << " threads";
+
+                AtomicUInt32 nextCollection;
+                {
+                    // The workers lock the database themselves.
+                    Lock::TempRelease tempRelease(txn->lockState());
+                    massert(28723,
+                            str::stream() << "can't clone " << toDBName << " in parallel while "
+                                          << "holding locks recursively",
+                            !txn->lockState()->isLocked());
+
+                    const bool writesAreReplicated = txn->writesAreReplicated();
+                    const bool validationDisabled = documentValidationDisabled(txn);
+                    std::vector<boost::shared_ptr<boost::thread> > workers;
+                    for (int i = 0; i < numThreads; i++) {
+                        workers.push_back(boost::make_shared<boost::thread>([&, i]() {
+                            copyCollectionsWorker(i, cs, toDBName, opts, writesAreReplicated,
+                                                  validationDisabled, ordered, &nextCollection,
+                                                  &progress);
+                        }));
                     }
-
-                    WriteUnitOfWork wunit(txn);
-                    indexer.commit();
-                    if (txn->writesAreReplicated()) {
-                        getGlobalServiceContext()->getOpObserver()->onCreateIndex(
-                                txn,
-                                c->ns().getSystemIndexesCollection().c_str(),
-                                c->getIndexCatalog()->getDefaultIdIndexSpec());
+                    for (size_t i = 0; i < workers.size(); i++) {
+                        workers[i]->join();
                     }
-                    wunit.commit();
                 }
+
+                Status status = progress.getStatus();
+                if (!status.isOK()) {
+                    errmsg = str::stream() << "failed to clone " << toDBName << ": "
+                                           << status.toString();
+                    if (errCode)
+                        *errCode = status.code();
+                    return false;
+                }
+
+                uassert(ErrorCodes::NotMaster,
+                        str::stream() << "Not primary while cloning database " << opts.fromDB,
+                        !txn->writesAreReplicated() ||
+                        repl::getGlobalReplicationCoordinator()->
+                            canAcceptWritesForDatabase(toDBName));
             }
         }
 
@@ -30,8 +30,11 @@
 
 #pragma once
 
+#include <vector>
+
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 
@@ -68,6 +71,9 @@ namespace mongo {
                             bool copyIndexes = true);
 
     private:
+        class Progress;
+        struct Fun;
+
         void copy(OperationContext* txn,
                   const std::string& toDBName,
                   const NamespaceString& from_ns,
@@ -76,7 +82,8 @@ namespace mongo {
                   bool slaveOk,
                   bool mayYield,
                   bool mayBeInterrupted,
-                  Query q);
+                  Query q,
+                  Progress* progress);
 
         void copyIndexes(OperationContext* txn,
                          const std::string& toDBName,
@@ -87,7 +94,21 @@ namespace mongo {
                          bool mayYield,
                          bool mayBeInterrupted);
 
-        struct Fun;
+        /**
+         * Body of the threads of a parallel clone. Each has its own connection to 'cs' and copies
+         * collections from 'toClone', in order, until none are left or one of the workers fails.
+         * The replication and validation settings are those of the caller's OperationContext.
+         */
+        static void copyCollectionsWorker(int workerId,
+                                          const ConnectionString& cs,
+                                          const std::string& toDBName,
+                                          const CloneOptions& opts,
+                                          bool writesAreReplicated,
+                                          bool validationDisabled,
+                                          const std::vector<BSONObj>& toClone,
+                                          AtomicUInt32* nextCollection,
+                                          Progress* progress);
+
         std::auto_ptr<DBClientBase> _conn;
     };
 
@@ -97,6 +118,9 @@ namespace mongo {
      *  snapshot    - use $snapshot mode for copying collections.  note this should not be used
      *                when it isn't required, as it will be slower.  for example,
      *                repairDatabase need not use it.
+     *  cloneThreads - number of collections copied at once when syncing data from another host.
+     *                each copy has its own connection and only locks its own collection while
+     *                inserting.
      */
     struct CloneOptions {
         CloneOptions() {
@@ -105,6 +129,7 @@ namespace mongo {
             snapshot = true;
             mayYield = true;
             mayBeInterrupted = false;
+            cloneThreads = 1;
 
             syncData = true;
             syncIndexes = true;
@@ -118,6 +143,7 @@ namespace mongo {
         bool snapshot;
         bool mayYield;
         bool mayBeInterrupted;
+        int cloneThreads;
 
         bool syncData;
         bool syncIndexes;
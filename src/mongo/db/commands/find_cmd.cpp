@@ -203,6 +203,8 @@ namespace mongo {
             // Fill out curop information.
             beginQueryOp(nss, cmdObj, lpq->getNumToReturn(), lpq->getSkip(), txn->getCurOp());
 
+            const int readAtSnapshotMS = lpq->getReadAtSnapshotMS();
+
             // 1b) Finish the parsing step by using the LiteParsedQuery to create a CanonicalQuery.
             std::unique_ptr<CanonicalQuery> cq;
             {
@@ -229,6 +231,16 @@ namespace mongo {
             // retry.
             const ChunkVersion shardingVersionAtStart = shardingState.getVersion(nss.ns());
 
+            // Keep reading from the same snapshot across yields and getMores. The RecoveryUnit
+            // holding it is stashed in the ClientCursor below.
+            if (readAtSnapshotMS > 0) {
+                Status snapshotStatus = txn->recoveryUnit()->setReadAtSnapshot(
+                    Date_t::now() + Milliseconds(readAtSnapshotMS));
+                if (!snapshotStatus.isOK()) {
+                    return appendCommandStatus(result, snapshotStatus);
+                }
+            }
+
             // 3) Get the execution plan for the query.
             std::unique_ptr<PlanExecutor> execHolder;
             {
@@ -0,0 +1,213 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/bson/util/bson_extract.h"
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/materialized_view_catalog.h"
+
+namespace mongo {
+
+    using std::string;
+    using std::stringstream;
+    using std::vector;
+
+namespace {
+
+    NamespaceString viewsNamespace(const string& dbname) {
+        return NamespaceString(dbname, MaterializedViewCatalog::kViewsCollectionName);
+    }
+
+    void addViewWritePrivileges(const NamespaceString& viewNs, vector<Privilege>* out) {
+        ActionSet actions;
+        actions.addAction(ActionType::createCollection);
+        actions.addAction(ActionType::insert);
+        actions.addAction(ActionType::update);
+        actions.addAction(ActionType::remove);
+        actions.addAction(ActionType::dropCollection);
+        out->push_back(Privilege(ResourcePattern::forExactNamespace(viewNs), actions));
+    }
+
+} // namespace
+
+    /**
+     * { createMaterializedView: <view>, viewOn: <source>, pipeline: [...] }
+     */
+    class CreateMaterializedViewCmd : public Command {
+    public:
+        CreateMaterializedViewCmd() : Command("createMaterializedView") {}
+        virtual bool slaveOk() const { return false; }
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+        virtual void help(stringstream& help) const {
+            help << "define a collection holding the incrementally maintained output of an "
+                    "aggregation pipeline\n"
+                    "{ createMaterializedView: <view>, viewOn: <source>, pipeline: [...] }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            addViewWritePrivileges(NamespaceString(dbname, cmdObj.firstElement().str()), out);
+            out->push_back(Privilege(ResourcePattern::forExactNamespace(
+                                         NamespaceString(dbname, cmdObj["viewOn"].str())),
+                                     ActionType::find));
+            out->push_back(Privilege(ResourcePattern::forExactNamespace(viewsNamespace(dbname)),
+                                     ActionType::insert));
+        }
+
+        virtual bool run(OperationContext* txn,
+                         const string& dbname,
+                         BSONObj& cmdObj,
+                         int,
+                         string& errmsg,
+                         BSONObjBuilder& result) {
+            const NamespaceString viewNs(parseNsCollectionRequired(dbname, cmdObj));
+            if (!viewNs.isNormal()) {
+                errmsg = "bad namespace name";
+                return false;
+            }
+
+            string viewOn;
+            Status status = bsonExtractStringField(cmdObj, "viewOn", &viewOn);
+            if (!status.isOK())
+                return appendCommandStatus(result, status);
+
+            BSONElement pipelineElem;
+            status = bsonExtractTypedField(cmdObj, "pipeline", Array, &pipelineElem);
+            if (!status.isOK())
+                return appendCommandStatus(result, status);
+
+            status = MaterializedViewCatalog::validatePipeline(pipelineElem.Obj());
+            if (!status.isOK())
+                return appendCommandStatus(result, status);
+
+            // The OpObserver registers the view once this insert commits, here and on every
+            // secondary.
+            DBDirectClient client(txn);
+            client.insert(viewsNamespace(dbname).ns(),
+                          BSON("_id" << viewNs.coll()
+                               << "viewOn" << viewOn
+                               << "pipeline" << pipelineElem));
+            const string err = client.getLastError();
+            if (!err.empty()) {
+                errmsg = str::stream() << "failed to save materialized view definition: " << err;
+                return false;
+            }
+
+            return appendCommandStatus(
+                result,
+                getGlobalMaterializedViewCatalog().refreshView(txn, viewNs, /*full*/true));
+        }
+
+    } createMaterializedViewCmd;
+
+    /**
+     * { refreshMaterializedView: <view>, full: <bool> }
+     */
+    class RefreshMaterializedViewCmd : public Command {
+    public:
+        RefreshMaterializedViewCmd() : Command("refreshMaterializedView") {}
+        virtual bool slaveOk() const { return false; }
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+        virtual void help(stringstream& help) const {
+            help << "apply pending changes to a materialized view, or recompute it if full is set\n"
+                    "{ refreshMaterializedView: <view>, full: <bool> }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            addViewWritePrivileges(NamespaceString(dbname, cmdObj.firstElement().str()), out);
+        }
+
+        virtual bool run(OperationContext* txn,
+                         const string& dbname,
+                         BSONObj& cmdObj,
+                         int,
+                         string& errmsg,
+                         BSONObjBuilder& result) {
+            const NamespaceString viewNs(parseNsCollectionRequired(dbname, cmdObj));
+            MaterializedViewCatalog& catalog = getGlobalMaterializedViewCatalog();
+            catalog.loadDatabase(txn, dbname);
+            return appendCommandStatus(
+                result,
+                catalog.refreshView(txn, viewNs, cmdObj["full"].trueValue()));
+        }
+
+    } refreshMaterializedViewCmd;
+
+    /**
+     * { dropMaterializedView: <view> }
+     */
+    class DropMaterializedViewCmd : public Command {
+    public:
+        DropMaterializedViewCmd() : Command("dropMaterializedView") {}
+        virtual bool slaveOk() const { return false; }
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+        virtual void help(stringstream& help) const {
+            help << "drop a materialized view and its definition\n"
+                    "{ dropMaterializedView: <view> }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            addViewWritePrivileges(NamespaceString(dbname, cmdObj.firstElement().str()), out);
+            out->push_back(Privilege(ResourcePattern::forExactNamespace(viewsNamespace(dbname)),
+                                     ActionType::remove));
+        }
+
+        virtual bool run(OperationContext* txn,
+                         const string& dbname,
+                         BSONObj& cmdObj,
+                         int,
+                         string& errmsg,
+                         BSONObjBuilder& result) {
+            const NamespaceString viewNs(parseNsCollectionRequired(dbname, cmdObj));
+
+            DBDirectClient client(txn);
+            client.remove(viewsNamespace(dbname).ns(), BSON("_id" << viewNs.coll()));
+            const string err = client.getLastError();
+            if (!err.empty()) {
+                errmsg = str::stream() << "failed to remove materialized view definition: " << err;
+                return false;
+            }
+
+            client.dropCollection(viewNs.ns());
+            return true;
+        }
+
+    } dropMaterializedViewCmd;
+
+} // namespace mongo
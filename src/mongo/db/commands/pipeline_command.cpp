@@ -168,6 +168,7 @@ namespace mongo {
             help << "{ pipeline: [ { $operator: {...}}, ... ]"
                  << ", explain: <bool>"
                  << ", allowDiskUse: <bool>"
+                 << ", readAtSnapshotMS: <number>"
                  << ", cursor: {batchSize: <number>}"
                  << " }"
                  << endl
@@ -227,6 +228,16 @@ namespace mongo {
 
                 Collection* collection = ctx.getCollection();
 
+                // Keep reading from the same snapshot across getMores. The RecoveryUnit holding
+                // it is stashed in the ClientCursor by handleCursorCommand().
+                if (pCtx->readAtSnapshotMS > 0) {
+                    Status snapshotStatus = txn->recoveryUnit()->setReadAtSnapshot(
+                        Date_t::now() + Milliseconds(pCtx->readAtSnapshotMS));
+                    if (!snapshotStatus.isOK()) {
+                        return appendCommandStatus(result, snapshotStatus);
+                    }
+                }
+
                 // This does mongod-specific stuff like creating the input PlanExecutor and adding
                 // it to the front of the pipeline if needed.
                 boost::shared_ptr<PlanExecutor> input = PipelineD::prepareCursorSource(txn,
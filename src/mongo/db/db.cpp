@@ -70,6 +70,7 @@
 #include "mongo/db/introspect.h"
 #include "mongo/db/json.h"
 #include "mongo/db/log_process_details.h"
+#include "mongo/db/materialized_view_catalog.h"
 #include "mongo/db/mongod_options.h"
 #include "mongo/db/op_observer.h"
 #include "mongo/db/operation_context_impl.h"
@@ -114,6 +115,7 @@
 #include "mongo/util/startup_test.h"
 #include "mongo/util/text.h"
 #include "mongo/util/time_support.h"
+#include "mongo/util/timer.h"
 #include "mongo/util/version.h"
 
 #if !defined(_WIN32)
@@ -324,12 +326,16 @@ namespace mongo {
                                                     || replSettings.usingReplSets()
                                                     || replSettings.slave == repl::SimpleSlave);
 
+        Timer recoverTimer;
+        long long openMicros = 0;
         for (vector<string>::const_iterator i = dbNames.begin(); i != dbNames.end(); ++i) {
             const string dbName = *i;
             LOG(1) << "    Recovering database: " << dbName << endl;
 
+            Timer openTimer;
             Database* db = dbHolder().openDb(&txn, dbName);
             invariant(db);
+            openMicros += openTimer.micros();
 
             // First thing after opening the database is to check for file compatibility,
             // otherwise we might crash if this is a deprecated format.
@@ -390,6 +396,10 @@ namespace mongo {
             }
         }
 
+        const long long recoverMillis = recoverTimer.millis();
+        log() << "opened " << dbNames.size() << " databases in " << recoverMillis << "ms: "
+              << "database open " << openMicros / 1000 << "ms, "
+              << "index and temp collection checks " << recoverMillis - openMicros / 1000 << "ms";
         LOG(1) << "done repairDatabases" << endl;
     }
 
@@ -586,6 +596,7 @@ namespace mongo {
                 startTTLBackgroundJob();
             }
 
+            startMaterializedViewBackgroundJob();
         }
 
         startClientCursorMonitor();
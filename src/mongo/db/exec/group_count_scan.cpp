@@ -0,0 +1,235 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/exec/group_count_scan.h"
+
+#include <boost/optional.hpp>
+#include <limits>
+
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/exec/scoped_timer.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/index/index_descriptor.h"
+
+namespace mongo {
+
+    using std::auto_ptr;
+    using std::vector;
+
+    // static
+    const char* GroupCountScan::kStageType = "GROUP_COUNT_SCAN";
+
+    GroupCountScan::GroupCountScan(OperationContext* txn,
+                                   const GroupCountScanParams& params,
+                                   WorkingSet* workingSet)
+        : _txn(txn),
+          _workingSet(workingSet),
+          _descriptor(params.descriptor),
+          _iam(params.descriptor->getIndexCatalog()->getIndex(params.descriptor)),
+          _params(params),
+          _inGroup(false),
+          _groupCount(0),
+          _skipGroup(false),
+          _exhausted(false),
+          _becameMultikey(false),
+          _commonStats(kStageType) {
+
+        invariant(!_descriptor->isSparse() && !_descriptor->isPartial());
+
+        _specificStats.keyPattern = _descriptor->keyPattern();
+        _specificStats.indexName = _descriptor->indexName();
+        _specificStats.indexVersion = _descriptor->version();
+        _specificStats.countField = _params.countField;
+
+        _seekPoint.prefixLen = 1;
+        _seekPoint.prefixExclusive = true;
+    }
+
+    PlanStage::StageState GroupCountScan::work(WorkingSetID* out) {
+        ++_commonStats.works;
+        if (_commonStats.isEOF) return PlanStage::IS_EOF;
+
+        // Adds the amount of time taken by work() to executionTimeMillis.
+        ScopedTimer timer(&_commonStats.executionTimeMillis);
+
+        if (_becameMultikey) {
+            Status status(ErrorCodes::OperationFailed,
+                          str::stream() << "index " << _descriptor->indexName()
+                                        << " became multikey while counting its keys");
+            *out = WorkingSetCommon::allocateStatusMember(_workingSet, status);
+            return PlanStage::FAILURE;
+        }
+
+        if (!_results.empty()) {
+            *out = _workingSet->allocate();
+            WorkingSetMember* member = _workingSet->get(*out);
+            member->obj = Snapshotted<BSONObj>(SnapshotId(), _results.front());
+            member->state = WorkingSetMember::OWNED_OBJ;
+            _results.pop_front();
+
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
+        if (_exhausted) {
+            _commonStats.isEOF = true;
+            return PlanStage::IS_EOF;
+        }
+
+        boost::optional<IndexKeyEntry> kv;
+        const bool needInit = !_cursor;
+        try {
+            if (needInit) {
+                _cursor = _iam->newCursor(_txn);
+
+                // Start before the first key, whatever the directions of the fields are.
+                BSONObjBuilder startKey;
+                BSONForEach(field, _descriptor->keyPattern()) {
+                    if (field.number() < 0)
+                        startKey.appendMaxKey("");
+                    else
+                        startKey.appendMinKey("");
+                }
+                kv = _cursor->seek(startKey.obj(), true);
+            }
+            else if (_skipGroup) {
+                kv = _cursor->seek(_seekPoint);
+            }
+            else {
+                kv = _cursor->next();
+            }
+        }
+        catch (const WriteConflictException& wce) {
+            if (needInit) {
+                // Release our cursor and try again next time.
+                _cursor.reset();
+            }
+            *out = WorkingSet::INVALID_ID;
+            return PlanStage::NEED_YIELD;
+        }
+
+        if (kv) {
+            ++_specificStats.keysExamined;
+            addKey(kv->key);
+        }
+        else {
+            finishGroup();
+            _exhausted = true;
+            _cursor.reset();
+        }
+
+        ++_commonStats.needTime;
+        return PlanStage::NEED_TIME;
+    }
+
+    void GroupCountScan::addKey(const BSONObj& key) {
+        const BSONElement value = key.firstElement();
+
+        if (_inGroup && _groupKey.firstElement().woCompare(value, false) == 0) {
+            ++_groupCount;
+            return;
+        }
+
+        finishGroup();
+        _groupKey = key.getOwned();
+        _groupCount = 1;
+        _inGroup = true;
+
+        if (_params.countField.empty()) {
+            // Only the distinct values matter, so jump straight past this one.
+            _seekPoint.keyPrefix = _groupKey;
+            _skipGroup = true;
+        }
+    }
+
+    void GroupCountScan::finishGroup() {
+        if (!_inGroup)
+            return;
+
+        BSONObjBuilder bob;
+        bob.appendAs(_groupKey.firstElement(), "_id");
+        if (!_params.countField.empty()) {
+            // Match the type {$sum: 1} produces.
+            if (_groupCount <= std::numeric_limits<int>::max())
+                bob.append(_params.countField, static_cast<int>(_groupCount));
+            else
+                bob.append(_params.countField, _groupCount);
+        }
+        _results.push_back(bob.obj());
+        _inGroup = false;
+        _skipGroup = false;
+    }
+
+    bool GroupCountScan::isEOF() {
+        return _commonStats.isEOF;
+    }
+
+    void GroupCountScan::saveState() {
+        _txn = NULL;
+        ++_commonStats.yields;
+        if (_cursor) _cursor->savePositioned();
+    }
+
+    void GroupCountScan::restoreState(OperationContext* opCtx) {
+        invariant(_txn == NULL);
+        _txn = opCtx;
+        ++_commonStats.unyields;
+
+        if (_cursor) _cursor->restore(opCtx);
+
+        // This can change during yielding.
+        _becameMultikey = _descriptor->isMultikey(_txn);
+    }
+
+    void GroupCountScan::invalidate(OperationContext* txn,
+                                    const RecordId& dl,
+                                    InvalidationType type) {
+        // We only hold on to keys, never to RecordIds, so there is nothing to invalidate.
+        ++_commonStats.invalidates;
+    }
+
+    vector<PlanStage*> GroupCountScan::getChildren() const {
+        vector<PlanStage*> empty;
+        return empty;
+    }
+
+    PlanStageStats* GroupCountScan::getStats() {
+        auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_GROUP_COUNT_SCAN));
+        ret->specific.reset(_specificStats.clone());
+        return ret.release();
+    }
+
+    const CommonStats* GroupCountScan::getCommonStats() const {
+        return &_commonStats;
+    }
+
+    const SpecificStats* GroupCountScan::getSpecificStats() const {
+        return &_specificStats;
+    }
+
+}  // namespace mongo
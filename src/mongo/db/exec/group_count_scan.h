@@ -0,0 +1,136 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <string>
+
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/index/index_access_method.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/record_id.h"
+
+namespace mongo {
+
+    class IndexAccessMethod;
+    class IndexDescriptor;
+    class WorkingSet;
+
+    struct GroupCountScanParams {
+        GroupCountScanParams() : descriptor(NULL) { }
+
+        // What index are we traversing? It must be a non-multikey btree index that is neither
+        // sparse nor partial, so that every document has exactly one key.
+        const IndexDescriptor* descriptor;
+
+        // Name of the field holding the number of documents in each group. If empty, only the
+        // distinct values are returned and runs of equal keys are skipped over.
+        std::string countField;
+    };
+
+    /**
+     * Computes {$group: {_id: "$<field>", <countField>: {$sum: 1}}} over a whole collection
+     * directly from an index whose first field is <field>. Walks the index in order, counting
+     * runs of keys with the same leading value, and returns one owned object per run shaped like
+     * the $group output. No documents are fetched: the index stores null for a missing field,
+     * and $group puts missing values in the _id: null group as well.
+     *
+     * Only created by the aggregation pushdown in PipelineD::prepareCursorSource.
+     */
+    class GroupCountScan : public PlanStage {
+    public:
+        GroupCountScan(OperationContext* txn,
+                       const GroupCountScanParams& params,
+                       WorkingSet* workingSet);
+        virtual ~GroupCountScan() { }
+
+        virtual StageState work(WorkingSetID* out);
+        virtual bool isEOF();
+        virtual void saveState();
+        virtual void restoreState(OperationContext* opCtx);
+        virtual void invalidate(OperationContext* txn, const RecordId& dl, InvalidationType type);
+
+        virtual std::vector<PlanStage*> getChildren() const;
+
+        virtual StageType stageType() const { return STAGE_GROUP_COUNT_SCAN; }
+
+        virtual PlanStageStats* getStats();
+
+        virtual const CommonStats* getCommonStats() const;
+
+        virtual const SpecificStats* getSpecificStats() const;
+
+        static const char* kStageType;
+
+    private:
+        // Folds one index key into the current group.
+        void addKey(const BSONObj& key);
+
+        // Queues the current group, if any, for output.
+        void finishGroup();
+
+        // transactional context for read locks. Not owned by us
+        OperationContext* _txn;
+
+        // The WorkingSet we annotate with results.  Not owned by us.
+        WorkingSet* _workingSet;
+
+        // Index access.
+        const IndexDescriptor* _descriptor; // owned by Collection -> IndexCatalog
+        const IndexAccessMethod* _iam; // owned by Collection -> IndexCatalog
+
+        // The cursor we use to navigate the tree.
+        std::unique_ptr<SortedDataInterface::Cursor> _cursor;
+
+        GroupCountScanParams _params;
+
+        // The group currently being counted, whose value is the first element of _groupKey.
+        bool _inGroup;
+        BSONObj _groupKey;
+        long long _groupCount;
+
+        // Set when the next key to look at is the first one past the current group.
+        bool _skipGroup;
+        IndexSeekPoint _seekPoint;
+
+        // Finished groups waiting to be returned.
+        std::deque<BSONObj> _results;
+
+        bool _exhausted;
+
+        // Set if the index became multikey while we yielded, so keys no longer map one to one
+        // onto documents.
+        bool _becameMultikey;
+
+        // Stats
+        CommonStats _commonStats;
+        GroupCountScanStats _specificStats;
+    };
+
+}  // namespace mongo
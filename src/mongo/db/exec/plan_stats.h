@@ -341,6 +341,26 @@ namespace mongo {
         size_t nGroups;
     };
 
+    struct GroupCountScanStats : public SpecificStats {
+        GroupCountScanStats() : keysExamined(0), indexVersion(0) { }
+
+        virtual SpecificStats* clone() const {
+            GroupCountScanStats* specific = new GroupCountScanStats(*this);
+            specific->keyPattern = keyPattern.getOwned();
+            return specific;
+        }
+
+        size_t keysExamined;
+
+        std::string countField;
+
+        std::string indexName;
+
+        BSONObj keyPattern;
+
+        int indexVersion;
+    };
+
     struct IDHackStats : public SpecificStats {
         IDHackStats() : keysExamined(0),
                         docsExamined(0) { }
@@ -0,0 +1,830 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kCommand
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/materialized_view_catalog.h"
+
+#include "mongo/db/auth/authorization_session.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/concurrency/d_concurrency.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/pipeline/pipeline.h"
+#include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/background.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    using boost::intrusive_ptr;
+    using std::auto_ptr;
+    using std::string;
+    using std::vector;
+
+    MONGO_EXPORT_SERVER_PARAMETER(materializedViewMonitorEnabled, bool, true);
+    MONGO_EXPORT_SERVER_PARAMETER(materializedViewRefreshIntervalSecs, int, 60);
+
+    // Past this many buffered bytes a view is marked stale rather than holding more deltas.
+    MONGO_EXPORT_SERVER_PARAMETER(materializedViewMaxPendingBytes, int, 64 * 1024 * 1024);
+
+    const char MaterializedViewCatalog::kViewsCollectionName[] = "system.materializedViews";
+
+namespace {
+
+    // A full refresh buffers the complete pipeline output while the source is locked.
+    const long long kMaxFullRefreshBytes = 100 * 1024 * 1024;
+
+    const int kMaxWriteBatchSize = 1000;
+
+    MaterializedViewCatalog globalMaterializedViewCatalog;
+
+    bool isViewsCollection(const NamespaceString& ns) {
+        return ns.coll() == MaterializedViewCatalog::kViewsCollectionName;
+    }
+
+    /**
+     * Returns the update operator that folds two partial results of 'accumulator', or an empty
+     * string if the accumulator is not decomposable.
+     */
+    string mergeOperatorFor(StringData accumulator) {
+        if (accumulator == "$sum")
+            return "$inc";
+        if (accumulator == "$min")
+            return "$min";
+        if (accumulator == "$max")
+            return "$max";
+        return "";
+    }
+
+    /**
+     * Sends 'updates' to 'ns' as a single update command.
+     */
+    Status runUpdates(DBDirectClient* client,
+                      const NamespaceString& ns,
+                      const vector<BSONObj>& updates) {
+        if (updates.empty())
+            return Status::OK();
+
+        BSONObjBuilder cmd;
+        cmd.append("update", ns.coll());
+        cmd.append("updates", updates);
+        cmd.append("ordered", true);
+
+        BSONObj res;
+        if (!client->runCommand(ns.db().toString(), cmd.obj(), res)) {
+            return Status(ErrorCodes::OperationFailed,
+                          str::stream() << "updating materialized view " << ns.ns()
+                                        << " failed: " << res);
+        }
+        if (res.hasField("writeErrors")) {
+            return Status(ErrorCodes::OperationFailed,
+                          str::stream() << "updating materialized view " << ns.ns()
+                                        << " failed: " << res["writeErrors"]);
+        }
+        return Status::OK();
+    }
+
+} // namespace
+
+    MaterializedViewCatalog& getGlobalMaterializedViewCatalog() {
+        return globalMaterializedViewCatalog;
+    }
+
+    /**
+     * Hands a committed insert on a view source to the catalog. Inserts that roll back never reach
+     * the view.
+     */
+    class MaterializedViewCatalog::PendingInsert : public RecoveryUnit::Change {
+    public:
+        PendingInsert(MaterializedViewCatalog* catalog, const NamespaceString& ns, BSONObj doc)
+            : _catalog(catalog)
+            , _ns(ns)
+            , _doc(doc.getOwned())
+        {}
+
+        virtual void commit() {
+            boost::lock_guard<boost::mutex> lk(_catalog->_mutex);
+            typedef std::multimap<string, string>::const_iterator Iter;
+            std::pair<Iter, Iter> range = _catalog->_viewsBySource.equal_range(_ns.ns());
+            for (Iter it = range.first; it != range.second; ++it) {
+                ViewMap::iterator view = _catalog->_views.find(it->second);
+                if (view == _catalog->_views.end() || view->second.stale)
+                    continue;
+
+                view->second.pendingBytes += _doc.objsize();
+                if (view->second.pendingBytes > materializedViewMaxPendingBytes) {
+                    _catalog->_markStale_inlock(&view->second);
+                    continue;
+                }
+                view->second.pendingInserts.push_back(_doc);
+            }
+        }
+
+        virtual void rollback() {}
+
+    private:
+        MaterializedViewCatalog* const _catalog;
+        const NamespaceString _ns;
+        const BSONObj _doc;
+    };
+
+namespace {
+
+    /**
+     * Applies a change to the set of view definitions once its write commits.
+     */
+    class DefinitionChange : public RecoveryUnit::Change {
+    public:
+        DefinitionChange(MaterializedViewCatalog* catalog,
+                         const NamespaceString& viewsNs,
+                         BSONObj definition,
+                         bool isInsert)
+            : _catalog(catalog)
+            , _viewsNs(viewsNs)
+            , _definition(definition.getOwned())
+            , _isInsert(isInsert)
+        {}
+
+        virtual void commit() {
+            const string viewColl = _definition["_id"].str();
+            if (_isInsert) {
+                Status status = _catalog->registerView(_viewsNs.db(), _definition);
+                if (!status.isOK()) {
+                    warning() << "ignoring invalid materialized view definition " << _definition
+                              << ": " << status;
+                }
+            }
+            else {
+                _catalog->unregisterView(NamespaceString(_viewsNs.db(), viewColl));
+            }
+        }
+
+        virtual void rollback() {}
+
+    private:
+        MaterializedViewCatalog* const _catalog;
+        const NamespaceString _viewsNs;
+        const BSONObj _definition;
+        const bool _isInsert;
+    };
+
+    /**
+     * Forgets the views of a database once an edit of its definitions commits, so that they are
+     * reloaded on next use. A rolled back edit leaves the registered views alone.
+     */
+    class ReloadDatabaseChange : public RecoveryUnit::Change {
+    public:
+        ReloadDatabaseChange(MaterializedViewCatalog* catalog, StringData dbName)
+            : _catalog(catalog)
+            , _dbName(dbName.toString())
+        {}
+
+        virtual void commit() {
+            _catalog->unregisterDatabase(_dbName);
+        }
+
+        virtual void rollback() {}
+
+    private:
+        MaterializedViewCatalog* const _catalog;
+        const string _dbName;
+    };
+
+} // namespace
+
+    MaterializedViewCatalog::MaterializedViewCatalog() {}
+
+    Status MaterializedViewCatalog::validatePipeline(const BSONObj& pipeline) {
+        bool seenGroup = false;
+        BSONForEach(stageElem, pipeline) {
+            if (stageElem.type() != Object || stageElem.Obj().nFields() != 1) {
+                return Status(ErrorCodes::BadValue,
+                              "each pipeline stage must be an object with a single field");
+            }
+
+            const BSONElement stage = stageElem.Obj().firstElement();
+            const StringData stageName = stage.fieldNameStringData();
+
+            if (seenGroup) {
+                return Status(ErrorCodes::BadValue,
+                              "$group must be the last stage of a materialized view pipeline");
+            }
+
+            if (stageName == DocumentSourceMatch::matchName
+                    || stageName == DocumentSourceProject::projectName
+                    || stageName == DocumentSourceUnwind::unwindName) {
+                continue;
+            }
+
+            if (stageName != DocumentSourceGroup::groupName) {
+                return Status(ErrorCodes::BadValue,
+                              str::stream() << stageName << " can't be maintained incrementally; "
+                                            << "only $match, $project, $unwind and a final $group "
+                                            << "are allowed");
+            }
+
+            seenGroup = true;
+            if (stage.type() != Object) {
+                return Status(ErrorCodes::BadValue, "$group specification must be an object");
+            }
+
+            BSONForEach(field, stage.Obj()) {
+                if (str::equals(field.fieldName(), "_id"))
+                    continue;
+
+                if (field.type() != Object || field.Obj().nFields() != 1
+                        || mergeOperatorFor(field.Obj().firstElementFieldName()).empty()) {
+                    return Status(ErrorCodes::BadValue,
+                                  str::stream() << "$group field '" << field.fieldName()
+                                                << "' must use $sum, $min or $max to be "
+                                                << "maintained incrementally");
+                }
+            }
+        }
+
+        // Every view document is stored under the _id the pipeline gives it. Only a $group
+        // guarantees those are present and unique: after $unwind, documents from the same source
+        // document share its _id, and $project can leave the _id out altogether.
+        if (!seenGroup) {
+            return Status(ErrorCodes::BadValue,
+                          "a materialized view pipeline must end in a $group");
+        }
+        return Status::OK();
+    }
+
+    Status MaterializedViewCatalog::registerView(StringData dbName, const BSONObj& definition) {
+        if (definition["_id"].type() != String || definition["viewOn"].type() != String
+                || definition["pipeline"].type() != Array) {
+            return Status(ErrorCodes::BadValue,
+                          "a materialized view needs string _id and viewOn and an array pipeline");
+        }
+
+        const BSONObj pipeline = definition["pipeline"].Obj();
+        Status status = validatePipeline(pipeline);
+        if (!status.isOK())
+            return status;
+
+        View view;
+        view.viewNs = NamespaceString(dbName, definition["_id"].str());
+        view.sourceNs = NamespaceString(dbName, definition["viewOn"].str());
+        view.pipeline = pipeline.getOwned();
+        view.stale = true;
+        view.pendingBytes = 0;
+        view.numIncrementalRefreshes = 0;
+        view.numFullRefreshes = 0;
+        view.numDeltasApplied = 0;
+
+        BSONForEach(stageElem, view.pipeline) {
+            const BSONElement stage = stageElem.Obj().firstElement();
+            if (stage.fieldNameStringData() != DocumentSourceGroup::groupName)
+                continue;
+
+            BSONForEach(field, stage.Obj()) {
+                if (str::equals(field.fieldName(), "_id"))
+                    continue;
+                view.groupFieldOps[field.fieldName()] =
+                    mergeOperatorFor(field.Obj().firstElementFieldName());
+            }
+        }
+
+        unregisterView(view.viewNs);
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        _viewsBySource.insert(std::make_pair(view.sourceNs.ns(), view.viewNs.ns()));
+        _views[view.viewNs.ns()] = view;
+        _numViews.store(_views.size());
+        return Status::OK();
+    }
+
+    void MaterializedViewCatalog::unregisterView(const NamespaceString& viewNs) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        ViewMap::iterator it = _views.find(viewNs.ns());
+        if (it == _views.end())
+            return;
+
+        typedef std::multimap<string, string>::iterator Iter;
+        std::pair<Iter, Iter> range = _viewsBySource.equal_range(it->second.sourceNs.ns());
+        for (Iter source = range.first; source != range.second; ++source) {
+            if (source->second == viewNs.ns()) {
+                _viewsBySource.erase(source);
+                break;
+            }
+        }
+
+        _views.erase(it);
+        _numViews.store(_views.size());
+    }
+
+    void MaterializedViewCatalog::unregisterDatabase(StringData dbName) {
+        vector<NamespaceString> toRemove;
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            _loadedDatabases.erase(dbName.toString());
+            for (ViewMap::const_iterator it = _views.begin(); it != _views.end(); ++it) {
+                if (it->second.viewNs.db() == dbName)
+                    toRemove.push_back(it->second.viewNs);
+            }
+        }
+
+        for (size_t i = 0; i < toRemove.size(); i++) {
+            unregisterView(toRemove[i]);
+        }
+    }
+
+    void MaterializedViewCatalog::loadDatabase(OperationContext* txn, const string& dbName) {
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            if (!_loadedDatabases.insert(dbName).second)
+                return;
+        }
+
+        DBDirectClient client(txn);
+        const NamespaceString viewsNs(dbName, kViewsCollectionName);
+        auto_ptr<DBClientCursor> cursor = client.query(viewsNs.ns(), Query());
+        while (cursor->more()) {
+            BSONObj definition = cursor->nextSafe();
+            Status status = registerView(dbName, definition);
+            if (!status.isOK()) {
+                warning() << "ignoring invalid materialized view definition " << definition
+                          << " in " << viewsNs.ns() << ": " << status;
+            }
+        }
+    }
+
+    void MaterializedViewCatalog::onInsert(OperationContext* txn,
+                                           const NamespaceString& ns,
+                                           const BSONObj& doc) {
+        if (isViewsCollection(ns)) {
+            txn->recoveryUnit()->registerChange(new DefinitionChange(this, ns, doc, true));
+            return;
+        }
+
+        if (_numViews.load() == 0)
+            return;
+
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            if (_viewsBySource.find(ns.ns()) == _viewsBySource.end())
+                return;
+        }
+
+        // Secondaries get the view contents through replication, so they buffer nothing. Should
+        // this node become primary the view no longer reflects its source, so it must be
+        // recomputed on the next refresh.
+        if (!repl::getGlobalReplicationCoordinator()->canAcceptWritesForDatabase(ns.db())) {
+            _markSourceStale(ns);
+            return;
+        }
+
+        txn->recoveryUnit()->registerChange(new PendingInsert(this, ns, doc));
+    }
+
+    void MaterializedViewCatalog::onDelete(OperationContext* txn,
+                                           const NamespaceString& ns,
+                                           const BSONObj& idDoc) {
+        if (isViewsCollection(ns)) {
+            txn->recoveryUnit()->registerChange(new DefinitionChange(this, ns, idDoc, false));
+            return;
+        }
+        onNonAppendWrite(txn, ns);
+    }
+
+    void MaterializedViewCatalog::onNonAppendWrite(OperationContext* txn,
+                                                   const NamespaceString& ns) {
+        if (isViewsCollection(ns)) {
+            // An edited definition is picked up by reloading the whole database.
+            txn->recoveryUnit()->registerChange(new ReloadDatabaseChange(this, ns.db()));
+            return;
+        }
+
+        if (_numViews.load() == 0)
+            return;
+
+        _markSourceStale(ns);
+    }
+
+    void MaterializedViewCatalog::_markSourceStale(const NamespaceString& sourceNs) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        typedef std::multimap<string, string>::const_iterator Iter;
+        std::pair<Iter, Iter> range = _viewsBySource.equal_range(sourceNs.ns());
+        for (Iter it = range.first; it != range.second; ++it) {
+            ViewMap::iterator view = _views.find(it->second);
+            if (view != _views.end())
+                _markStale_inlock(&view->second);
+        }
+    }
+
+    void MaterializedViewCatalog::markAllStale() {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        for (ViewMap::iterator it = _views.begin(); it != _views.end(); ++it) {
+            _markStale_inlock(&it->second);
+        }
+    }
+
+    void MaterializedViewCatalog::_markStale_inlock(View* view) {
+        view->stale = true;
+        view->pendingInserts.clear();
+        view->pendingBytes = 0;
+    }
+
+    vector<NamespaceString> MaterializedViewCatalog::getViewNamespaces() const {
+        vector<NamespaceString> out;
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        for (ViewMap::const_iterator it = _views.begin(); it != _views.end(); ++it) {
+            out.push_back(it->second.viewNs);
+        }
+        return out;
+    }
+
+    Status MaterializedViewCatalog::refreshView(OperationContext* txn,
+                                                const NamespaceString& viewNs,
+                                                bool full) {
+        boost::lock_guard<boost::mutex> refreshLock(_refreshMutex);
+
+        View view;
+        vector<BSONObj> inserts;
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            ViewMap::iterator it = _views.find(viewNs.ns());
+            if (it == _views.end()) {
+                return Status(ErrorCodes::NamespaceNotFound,
+                              str::stream() << viewNs.ns() << " is not a materialized view");
+            }
+
+            if (full)
+                _markStale_inlock(&it->second);
+
+            // Copy the definition only. The deltas are taken below.
+            view.viewNs = it->second.viewNs;
+            view.sourceNs = it->second.sourceNs;
+            view.pipeline = it->second.pipeline;
+            view.groupFieldOps = it->second.groupFieldOps;
+            view.stale = it->second.stale;
+
+            if (!view.stale) {
+                inserts.swap(it->second.pendingInserts);
+                it->second.pendingBytes = 0;
+            }
+        }
+
+        Status status = view.stale ? _fullRefresh(txn, view)
+                                   : _applyDeltas(txn, view, inserts);
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        ViewMap::iterator it = _views.find(viewNs.ns());
+        if (it == _views.end())
+            return status;
+
+        if (!status.isOK()) {
+            // Whatever was folded in before the failure can't be undone, so start over.
+            _markStale_inlock(&it->second);
+            return status;
+        }
+
+        if (view.stale) {
+            it->second.numFullRefreshes++;
+        }
+        else {
+            it->second.numIncrementalRefreshes++;
+            it->second.numDeltasApplied += inserts.size();
+        }
+        return status;
+    }
+
+    void MaterializedViewCatalog::refreshAll(OperationContext* txn) {
+        const vector<NamespaceString> views = getViewNamespaces();
+        for (size_t i = 0; i < views.size(); i++) {
+            try {
+                Status status = refreshView(txn, views[i], false);
+                if (!status.isOK()) {
+                    warning() << "failed to refresh materialized view " << views[i].ns() << ": "
+                              << status;
+                }
+            }
+            catch (const DBException& ex) {
+                warning() << "failed to refresh materialized view " << views[i].ns() << ": "
+                          << ex.toString();
+            }
+        }
+    }
+
+    Status MaterializedViewCatalog::_applyDeltas(OperationContext* txn,
+                                                 const View& view,
+                                                 const vector<BSONObj>& inserts) {
+        if (inserts.empty())
+            return Status::OK();
+
+        // Run the pipeline over just the new documents.
+        intrusive_ptr<ExpressionContext> expCtx = new ExpressionContext(txn, view.sourceNs);
+        string errmsg;
+        intrusive_ptr<Pipeline> pipeline =
+            Pipeline::parseCommand(errmsg,
+                                   BSON(Pipeline::commandName << view.sourceNs.coll()
+                                        << "pipeline" << BSONArray(view.pipeline)),
+                                   expCtx);
+        if (!pipeline)
+            return Status(ErrorCodes::BadValue, errmsg);
+
+        BSONArrayBuilder deltaArray;
+        for (size_t i = 0; i < inserts.size(); i++) {
+            deltaArray.append(inserts[i]);
+        }
+        const BSONObj deltas = deltaArray.obj();
+        pipeline->addInitialSource(DocumentSourceBsonArray::create(deltas, expCtx));
+        pipeline->stitch();
+
+        DBDirectClient client(txn);
+        vector<BSONObj> updates;
+        DocumentSource* output = pipeline->output();
+        while (boost::optional<Document> next = output->getNext()) {
+            const BSONObj partial = next->toBson();
+            const BSONElement id = partial["_id"];
+            if (id.eoo()) {
+                return Status(ErrorCodes::BadValue,
+                              str::stream() << "materialized view " << view.viewNs.ns()
+                                            << " produced a document without an _id");
+            }
+
+            BSONObjBuilder update;
+            update.append("q", BSON("_id" << id));
+
+            // Group by operator: {$inc: {...}, $min: {...}, $max: {...}}.
+            std::map<string, BSONObjBuilder*> byOperator;
+            BSONObjBuilder u(update.subobjStart("u"));
+            BSONObjBuilder inc, min, max;
+            byOperator["$inc"] = &inc;
+            byOperator["$min"] = &min;
+            byOperator["$max"] = &max;
+
+            BSONForEach(field, partial) {
+                std::map<string, string>::const_iterator op =
+                    view.groupFieldOps.find(field.fieldName());
+                if (op == view.groupFieldOps.end())
+                    continue; // _id
+                if (field.isNull() || field.type() == Undefined)
+                    continue; // all inputs in this delta were missing
+                byOperator[op->second]->append(field);
+            }
+
+            for (std::map<string, BSONObjBuilder*>::const_iterator op = byOperator.begin();
+                    op != byOperator.end(); ++op) {
+                if (op->second->asTempObj().isEmpty())
+                    continue;
+                u.append(op->first, op->second->obj());
+            }
+
+            if (u.asTempObj().isEmpty()) {
+                // Still create the group so that it shows up in the view.
+                u.append("$setOnInsert", BSON("_id" << id));
+            }
+            u.doneFast();
+            update.append("upsert", true);
+            updates.push_back(update.obj());
+
+            if (updates.size() >= size_t(kMaxWriteBatchSize)) {
+                Status status = runUpdates(&client, view.viewNs, updates);
+                if (!status.isOK())
+                    return status;
+                updates.clear();
+            }
+        }
+
+        return runUpdates(&client, view.viewNs, updates);
+    }
+
+    Status MaterializedViewCatalog::_fullRefresh(OperationContext* txn, const View& view) {
+        DBDirectClient client(txn);
+        vector<BSONObj> results;
+
+        {
+            // Block writers on the source for the duration of the read so that no insert can
+            // be both seen by the aggregation and buffered as a delta.
+            ScopedTransaction transaction(txn, MODE_IS);
+            Lock::DBLock dbLock(txn->lockState(), view.sourceNs.db(), MODE_IS);
+            Lock::CollectionLock collLock(txn->lockState(), view.sourceNs.ns(), MODE_S);
+
+            {
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                ViewMap::iterator it = _views.find(view.viewNs.ns());
+                if (it != _views.end()) {
+                    it->second.pendingInserts.clear();
+                    it->second.pendingBytes = 0;
+                    it->second.stale = false;
+                }
+            }
+
+            BSONObj res;
+            const bool ok = client.runCommand(view.sourceNs.db().toString(),
+                                              BSON(Pipeline::commandName << view.sourceNs.coll()
+                                                   << "pipeline" << BSONArray(view.pipeline)
+                                                   << "cursor" << BSONObj()),
+                                              res);
+            if (!ok) {
+                return Status(ErrorCodes::OperationFailed,
+                              str::stream() << "computing materialized view " << view.viewNs.ns()
+                                            << " failed: " << res);
+            }
+
+            long long resultBytes = 0;
+            const BSONObj cursorObj = res["cursor"].Obj();
+            BSONForEach(doc, cursorObj["firstBatch"].Obj()) {
+                results.push_back(doc.Obj().getOwned());
+                resultBytes += results.back().objsize();
+            }
+
+            const long long cursorId = cursorObj["id"].Long();
+            if (cursorId != 0) {
+                auto_ptr<DBClientCursor> cursor =
+                    client.getMore(cursorObj["ns"].String(), cursorId, 0, 0);
+                while (cursor->more()) {
+                    results.push_back(cursor->nextSafe().getOwned());
+                    resultBytes += results.back().objsize();
+                    if (resultBytes > kMaxFullRefreshBytes) {
+                        // Destroying the cursor kills it on the server.
+                        return Status(ErrorCodes::OperationFailed,
+                                      str::stream() << "materialized view " << view.viewNs.ns()
+                                                    << " is larger than "
+                                                    << kMaxFullRefreshBytes << " bytes");
+                    }
+                }
+            }
+        }
+
+        // Build the new contents on the side and swap them in, like $out does.
+        const NamespaceString tempNs(StringData(str::stream() << view.viewNs.db() << ".tmp.mv."
+                                                              << view.viewNs.coll()));
+        client.dropCollection(tempNs.ns());
+
+        BSONObj info;
+        if (!client.runCommand(tempNs.db().toString(),
+                               BSON("create" << tempNs.coll() << "temp" << true),
+                               info)) {
+            return Status(ErrorCodes::OperationFailed,
+                          str::stream() << "failed to create " << tempNs.ns() << ": " << info);
+        }
+
+        const std::list<BSONObj> indexes = client.getIndexSpecs(view.viewNs.ns());
+        for (std::list<BSONObj>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+            BSONObjBuilder index;
+            BSONForEach(field, *it) {
+                if (str::equals(field.fieldName(), "_id") || str::equals(field.fieldName(), "ns"))
+                    continue;
+                index.append(field);
+            }
+            index.append("ns", tempNs.ns());
+            client.insert(tempNs.getSystemIndexesCollection(), index.obj());
+        }
+
+        for (size_t start = 0; start < results.size(); start += kMaxWriteBatchSize) {
+            const size_t end = std::min(results.size(), start + kMaxWriteBatchSize);
+            client.insert(tempNs.ns(), vector<BSONObj>(results.begin() + start,
+                                                       results.begin() + end));
+            const string err = client.getLastError();
+            if (!err.empty()) {
+                client.dropCollection(tempNs.ns());
+                return Status(ErrorCodes::OperationFailed,
+                              str::stream() << "writing materialized view " << view.viewNs.ns()
+                                            << " failed: " << err);
+            }
+        }
+
+        if (!client.runCommand("admin",
+                               BSON("renameCollection" << tempNs.ns()
+                                    << "to" << view.viewNs.ns()
+                                    << "dropTarget" << true),
+                               info)) {
+            client.dropCollection(tempNs.ns());
+            return Status(ErrorCodes::OperationFailed,
+                          str::stream() << "renaming into materialized view " << view.viewNs.ns()
+                                        << " failed: " << info);
+        }
+
+        return Status::OK();
+    }
+
+    void MaterializedViewCatalog::appendStats(BSONObjBuilder* builder) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        for (ViewMap::const_iterator it = _views.begin(); it != _views.end(); ++it) {
+            const View& view = it->second;
+            BSONObjBuilder viewBuilder(builder->subobjStart(view.viewNs.ns()));
+            viewBuilder.append("viewOn", view.sourceNs.ns());
+            viewBuilder.append("stale", view.stale);
+            viewBuilder.appendNumber("pendingInserts",
+                                     static_cast<long long>(view.pendingInserts.size()));
+            viewBuilder.appendNumber("pendingBytes", view.pendingBytes);
+            viewBuilder.appendNumber("incrementalRefreshes", view.numIncrementalRefreshes);
+            viewBuilder.appendNumber("fullRefreshes", view.numFullRefreshes);
+            viewBuilder.appendNumber("deltasApplied", view.numDeltasApplied);
+            viewBuilder.doneFast();
+        }
+    }
+
+namespace {
+
+    class MaterializedViewMonitor : public BackgroundJob {
+    public:
+        virtual string name() const { return "MaterializedViewMonitor"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            AuthorizationSession::get(cc())->grantInternalAuthorization();
+
+            bool wasPrimary = false;
+            while (!inShutdown()) {
+                sleepsecs(materializedViewRefreshIntervalSecs);
+
+                if (!materializedViewMonitorEnabled) {
+                    LOG(1) << "MaterializedViewMonitor is disabled";
+                    continue;
+                }
+
+                repl::ReplicationCoordinator* replCoord = repl::getGlobalReplicationCoordinator();
+                const bool isPrimary =
+                    replCoord->getReplicationMode() != repl::ReplicationCoordinator::modeReplSet
+                    || replCoord->getMemberState().primary();
+                if (!isPrimary) {
+                    wasPrimary = false;
+                    continue;
+                }
+
+                try {
+                    OperationContextImpl txn;
+                    MaterializedViewCatalog& catalog = getGlobalMaterializedViewCatalog();
+
+                    // Nothing was buffered while this node was not primary.
+                    if (!wasPrimary)
+                        catalog.markAllStale();
+                    wasPrimary = true;
+
+                    std::set<string> dbs;
+                    dbHolder().getAllShortNames(dbs);
+                    for (std::set<string>::const_iterator it = dbs.begin(); it != dbs.end(); ++it) {
+                        catalog.loadDatabase(&txn, *it);
+                    }
+
+                    catalog.refreshAll(&txn);
+                }
+                catch (const DBException& ex) {
+                    warning() << "MaterializedViewMonitor pass failed: " << ex.toString();
+                }
+            }
+        }
+    };
+
+    class MaterializedViewServerStatusSection : public ServerStatusSection {
+    public:
+        MaterializedViewServerStatusSection() : ServerStatusSection("materializedViews") {}
+
+        virtual bool includeByDefault() const { return false; }
+
+        virtual BSONObj generateSection(OperationContext* txn,
+                                        const BSONElement& configElement) const {
+            BSONObjBuilder builder;
+            getGlobalMaterializedViewCatalog().appendStats(&builder);
+            return builder.obj();
+        }
+
+    } materializedViewServerStatusSection;
+
+} // namespace
+
+    void startMaterializedViewBackgroundJob() {
+        MaterializedViewMonitor* monitor = new MaterializedViewMonitor();
+        monitor->go();
+    }
+
+} // namespace mongo
@@ -0,0 +1,178 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    class OperationContext;
+
+    /**
+     * Tracks materialized views: collections holding the output of an aggregation pipeline over a
+     * source collection in the same database.
+     *
+     * View definitions live in <db>.system.materializedViews as
+     *     {_id: <view collection>, viewOn: <source collection>, pipeline: [...]}
+     * and are picked up through the OpObserver, so secondaries know about them as well.
+     *
+     * Only pipelines made of $match, $project and $unwind stages followed by a single $group using
+     * $sum, $min and $max are accepted. For those, the documents inserted into the
+     * source since the last refresh can be run through the pipeline on their own and the result
+     * folded into the view with $inc/$min/$max upserts. Any other write to the source marks the
+     * view stale, and the next refresh recomputes it from scratch.
+     *
+     * Deltas are only buffered on a primary. The view collection itself is written through the
+     * normal write path, so secondaries get the results through replication.
+     */
+    class MaterializedViewCatalog {
+        MONGO_DISALLOW_COPYING(MaterializedViewCatalog);
+    public:
+        static const char kViewsCollectionName[];
+
+        MaterializedViewCatalog();
+
+        /**
+         * Returns OK if 'pipeline' can be maintained incrementally.
+         */
+        static Status validatePipeline(const BSONObj& pipeline);
+
+        /**
+         * Registers or replaces the view described by 'definition', a document from
+         * <dbName>.system.materializedViews. The view starts out stale.
+         */
+        Status registerView(StringData dbName, const BSONObj& definition);
+
+        void unregisterView(const NamespaceString& viewNs);
+
+        void unregisterDatabase(StringData dbName);
+
+        /**
+         * Loads every view definition in 'dbName' unless that has already been done.
+         */
+        void loadDatabase(OperationContext* txn, const std::string& dbName);
+
+        //
+        // OpObserver hooks. These are called on every write so they return immediately when no
+        // view is defined.
+        //
+
+        void onInsert(OperationContext* txn, const NamespaceString& ns, const BSONObj& doc);
+
+        void onDelete(OperationContext* txn, const NamespaceString& ns, const BSONObj& idDoc);
+
+        /**
+         * Any write to 'ns' that can't be expressed as a delta, such as an update or a drop.
+         */
+        void onNonAppendWrite(OperationContext* txn, const NamespaceString& ns);
+
+        void markAllStale();
+
+        /**
+         * Brings the view up to date, either by folding in the buffered deltas or, if the view is
+         * stale or 'full' is set, by recomputing it from the source collection.
+         */
+        Status refreshView(OperationContext* txn, const NamespaceString& viewNs, bool full);
+
+        /**
+         * Refreshes every registered view. Errors are logged and do not stop the pass.
+         */
+        void refreshAll(OperationContext* txn);
+
+        void appendStats(BSONObjBuilder* builder) const;
+
+        std::vector<NamespaceString> getViewNamespaces() const;
+
+    private:
+        struct View {
+            NamespaceString viewNs;
+            NamespaceString sourceNs;
+            BSONObj pipeline;
+
+            // Maps each output field of the final $group to the update operator that folds a
+            // partial result into the stored one.
+            std::map<std::string, std::string> groupFieldOps;
+
+            bool stale;
+            std::vector<BSONObj> pendingInserts;
+            long long pendingBytes;
+
+            long long numIncrementalRefreshes;
+            long long numFullRefreshes;
+            long long numDeltasApplied;
+        };
+
+        typedef std::map<std::string, View> ViewMap;
+
+        class PendingInsert;
+
+        Status _applyDeltas(OperationContext* txn,
+                            const View& view,
+                            const std::vector<BSONObj>& inserts);
+
+        Status _fullRefresh(OperationContext* txn, const View& view);
+
+        // Drops buffered deltas and marks the view stale. Caller must hold _mutex.
+        void _markStale_inlock(View* view);
+
+        // Marks every view that reads from 'sourceNs' stale.
+        void _markSourceStale(const NamespaceString& sourceNs);
+
+        mutable boost::mutex _mutex;
+
+        // Keyed by view namespace.
+        ViewMap _views;
+
+        // Source namespace to the view namespaces that read from it.
+        std::multimap<std::string, std::string> _viewsBySource;
+
+        std::set<std::string> _loadedDatabases;
+
+        // Lets the write path skip _mutex entirely when no views exist.
+        AtomicUInt32 _numViews;
+
+        // Serializes refreshes so that deltas are folded in the order they were taken.
+        boost::mutex _refreshMutex;
+    };
+
+    MaterializedViewCatalog& getGlobalMaterializedViewCatalog();
+
+    void startMaterializedViewBackgroundJob();
+
+} // namespace mongo
@@ -79,6 +79,8 @@ namespace mongo {
 
         if ( ns.find( ".system.js" ) != string::npos ) return true;
 
+        if ( ns.find( ".system.materializedViews" ) != string::npos ) return true;
+
         return false;
     }
 
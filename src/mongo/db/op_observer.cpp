@@ -34,6 +34,7 @@
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/commands/dbhash.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/materialized_view_catalog.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/repl/oplog.h"
@@ -66,6 +67,7 @@ namespace mongo {
         if (strstr(ns.ns().c_str(), ".system.js")) {
             Scope::storedFuncMod(txn);
         }
+        getGlobalMaterializedViewCatalog().onInsert(txn, ns, doc);
     }
 
     void OpObserver::onUpdate(OperationContext* txn,
@@ -82,6 +84,7 @@ namespace mongo {
         if (strstr(args.ns.c_str(), ".system.js")) {
             Scope::storedFuncMod(txn);
         }
+        getGlobalMaterializedViewCatalog().onNonAppendWrite(txn, NamespaceString(args.ns));
     }
 
     void OpObserver::onDelete(OperationContext* txn,
@@ -96,6 +99,7 @@ namespace mongo {
         if (strstr(ns.c_str(), ".system.js")) {
             Scope::storedFuncMod(txn);
         }
+        getGlobalMaterializedViewCatalog().onDelete(txn, NamespaceString(ns), idDoc);
     }
 
     void OpObserver::onOpMessage(OperationContext* txn, const BSONObj& msgObj) {
@@ -134,6 +138,7 @@ namespace mongo {
 
         getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
         logOpForDbHash(txn, dbName.c_str());
+        getGlobalMaterializedViewCatalog().unregisterDatabase(dbName);
     }
 
     void OpObserver::onDropCollection(OperationContext* txn,
@@ -145,6 +150,7 @@ namespace mongo {
 
         getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
         logOpForDbHash(txn, dbName.c_str());
+        getGlobalMaterializedViewCatalog().onNonAppendWrite(txn, collectionName);
     }
 
     void OpObserver::onDropIndex(OperationContext* txn,
@@ -171,6 +177,8 @@ namespace mongo {
 
         getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
         logOpForDbHash(txn, dbName.c_str());
+        getGlobalMaterializedViewCatalog().onNonAppendWrite(txn, fromCollection);
+        getGlobalMaterializedViewCatalog().onNonAppendWrite(txn, toCollection);
     }
 
     void OpObserver::onApplyOps(OperationContext* txn,
@@ -192,6 +200,7 @@ namespace mongo {
 
         getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
         logOpForDbHash(txn, dbName.c_str());
+        getGlobalMaterializedViewCatalog().onNonAppendWrite(txn, collectionName);
     }
 
     void OpObserver::onEmptyCapped(OperationContext* txn, const NamespaceString& collectionName) {
@@ -202,6 +211,7 @@ namespace mongo {
 
         getGlobalAuthorizationManager()->logOp(txn, "c", dbName.c_str(), cmdObj, nullptr);
         logOpForDbHash(txn, dbName.c_str());
+        getGlobalMaterializedViewCatalog().onNonAppendWrite(txn, collectionName);
     }
 
 } // namespace mongo
@@ -34,6 +34,7 @@
 #include <boost/unordered_set.hpp>
 
 #include "mongo/bson/bsontypes.h"
+#include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/value.h"
 
 namespace mongo {
@@ -89,6 +90,38 @@ namespace mongo {
     };
 
 
+    /**
+     * Estimates the number of distinct values with a HyperLogLog sketch, so memory stays bounded
+     * however many values there are. Counts are exact until kMaxExactHashes distinct hashes have
+     * been seen. The partial result sent to a merger is the sketch itself.
+     */
+    class AccumulatorApproxCountDistinct : public Accumulator {
+    public:
+        virtual void processInternal(const Value& input, bool merging);
+        virtual Value getValue(bool toBeMerged) const;
+        virtual const char* getOpName() const;
+        virtual void reset();
+
+        static boost::intrusive_ptr<Accumulator> create();
+
+        // 2^kPrecision one-byte registers, for a standard error of about 1.04/sqrt(2^kPrecision).
+        static const int kPrecision = 14;
+
+        // Beyond this many hashes the registers take less memory than the hashes themselves.
+        static const size_t kMaxExactHashes = 2048;
+
+    private:
+        AccumulatorApproxCountDistinct();
+
+        void addHash(unsigned long long hash);
+        void addToRegisters(unsigned long long hash);
+        void switchToRegisters();
+
+        std::vector<unsigned long long> _hashes; // sorted, only used while _registers is empty
+        std::vector<unsigned char> _registers;
+    };
+
+
     class AccumulatorFirst : public Accumulator {
     public:
         virtual void processInternal(const Value& input, bool merging);
@@ -157,6 +190,61 @@ namespace mongo {
     };
 
 
+    /**
+     * Estimates percentiles with a t-digest: a bounded set of weighted centroids that is most
+     * precise near the extremes. Used as {$percentile: {input: <expression>, p: <p>}}, where p is
+     * a number or an array of numbers between 0 and 1. Returns a double, or an array of doubles
+     * if p is an array. The partial result sent to a merger is the digest itself.
+     */
+    class AccumulatorPercentile : public Accumulator {
+    public:
+        virtual void processInternal(const Value& input, bool merging);
+        virtual Value getValue(bool toBeMerged) const;
+        virtual const char* getOpName() const;
+        virtual void reset();
+
+        static boost::intrusive_ptr<Accumulator> create();
+
+        /**
+         * Validates the argument of $percentile and returns it with a plain 'p' wrapped in $literal,
+         * since an expression object would take a bare number for a field inclusion.
+         */
+        static BSONObj normalizeSpec(const BSONObj& spec);
+
+        // Bounds the number of centroids to roughly kCompression.
+        static const double kCompression;
+
+    private:
+        AccumulatorPercentile();
+
+        struct Centroid {
+            Centroid() : mean(0), weight(0) {}
+            Centroid(double mean, double weight) : mean(mean), weight(weight) {}
+            bool operator<(const Centroid& other) const { return mean < other.mean; }
+
+            double mean;
+            double weight;
+        };
+
+        void setP(const Value& p);
+        void add(double mean, double weight);
+        void compress();
+        static void compress(std::vector<Centroid>* centroids, double totalWeight);
+        static double quantile(const std::vector<Centroid>& centroids,
+                               double totalWeight,
+                               double min,
+                               double max,
+                               double q);
+
+        Value _p;
+        std::vector<Centroid> _centroids; // sorted and compressed
+        std::vector<Centroid> _buffer; // unsorted points not folded into _centroids yet
+        double _totalWeight;
+        double _min;
+        double _max;
+    };
+
+
     class AccumulatorPush : public Accumulator {
     public:
         virtual void processInternal(const Value& input, bool merging);
@@ -0,0 +1,205 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+    using boost::intrusive_ptr;
+    using std::vector;
+
+namespace {
+
+    // First byte of the partial result sent to a merger.
+    const char kExactFormat = 0; // followed by the sorted hashes, 8 bytes each
+    const char kRegisterFormat = 1; // followed by the registers, one byte each
+
+    const size_t kNumRegisters = size_t(1) << AccumulatorApproxCountDistinct::kPrecision;
+
+    // The MurmurHash3 finalizer. Value::hash_combine is fast but clusters badly in the high bits,
+    // which HyperLogLog depends on.
+    unsigned long long mix(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+} // namespace
+
+    void AccumulatorApproxCountDistinct::processInternal(const Value& input, bool merging) {
+        if (!merging) {
+            if (input.missing())
+                return;
+
+            size_t seed = 0;
+            input.hash_combine(seed);
+            addHash(mix(seed));
+            return;
+        }
+
+        uassert(28708, "bad partial result for $approxCountDistinct",
+                input.getType() == BinData && input.getBinData().length >= 1);
+
+        const BSONBinData data = input.getBinData();
+        const char format = static_cast<const char*>(data.data)[0];
+        const char* bytes = static_cast<const char*>(data.data) + 1;
+        const size_t size = data.length - 1;
+
+        if (format == kExactFormat) {
+            uassert(28709, "bad partial result for $approxCountDistinct", size % 8 == 0);
+            for (size_t offset = 0; offset < size; offset += 8) {
+                addHash(ConstDataView(bytes).read<LittleEndian<unsigned long long> >(offset));
+            }
+            return;
+        }
+
+        uassert(28710, "bad partial result for $approxCountDistinct",
+                format == kRegisterFormat && size == kNumRegisters);
+        if (_registers.empty())
+            switchToRegisters();
+        for (size_t i = 0; i < kNumRegisters; i++) {
+            _registers[i] = std::max(_registers[i], static_cast<unsigned char>(bytes[i]));
+        }
+    }
+
+    void AccumulatorApproxCountDistinct::addHash(unsigned long long hash) {
+        if (!_registers.empty()) {
+            addToRegisters(hash);
+            return;
+        }
+
+        vector<unsigned long long>::iterator it =
+            std::lower_bound(_hashes.begin(), _hashes.end(), hash);
+        if (it != _hashes.end() && *it == hash)
+            return;
+
+        if (_hashes.size() == kMaxExactHashes) {
+            switchToRegisters();
+            addToRegisters(hash);
+            return;
+        }
+
+        _hashes.insert(it, hash);
+        _memUsageBytes = sizeof(*this) + _hashes.capacity() * sizeof(unsigned long long);
+    }
+
+    void AccumulatorApproxCountDistinct::addToRegisters(unsigned long long hash) {
+        // The top kPrecision bits pick the register, which records the longest run of leading
+        // zeros seen in the remaining bits.
+        const size_t index = hash >> (64 - kPrecision);
+        unsigned long long rest = hash << kPrecision;
+
+        unsigned char rank = 1;
+        const unsigned char maxRank = 64 - kPrecision + 1;
+        while (rank < maxRank && !(rest & (1ULL << 63))) {
+            rest <<= 1;
+            rank++;
+        }
+
+        if (rank > _registers[index])
+            _registers[index] = rank;
+    }
+
+    void AccumulatorApproxCountDistinct::switchToRegisters() {
+        _registers.assign(kNumRegisters, 0);
+        for (size_t i = 0; i < _hashes.size(); i++) {
+            addToRegisters(_hashes[i]);
+        }
+        vector<unsigned long long>().swap(_hashes);
+        _memUsageBytes = sizeof(*this) + _registers.capacity();
+    }
+
+    Value AccumulatorApproxCountDistinct::getValue(bool toBeMerged) const {
+        if (toBeMerged) {
+            std::string buf;
+            if (_registers.empty()) {
+                buf.resize(1 + _hashes.size() * 8);
+                buf[0] = kExactFormat;
+                DataView view(&buf[1]);
+                for (size_t i = 0; i < _hashes.size(); i++) {
+                    view.write(tagLittleEndian(_hashes[i]), i * 8);
+                }
+            }
+            else {
+                buf.reserve(1 + kNumRegisters);
+                buf.push_back(kRegisterFormat);
+                buf.append(_registers.begin(), _registers.end());
+            }
+            return Value(BSONBinData(buf.data(), buf.size(), BinDataGeneral));
+        }
+
+        if (_registers.empty())
+            return Value(static_cast<long long>(_hashes.size()));
+
+        const double m = kNumRegisters;
+        double sum = 0;
+        size_t zeros = 0;
+        for (size_t i = 0; i < kNumRegisters; i++) {
+            sum += std::ldexp(1.0, -_registers[i]);
+            if (_registers[i] == 0)
+                zeros++;
+        }
+
+        double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+
+        // Small cardinalities leave registers empty, where linear counting is more accurate.
+        if (estimate <= 2.5 * m && zeros != 0)
+            estimate = m * std::log(m / zeros);
+
+        return Value(static_cast<long long>(estimate + 0.5));
+    }
+
+    AccumulatorApproxCountDistinct::AccumulatorApproxCountDistinct() {
+        _memUsageBytes = sizeof(*this);
+    }
+
+    void AccumulatorApproxCountDistinct::reset() {
+        vector<unsigned long long>().swap(_hashes);
+        vector<unsigned char>().swap(_registers);
+        _memUsageBytes = sizeof(*this);
+    }
+
+    intrusive_ptr<Accumulator> AccumulatorApproxCountDistinct::create() {
+        return new AccumulatorApproxCountDistinct();
+    }
+
+    const char* AccumulatorApproxCountDistinct::getOpName() const {
+        return "$approxCountDistinct";
+    }
+}
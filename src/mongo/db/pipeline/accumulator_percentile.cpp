@@ -0,0 +1,287 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mongo/db/pipeline/accumulator.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/value.h"
+
+namespace mongo {
+
+    using boost::intrusive_ptr;
+    using std::vector;
+
+    const double AccumulatorPercentile::kCompression = 100;
+
+namespace {
+
+    const double kPi = 3.14159265358979323846;
+
+    // Points are buffered and folded into the centroids in batches, which is much cheaper than
+    // inserting them one at a time.
+    const size_t kBufferSize = 5 * static_cast<size_t>(AccumulatorPercentile::kCompression);
+
+    const char kSpecErrorMessage[] =
+        "$percentile requires an object of the form {input: <expression>, p: <p>}, where p is a "
+        "number or an array of numbers between 0 and 1";
+
+    /**
+     * The t-digest scale function: centroids may only span one unit of k, so they are small near
+     * q = 0 and q = 1 and large in the middle.
+     */
+    double scale(double q) {
+        return AccumulatorPercentile::kCompression / (2 * kPi)
+             * std::asin(2 * std::min(1.0, std::max(0.0, q)) - 1);
+    }
+
+    bool isValidP(const Value& p) {
+        return p.numeric() && p.coerceToDouble() >= 0 && p.coerceToDouble() <= 1;
+    }
+
+} // namespace
+
+    BSONObj AccumulatorPercentile::normalizeSpec(const BSONObj& spec) {
+        BSONObjBuilder normalized;
+        bool hasInput = false;
+        bool hasP = false;
+        BSONForEach(elem, spec) {
+            const StringData name = elem.fieldNameStringData();
+            if (name == "input") {
+                hasInput = true;
+                normalized.append(elem);
+            }
+            else if (name == "p") {
+                hasP = true;
+                if (elem.type() == Object)
+                    normalized.append(elem);
+                else
+                    normalized.append("p", BSON("$literal" << elem));
+            }
+            else {
+                uasserted(28711, kSpecErrorMessage);
+            }
+        }
+        uassert(28712, kSpecErrorMessage, hasInput && hasP);
+        return normalized.obj();
+    }
+
+    void AccumulatorPercentile::setP(const Value& p) {
+        if (p.getType() == Array) {
+            const vector<Value>& ps = p.getArray();
+            uassert(28713, kSpecErrorMessage, !ps.empty());
+            for (size_t i = 0; i < ps.size(); i++) {
+                uassert(28729, kSpecErrorMessage, isValidP(ps[i]));
+            }
+        }
+        else {
+            uassert(28730, kSpecErrorMessage, isValidP(p));
+        }
+        _p = p;
+    }
+
+    void AccumulatorPercentile::processInternal(const Value& input, bool merging) {
+        if (!merging) {
+            uassert(28714, kSpecErrorMessage, input.getType() == Object);
+            const Document spec = input.getDocument();
+            if (_p.missing())
+                setP(spec["p"]);
+
+            // Like $avg, non-numeric input is ignored.
+            const Value x = spec["input"];
+            if (!x.numeric())
+                return;
+            const double d = x.coerceToDouble();
+            if (std::isnan(d))
+                return;
+
+            _min = std::min(_min, d);
+            _max = std::max(_max, d);
+            add(d, 1);
+            return;
+        }
+
+        uassert(28715, "bad partial result for $percentile", input.getType() == Object);
+        const Document partial = input.getDocument();
+        if (_p.missing())
+            setP(partial["p"]);
+
+        const Value centroids = partial["centroids"];
+        uassert(28731, "bad partial result for $percentile",
+                centroids.getType() == Array && centroids.getArray().size() % 2 == 0);
+        const vector<Value>& flat = centroids.getArray();
+        if (flat.empty())
+            return;
+
+        _min = std::min(_min, partial["min"].coerceToDouble());
+        _max = std::max(_max, partial["max"].coerceToDouble());
+        for (size_t i = 0; i < flat.size(); i += 2) {
+            add(flat[i].coerceToDouble(), flat[i + 1].coerceToDouble());
+        }
+    }
+
+    void AccumulatorPercentile::add(double mean, double weight) {
+        _buffer.push_back(Centroid(mean, weight));
+        _totalWeight += weight;
+        if (_buffer.size() >= kBufferSize)
+            compress();
+
+        _memUsageBytes = sizeof(*this)
+                       + (_centroids.capacity() + _buffer.capacity()) * sizeof(Centroid);
+    }
+
+    void AccumulatorPercentile::compress() {
+        _buffer.insert(_buffer.end(), _centroids.begin(), _centroids.end());
+        compress(&_buffer, _totalWeight);
+        _centroids.swap(_buffer);
+        _buffer.clear();
+    }
+
+    void AccumulatorPercentile::compress(vector<Centroid>* centroids, double totalWeight) {
+        if (centroids->empty())
+            return;
+
+        std::sort(centroids->begin(), centroids->end());
+
+        // Merge neighbours in place for as long as the merged centroid stays within one unit of
+        // the scale function.
+        vector<Centroid>& c = *centroids;
+        size_t last = 0;
+        double weightBefore = 0;
+        double kLeft = scale(0);
+        for (size_t i = 1; i < c.size(); i++) {
+            const double q = (weightBefore + c[last].weight + c[i].weight) / totalWeight;
+            if (scale(q) - kLeft <= 1) {
+                c[last].weight += c[i].weight;
+                c[last].mean += (c[i].mean - c[last].mean) * c[i].weight / c[last].weight;
+            }
+            else {
+                weightBefore += c[last].weight;
+                kLeft = scale(weightBefore / totalWeight);
+                c[++last] = c[i];
+            }
+        }
+        c.resize(last + 1);
+    }
+
+    double AccumulatorPercentile::quantile(const vector<Centroid>& c,
+                                           double totalWeight,
+                                           double min,
+                                           double max,
+                                           double q) {
+        // Each centroid's mean is taken to sit at the middle of its weight. Between those points,
+        // and between the outer centroids and the exact min and max, interpolate linearly.
+        const double target = q * totalWeight;
+        if (target <= 0)
+            return min;
+        if (target >= totalWeight)
+            return max;
+
+        if (target < c.front().weight / 2) {
+            return min + (c.front().mean - min) * target / (c.front().weight / 2);
+        }
+
+        double weightBefore = 0;
+        for (size_t i = 0; i + 1 < c.size(); i++) {
+            const double left = weightBefore + c[i].weight / 2;
+            const double right = weightBefore + c[i].weight + c[i + 1].weight / 2;
+            if (target <= right) {
+                return c[i].mean + (c[i + 1].mean - c[i].mean) * (target - left) / (right - left);
+            }
+            weightBefore += c[i].weight;
+        }
+
+        const double left = totalWeight - c.back().weight / 2;
+        return c.back().mean + (max - c.back().mean) * (target - left) / (c.back().weight / 2);
+    }
+
+    Value AccumulatorPercentile::getValue(bool toBeMerged) const {
+        vector<Centroid> centroids(_centroids);
+        if (!_buffer.empty()) {
+            centroids.insert(centroids.end(), _buffer.begin(), _buffer.end());
+            compress(&centroids, _totalWeight);
+        }
+
+        if (toBeMerged) {
+            vector<Value> flat;
+            flat.reserve(centroids.size() * 2);
+            for (size_t i = 0; i < centroids.size(); i++) {
+                flat.push_back(Value(centroids[i].mean));
+                flat.push_back(Value(centroids[i].weight));
+            }
+            return Value(DOC("p" << _p
+                          << "min" << _min
+                          << "max" << _max
+                          << "centroids" << flat));
+        }
+
+        if (centroids.empty())
+            return Value(BSONNULL);
+
+        if (_p.getType() != Array)
+            return Value(quantile(centroids, _totalWeight, _min, _max, _p.coerceToDouble()));
+
+        const vector<Value>& ps = _p.getArray();
+        vector<Value> result;
+        result.reserve(ps.size());
+        for (size_t i = 0; i < ps.size(); i++) {
+            result.push_back(
+                Value(quantile(centroids, _totalWeight, _min, _max, ps[i].coerceToDouble())));
+        }
+        return Value(result);
+    }
+
+    AccumulatorPercentile::AccumulatorPercentile()
+        : _totalWeight(0)
+        , _min(std::numeric_limits<double>::infinity())
+        , _max(-std::numeric_limits<double>::infinity()) {
+        _memUsageBytes = sizeof(*this);
+    }
+
+    void AccumulatorPercentile::reset() {
+        _p = Value();
+        vector<Centroid>().swap(_centroids);
+        vector<Centroid>().swap(_buffer);
+        _totalWeight = 0;
+        _min = std::numeric_limits<double>::infinity();
+        _max = -std::numeric_limits<double>::infinity();
+        _memUsageBytes = sizeof(*this);
+    }
+
+    intrusive_ptr<Accumulator> AccumulatorPercentile::create() {
+        return new AccumulatorPercentile();
+    }
+
+    const char* AccumulatorPercentile::getOpName() const {
+        return "$percentile";
+    }
+}
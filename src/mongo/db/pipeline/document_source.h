@@ -34,6 +34,8 @@
 #include <boost/intrusive_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/unordered_map.hpp>
 #include <deque>
 
@@ -48,6 +50,7 @@
 #include "mongo/db/pipeline/value.h"
 #include "mongo/db/sorter/sorter.h"
 #include "mongo/s/strategy.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/intrusive_counter.h"
 
 
@@ -467,6 +470,13 @@ namespace mongo {
         /// Tell this source if it is doing a merge from shards. Defaults to false.
         void setDoingMerge(bool doingMerge) { _doingMerge = doingMerge; }
 
+        /**
+         * Returns true if this is {$group: {_id: "$<path>"}}, optionally with one
+         * {<name>: {$sum: 1}} accumulator. On success 'groupField' is set to the path and
+         * 'countField' to the accumulator's name, or cleared if there is none.
+         */
+        bool isCountByField(std::string* groupField, std::string* countField) const;
+
         /**
           Create a grouping DocumentSource from BSON.
 
@@ -565,6 +575,148 @@ namespace mongo {
     };
 
 
+    /**
+     * Performs a left outer equality join against an unsharded collection in the same database.
+     * Each input document gets an array field containing every foreign document whose
+     * foreignField equals the input's localField.
+     *
+     * The join strategy is picked on the first call to getNext():
+     *   - If the foreign collection has an index prefixed by foreignField, input documents are
+     *     buffered in batches and each batch is probed with a single $in query so that the
+     *     foreign index is traversed once per batch rather than once per input document.
+     *   - Otherwise the foreign collection is scanned once to build an in-memory hash table
+     *     keyed on foreignField. If that table would exceed the memory limit and disk use is
+     *     allowed, the foreign documents are spilled to disk sorted by key instead, and joined
+     *     with the input after sorting it by key too. Without disk use the build is abandoned and
+     *     the batched probing is used instead, trading the memory for one collection scan per
+     *     batch.
+     */
+    class DocumentSourceLookUp : public DocumentSource
+                               , public SplittableDocumentSource
+                               , public DocumentSourceNeedsMongod {
+    public:
+        // virtuals from DocumentSource
+        virtual boost::optional<Document> getNext();
+        virtual const char *getSourceName() const;
+        virtual void dispose();
+        virtual Value serialize(bool explain = false) const;
+        virtual GetDepsReturn getDependencies(DepsTracker* deps) const;
+
+        // Virtuals for SplittableDocumentSource
+        // The foreign collection only lives on the primary shard, so this must run in the merger.
+        virtual boost::intrusive_ptr<DocumentSource> getShardSource() { return NULL; }
+        virtual boost::intrusive_ptr<DocumentSource> getMergeSource() { return this; }
+
+        const NamespaceString& getFromNs() const { return _fromNs; }
+
+        static boost::intrusive_ptr<DocumentSource> createFromBson(
+            BSONElement elem,
+            const boost::intrusive_ptr<ExpressionContext> &pExpCtx);
+
+        static const char lookupName[];
+
+        // Bounds on the input documents that share a single probe of the foreign collection.
+        static const size_t kMaxProbeBatchSize = 1000;
+        static const int kMaxProbeBatchKeyBytes = 1024 * 1024;
+
+    private:
+        enum JoinStrategy {
+            kUndecided,
+            kHashJoin,
+            kIndexNestedLoop,
+            kSortMergeJoin, // hash build exceeded the memory limit and was spilled to disk
+            kBlockNestedLoop, // hash build exceeded the memory limit, disk use not allowed
+        };
+
+        DocumentSourceLookUp(const NamespaceString& fromNs,
+                             const std::string& as,
+                             const std::string& localField,
+                             const std::string& foreignField,
+                             const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+        static const char* strategyName(JoinStrategy strategy);
+
+        /// Picks _strategy and, for kHashJoin, builds _hashTable.
+        void chooseStrategy();
+
+        /// Returns true if the foreign collection has an index usable for equality on foreignField.
+        bool foreignFieldIsIndexed();
+
+        /**
+         * Scans the foreign collection into _hashTable. Returns false if the memory limit is hit,
+         * in which case the foreign collection is in _buildSorter if disk use is allowed.
+         */
+        bool buildHashTable();
+
+        /// Moves _hashTable into _buildSorter and adds 'next' and the rest of 'cursor' to it.
+        void spillBuildSide(DBClientCursor* cursor, const BSONObj& next);
+
+        /**
+         * Consumes all of pSource and joins it with _buildSorter on disk, leaving the input in
+         * _spilledInput and the matches for each input in _spilledMatches, both in input order.
+         */
+        void joinSpilled();
+
+        /// Returns the next input joined by joinSpilled() with its matches attached.
+        boost::optional<Document> getNextSpilled();
+
+        /// Refills _probeBatch from pSource and runs one foreign query for the whole batch.
+        void loadProbeBatch();
+
+        /// Appends 'foreignDoc' to _foreignDocs and indexes it under each of its foreignField keys.
+        void addToTable(const BSONObj& foreignDoc);
+
+        /// Returns the distinct keys under which an equality match on foreignField finds 'doc'.
+        std::vector<Value> extractForeignKeys(const BSONObj& doc) const;
+
+        /// Returns the keys that the localField of 'input' should be looked up with.
+        std::vector<Value> extractLocalKeys(const Document& input) const;
+
+        /// Attaches the foreign documents matching 'input' as the 'as' field.
+        Document makeOutput(const Document& input) const;
+
+        /// Adds 'match' to 'matches', failing if they no longer fit in one document.
+        void addMatch(const Value& match, std::vector<Value>* matches, size_t* matchBytes) const;
+
+        SortOptions makeSortOptions() const;
+
+        // Positions are stored with the foreign documents so that the matches of each input come
+        // out in the foreign scan order, as they do from the in-memory hash table.
+        typedef Sorter<Value, Value> KeySorter;
+        typedef Sorter<Value, Document> InputSorter;
+
+        /// Maps a foreignField key to positions in _foreignDocs, in natural order.
+        typedef boost::unordered_map<Value, std::vector<size_t>, Value::Hash> ForeignTable;
+
+        const NamespaceString _fromNs;
+        const FieldPath _as;
+        const FieldPath _localField;
+        const FieldPath _foreignField;
+        const int _maxMemoryUsageBytes;
+        const bool _extSortAllowed;
+
+        JoinStrategy _strategy;
+
+        // For kHashJoin this holds the whole foreign collection. For the nested loop strategies it
+        // only holds the foreign documents matching _probeBatch.
+        ForeignTable _hashTable;
+        std::vector<Value> _foreignDocs;
+        std::deque<Document> _probeBatch;
+        bool _inputExhausted;
+
+        // Only used by kSortMergeJoin. _buildSorter maps each key of the foreign collection to
+        // [position, document]. Once joined, _spilledInput holds the input keyed by its position
+        // and _spilledMatches maps that position to [foreign position, document] for each match.
+        boost::scoped_ptr<KeySorter> _buildSorter;
+        boost::scoped_ptr<InputSorter::Iterator> _spilledInput;
+        boost::scoped_ptr<KeySorter::Iterator> _spilledMatches;
+        boost::optional<KeySorter::Data> _nextMatch;
+
+        // Stats reported in explain.
+        long long _numProbes;
+    };
+
+
     class DocumentSourceMatch : public DocumentSource {
     public:
         // virtuals from DocumentSource
@@ -613,11 +765,21 @@ namespace mongo {
         bool _isTextQuery;
     };
 
+    /**
+     * Merges the cursors the shards opened for the first half of a split pipeline.
+     *
+     * Each shard is read ahead on a small thread pool so that the getMore for a shard's next
+     * batch is on the wire while its current batch is being consumed. At most
+     * aggregationMergeCursorsBufferBytes of documents are buffered per shard before its reader
+     * stops issuing getMores; a single batch may overshoot that bound.
+     */
     class DocumentSourceMergeCursors :
         public DocumentSource {
     public:
         typedef std::vector<std::pair<ConnectionString, CursorId> > CursorIds;
 
+        virtual ~DocumentSourceMergeCursors();
+
         // virtuals from DocumentSource
         boost::optional<Document> getNext();
         virtual void setSource(DocumentSource *pSource);
@@ -636,17 +798,17 @@ namespace mongo {
 
         static const char name[];
 
-        /** Returns non-owning pointers to cursors managed by this stage.
-         *  Call this instead of getNext() if you want access to the raw streams.
-         *  This method should only be called at most once.
+        /** Starts reading ahead from every shard and returns the number of shard streams.
+         *  Call this instead of getNext() if you want to merge the streams yourself, pulling
+         *  each one with getNextFrom(). This method should only be called at most once.
          */
-        std::vector<DBClientCursor*> getCursors();
+        size_t startStreams();
 
         /**
-         * Returns the next object from the cursor, throwing an appropriate exception if the cursor
-         * reported an error. This is a better form of DBClientCursor::nextSafe.
+         * Returns the next document from shard stream 'stream', blocking until the prefetcher
+         * has read it. Throws if the shard reported an error.
          */
-        static Document nextSafeFrom(DBClientCursor* cursor);
+        boost::optional<Document> getNextFrom(size_t stream);
 
     private:
 
@@ -654,26 +816,55 @@ namespace mongo {
             CursorAndConnection(ConnectionString host, NamespaceString ns, CursorId id);
             ScopedDbConnection connection;
             DBClientCursor cursor;
+            const std::string host;
+
+            // The members below are guarded by the owning stage's _mutex. 'connection' and
+            // 'cursor' are only touched by one prefetch task at a time once start() returns.
+            std::deque<BSONObj> buffer; // owned documents read ahead of the consumer
+            size_t bufferedBytes;
+            bool fetching; // a prefetch task for this cursor is scheduled or running
+            bool exhausted; // no more batches; 'buffer' may still hold documents
+            Status error; // set if a prefetch task failed
         };
 
-        // using list to enable removing arbitrary elements
-        typedef std::list<boost::shared_ptr<CursorAndConnection> > Cursors;
+        typedef std::vector<boost::shared_ptr<CursorAndConnection> > Cursors;
 
         DocumentSourceMergeCursors(
             const CursorIds& cursorIds,
             const boost::intrusive_ptr<ExpressionContext> &pExpCtx);
 
-        // Converts _cursorIds into active _cursors.
+        // Converts _cursorIds into active _cursors and starts prefetching.
         void start();
 
+        // Schedules a prefetch task for 'cursor' unless one is pending, the cursor is done or
+        // enough is already buffered. Caller must hold _mutex.
+        void _scheduleFetch_inlock(CursorAndConnection* cursor);
+
+        // Runs on _prefetchPool. Reads the cursor's next batch into its buffer.
+        void _fetchBatch(CursorAndConnection* cursor);
+
+        // Moves the next buffered document of 'cursor' into 'out'. Returns false if nothing is
+        // buffered and throws if the cursor failed. Caller must hold _mutex.
+        bool _popBuffered_inlock(CursorAndConnection* cursor, BSONObj* out);
+
+        // Converts a document from a shard, throwing if it is an error reply.
+        static Document _checkedDocument(const BSONObj& obj, const CursorAndConnection& cursor);
+
         // This is the description of cursors to merge.
         const CursorIds _cursorIds;
 
         // These are the actual cursors we are merging. Created lazily.
         Cursors _cursors;
-        Cursors::iterator _currentCursor;
+        size_t _currentCursor; // where getNext() starts looking for a buffered document
 
         bool _unstarted;
+        bool _disposed;
+
+        boost::mutex _mutex;
+        boost::condition_variable _fetched; // signaled whenever a prefetch task finishes
+
+        // Declared after _cursors so its destructor joins the tasks before the cursors go away.
+        boost::scoped_ptr<ThreadPool> _prefetchPool;
     };
 
     class DocumentSourceOut : public DocumentSource
@@ -871,9 +1062,9 @@ namespace mongo {
         // These are used to merge pre-sorted results from a DocumentSourceMergeCursors or a
         // DocumentSourceCommandShards depending on whether we have finished upgrading to 2.6 or
         // not.
-        class IteratorFromCursor;
+        class IteratorFromMergeCursors;
         class IteratorFromBsonArray;
-        void populateFromCursors(const std::vector<DBClientCursor*>& cursors);
+        void populateFromMergeCursors(DocumentSourceMergeCursors* source);
         void populateFromBsonArrays(const std::vector<BSONArray>& arrays);
 
         /* these two parallel each other */
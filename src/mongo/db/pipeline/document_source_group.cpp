@@ -42,6 +42,7 @@ namespace mongo {
     using boost::intrusive_ptr;
     using boost::shared_ptr;
     using std::pair;
+    using std::string;
     using std::vector;
 
     const char DocumentSourceGroup::groupName[] = "$group";
@@ -235,11 +236,13 @@ namespace mongo {
     */
     static const GroupOpDesc GroupOpTable[] = {
         {"$addToSet", AccumulatorAddToSet::create},
+        {"$approxCountDistinct", AccumulatorApproxCountDistinct::create},
         {"$avg", AccumulatorAvg::create},
         {"$first", AccumulatorFirst::create},
         {"$last", AccumulatorLast::create},
         {"$max", AccumulatorMinMax::createMax},
         {"$min", AccumulatorMinMax::createMin},
+        {"$percentile", AccumulatorPercentile::create},
         {"$push", AccumulatorPush::create},
         {"$sum", AccumulatorSum::create},
     };
@@ -316,8 +319,12 @@ namespace mongo {
 
                     BSONType elementType = subElement.type();
                     if (elementType == Object) {
+                        BSONObj operand = subElement.Obj();
+                        if (pOp->factory == AccumulatorPercentile::create)
+                            operand = AccumulatorPercentile::normalizeSpec(operand);
+
                         Expression::ObjectCtx oCtx(Expression::ObjectCtx::DOCUMENT_OK);
-                        pGroupExpr = Expression::parseObject(subElement.Obj(), &oCtx, vps);
+                        pGroupExpr = Expression::parseObject(operand, &oCtx, vps);
                     }
                     else if (elementType == Array) {
                         uasserted(15953, str::stream()
@@ -595,6 +602,39 @@ namespace mongo {
         return out.freeze();
     }
 
+    bool DocumentSourceGroup::isCountByField(string* groupField, string* countField) const {
+        if (_doingMerge || !_idFieldNames.empty() || _idExpressions.size() != 1)
+            return false;
+
+        const ExpressionFieldPath* idPath =
+            dynamic_cast<const ExpressionFieldPath*>(_idExpressions[0].get());
+        if (!idPath || idPath->getFieldPath().getPathLength() < 2
+                    || idPath->getFieldPath().getFieldName(0) != "CURRENT") {
+            return false;
+        }
+
+        if (vFieldName.size() > 1)
+            return false;
+
+        if (vFieldName.size() == 1) {
+            if (vpAccumulatorFactory[0] != AccumulatorSum::create)
+                return false;
+
+            // Only an int 1, since other constants change the type or value of the sum.
+            const ExpressionConstant* constant =
+                dynamic_cast<const ExpressionConstant*>(vpExpression[0].get());
+            if (!constant)
+                return false;
+            const Value one = constant->getValue();
+            if (one.getType() != NumberInt || one.getInt() != 1)
+                return false;
+        }
+
+        *groupField = idPath->getFieldPath().tail().getPath(false);
+        *countField = vFieldName.empty() ? string() : vFieldName[0];
+        return true;
+    }
+
     intrusive_ptr<DocumentSource> DocumentSourceGroup::getShardSource() {
         return this; // No modifications necessary when on shard
     }
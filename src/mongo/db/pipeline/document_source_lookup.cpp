@@ -0,0 +1,551 @@
+/**
+ * Copyright (C) 2015 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects for
+ * all of the code used other than as permitted herein. If you modify file(s)
+ * with this exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do so,
+ * delete this exception statement from your version. If you delete this
+ * exception statement from all source files in the program, then also delete
+ * it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <set>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/pipeline/document.h"
+#include "mongo/db/pipeline/expression.h"
+#include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+    using boost::intrusive_ptr;
+    using boost::scoped_ptr;
+    using std::auto_ptr;
+    using std::string;
+    using std::vector;
+
+    // Past this many bytes of foreign documents the hash build gives way to a join on disk.
+    MONGO_EXPORT_SERVER_PARAMETER(aggregationLookupMaxMemoryBytes, int, 100 * 1024 * 1024);
+
+namespace {
+
+    /**
+     * Orders pairs by key and then by value. The values are either positions or arrays that start
+     * with a position, so entries with equal keys keep the order they were numbered in.
+     */
+    class KeyThenValueComparator {
+    public:
+        typedef std::pair<Value, Value> Data;
+        int operator()(const Data& lhs, const Data& rhs) const {
+            const int cmp = Value::compare(lhs.first, rhs.first);
+            return cmp ? cmp : Value::compare(lhs.second, rhs.second);
+        }
+    };
+
+    class KeyComparator {
+    public:
+        typedef std::pair<Value, Document> Data;
+        int operator()(const Data& lhs, const Data& rhs) const {
+            return Value::compare(lhs.first, rhs.first);
+        }
+    };
+
+    Value positioned(long long position, const Value& doc) {
+        vector<Value> out;
+        out.push_back(Value(position));
+        out.push_back(doc);
+        return Value(std::move(out));
+    }
+
+    boost::optional<std::pair<Value, Value> > nextOrNone(Sorter<Value, Value>::Iterator* it) {
+        if (!it->more())
+            return boost::none;
+        return it->next();
+    }
+
+} // namespace
+
+    const char DocumentSourceLookUp::lookupName[] = "$lookup";
+
+    const char *DocumentSourceLookUp::getSourceName() const {
+        return lookupName;
+    }
+
+    DocumentSourceLookUp::DocumentSourceLookUp(const NamespaceString& fromNs,
+                                               const string& as,
+                                               const string& localField,
+                                               const string& foreignField,
+                                               const intrusive_ptr<ExpressionContext>& pExpCtx)
+        : DocumentSource(pExpCtx)
+        , _fromNs(fromNs)
+        , _as(as)
+        , _localField(localField)
+        , _foreignField(foreignField)
+        , _maxMemoryUsageBytes(aggregationLookupMaxMemoryBytes)
+        , _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter)
+        , _strategy(kUndecided)
+        , _inputExhausted(false)
+        , _numProbes(0)
+    {}
+
+    const char* DocumentSourceLookUp::strategyName(JoinStrategy strategy) {
+        switch (strategy) {
+        case kUndecided: return "undecided";
+        case kHashJoin: return "hashJoin";
+        case kIndexNestedLoop: return "indexNestedLoop";
+        case kSortMergeJoin: return "sortMergeJoin";
+        case kBlockNestedLoop: return "blockNestedLoop";
+        }
+        verify(false);
+    }
+
+    boost::optional<Document> DocumentSourceLookUp::getNext() {
+        pExpCtx->checkForInterrupt();
+
+        if (_strategy == kUndecided)
+            chooseStrategy();
+
+        if (_strategy == kHashJoin) {
+            boost::optional<Document> input = pSource->getNext();
+            if (!input)
+                return boost::none;
+            return makeOutput(*input);
+        }
+
+        if (_strategy == kSortMergeJoin)
+            return getNextSpilled();
+
+        // Nested loop strategies work on a buffered batch of input documents.
+        if (_probeBatch.empty()) {
+            loadProbeBatch();
+            if (_probeBatch.empty())
+                return boost::none;
+        }
+
+        Document out = makeOutput(_probeBatch.front());
+        _probeBatch.pop_front();
+        return out;
+    }
+
+    void DocumentSourceLookUp::dispose() {
+        _hashTable.clear();
+        _foreignDocs.clear();
+        _probeBatch.clear();
+        _buildSorter.reset();
+        _spilledInput.reset();
+        _spilledMatches.reset();
+        _nextMatch = boost::none;
+        pSource->dispose();
+    }
+
+    void DocumentSourceLookUp::chooseStrategy() {
+        verify(_mongod);
+
+        uassert(28700, str::stream() << "namespace '" << _fromNs.ns()
+                                     << "' is sharded so it can't be used for $lookup",
+                !_mongod->isSharded(_fromNs));
+
+        if (foreignFieldIsIndexed()) {
+            _strategy = kIndexNestedLoop;
+        }
+        else if (buildHashTable()) {
+            _strategy = kHashJoin;
+        }
+        else if (_buildSorter) {
+            _strategy = kSortMergeJoin;
+        }
+        else {
+            _strategy = kBlockNestedLoop;
+        }
+    }
+
+    bool DocumentSourceLookUp::foreignFieldIsIndexed() {
+        const string foreignPath = _foreignField.getPath(false);
+        const std::list<BSONObj> indexes =
+            _mongod->directClient()->getIndexSpecs(_fromNs.ns());
+        for (std::list<BSONObj>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+            const BSONObj keyPattern = it->getObjectField("key");
+            // Sparse indexes can't answer the null probes used for missing fields.
+            if (it->getBoolField("sparse"))
+                continue;
+
+            BSONElement firstKey = keyPattern.firstElement();
+            if (firstKey.eoo() || foreignPath != firstKey.fieldName())
+                continue;
+
+            // Only btree and hashed indexes can be used for point lookups.
+            if (firstKey.isNumber() || str::equals(firstKey.valuestrsafe(), "hashed"))
+                return true;
+        }
+        return false;
+    }
+
+    bool DocumentSourceLookUp::buildHashTable() {
+        auto_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_fromNs.ns(), Query());
+
+        long long memoryUsageBytes = 0;
+        while (cursor->more()) {
+            pExpCtx->checkForInterrupt();
+
+            BSONObj foreignDoc = cursor->nextSafe();
+            memoryUsageBytes += foreignDoc.objsize();
+            if (memoryUsageBytes > _maxMemoryUsageBytes) {
+                // Without disk, give up on the build rather than fail the aggregation. The nested
+                // loop strategy only needs to hold the foreign documents matching one batch.
+                if (_extSortAllowed)
+                    spillBuildSide(cursor.get(), foreignDoc);
+                _hashTable.clear();
+                _foreignDocs.clear();
+                return false;
+            }
+
+            addToTable(foreignDoc);
+        }
+
+        return true;
+    }
+
+    void DocumentSourceLookUp::spillBuildSide(DBClientCursor* cursor, const BSONObj& next) {
+        _buildSorter.reset(KeySorter::make(makeSortOptions(), KeyThenValueComparator()));
+        for (ForeignTable::const_iterator it = _hashTable.begin(); it != _hashTable.end(); ++it) {
+            for (size_t i = 0; i < it->second.size(); i++) {
+                const size_t position = it->second[i];
+                _buildSorter->add(it->first, positioned(position, _foreignDocs[position]));
+            }
+        }
+
+        long long position = _foreignDocs.size();
+        BSONObj foreignDoc = next;
+        while (true) {
+            const Value doc = Value(Document(foreignDoc));
+            const vector<Value> keys = extractForeignKeys(foreignDoc);
+            for (vector<Value>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+                _buildSorter->add(*it, positioned(position, doc));
+            }
+            position++;
+
+            if (!cursor->more())
+                break;
+            pExpCtx->checkForInterrupt();
+            foreignDoc = cursor->nextSafe();
+        }
+    }
+
+    void DocumentSourceLookUp::joinSpilled() {
+        // Number the input so that it can be put back in order once it has been sorted by key.
+        scoped_ptr<InputSorter> inputSorter(InputSorter::make(makeSortOptions(), KeyComparator()));
+        scoped_ptr<KeySorter> probeSorter(KeySorter::make(makeSortOptions(),
+                                                          KeyThenValueComparator()));
+        long long position = 0;
+        while (boost::optional<Document> input = pSource->getNext()) {
+            pExpCtx->checkForInterrupt();
+
+            ValueSet seen;
+            const vector<Value> localKeys = extractLocalKeys(*input);
+            for (vector<Value>::const_iterator it = localKeys.begin(); it != localKeys.end(); ++it) {
+                if (seen.insert(*it).second)
+                    probeSorter->add(*it, Value(position));
+            }
+            inputSorter->add(Value(position), *input);
+            position++;
+        }
+        _spilledInput.reset(inputSorter->done());
+
+        // Both sides are sorted by key now, so one pass over each finds every match. The matches
+        // are sorted again by input position to come out alongside their input.
+        scoped_ptr<KeySorter::Iterator> build(_buildSorter->done());
+        _buildSorter.reset();
+        scoped_ptr<KeySorter::Iterator> probe(probeSorter->done());
+        scoped_ptr<KeySorter> matchSorter(KeySorter::make(makeSortOptions(),
+                                                          KeyThenValueComparator()));
+
+        boost::optional<KeySorter::Data> nextBuild = nextOrNone(build.get());
+        boost::optional<KeySorter::Data> nextProbe = nextOrNone(probe.get());
+        vector<Value> inputs;
+        while (nextProbe && nextBuild) {
+            pExpCtx->checkForInterrupt();
+
+            const Value key = nextProbe->first;
+            inputs.clear();
+            while (nextProbe && Value::compare(nextProbe->first, key) == 0) {
+                inputs.push_back(nextProbe->second);
+                nextProbe = nextOrNone(probe.get());
+            }
+
+            while (nextBuild && Value::compare(nextBuild->first, key) < 0) {
+                nextBuild = nextOrNone(build.get());
+            }
+            while (nextBuild && Value::compare(nextBuild->first, key) == 0) {
+                for (size_t i = 0; i < inputs.size(); i++) {
+                    matchSorter->add(inputs[i], nextBuild->second);
+                }
+                nextBuild = nextOrNone(build.get());
+            }
+        }
+
+        _spilledMatches.reset(matchSorter->done());
+        _nextMatch = nextOrNone(_spilledMatches.get());
+    }
+
+    boost::optional<Document> DocumentSourceLookUp::getNextSpilled() {
+        if (!_spilledInput)
+            joinSpilled();
+
+        if (!_spilledInput->more())
+            return boost::none;
+        const InputSorter::Data input = _spilledInput->next();
+
+        vector<Value> matches;
+        size_t matchBytes = 0;
+        Value lastPosition;
+        while (_nextMatch && Value::compare(_nextMatch->first, input.first) == 0) {
+            // A foreign document shows up once for every key it shares with the input.
+            const vector<Value>& match = _nextMatch->second.getArray();
+            if (matches.empty() || Value::compare(match[0], lastPosition) != 0) {
+                lastPosition = match[0];
+                addMatch(match[1], &matches, &matchBytes);
+            }
+            _nextMatch = nextOrNone(_spilledMatches.get());
+        }
+
+        MutableDocument output(input.second);
+        output.setNestedField(_as, Value(matches));
+        return output.freeze();
+    }
+
+    SortOptions DocumentSourceLookUp::makeSortOptions() const {
+        return SortOptions().MaxMemoryUsageBytes(_maxMemoryUsageBytes)
+                            .ExtSortAllowed()
+                            .TempDir(pExpCtx->tempDir);
+    }
+
+    void DocumentSourceLookUp::loadProbeBatch() {
+        _hashTable.clear();
+        _foreignDocs.clear();
+
+        if (_inputExhausted)
+            return;
+
+        // Gather a batch of input documents along with the distinct keys they are looking for.
+        ValueSet keys;
+        int keyBytes = 0;
+        while (_probeBatch.size() < kMaxProbeBatchSize && keyBytes < kMaxProbeBatchKeyBytes) {
+            boost::optional<Document> input = pSource->getNext();
+            if (!input) {
+                _inputExhausted = true;
+                break;
+            }
+
+            const vector<Value> localKeys = extractLocalKeys(*input);
+            for (vector<Value>::const_iterator it = localKeys.begin(); it != localKeys.end(); ++it) {
+                if (keys.insert(*it).second)
+                    keyBytes += it->getApproximateSize();
+            }
+
+            _probeBatch.push_back(*input);
+        }
+
+        if (_probeBatch.empty())
+            return;
+
+        // Probe the foreign collection once for the whole batch. The $in becomes a single index
+        // scan over one point interval per key when foreignField is indexed.
+        BSONObjBuilder query;
+        {
+            BSONObjBuilder inBuilder(query.subobjStart(_foreignField.getPath(false)));
+            BSONArrayBuilder inArray(inBuilder.subarrayStart("$in"));
+            for (ValueSet::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+                it->addToBsonArray(&inArray);
+            }
+            inArray.doneFast();
+            inBuilder.doneFast();
+        }
+
+        auto_ptr<DBClientCursor> cursor =
+            _mongod->directClient()->query(_fromNs.ns(), Query(query.obj()));
+        _numProbes++;
+
+        while (cursor->more()) {
+            pExpCtx->checkForInterrupt();
+            addToTable(cursor->nextSafe());
+        }
+    }
+
+    void DocumentSourceLookUp::addToTable(const BSONObj& foreignDoc) {
+        const size_t position = _foreignDocs.size();
+        _foreignDocs.push_back(Value(Document(foreignDoc)));
+
+        const vector<Value> keys = extractForeignKeys(foreignDoc);
+        for (vector<Value>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+            _hashTable[*it].push_back(position);
+        }
+    }
+
+    vector<Value> DocumentSourceLookUp::extractForeignKeys(const BSONObj& doc) const {
+        // An equality predicate on foreignField matches an array either as a whole or by any of
+        // its elements, so the document is reachable under all of those keys.
+        const string foreignPath = _foreignField.getPath(false);
+        BSONElementSet elements;
+        doc.getFieldsDotted(foreignPath, elements, /*expandLastArray*/true);
+        doc.getFieldsDotted(foreignPath, elements, /*expandLastArray*/false);
+
+        vector<Value> keys;
+        if (elements.empty()) {
+            // A missing field compares equal to null.
+            keys.push_back(Value(BSONNULL));
+            return keys;
+        }
+
+        ValueSet seen;
+        for (BSONElementSet::const_iterator it = elements.begin(); it != elements.end(); ++it) {
+            Value key(*it);
+            if (key.missing() || key.getType() == Undefined)
+                key = Value(BSONNULL);
+            if (seen.insert(key).second)
+                keys.push_back(key);
+        }
+        return keys;
+    }
+
+    vector<Value> DocumentSourceLookUp::extractLocalKeys(const Document& input) const {
+        vector<Value> out;
+        Value local = input.getNestedField(_localField);
+        if (local.missing() || local.getType() == Undefined) {
+            out.push_back(Value(BSONNULL));
+        }
+        else if (local.getType() == Array) {
+            const vector<Value>& elements = local.getArray();
+            if (elements.empty())
+                out.push_back(Value(BSONNULL));
+            out.insert(out.end(), elements.begin(), elements.end());
+        }
+        else {
+            out.push_back(local);
+        }
+        return out;
+    }
+
+    Document DocumentSourceLookUp::makeOutput(const Document& input) const {
+        // Use an ordered set so that the matches come out in the foreign scan order and a foreign
+        // document reachable through several of the input's keys is only attached once.
+        std::set<size_t> positions;
+        const vector<Value> localKeys = extractLocalKeys(input);
+        for (vector<Value>::const_iterator key = localKeys.begin(); key != localKeys.end(); ++key) {
+            ForeignTable::const_iterator bucket = _hashTable.find(*key);
+            if (bucket == _hashTable.end())
+                continue;
+            positions.insert(bucket->second.begin(), bucket->second.end());
+        }
+
+        vector<Value> matches;
+        matches.reserve(positions.size());
+        size_t matchBytes = 0;
+        for (std::set<size_t>::const_iterator it = positions.begin(); it != positions.end(); ++it) {
+            addMatch(_foreignDocs[*it], &matches, &matchBytes);
+        }
+
+        MutableDocument output(input);
+        output.setNestedField(_as, Value(matches));
+        return output.freeze();
+    }
+
+    void DocumentSourceLookUp::addMatch(const Value& match,
+                                        vector<Value>* matches,
+                                        size_t* matchBytes) const {
+        matches->push_back(match);
+        *matchBytes += match.getApproximateSize();
+        uassert(28701, str::stream() << "Total size of documents in " << _fromNs.coll()
+                                     << " matching a single input document exceeds maximum"
+                                        " document size",
+                *matchBytes < size_t(BSONObjMaxUserSize));
+    }
+
+    Value DocumentSourceLookUp::serialize(bool explain) const {
+        MutableDocument spec(DOC("from" << _fromNs.coll()
+                              << "as" << _as.getPath(false)
+                              << "localField" << _localField.getPath(false)
+                              << "foreignField" << _foreignField.getPath(false)));
+        if (explain) {
+            spec["strategy"] = Value(strategyName(_strategy));
+            spec["probes"] = Value(_numProbes);
+        }
+        return Value(DOC(getSourceName() << spec.freeze()));
+    }
+
+    DocumentSource::GetDepsReturn DocumentSourceLookUp::getDependencies(DepsTracker* deps) const {
+        deps->fields.insert(_localField.getPath(false));
+        return SEE_NEXT;
+    }
+
+    intrusive_ptr<DocumentSource> DocumentSourceLookUp::createFromBson(
+            BSONElement elem,
+            const intrusive_ptr<ExpressionContext>& pExpCtx) {
+        uassert(28702, "the $lookup specification must be an Object",
+                elem.type() == Object);
+
+        string from;
+        string as;
+        string localField;
+        string foreignField;
+
+        BSONForEach(argument, elem.Obj()) {
+            const StringData argName = argument.fieldNameStringData();
+            uassert(28703, str::stream() << "arguments to $lookup must be strings, "
+                                         << argName << ": " << argument
+                                         << " is type " << typeName(argument.type()),
+                    argument.type() == String);
+
+            if (argName == "from") {
+                from = argument.String();
+            }
+            else if (argName == "as") {
+                as = argument.String();
+            }
+            else if (argName == "localField") {
+                localField = argument.String();
+            }
+            else if (argName == "foreignField") {
+                foreignField = argument.String();
+            }
+            else {
+                uasserted(28704, str::stream() << "unknown argument to $lookup: " << argName);
+            }
+        }
+
+        uassert(28705, "need to specify fields from, as, localField, and foreignField for a "
+                       "$lookup",
+                !from.empty() && !as.empty() && !localField.empty() && !foreignField.empty());
+
+        NamespaceString fromNs(pExpCtx->ns.db(), from);
+        uassert(28706, "Can't $lookup from special collection: " + from,
+                fromNs.isValid() && !fromNs.isSpecial());
+
+        return new DocumentSourceLookUp(fromNs, as, localField, foreignField, pExpCtx);
+    }
+}
+
+#include "mongo/db/sorter/sorter.cpp"
+// Explicit instantiation unneeded since we aren't exposing Sorter outside of this file.
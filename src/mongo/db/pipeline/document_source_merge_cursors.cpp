@@ -30,8 +30,11 @@
 
 #include "mongo/db/pipeline/document_source.h"
 
+#include <algorithm>
 #include <boost/make_shared.hpp>
 
+#include "mongo/db/server_parameters.h"
+
 namespace mongo {
 
     using boost::intrusive_ptr;
@@ -39,6 +42,12 @@ namespace mongo {
     using std::string;
     using std::vector;
 
+    // Documents buffered per shard before its prefetcher stops issuing getMores.
+    MONGO_EXPORT_SERVER_PARAMETER(aggregationMergeCursorsBufferBytes, int, 16 * 1024 * 1024);
+
+    // Upper bound on the threads reading ahead for one merge. Shards beyond this take turns.
+    MONGO_EXPORT_SERVER_PARAMETER(aggregationMergeCursorsMaxPrefetchThreads, int, 32);
+
     const char DocumentSourceMergeCursors::name[] = "$mergeCursors";
 
     const char* DocumentSourceMergeCursors::getSourceName() const {
@@ -55,9 +64,15 @@ namespace mongo {
             const intrusive_ptr<ExpressionContext> &pExpCtx)
         : DocumentSource(pExpCtx)
         , _cursorIds(cursorIds)
+        , _currentCursor(0)
         , _unstarted(true)
+        , _disposed(false)
     {}
 
+    DocumentSourceMergeCursors::~DocumentSourceMergeCursors() {
+        dispose();
+    }
+
     intrusive_ptr<DocumentSource> DocumentSourceMergeCursors::create(
             const CursorIds& cursorIds,
             const intrusive_ptr<ExpressionContext> &pExpCtx) {
@@ -99,17 +114,17 @@ namespace mongo {
             CursorId id)
         : connection(host)
         , cursor(connection.get(), ns, id, 0, 0)
+        , host(connection->toString())
+        , bufferedBytes(0)
+        , fetching(false)
+        , exhausted(false)
+        , error(Status::OK())
     {}
 
-    vector<DBClientCursor*> DocumentSourceMergeCursors::getCursors() {
+    size_t DocumentSourceMergeCursors::startStreams() {
         verify(_unstarted);
         start();
-        vector<DBClientCursor*> out;
-        for (Cursors::const_iterator it = _cursors.begin(); it !=_cursors.end(); ++it) {
-            out.push_back(&((*it)->cursor));
-        }
-
-        return out;
+        return _cursors.size();
     }
 
     void DocumentSourceMergeCursors::start() {
@@ -130,50 +145,169 @@ namespace mongo {
             bool ok = (*it)->cursor.initLazyFinish(retry); // blocks here for first batch
 
             uassert(17028,
-                    "error reading response from " + _cursors.back()->connection->toString(),
+                    "error reading response from " + (*it)->host,
                     ok);
             verify(!retry);
         }
 
-        _currentCursor = _cursors.begin();
+        if (_cursors.empty())
+            return;
+
+        // From here on each cursor is only used by its prefetch task. The first task just
+        // drains the batch we already have, after which the shard's next getMore is in flight
+        // while the consumer works through that batch.
+        const int nThreads = std::max(1, std::min(static_cast<int>(_cursors.size()),
+                                                  aggregationMergeCursorsMaxPrefetchThreads));
+        _prefetchPool.reset(new ThreadPool(nThreads, "mergeCursorsPrefetch"));
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        for (Cursors::const_iterator it = _cursors.begin(); it != _cursors.end(); ++it) {
+            _scheduleFetch_inlock(it->get());
+        }
+    }
+
+    void DocumentSourceMergeCursors::_scheduleFetch_inlock(CursorAndConnection* cursor) {
+        if (_disposed || cursor->fetching || cursor->exhausted || !cursor->error.isOK())
+            return;
+
+        if (cursor->bufferedBytes >= static_cast<size_t>(aggregationMergeCursorsBufferBytes))
+            return;
+
+        cursor->fetching = true;
+        _prefetchPool->schedule(&DocumentSourceMergeCursors::_fetchBatch, this, cursor);
     }
 
-    Document DocumentSourceMergeCursors::nextSafeFrom(DBClientCursor* cursor) {
-        const BSONObj next = cursor->next();
+    void DocumentSourceMergeCursors::_fetchBatch(CursorAndConnection* cursor) {
+        vector<BSONObj> batch;
+        size_t batchBytes = 0;
+        bool exhausted = false;
+        Status status = Status::OK();
+
+        try {
+            // more() only goes to the network once the current batch has been drained.
+            if (cursor->cursor.more()) {
+                while (cursor->cursor.moreInCurrentBatch()) {
+                    batch.push_back(cursor->cursor.next().getOwned());
+                    batchBytes += batch.back().objsize();
+                }
+            }
+
+            exhausted = cursor->cursor.isDead();
+            if (exhausted)
+                cursor->connection.done();
+        }
+        catch (const DBException& ex) {
+            status = ex.toStatus();
+        }
+        catch (const std::exception& ex) {
+            status = Status(ErrorCodes::UnknownError, ex.what());
+        }
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        cursor->buffer.insert(cursor->buffer.end(), batch.begin(), batch.end());
+        cursor->bufferedBytes += batchBytes;
+        cursor->exhausted = exhausted;
+        cursor->error = status;
+        cursor->fetching = false;
+        _scheduleFetch_inlock(cursor);
+        _fetched.notify_all();
+    }
+
+    bool DocumentSourceMergeCursors::_popBuffered_inlock(CursorAndConnection* cursor,
+                                                         BSONObj* out) {
+        uassert(cursor->error.code(),
+                str::stream() << "error reading from " << cursor->host << ": "
+                              << cursor->error.reason(),
+                cursor->error.isOK());
+
+        if (cursor->buffer.empty())
+            return false;
+
+        *out = cursor->buffer.front();
+        cursor->buffer.pop_front();
+        cursor->bufferedBytes -= out->objsize();
+
+        // Dropping below the bound may let the next getMore go out.
+        _scheduleFetch_inlock(cursor);
+        return true;
+    }
+
+    Document DocumentSourceMergeCursors::_checkedDocument(const BSONObj& next,
+                                                          const CursorAndConnection& cursor) {
         if (next.hasField("$err")) {
             const int code = next.hasField("code") ? next["code"].numberInt() : 17029;
             uasserted(code, str::stream() << "Received error in response from "
-                                          << cursor->originalHost()
+                                          << cursor.host
                                           << ": " << next);
         }
         return Document::fromBsonWithMetaData(next);
     }
 
+    boost::optional<Document> DocumentSourceMergeCursors::getNextFrom(size_t stream) {
+        verify(stream < _cursors.size());
+        CursorAndConnection* cursor = _cursors[stream].get();
+
+        BSONObj next;
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            while (!_popBuffered_inlock(cursor, &next)) {
+                if (cursor->exhausted)
+                    return boost::none;
+                _fetched.wait(lk);
+            }
+        }
+
+        return _checkedDocument(next, *cursor);
+    }
+
     boost::optional<Document> DocumentSourceMergeCursors::getNext() {
         if (_unstarted)
             start();
 
-        // purge eof cursors and release their connections
-        while (!_cursors.empty() && !(*_currentCursor)->cursor.more()) {
-            (*_currentCursor)->connection.done();
-            _cursors.erase(_currentCursor);
-            _currentCursor = _cursors.begin();
-        }
+        BSONObj next;
+        CursorAndConnection* from = NULL;
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            while (!from) {
+                // Take whatever is already buffered, starting after the last shard we read from
+                // so a fast shard can't starve the others.
+                bool anyPending = false;
+                for (size_t n = 0; n < _cursors.size() && !from; n++) {
+                    const size_t i = (_currentCursor + n) % _cursors.size();
+                    CursorAndConnection* cursor = _cursors[i].get();
+                    if (_popBuffered_inlock(cursor, &next)) {
+                        from = cursor;
+                        _currentCursor = i + 1;
+                    }
+                    else if (!cursor->exhausted) {
+                        anyPending = true;
+                    }
+                }
 
-        if (_cursors.empty())
-            return boost::none;
+                if (from)
+                    break;
 
-        const Document next = nextSafeFrom(&((*_currentCursor)->cursor));
+                if (!anyPending)
+                    return boost::none;
 
-        // advance _currentCursor, wrapping if needed
-        if (++_currentCursor == _cursors.end())
-            _currentCursor = _cursors.begin();
+                _fetched.wait(lk);
+            }
+        }
 
-        return next;
+        return _checkedDocument(next, *from);
     }
 
     void DocumentSourceMergeCursors::dispose() {
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            _disposed = true;
+        }
+
+        // Wait for in-flight getMores so no task touches a cursor after it is destroyed.
+        // Cursors that were not exhausted have their connections discarded rather than
+        // returned to the pool.
+        _prefetchPool.reset();
         _cursors.clear();
-        _currentCursor = _cursors.end();
+        _currentCursor = 0;
     }
 }
@@ -232,7 +232,7 @@ namespace mongo {
             typedef DocumentSourceMergeCursors DSCursors;
             typedef DocumentSourceCommandShards DSCommands;
             if (DSCursors* castedSource = dynamic_cast<DSCursors*>(pSource)) {
-                populateFromCursors(castedSource->getCursors());
+                populateFromMergeCursors(castedSource);
             } else if (DSCommands* castedSource = dynamic_cast<DSCommands*>(pSource)) {
                 populateFromBsonArrays(castedSource->getArrays());
             } else {
@@ -248,27 +248,42 @@ namespace mongo {
         populated = true;
     }
 
-    class DocumentSourceSort::IteratorFromCursor : public MySorter::Iterator {
+    class DocumentSourceSort::IteratorFromMergeCursors : public MySorter::Iterator {
     public:
-        IteratorFromCursor(DocumentSourceSort* sorter, DBClientCursor* cursor)
+        IteratorFromMergeCursors(DocumentSourceSort* sorter,
+                                 DocumentSourceMergeCursors* source,
+                                 size_t stream)
             : _sorter(sorter)
-            , _cursor(cursor)
+            , _source(source)
+            , _stream(stream)
+            , _peeked(false)
         {}
 
-        bool more() { return _cursor->more(); }
+        bool more() {
+            if (!_peeked) {
+                _next = _source->getNextFrom(_stream);
+                _peeked = true;
+            }
+            return static_cast<bool>(_next);
+        }
         Data next() {
-            const Document doc = DocumentSourceMergeCursors::nextSafeFrom(_cursor);
-            return make_pair(_sorter->extractKey(doc), doc);
+            verify(more());
+            _peeked = false;
+            return make_pair(_sorter->extractKey(*_next), *_next);
         }
     private:
         DocumentSourceSort* _sorter;
-        DBClientCursor* _cursor;
+        DocumentSourceMergeCursors* _source;
+        const size_t _stream;
+        bool _peeked;
+        boost::optional<Document> _next;
     };
 
-    void DocumentSourceSort::populateFromCursors(const vector<DBClientCursor*>& cursors) {
+    void DocumentSourceSort::populateFromMergeCursors(DocumentSourceMergeCursors* source) {
+        const size_t numStreams = source->startStreams();
         vector<boost::shared_ptr<MySorter::Iterator> > iterators;
-        for (size_t i = 0; i < cursors.size(); i++) {
-            iterators.push_back(boost::make_shared<IteratorFromCursor>(this, cursors[i]));
+        for (size_t i = 0; i < numStreams; i++) {
+            iterators.push_back(boost::make_shared<IteratorFromMergeCursors>(this, source, i));
         }
 
         _output.reset(MySorter::Iterator::merge(iterators, makeSortOptions(), Comparator(*this)));
@@ -59,6 +59,10 @@ namespace mongo {
         bool extSortAllowed = false;
         bool bypassDocumentValidation = false;
 
+        // If non-zero, all reads done for this pipeline, including its getMores, see a single
+        // snapshot held open for at most this many milliseconds.
+        int readAtSnapshotMS = 0;
+
         NamespaceString ns;
         std::string tempDir; // Defaults to empty to prevent external sorting in mongos.
 
@@ -80,6 +80,8 @@ namespace mongo {
          DocumentSourceGroup::createFromBson},
         {DocumentSourceLimit::limitName,
          DocumentSourceLimit::createFromBson},
+        {DocumentSourceLookUp::lookupName,
+         DocumentSourceLookUp::createFromBson},
         {DocumentSourceMatch::matchName,
          DocumentSourceMatch::createFromBson},
         {DocumentSourceMergeCursors::name,
@@ -168,6 +170,14 @@ namespace mongo {
                 continue;
             }
 
+            if (pFieldName == LiteParsedQuery::cmdOptionReadAtSnapshotMS) {
+                StatusWith<int> readAtSnapshotMS =
+                    LiteParsedQuery::parseReadAtSnapshotMSCommand(cmdObj);
+                uassertStatusOK(readAtSnapshotMS.getStatus());
+                pCtx->readAtSnapshotMS = readAtSnapshotMS.getValue();
+                continue;
+            }
+
             /* we didn't recognize a field in the command */
             ostringstream sb;
             sb << "unrecognized field '" << cmdElement.fieldName() << "'";
@@ -217,6 +227,9 @@ namespace mongo {
             if (dynamic_cast<DocumentSourceOut*>(stage.get())) {
                 uassert(16991, "$out can only be the final stage in the pipeline",
                         iStep == nSteps - 1);
+                // The first write would end the snapshot the rest of the input is read from.
+                uassert(28717, "$out can't be used with readAtSnapshotMS",
+                        pCtx->readAtSnapshotMS == 0);
             }
         }
 
@@ -365,6 +378,16 @@ namespace mongo {
 
                 out->push_back(Privilege(ResourcePattern::forExactNamespace(outputNs), actions));
             }
+            else if (str::equals(stage.firstElementFieldName(), "$lookup")) {
+                NamespaceString fromNs(db, stage.firstElement()["from"].str());
+                uassert(28707,
+                        mongoutils::str::stream() << "Invalid $lookup namespace, " <<
+                        fromNs.ns(),
+                        fromNs.isValid());
+
+                out->push_back(Privilege(ResourcePattern::forExactNamespace(fromNs),
+                                         ActionType::find));
+            }
         }
     }
 
@@ -495,6 +518,11 @@ namespace mongo {
             serialized.setField(bypassDocumentValidationCommandOption(), Value(true));
         }
 
+        if (pCtx->readAtSnapshotMS) {
+            serialized.setField(LiteParsedQuery::cmdOptionReadAtSnapshotMS,
+                                Value(pCtx->readAtSnapshotMS));
+        }
+
         return serialized.freeze();
     }
 
@@ -39,9 +39,15 @@
 #include "mongo/db/catalog/document_validation.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/exec/group_count_scan.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index_names.h"
 #include "mongo/db/pipeline/document_source.h"
 #include "mongo/db/pipeline/pipeline.h"
 #include "mongo/db/query/get_executor.h"
+#include "mongo/db/query/plan_executor.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/s/d_state.h"
 
@@ -90,6 +96,74 @@ namespace {
         intrusive_ptr<ExpressionContext> _ctx;
         DBDirectClient _client;
     };
+
+    /**
+     * Returns an index that lets GroupCountScan group on 'field': a finished btree index on
+     * 'field' and possibly more fields, holding exactly one key per document. Prefers the
+     * smallest such index. Returns NULL if there is none.
+     */
+    const IndexDescriptor* findGroupCountIndex(OperationContext* txn,
+                                               Collection* collection,
+                                               const string& field) {
+        const IndexDescriptor* best = NULL;
+        IndexCatalog::IndexIterator it =
+            collection->getIndexCatalog()->getIndexIterator(txn, false);
+        while (it.more()) {
+            const IndexDescriptor* desc = it.next();
+            if (desc->keyPattern().firstElement().fieldNameStringData() != field
+                    || desc->getAccessMethodName() != IndexNames::BTREE
+                    || desc->isSparse()
+                    || desc->isPartial()
+                    || desc->isMultikey(txn)) {
+                continue;
+            }
+
+            if (!best || desc->keyPattern().nFields() < best->keyPattern().nFields())
+                best = desc;
+        }
+        return best;
+    }
+
+    /**
+     * The query layer's SORT stage fails once it holds more than
+     * internalQueryExecMaxBlockingSortBytes, while $sort allows 100MB. Only hand it a top-K that
+     * fits even if every document is as large as a document can be, so aggregations that worked
+     * with $sort don't start failing on collections with a few large documents.
+     */
+    bool topKFitsBlockingSort(long long limit) {
+        return limit <= internalQueryExecMaxBlockingSortBytes / BSONObjMaxInternalSize;
+    }
+
+    /**
+     * A blocking sort in the query layer orders arrays by their smallest or largest element,
+     * while $sort compares them as whole arrays. The two only agree when no sorted field can
+     * hold an array, which a non-multikey index on the field guarantees.
+     */
+    bool sortFieldsCannotBeArrays(OperationContext* txn,
+                                  Collection* collection,
+                                  const BSONObj& sortObj) {
+        BSONForEach(sortField, sortObj) {
+            if (sortField.type() == Object)
+                continue; // {$meta: "textScore"}
+
+            bool covered = false;
+            IndexCatalog::IndexIterator it =
+                collection->getIndexCatalog()->getIndexIterator(txn, false);
+            while (it.more() && !covered) {
+                const IndexDescriptor* desc = it.next();
+                const string& accessMethod = desc->getAccessMethodName();
+                covered = (accessMethod == IndexNames::BTREE
+                                || accessMethod == IndexNames::HASHED)
+                          && !desc->isPartial()
+                          && desc->keyPattern().hasField(sortField.fieldNameStringData())
+                          && !desc->isMultikey(txn);
+            }
+
+            if (!covered)
+                return false;
+        }
+        return true;
+    }
 }
 
     shared_ptr<PlanExecutor> PipelineD::prepareCursorSource(
@@ -128,15 +202,51 @@ namespace {
         // Look for an initial match. This works whether we got an initial query or not.
         // If not, it results in a "{}" query, which will be what we want in that case.
         const BSONObj queryObj = pPipeline->getInitialQuery();
-        if (!queryObj.isEmpty()) {
+        if (!sources.empty() && dynamic_cast<DocumentSourceMatch*>(sources.front().get())) {
             // This will get built in to the Cursor we'll create, so
-            // remove the match from the pipeline
+            // remove the match from the pipeline. An empty $match goes as well, so that the
+            // stages after it can be pushed down as if it weren't there.
             sources.pop_front();
         }
 
         // Find the set of fields in the source documents depended on by this pipeline.
         const DepsTracker deps = pPipeline->getDependencies(queryObj);
 
+        // A $group over the whole collection that only lists or counts the values of an indexed
+        // field can be answered from the index keys, without building any Documents. This skips
+        // sharded collections since orphans can only be filtered out by fetching documents.
+        boost::shared_ptr<PlanExecutor> exec;
+        bool groupInRunner = false;
+        string groupField;
+        string countField;
+        DocumentSourceGroup* groupStage =
+            sources.empty() ? NULL : dynamic_cast<DocumentSourceGroup*>(sources.front().get());
+        if (queryObj.isEmpty()
+                && collection
+                && groupStage
+                && groupStage->isCountByField(&groupField, &countField)
+                && !shardingState.needCollectionMetadata(fullName)) {
+            if (const IndexDescriptor* desc = findGroupCountIndex(txn, collection, groupField)) {
+                GroupCountScanParams params;
+                params.descriptor = desc;
+                params.countField = countField;
+
+                std::auto_ptr<WorkingSet> ws(new WorkingSet());
+                PlanStage* root = new GroupCountScan(txn, params, ws.get());
+
+                PlanExecutor* rawExec;
+                uassertStatusOK(PlanExecutor::make(txn,
+                                                   ws.release(),
+                                                   root,
+                                                   collection,
+                                                   PlanExecutor::YIELD_AUTO,
+                                                   &rawExec));
+                exec.reset(rawExec);
+                groupInRunner = true;
+                sources.pop_front();
+            }
+        }
+
         // Passing query an empty projection since it is faster to use ParsedDeps::extractFields().
         // This will need to change to support covering indexes (SERVER-12015). There is an
         // exception for textScore since that can only be retrieved by a query projection.
@@ -151,7 +261,7 @@ namespace {
         */
         intrusive_ptr<DocumentSourceSort> sortStage;
         BSONObj sortObj;
-        if (!sources.empty()) {
+        if (!groupInRunner && !sources.empty()) {
             sortStage = dynamic_cast<DocumentSourceSort*>(sources.front().get());
             if (sortStage) {
                 // build the sort key
@@ -177,11 +287,14 @@ namespace {
         // LATER - we should be able to find this out before we create the
         // cursor.  Either way, we can then apply other optimizations there
         // are tickets for, such as SERVER-4507.
+        //
+        // If no index provides the sort but a $limit was coalesced into it, we try once more
+        // with a blocking sort so the query layer does the top-K on WorkingSet members, as long
+        // as the top-K should fit in the SORT stage's smaller memory limit.
         const size_t runnerOptions = QueryPlannerParams::DEFAULT
                                    | QueryPlannerParams::INCLUDE_SHARD_FILTER
                                    | QueryPlannerParams::NO_BLOCKING_SORT
                                    ;
-        boost::shared_ptr<PlanExecutor> exec;
         bool sortInRunner = false;
 
         const WhereCallbackReal whereCallback(pExpCtx->opCtx, pExpCtx->ns.db());
@@ -207,6 +320,36 @@ namespace {
                 exec.reset(rawExec);
                 sortInRunner = true;
 
+            }
+            else if (sortStage->getLimitSrc()
+                     && !pExpCtx->extSortAllowed // $sort can spill, the query layer can't
+                     && collection
+                     && topKFitsBlockingSort(sortStage->getLimit())
+                     && sortFieldsCannotBeArrays(txn, collection, sortObj)) {
+                status = CanonicalQuery::canonicalize(pExpCtx->ns,
+                                                      queryObj,
+                                                      sortObj,
+                                                      projectionForQuery,
+                                                      0, // skip
+                                                      sortStage->getLimit(),
+                                                      &cq,
+                                                      whereCallback);
+
+                if (status.isOK() && getExecutor(txn,
+                                                 collection,
+                                                 cq,
+                                                 PlanExecutor::YIELD_AUTO,
+                                                 &rawExec,
+                                                 runnerOptions
+                                                    & ~QueryPlannerParams::NO_BLOCKING_SORT)
+                                        .isOK()) {
+                    // success: The PlanExecutor keeps only the top documents as it sorts.
+                    exec.reset(rawExec);
+                    sortInRunner = true;
+                }
+            }
+
+            if (sortInRunner) {
                 sources.pop_front();
                 if (sortStage->getLimitSrc()) {
                     // need to reinsert coalesced $limit after removing $sort
@@ -251,7 +394,9 @@ namespace {
         if (sortInRunner)
             pSource->setSort(sortObj);
 
-        pSource->setProjection(deps.toProjection(), deps.toParsedDeps());
+        // The GroupCountScan output already is the $group output, so there is nothing to pick.
+        if (!groupInRunner)
+            pSource->setProjection(deps.toProjection(), deps.toParsedDeps());
 
         while (!sources.empty() && pSource->coalesce(sources.front())) {
             sources.pop_front();
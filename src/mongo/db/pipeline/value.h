@@ -143,6 +143,7 @@ namespace mongo {
         const char* getRegexFlags() const;
         std::string getSymbol() const;
         std::string getCode() const;
+        BSONBinData getBinData() const;
         int getInt() const;
         long long getLong() const;
         const std::vector<Value>& getArray() const { return _storage.getArray(); }
@@ -339,6 +340,12 @@ namespace mongo {
         return _storage.getString().toString();
     }
 
+    inline BSONBinData Value::getBinData() const {
+        verify(getType() == BinData);
+        const StringData data = _storage.getString();
+        return BSONBinData(data.rawData(), data.size(), _storage.binDataType());
+    }
+
     inline int Value::getInt() const {
         verify(getType() == NumberInt);
         return _storage.intValue;
@@ -42,6 +42,7 @@
 #include "mongo/db/repl/replication_coordinator.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/server_parameters.h"
+#include "mongo/db/service_context.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/storage/mmap_v1/mmap.h"
 #include "mongo/util/log.h"
@@ -121,18 +122,19 @@ namespace {
         }
     }
 
-    // page in the data pages for a record associated with an object
-    void prefetchRecordPages(OperationContext* txn,
-                             Database* db,
-                             const char* ns,
-                             const BSONObj& obj) {
+    // page in the data pages for a record associated with an object. Returns the record, which is
+    // only valid as long as the collection lock is held, or an empty object if there is none.
+    BSONObj prefetchRecordPages(OperationContext* txn,
+                                Database* db,
+                                const char* ns,
+                                const BSONObj& obj) {
 
         BSONElement _id;
+        BSONObj result;
         if( obj.getObjectID(_id) ) {
             TimerHolder timer(&prefetchDocStats);
             BSONObjBuilder builder;
             builder.append(_id);
-            BSONObj result;
             try {
                 if (Helpers::findById(txn, db, ns, builder.done(), result)) {
                     // do we want to use Record::touch() here?  it's pretty similar.
@@ -148,8 +150,10 @@ namespace {
             }
             catch(const DBException& e) {
                 LOG(2) << "ignoring exception in prefetchRecordPages(): " << e.what() << endl;
+                result = BSONObj();
             }
         }
+        return result;
     }
 } // namespace
 
@@ -178,10 +182,11 @@ namespace {
         BSONObj obj = op.getObjectField(opField);
         const char *ns = op.getStringField("ns");
 
-        // This will have to change for engines other than MMAP V1, because they might not have
-        // means for directly prefetching pages from the collection. For this purpose, acquire S
-        // lock on the database, instead of optimizing with IS.
-        Lock::CollectionLock collLock(txn->lockState(), ns, MODE_S);
+        // Engines with document locking prefetch while the batch is being applied, so they only
+        // take an intent lock, which doesn't keep the writers out. MMAP V1 prefetches before the
+        // writers start and acquires S lock on the collection, instead of optimizing with IS.
+        const bool docLocking = supportsDocLocking();
+        Lock::CollectionLock collLock(txn->lockState(), ns, docLocking ? MODE_IS : MODE_S);
 
         Collection* collection = db->getCollection( ns );
         if (!collection) {
@@ -190,6 +195,15 @@ namespace {
 
         LOG(4) << "index prefetch for op " << *opType << endl;
 
+        if (docLocking && *opType != 'i' && !collection->isCapped()) {
+            // Updating or deleting a document reads it and removes its old index keys, none of
+            // which but _id are in the op. So read the document first and prefetch the keys it
+            // has now. Capped collections typically have no _id index for findById() to use.
+            BSONObj doc = prefetchRecordPages(txn, db, ns, obj);
+            prefetchIndexPages(txn, collection, prefetchConfig, doc.isEmpty() ? obj : doc);
+            return;
+        }
+
         // should we prefetch index pages on updates? if the update is in-place and doesn't change 
         // indexed values, it is actually slower - a lot slower if there are a dozen indexes or 
         // lots of multikeys.  possible variations (not all mutually exclusive):
@@ -125,6 +125,10 @@ namespace {
             const DistinctScanStats* spec = static_cast<const DistinctScanStats*>(specific);
             return spec->keysExamined;
         }
+        else if (STAGE_GROUP_COUNT_SCAN == type) {
+            const GroupCountScanStats* spec = static_cast<const GroupCountScanStats*>(specific);
+            return spec->keysExamined;
+        }
 
         return 0;
      }
@@ -177,6 +181,10 @@ namespace {
             const DistinctScanStats* spec = static_cast<const DistinctScanStats*>(specific);
             ss << " " << spec->keyPattern;
         }
+        else if (STAGE_GROUP_COUNT_SCAN == stage->stageType()) {
+            const GroupCountScanStats* spec = static_cast<const GroupCountScanStats*>(specific);
+            ss << " " << spec->keyPattern;
+        }
         else if (STAGE_GEO_NEAR_2D == stage->stageType()) {
             const NearStats* spec = static_cast<const NearStats*>(specific);
             ss << " " << spec->keyPattern;
@@ -308,6 +316,19 @@ namespace mongo {
                 bob->appendNumber("alreadyHasObj", spec->alreadyHasObj);
             }
         }
+        else if (STAGE_GROUP_COUNT_SCAN == stats.stageType) {
+            GroupCountScanStats* spec = static_cast<GroupCountScanStats*>(stats.specific.get());
+
+            if (verbosity >= ExplainCommon::EXEC_STATS) {
+                bob->appendNumber("keysExamined", spec->keysExamined);
+            }
+
+            bob->append("keyPattern", spec->keyPattern);
+            bob->append("indexName", spec->indexName);
+            bob->append("indexVersion", spec->indexVersion);
+            if (!spec->countField.empty())
+                bob->append("countField", spec->countField);
+        }
         else if (STAGE_GEO_NEAR_2D == stats.stageType
                 || STAGE_GEO_NEAR_2DSPHERE == stats.stageType) {
             NearStats* spec = static_cast<NearStats*>(stats.specific.get());
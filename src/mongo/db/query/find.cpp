@@ -113,8 +113,14 @@ namespace mongo {
      *
      * If ntoreturn is non-zero, the we stop building the first batch once we either have ntoreturn
      * results, or when the result set exceeds 4 MB.
+     *
+     * Oplog replay queries are used to read the whole oplog from some point on, so with ntoreturn
+     * zero their first batch is as big as a getmore.
      */
     bool enoughForFirstBatch(const LiteParsedQuery& pq, int numDocs, int bytesBuffered) {
+        if (0 == pq.getNumToReturn() && pq.isOplogReplay()) {
+            return bytesBuffered > MaxBytesToReturnToClientAtOnce;
+        }
         if (0 == pq.getNumToReturn()) {
             return (bytesBuffered > 1024 * 1024) || numDocs >= 101;
         }
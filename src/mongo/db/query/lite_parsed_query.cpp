@@ -42,6 +42,7 @@ namespace mongo {
 
     const string LiteParsedQuery::cmdOptionMaxTimeMS("maxTimeMS");
     const string LiteParsedQuery::queryOptionMaxTimeMS("$maxTimeMS");
+    const string LiteParsedQuery::cmdOptionReadAtSnapshotMS("readAtSnapshotMS");
 
     const string LiteParsedQuery::metaTextScore("textScore");
     const string LiteParsedQuery::metaGeoNearDistance("geoNearDistance");
@@ -213,6 +214,14 @@ namespace mongo {
 
                 pq->_maxTimeMS = maxTimeMS.getValue();
             }
+            else if (mongoutils::str::equals(fieldName, cmdOptionReadAtSnapshotMS.c_str())) {
+                StatusWith<int> readAtSnapshotMS = parseMaxTimeMS(el);
+                if (!readAtSnapshotMS.isOK()) {
+                    return readAtSnapshotMS.getStatus();
+                }
+
+                pq->_readAtSnapshotMS = readAtSnapshotMS.getValue();
+            }
             else if (mongoutils::str::equals(fieldName, "min")) {
                 Status status = checkFieldType(el, Object);
                 if (!status.isOK()) {
@@ -422,6 +431,11 @@ namespace mongo {
             }
         }
 
+        // A tailable cursor would have to pin its snapshot forever to see anything new.
+        if (_readAtSnapshotMS > 0 && _tailable) {
+            return Status(ErrorCodes::BadValue, "readAtSnapshotMS can't be used with tailable");
+        }
+
         return Status::OK();
     }
 
@@ -435,6 +449,11 @@ namespace mongo {
         return parseMaxTimeMS(queryObj[queryOptionMaxTimeMS]);
     }
 
+    // static
+    StatusWith<int> LiteParsedQuery::parseReadAtSnapshotMSCommand(const BSONObj& cmdObj) {
+        return parseMaxTimeMS(cmdObj[cmdOptionReadAtSnapshotMS]);
+    }
+
     // static
     StatusWith<int> LiteParsedQuery::parseMaxTimeMS(const BSONElement& maxTimeMSElt) {
         if (!maxTimeMSElt.eoo() && !maxTimeMSElt.isNumber()) {
@@ -561,6 +580,7 @@ namespace mongo {
         _explain(false),
         _maxScan(0),
         _maxTimeMS(0),
+        _readAtSnapshotMS(0),
         _returnKey(false),
         _showRecordId(false),
         _snapshot(false),
@@ -70,6 +70,11 @@ namespace mongo {
          */
         static StatusWith<int> parseMaxTimeMSQuery(const BSONObj& queryObj);
 
+        /**
+         * Same as parseMaxTimeMSCommand, but for readAtSnapshotMS.
+         */
+        static StatusWith<int> parseReadAtSnapshotMSCommand(const BSONObj& cmdObj);
+
         /**
          * Helper function to identify text search sort key
          * Example: {a: {$meta: "textScore"}}
@@ -102,6 +107,9 @@ namespace mongo {
         static const std::string cmdOptionMaxTimeMS;
         static const std::string queryOptionMaxTimeMS;
 
+        // Name of the find command option which keeps all reads at one snapshot for that long.
+        static const std::string cmdOptionReadAtSnapshotMS;
+
         // Names of the $meta projection values.
         static const std::string metaTextScore;
         static const std::string metaGeoNearDistance;
@@ -129,6 +137,7 @@ namespace mongo {
 
         int getMaxScan() const { return _maxScan; }
         int getMaxTimeMS() const { return _maxTimeMS; }
+        int getReadAtSnapshotMS() const { return _readAtSnapshotMS; }
 
         const BSONObj& getMin() const { return _min; }
         const BSONObj& getMax() const { return _max; }
@@ -236,6 +245,10 @@ namespace mongo {
         int _maxScan;
         int _maxTimeMS;
 
+        // If non-zero, the query and its getMores read from a single snapshot, which is held
+        // open for at most this many milliseconds.
+        int _readAtSnapshotMS;
+
         BSONObj _min;
         BSONObj _max;
 
@@ -516,6 +516,43 @@ namespace {
         ASSERT_NOT_OK(status);
     }
 
+    TEST(LiteParsedQueryTest, ParseFromCommandReadAtSnapshotMS) {
+        BSONObj cmdObj = fromjson("{find: 'testns',"
+                                   "filter:  {a: 1},"
+                                   "readAtSnapshotMS: 60000}");
+
+        LiteParsedQuery* rawLpq;
+        bool isExplain = false;
+        Status status = LiteParsedQuery::make("testns", cmdObj, isExplain, &rawLpq);
+        ASSERT_OK(status);
+        scoped_ptr<LiteParsedQuery> lpq(rawLpq);
+
+        ASSERT_EQUALS(60000, lpq->getReadAtSnapshotMS());
+    }
+
+    TEST(LiteParsedQueryTest, ParseFromCommandReadAtSnapshotMSWrongType) {
+        BSONObj cmdObj = fromjson("{find: 'testns',"
+                                   "filter:  {a: 1},"
+                                   "readAtSnapshotMS: 'foo'}");
+
+        LiteParsedQuery* rawLpq;
+        bool isExplain = false;
+        Status status = LiteParsedQuery::make("testns", cmdObj, isExplain, &rawLpq);
+        ASSERT_NOT_OK(status);
+    }
+
+    TEST(LiteParsedQueryTest, ParseFromCommandReadAtSnapshotMSTailable) {
+        BSONObj cmdObj = fromjson("{find: 'testns',"
+                                   "filter:  {a: 1},"
+                                   "tailable: true,"
+                                   "readAtSnapshotMS: 1000}");
+
+        LiteParsedQuery* rawLpq;
+        bool isExplain = false;
+        Status status = LiteParsedQuery::make("testns", cmdObj, isExplain, &rawLpq);
+        ASSERT_NOT_OK(status);
+    }
+
     TEST(LiteParsedQueryTest, ParseFromCommandMaxWrongType) {
         BSONObj cmdObj = fromjson("{find: 'testns',"
                                    "filter:  {a: 1},"
@@ -71,6 +71,10 @@ namespace mongo {
 
         STAGE_GROUP,
 
+        // An aggregation $group that counts documents per value of an indexed field, answered
+        // by walking the index keys.
+        STAGE_GROUP_COUNT_SCAN,
+
         STAGE_IDHACK,
         STAGE_IXSCAN,
         STAGE_LIMIT,
@@ -0,0 +1,137 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kReplication
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/repl/apply_budget.h"
+
+#include <algorithm>
+#include <boost/thread/lock_guard.hpp>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+namespace repl {
+
+namespace {
+
+    // Don't pause for so long at once that the applier can't react to a burst of writes.
+    const Milliseconds kMaxPause(1000);
+
+    // Below this the readers' share is not worth pausing for.
+    const double kMinReaderShare = 0.01;
+
+    // How many batches well within the lag it takes to give the readers back their full share.
+    const int kRecoverySteps = 8;
+
+    ApplyBudget globalApplyBudget;
+
+} // namespace
+
+    ApplyBudget::ApplyBudget()
+        : _maxLag(0),
+          _targetReaderShare(0),
+          _readerShare(0),
+          _lastLag(0),
+          _pausedMillis(0) {
+    }
+
+    ApplyBudget* ApplyBudget::get() {
+        return &globalApplyBudget;
+    }
+
+    void ApplyBudget::configure(Seconds maxLag, double readerShare) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        if (maxLag == _maxLag && readerShare == _targetReaderShare) {
+            return;
+        }
+        if (maxLag > Seconds(0)) {
+            log() << "Applying the oplog within " << durationCount<Seconds>(maxLag)
+                  << " seconds of lag, leaving readers " << readerShare << " of the time";
+        }
+        _maxLag = maxLag;
+        _targetReaderShare = maxLag > Seconds(0) ? readerShare : 0;
+        _readerShare = _targetReaderShare;
+        _lastLag = Seconds(0);
+    }
+
+    bool ApplyBudget::isEnabled() const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        return _maxLag > Seconds(0);
+    }
+
+    Milliseconds ApplyBudget::recordBatch(Seconds lag, Milliseconds applyTime) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        if (_maxLag == Seconds(0)) {
+            return Milliseconds(0);
+        }
+
+        _lastLag = lag;
+        if (lag > _maxLag) {
+            _readerShare /= 2;
+            if (_readerShare < kMinReaderShare) {
+                _readerShare = 0;
+            }
+        }
+        else if (lag * 2 <= _maxLag) {
+            _readerShare = std::min(_targetReaderShare,
+                                    _readerShare + _targetReaderShare / kRecoverySteps);
+        }
+
+        if (_readerShare == 0) {
+            return Milliseconds(0);
+        }
+
+        // Pause so that readers get _readerShare of the time spent on this batch and the pause.
+        const long long pauseMillis = std::min(
+            static_cast<long long>(durationCount<Milliseconds>(applyTime) * _readerShare /
+                                   (1 - _readerShare)),
+            static_cast<long long>(durationCount<Milliseconds>(kMaxPause)));
+        _pausedMillis += pauseMillis;
+        return Milliseconds(pauseMillis);
+    }
+
+    void ApplyBudget::append(BSONObjBuilder* builder) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        if (_maxLag == Seconds(0)) {
+            return;
+        }
+        BSONObjBuilder budget(builder->subobjStart("applyBudget"));
+        budget.append("maxLagSecs", durationCount<Seconds>(_maxLag));
+        budget.append("readerShare", _targetReaderShare);
+        budget.append("currentReaderShare", _readerShare);
+        budget.append("lagSecs", durationCount<Seconds>(_lastLag));
+        budget.append("pausedMillis", _pausedMillis);
+        budget.done();
+    }
+
+} // namespace repl
+} // namespace mongo
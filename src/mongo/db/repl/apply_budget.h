@@ -0,0 +1,99 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+namespace repl {
+
+    /**
+     * Splits a secondary's time between applying oplog batches and serving reads, for members
+     * configured with an applyBudget.
+     *
+     * Applying a batch blocks all readers, so the only way to leave readers room is to leave time
+     * between batches.  After each batch, the applier pauses for long enough that readers get
+     * their share of the time, as long as the member stays within its maximum lag.  When the
+     * member falls behind further, the readers' share is halved with each batch until it catches
+     * up, and it is given back a step at a time once the member is well within its lag again.
+     */
+    class ApplyBudget {
+        MONGO_DISALLOW_COPYING(ApplyBudget);
+    public:
+        ApplyBudget();
+
+        /**
+         * The budget of this process, configured from its member of the replica set config.
+         */
+        static ApplyBudget* get();
+
+        /**
+         * Sets the lag the member must stay within and the share of time left to readers while
+         * it does.  A zero 'maxLag' turns the budget off.  Starts over with the configured share
+         * when either changes.
+         */
+        void configure(Seconds maxLag, double readerShare);
+
+        bool isEnabled() const;
+
+        /**
+         * Records that a batch whose oldest entry was 'lag' behind took 'applyTime' to apply,
+         * adapts the readers' share to the lag and returns how long to pause before applying the
+         * next batch.
+         */
+        Milliseconds recordBatch(Seconds lag, Milliseconds applyTime);
+
+        /**
+         * Appends an "applyBudget" subdocument with the configured budget, the current share and
+         * the last lag seen, if the budget is enabled.
+         */
+        void append(BSONObjBuilder* builder) const;
+
+    private:
+        mutable boost::mutex _mutex;
+
+        // Configured budget
+        Seconds _maxLag;
+        double _targetReaderShare;
+
+        // Share of time currently left to readers, between 0 and _targetReaderShare
+        double _readerShare;
+
+        Seconds _lastLag;
+        long long _pausedMillis;
+    };
+
+} // namespace repl
+} // namespace mongo
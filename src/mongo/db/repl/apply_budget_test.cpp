@@ -0,0 +1,101 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/repl/apply_budget.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace repl {
+namespace {
+
+    TEST(ApplyBudget, DisabledNeverPauses) {
+        ApplyBudget budget;
+        ASSERT_FALSE(budget.isEnabled());
+        ASSERT_EQUALS(Milliseconds(0), budget.recordBatch(Seconds(0), Milliseconds(100)));
+
+        BSONObjBuilder builder;
+        budget.append(&builder);
+        ASSERT_TRUE(builder.obj().isEmpty());
+    }
+
+    TEST(ApplyBudget, PausesForReaderShareWithinLag) {
+        ApplyBudget budget;
+        budget.configure(Seconds(10), 0.5);
+        ASSERT_TRUE(budget.isEnabled());
+        ASSERT_EQUALS(Milliseconds(100), budget.recordBatch(Seconds(0), Milliseconds(100)));
+
+        budget.configure(Seconds(10), 0.75);
+        ASSERT_EQUALS(Milliseconds(300), budget.recordBatch(Seconds(0), Milliseconds(100)));
+
+        // Long batches don't get paused after for ever.
+        ASSERT_EQUALS(Milliseconds(1000), budget.recordBatch(Seconds(0), Milliseconds(10000)));
+    }
+
+    TEST(ApplyBudget, BacksOffWhenBehindAndRecoversWhenCaughtUp) {
+        ApplyBudget budget;
+        budget.configure(Seconds(10), 0.5);
+
+        // Behind: the readers' share halves with each batch, down to nothing.
+        ASSERT_EQUALS(Milliseconds(33), budget.recordBatch(Seconds(11), Milliseconds(100)));
+        for (int i = 0; i < 10; i++) {
+            budget.recordBatch(Seconds(11), Milliseconds(100));
+        }
+        ASSERT_EQUALS(Milliseconds(0), budget.recordBatch(Seconds(11), Milliseconds(100)));
+
+        // Between half the lag and the lag, the share stays where it is.
+        ASSERT_EQUALS(Milliseconds(0), budget.recordBatch(Seconds(8), Milliseconds(100)));
+
+        // Well within the lag, the share comes back a step at a time.
+        ASSERT_NOT_EQUALS(Milliseconds(0), budget.recordBatch(Seconds(1), Milliseconds(100)));
+        for (int i = 0; i < 10; i++) {
+            budget.recordBatch(Seconds(1), Milliseconds(100));
+        }
+        ASSERT_EQUALS(Milliseconds(100), budget.recordBatch(Seconds(1), Milliseconds(100)));
+
+        BSONObjBuilder builder;
+        budget.append(&builder);
+        const BSONObj status = builder.obj()["applyBudget"].Obj();
+        ASSERT_EQUALS(10, status["maxLagSecs"].numberInt());
+        ASSERT_EQUALS(0.5, status["currentReaderShare"].numberDouble());
+        ASSERT_EQUALS(1, status["lagSecs"].numberInt());
+    }
+
+    TEST(ApplyBudget, ZeroMaxLagDisables) {
+        ApplyBudget budget;
+        budget.configure(Seconds(10), 0.5);
+        budget.configure(Seconds(0), 0.5);
+        ASSERT_FALSE(budget.isEnabled());
+        ASSERT_EQUALS(Milliseconds(0), budget.recordBatch(Seconds(0), Milliseconds(100)));
+    }
+
+} // namespace
+} // namespace repl
+} // namespace mongo
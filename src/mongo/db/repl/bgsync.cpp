@@ -41,6 +41,7 @@
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/repl_settings.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/replication_coordinator_impl.h"
 #include "mongo/db/repl/rs_rollback.h"
@@ -72,6 +73,11 @@ namespace {
     static ServerStatusMetricField<TimerStats> displayBatchesRecieved(
                                                     "repl.network.getmores",
                                                     &getmoreReplStats );
+    //The getmores sent before the previous batch was buffered
+    static Counter64 batchesRequestedAheadStats;
+    static ServerStatusMetricField<Counter64> displayBatchesRequestedAhead(
+                                                    "repl.network.getmoresRequestedAhead",
+                                                    &batchesRequestedAheadStats );
     //The oplog entries read via the oplog reader
     static Counter64 opsReadStats;
     static ServerStatusMetricField<Counter64> displayOpsRead( "repl.network.ops",
@@ -263,6 +269,7 @@ namespace {
             return;
         }
 
+        std::vector<BSONObj> fetched;
         while (!inShutdown()) {
             if (!_syncSourceReader.moreInCurrentBatch()) {
                 // Check some things periodically
@@ -304,6 +311,14 @@ namespace {
                 }
                 networkByteStats.increment(_syncSourceReader.currentBatchMessageSize());
 
+                // A big batch means we are behind, so the next one will be ready as soon as it
+                // is asked for. Ask now rather than after buffering this one.
+                if (replOplogFetchAhead &&
+                    _syncSourceReader.currentBatchMessageSize() >= BatchIsSmallish &&
+                    _syncSourceReader.requestMoreAhead()) {
+                    batchesRequestedAheadStats.increment();
+                }
+
                 if (!_syncSourceReader.moreInCurrentBatch()) {
                     // If there is still no data from upstream, check a few more things
                     // and then loop back for another pass at getting more data
@@ -324,37 +339,47 @@ namespace {
                 }
             }
 
-            // If we are transitioning to primary state, we need to leave
-            // this loop in order to go into bgsync-pause mode.
-            if (_replCoord->isWaitingForApplierToDrain() ||
-                _replCoord->getMemberState().primary()) {
-                LOG(1) << "waiting for draining or we are primary, not adding more ops to buffer";
-                return;
-            }
-
             // At this point, we are guaranteed to have at least one thing to read out
-            // of the oplogreader cursor.
-            BSONObj o = _syncSourceReader.nextSafe().getOwned();
-            opsReadStats.increment();
+            // of the oplogreader cursor. Take all of it at once, so that the entries share
+            // one copy of the batch.
+            fetched.clear();
+            _syncSourceReader.takeCurrentBatch(&fetched);
 
             {
                 boost::unique_lock<boost::mutex> lock(_mutex);
                 _appliedBuffer = false;
             }
 
-            OCCASIONALLY {
-                LOG(2) << "bgsync buffer has " << _buffer.size() << " bytes";
-            }
+            for (std::vector<BSONObj>::const_iterator it = fetched.begin();
+                 it != fetched.end();
+                 ++it) {
+                // If we are transitioning to primary state, we need to leave
+                // this loop in order to go into bgsync-pause mode. Whatever is left of the
+                // batch gets fetched again by the next pass.
+                if (_replCoord->isWaitingForApplierToDrain() ||
+                    _replCoord->getMemberState().primary()) {
+                    LOG(1) << "waiting for draining or we are primary, "
+                           << "not adding more ops to buffer";
+                    return;
+                }
 
-            bufferCountGauge.increment();
-            bufferSizeGauge.increment(getSize(o));
-            _buffer.push(o);
+                const BSONObj& o = *it;
+                opsReadStats.increment();
 
-            {
-                boost::unique_lock<boost::mutex> lock(_mutex);
-                _lastFetchedHash = o["h"].numberLong();
-                _lastOpTimeFetched = o["ts"].timestamp();
-                LOG(3) << "lastOpTimeFetched: " << _lastOpTimeFetched.toStringPretty();
+                OCCASIONALLY {
+                    LOG(2) << "bgsync buffer has " << _buffer.size() << " bytes";
+                }
+
+                bufferCountGauge.increment();
+                bufferSizeGauge.increment(getSize(o));
+                _buffer.push(o);
+
+                {
+                    boost::unique_lock<boost::mutex> lock(_mutex);
+                    _lastFetchedHash = o["h"].numberLong();
+                    _lastOpTimeFetched = o["ts"].timestamp();
+                    LOG(3) << "lastOpTimeFetched: " << _lastOpTimeFetched.toStringPretty();
+                }
             }
         }
     }
@@ -528,6 +553,13 @@ namespace {
         return hashElement.safeNumberLong();
     }
 
+    BSONObj BackgroundSync::getCounters() {
+        return BSON("queueOps" << bufferCountGauge.get()
+                    << "queueBytes" << bufferSizeGauge.get()
+                    << "maxQueueBytes" << bufferMaxSizeGauge
+                    << "ops" << opsReadStats.get());
+    }
+
     bool BackgroundSync::getInitialSyncRequestedFlag() {
         boost::lock_guard<boost::mutex> lock(_initialSyncMutex);
         return _initialSyncRequestedFlag;
@@ -101,7 +101,7 @@ namespace repl {
         virtual void clearSyncTarget();
         virtual void waitForMore();
 
-        // For monitoring
+        // For monitoring: the depth of the fetch buffer and the number of entries fetched
         BSONObj getCounters();
 
         long long getLastAppliedHash() const;
@@ -49,6 +49,9 @@ namespace repl {
     const std::string MemberConfig::kArbiterOnlyFieldName = "arbiterOnly";
     const std::string MemberConfig::kBuildIndexesFieldName = "buildIndexes";
     const std::string MemberConfig::kTagsFieldName = "tags";
+    const std::string MemberConfig::kApplyBudgetFieldName = "applyBudget";
+    const std::string MemberConfig::kApplyBudgetMaxLagSecsFieldName = "maxLagSecs";
+    const std::string MemberConfig::kApplyBudgetReaderShareFieldName = "readerShare";
     const std::string MemberConfig::kInternalVoterTagName = "$voter";
     const std::string MemberConfig::kInternalElectableTagName = "$electable";
     const std::string MemberConfig::kInternalAllTagName = "$all";
@@ -63,7 +66,13 @@ namespace {
         MemberConfig::kSlaveDelayFieldName,
         MemberConfig::kArbiterOnlyFieldName,
         MemberConfig::kBuildIndexesFieldName,
-        MemberConfig::kTagsFieldName
+        MemberConfig::kTagsFieldName,
+        MemberConfig::kApplyBudgetFieldName
+    };
+
+    const std::string kLegalApplyBudgetFieldNames[] = {
+        MemberConfig::kApplyBudgetMaxLagSecsFieldName,
+        MemberConfig::kApplyBudgetReaderShareFieldName
     };
 
     const int kVotesFieldDefault = 1;
@@ -72,9 +81,13 @@ namespace {
     const bool kArbiterOnlyFieldDefault = false;
     const bool kHiddenFieldDefault = false;
     const bool kBuildIndexesFieldDefault = true;
+    const double kApplyBudgetReaderShareDefault = 0.5;
 
     const Seconds kMaxSlaveDelay(3600 * 24 * 366);
 
+    // Readers always leave the applier some time, or the member could never catch up.
+    const double kMaxApplyBudgetReaderShare = 0.9;
+
 }  // namespace
 
     Status MemberConfig::initialize(const BSONObj& mcfg, ReplicaSetTagConfig* tagConfig) {
@@ -212,6 +225,56 @@ namespace {
             return status;
         }
 
+        //
+        // Parse "applyBudget" field.
+        //
+        _applyMaxLag = Seconds(0);
+        _applyReaderShare = 0;
+        BSONElement applyBudgetElement;
+        status = bsonExtractTypedField(mcfg, kApplyBudgetFieldName, Object, &applyBudgetElement);
+        if (status.isOK()) {
+            const BSONObj applyBudget = applyBudgetElement.Obj();
+            status = bsonCheckOnlyHasFields(
+                "replica set member applyBudget", applyBudget, kLegalApplyBudgetFieldNames);
+            if (!status.isOK())
+                return status;
+
+            BSONElement maxLagElement = applyBudget[kApplyBudgetMaxLagSecsFieldName];
+            if (maxLagElement.eoo()) {
+                return Status(ErrorCodes::NoSuchKey, str::stream() << kApplyBudgetFieldName <<
+                              "." << kApplyBudgetMaxLagSecsFieldName << " field is missing");
+            }
+            if (!maxLagElement.isNumber()) {
+                return Status(ErrorCodes::TypeMismatch, str::stream() << kApplyBudgetFieldName <<
+                              "." << kApplyBudgetMaxLagSecsFieldName <<
+                              " field value has non-numeric type " <<
+                              typeName(maxLagElement.type()));
+            }
+            _applyMaxLag = Seconds(maxLagElement.numberInt());
+            if (_applyMaxLag <= Seconds(0)) {
+                return Status(ErrorCodes::BadValue, str::stream() << kApplyBudgetFieldName <<
+                              "." << kApplyBudgetMaxLagSecsFieldName <<
+                              " field value must be positive");
+            }
+
+            BSONElement readerShareElement = applyBudget[kApplyBudgetReaderShareFieldName];
+            if (readerShareElement.eoo()) {
+                _applyReaderShare = kApplyBudgetReaderShareDefault;
+            }
+            else if (readerShareElement.isNumber()) {
+                _applyReaderShare = readerShareElement.numberDouble();
+            }
+            else {
+                return Status(ErrorCodes::TypeMismatch, str::stream() << kApplyBudgetFieldName <<
+                              "." << kApplyBudgetReaderShareFieldName <<
+                              " field value has non-numeric type " <<
+                              typeName(readerShareElement.type()));
+            }
+        }
+        else if (ErrorCodes::NoSuchKey != status) {
+            return status;
+        }
+
         //
         // Add internal tags based on other member properties.
         //
@@ -271,6 +334,25 @@ namespace {
         if (!_buildIndexes && _priority != 0) {
             return Status(ErrorCodes::BadValue, "priority must be 0 when buildIndexes=false");
         }
+        if (hasApplyBudget()) {
+            if (_applyMaxLag > kMaxSlaveDelay) {
+                return Status(ErrorCodes::BadValue, str::stream() << kApplyBudgetFieldName <<
+                              "." << kApplyBudgetMaxLagSecsFieldName << " field value of " <<
+                              durationCount<Seconds>(_applyMaxLag) <<
+                              " seconds is out of range");
+            }
+            if (_applyReaderShare < 0 || _applyReaderShare > kMaxApplyBudgetReaderShare) {
+                return Status(ErrorCodes::BadValue, str::stream() << kApplyBudgetFieldName <<
+                              "." << kApplyBudgetReaderShareFieldName << " field value of " <<
+                              _applyReaderShare << " is out of range");
+            }
+            if (_arbiterOnly) {
+                return Status(ErrorCodes::BadValue, "Cannot set applyBudget on arbiters.");
+            }
+            if (_priority != 0) {
+                return Status(ErrorCodes::BadValue, "applyBudget requires priority be zero");
+            }
+        }
         return Status::OK();
     }
 
@@ -312,6 +394,13 @@ namespace {
 
         configBuilder.append("slaveDelay", durationCount<Seconds>(_slaveDelay));
         configBuilder.append("votes", getNumVotes());
+        if (hasApplyBudget()) {
+            BSONObjBuilder applyBudget(configBuilder.subobjStart(kApplyBudgetFieldName));
+            applyBudget.append(kApplyBudgetMaxLagSecsFieldName,
+                               durationCount<Seconds>(_applyMaxLag));
+            applyBudget.append(kApplyBudgetReaderShareFieldName, _applyReaderShare);
+            applyBudget.done();
+        }
         return configBuilder.obj();
     }
 
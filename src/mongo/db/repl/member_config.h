@@ -58,6 +58,9 @@ namespace repl {
         static const std::string kArbiterOnlyFieldName;
         static const std::string kBuildIndexesFieldName;
         static const std::string kTagsFieldName;
+        static const std::string kApplyBudgetFieldName;
+        static const std::string kApplyBudgetMaxLagSecsFieldName;
+        static const std::string kApplyBudgetReaderShareFieldName;
         static const std::string kInternalVoterTagName;
         static const std::string kInternalElectableTagName;
         static const std::string kInternalAllTagName;
@@ -67,7 +70,7 @@ namespace repl {
          * Must successfully call initialze() before calling validate() or the
          * accessors.
          */
-        MemberConfig() : _slaveDelay(0) {}
+        MemberConfig() : _slaveDelay(0), _applyMaxLag(0), _applyReaderShare(0) {}
 
         /**
          * Initializes this MemberConfig from the contents of "mcfg".
@@ -107,6 +110,24 @@ namespace repl {
          */
         Seconds getSlaveDelay() const { return _slaveDelay; }
 
+        /**
+         * Returns true if this member trades oplog application against reads, as configured by
+         * its applyBudget subdocument.
+         */
+        bool hasApplyBudget() const { return _applyMaxLag > Seconds(0); }
+
+        /**
+         * Gets how far behind the primary this member may fall before it stops leaving time to
+         * readers between batches.  Zero seconds means the member has no apply budget.
+         */
+        Seconds getApplyMaxLag() const { return _applyMaxLag; }
+
+        /**
+         * Gets the share of time, between 0 and 1, that this member leaves to readers between
+         * batches while it is within its maximum lag.
+         */
+        double getApplyReaderShare() const { return _applyReaderShare; }
+
         /**
          * Returns true if this member may vote in elections.
          */
@@ -173,6 +194,8 @@ namespace repl {
         Seconds _slaveDelay;
         bool _hidden;          // if set, don't advertise to drivers in isMaster.
         bool _buildIndexes;    // if false, do not create any non-_id indexes
+        Seconds _applyMaxLag;      // 0 means no apply budget
+        double _applyReaderShare;  // share of time left to readers while within _applyMaxLag
         std::vector<ReplicaSetTag> _tags;  // tagging for data center, rack, etc.
     };
 
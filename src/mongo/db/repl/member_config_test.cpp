@@ -195,6 +195,48 @@ namespace {
         ASSERT_EQUALS(Seconds(100), mc.getSlaveDelay());
     }
 
+    TEST(MemberConfig, ParseApplyBudget) {
+        ReplicaSetTagConfig tagConfig;
+        MemberConfig mc;
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h"), &tagConfig));
+        ASSERT_FALSE(mc.hasApplyBudget());
+
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h" <<
+                                     "applyBudget" << BSON("maxLagSecs" << 30)),
+                                &tagConfig));
+        ASSERT_TRUE(mc.hasApplyBudget());
+        ASSERT_EQUALS(Seconds(30), mc.getApplyMaxLag());
+        ASSERT_EQUALS(0.5, mc.getApplyReaderShare());
+
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h" <<
+                                     "applyBudget" << BSON("maxLagSecs" << 30 <<
+                                                           "readerShare" << 0.75)),
+                                &tagConfig));
+        ASSERT_EQUALS(0.75, mc.getApplyReaderShare());
+        ASSERT_EQUALS(0.75, mc.toBSON(tagConfig)["applyBudget"]["readerShare"].numberDouble());
+
+        ASSERT_EQUALS(ErrorCodes::NoSuchKey,
+                      mc.initialize(BSON("_id" << 0 << "host" << "h" <<
+                                         "applyBudget" << BSON("readerShare" << 0.75)),
+                                    &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::BadValue,
+                      mc.initialize(BSON("_id" << 0 << "host" << "h" <<
+                                         "applyBudget" << BSON("maxLagSecs" << 0)),
+                                    &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::TypeMismatch,
+                      mc.initialize(BSON("_id" << 0 << "host" << "h" <<
+                                         "applyBudget" << BSON("maxLagSecs" << "30")),
+                                    &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::BadValue,
+                      mc.initialize(BSON("_id" << 0 << "host" << "h" <<
+                                         "applyBudget" << BSON("maxLagSecs" << 30 <<
+                                                               "cpuShare" << 0.5)),
+                                    &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::TypeMismatch,
+                      mc.initialize(BSON("_id" << 0 << "host" << "h" << "applyBudget" << 30),
+                                    &tagConfig));
+    }
+
     TEST(MemberConfig, ParseTags) {
         ReplicaSetTagConfig tagConfig;
         MemberConfig mc;
@@ -338,6 +380,33 @@ namespace {
         ASSERT_OK(mc.validate());
     }
 
+    TEST(MemberConfig, ValidateApplyBudget) {
+        ReplicaSetTagConfig tagConfig;
+        MemberConfig mc;
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h" << "priority" << 0 <<
+                                     "applyBudget" << BSON("maxLagSecs" << 60 <<
+                                                           "readerShare" << 0.9)),
+                                &tagConfig));
+        ASSERT_OK(mc.validate());
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h" << "priority" << 0 <<
+                                     "applyBudget" << BSON("maxLagSecs" << 60 <<
+                                                           "readerShare" << 0.95)),
+                                &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::BadValue, mc.validate());
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h" << "priority" << 0 <<
+                                     "applyBudget" << BSON("maxLagSecs" << 3600 * 24 * 400)),
+                                &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::BadValue, mc.validate());
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h" << "priority" << 1 <<
+                                     "applyBudget" << BSON("maxLagSecs" << 60)),
+                                &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::BadValue, mc.validate());
+        ASSERT_OK(mc.initialize(BSON("_id" << 0 << "host" << "h" << "arbiterOnly" << true <<
+                                     "applyBudget" << BSON("maxLagSecs" << 60)),
+                                &tagConfig));
+        ASSERT_EQUALS(ErrorCodes::BadValue, mc.validate());
+    }
+
     TEST(MemberConfig, ValidateArbiterVotesRelationship) {
         ReplicaSetTagConfig tagConfig;
         MemberConfig mc;
@@ -70,6 +70,7 @@
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/update_lifecycle_impl.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/oplog_entry.h"
 #include "mongo/db/repl/optime.h"
 #include "mongo/db/repl/repl_client_info.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
@@ -595,30 +596,23 @@ namespace {
                                Database* db,
                                const BSONObj& op,
                                bool convertUpdateToUpsert) {
+        return applyOperation_inlock(txn, db, OplogEntry(op), convertUpdateToUpsert);
+    }
+
+    Status applyOperation_inlock(OperationContext* txn,
+                               Database* db,
+                               const OplogEntry& entry,
+                               bool convertUpdateToUpsert) {
+        const BSONObj& op = entry.raw;
         LOG(3) << "applying op: " << op << endl;
 
         OpCounters * opCounters = txn->writesAreReplicated() ? &globalOpCounters : &replOpCounters;
 
-        const char *names[] = { "o", "ns", "op", "b", "o2" };
-        BSONElement fields[5];
-        op.getFields(5, names, fields);
-        BSONElement& fieldO = fields[0];
-        BSONElement& fieldNs = fields[1];
-        BSONElement& fieldOp = fields[2];
-        BSONElement& fieldB = fields[3];
-        BSONElement& fieldO2 = fields[4];
-
-        BSONObj o;
-        if( fieldO.isABSONObj() )
-            o = fieldO.embeddedObject();
-
-        const char *ns = fieldNs.valuestrsafe();
-
-        BSONObj o2;
-        if (fieldO2.isABSONObj())
-            o2 = fieldO2.Obj();
-
-        bool valueB = fieldB.booleanSafe();
+        const BSONObj& o = entry.o;
+        const char *ns = entry.ns;
+        // logOp() takes a non-const pointer.
+        BSONObj o2 = entry.o2;
+        bool valueB = entry.b;
 
         if (nsIsFull(ns)) {
             if (supportsDocLocking()) {
@@ -635,7 +629,7 @@ namespace {
         IndexCatalog* indexCatalog = collection == nullptr ? nullptr : collection->getIndexCatalog();
 
         // operation type -- see logOp() comments for types
-        const char *opType = fieldOp.valuestrsafe();
+        const char *opType = entry.opType;
         invariant(*opType != 'c'); // commands are processed in applyCommand_inlock()
 
         if ( *opType == 'i' ) {
@@ -780,7 +774,7 @@ namespace {
                 opType,
                 ns,
                 o,
-                fieldO2.isABSONObj() ? &o2 : NULL);
+                entry.hasO2 ? &o2 : NULL);
         wuow.commit();
 
         return Status::OK();
@@ -48,6 +48,7 @@ namespace mongo {
     class RecordId;
 
 namespace repl {
+    struct OplogEntry;
     class ReplicationCoordinator;
  
     // Create a new capped collection for the oplog if it doesn't yet exist.
@@ -102,6 +103,14 @@ namespace repl {
                                  const BSONObj& op,
                                  bool convertUpdateToUpsert = false);
 
+    /**
+     * Same, for an op already parsed into an OplogEntry
+     */
+    Status applyOperation_inlock(OperationContext* txn,
+                                 Database* db,
+                                 const OplogEntry& op,
+                                 bool convertUpdateToUpsert = false);
+
     /**
      * Take a command op and apply it locally
      * Used for applying from an oplog
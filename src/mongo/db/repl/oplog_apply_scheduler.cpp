@@ -0,0 +1,93 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/repl/oplog_apply_scheduler.h"
+
+#include <algorithm>
+
+#include "mongo/platform/unordered_map.h"
+#include "third_party/murmurhash3/MurmurHash3.h"
+
+namespace mongo {
+namespace repl {
+
+namespace {
+
+    bool longerChain(const std::vector<OplogEntry>& a, const std::vector<OplogEntry>& b) {
+        return a.size() > b.size();
+    }
+
+    /**
+     * Entries with the same key must be applied in order. Two unrelated entries may share a key
+     * if their hashes collide, which only costs some parallelism.
+     */
+    uint32_t dependencyKey(const OplogEntry& op, bool byDocument) {
+        uint32_t hash = 0;
+        MurmurHash3_x86_32(op.ns, strlen(op.ns), 0, &hash);
+
+        if (byDocument && op.isCrudOpType()) {
+            const size_t idHash = BSONElement::Hasher()(op.id);
+            MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+        }
+
+        return hash;
+    }
+
+} // namespace
+
+    OplogApplyScheduler::OplogApplyScheduler(const std::deque<OplogEntry>& ops, bool byDocument)
+        : _next(0) {
+
+        unordered_map<uint32_t, size_t> chainForKey;
+        for (std::deque<OplogEntry>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+            const uint32_t key = dependencyKey(*it, byDocument);
+
+            unordered_map<uint32_t, size_t>::const_iterator chain = chainForKey.find(key);
+            if (chain == chainForKey.end()) {
+                chain = chainForKey.insert(std::make_pair(key, _chains.size())).first;
+                _chains.push_back(std::vector<OplogEntry>());
+            }
+            _chains[chain->second].push_back(*it);
+        }
+
+        // Stable, so that equally long chains keep the order they appear in the batch.
+        std::stable_sort(_chains.begin(), _chains.end(), longerChain);
+    }
+
+    const std::vector<OplogEntry>* OplogApplyScheduler::next() {
+        const size_t i = _next.fetchAndAdd(1);
+        if (i >= _chains.size()) {
+            return NULL;
+        }
+        return &_chains[i];
+    }
+
+} // namespace repl
+} // namespace mongo
@@ -0,0 +1,81 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/repl/oplog_entry.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+namespace repl {
+
+    /**
+     * Splits a batch of oplog entries into chains that can be applied independently of each other
+     * and hands the chains out to the writer threads as they ask for more work.
+     *
+     * Entries on the same document, or on the same collection when the storage engine does not
+     * lock documents, go into the same chain in oplog order. Everything else is independent, so
+     * instead of tying each chain to a writer up front, writers keep taking the next chain until
+     * there are none left. A hot collection with a few busy documents then keeps every writer
+     * going rather than the ones its documents happen to hash to.
+     *
+     * Chains are handed out longest first, so the longest one, which bounds how soon the batch
+     * can finish, is started right away.
+     */
+    class OplogApplyScheduler {
+        MONGO_DISALLOW_COPYING(OplogApplyScheduler);
+    public:
+        OplogApplyScheduler(const std::deque<OplogEntry>& ops, bool byDocument);
+
+        /**
+         * Returns the next chain to apply, or NULL once every chain has been handed out. May be
+         * called from several threads at once. The chain stays owned by the scheduler.
+         */
+        const std::vector<OplogEntry>* next();
+
+        size_t numChains() const { return _chains.size(); }
+
+        size_t longestChain() const { return _chains.empty() ? 0 : _chains.front().size(); }
+
+        /**
+         * The i-th chain in the order next() hands them out. For looking ahead at what the writers
+         * will apply without taking chains away from them.
+         */
+        const std::vector<OplogEntry>& chain(size_t i) const { return _chains[i]; }
+
+    private:
+        std::vector<std::vector<OplogEntry> > _chains;
+        AtomicUInt32 _next;
+    };
+
+} // namespace repl
+} // namespace mongo
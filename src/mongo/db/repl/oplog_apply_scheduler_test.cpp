@@ -0,0 +1,168 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <deque>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/repl/oplog_apply_scheduler.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace repl {
+namespace {
+
+    OplogEntry insertOp(const std::string& ns, int id) {
+        return OplogEntry(BSON("op" << "i" << "ns" << ns << "o" << BSON("_id" << id)));
+    }
+
+    OplogEntry updateOp(const std::string& ns, int id, int x) {
+        return OplogEntry(BSON("op" << "u" << "ns" << ns << "o2" << BSON("_id" << id)
+                               << "o" << BSON("$set" << BSON("x" << x))));
+    }
+
+    OplogEntry deleteOp(const std::string& ns, int id) {
+        return OplogEntry(BSON("op" << "d" << "ns" << ns << "o" << BSON("_id" << id)));
+    }
+
+    std::vector<const std::vector<OplogEntry>*> drain(OplogApplyScheduler* scheduler) {
+        std::vector<const std::vector<OplogEntry>*> chains;
+        while (const std::vector<OplogEntry>* chain = scheduler->next()) {
+            chains.push_back(chain);
+        }
+        ASSERT_EQUALS(scheduler->numChains(), chains.size());
+        ASSERT(!scheduler->next());
+        return chains;
+    }
+
+    TEST(OplogApplyScheduler, Empty) {
+        std::deque<OplogEntry> ops;
+        OplogApplyScheduler scheduler(ops, true);
+        ASSERT_EQUALS(0U, scheduler.numChains());
+        ASSERT_EQUALS(0U, scheduler.longestChain());
+        ASSERT(!scheduler.next());
+    }
+
+    TEST(OplogApplyScheduler, SameDocumentStaysInOrder) {
+        std::deque<OplogEntry> ops;
+        ops.push_back(insertOp("test.a", 1));
+        ops.push_back(insertOp("test.a", 2));
+        ops.push_back(updateOp("test.a", 1, 1));
+        ops.push_back(updateOp("test.a", 1, 2));
+        ops.push_back(deleteOp("test.a", 1));
+
+        OplogApplyScheduler scheduler(ops, true);
+        ASSERT_EQUALS(2U, scheduler.numChains());
+        ASSERT_EQUALS(4U, scheduler.longestChain());
+
+        std::vector<const std::vector<OplogEntry>*> chains = drain(&scheduler);
+
+        // Longest first.
+        const std::vector<OplogEntry>& first = *chains[0];
+        ASSERT_EQUALS(4U, first.size());
+        ASSERT_EQUALS(ops[0].raw, first[0].raw);
+        ASSERT_EQUALS(ops[2].raw, first[1].raw);
+        ASSERT_EQUALS(ops[3].raw, first[2].raw);
+        ASSERT_EQUALS(ops[4].raw, first[3].raw);
+
+        ASSERT_EQUALS(1U, chains[1]->size());
+        ASSERT_EQUALS(ops[1].raw, chains[1]->front().raw);
+    }
+
+    TEST(OplogApplyScheduler, ChainLooksAheadWithoutTakingChains) {
+        std::deque<OplogEntry> ops;
+        ops.push_back(insertOp("test.a", 1));
+        ops.push_back(insertOp("test.a", 2));
+        ops.push_back(updateOp("test.a", 2, 1));
+
+        OplogApplyScheduler scheduler(ops, true);
+        ASSERT_EQUALS(2U, scheduler.chain(0).size());
+        ASSERT_EQUALS(1U, scheduler.chain(1).size());
+
+        std::vector<const std::vector<OplogEntry>*> chains = drain(&scheduler);
+        for (size_t i = 0; i < chains.size(); i++) {
+            ASSERT_EQUALS(&scheduler.chain(i), chains[i]);
+        }
+    }
+
+    TEST(OplogApplyScheduler, SameIdInDifferentCollections) {
+        std::deque<OplogEntry> ops;
+        ops.push_back(insertOp("test.a", 1));
+        ops.push_back(insertOp("test.b", 1));
+
+        OplogApplyScheduler scheduler(ops, true);
+        ASSERT_EQUALS(2U, scheduler.numChains());
+    }
+
+    TEST(OplogApplyScheduler, ByCollectionWithoutDocumentLocking) {
+        std::deque<OplogEntry> ops;
+        ops.push_back(insertOp("test.a", 1));
+        ops.push_back(insertOp("test.b", 1));
+        ops.push_back(insertOp("test.a", 2));
+        ops.push_back(updateOp("test.b", 1, 1));
+        ops.push_back(insertOp("test.a", 3));
+
+        OplogApplyScheduler scheduler(ops, false);
+        ASSERT_EQUALS(2U, scheduler.numChains());
+
+        std::vector<const std::vector<OplogEntry>*> chains = drain(&scheduler);
+        ASSERT_EQUALS(3U, chains[0]->size());
+        ASSERT_EQUALS(ops[0].raw, (*chains[0])[0].raw);
+        ASSERT_EQUALS(ops[2].raw, (*chains[0])[1].raw);
+        ASSERT_EQUALS(ops[4].raw, (*chains[0])[2].raw);
+
+        ASSERT_EQUALS(2U, chains[1]->size());
+        ASSERT_EQUALS(ops[1].raw, (*chains[1])[0].raw);
+        ASSERT_EQUALS(ops[3].raw, (*chains[1])[1].raw);
+    }
+
+    TEST(OplogApplyScheduler, HotCollectionSpreadsOverChains) {
+        std::deque<OplogEntry> ops;
+        for (int i = 0; i < 100; i++) {
+            ops.push_back(insertOp("test.hot", i * 16));
+        }
+
+        OplogApplyScheduler scheduler(ops, true);
+        ASSERT_EQUALS(100U, scheduler.numChains());
+        ASSERT_EQUALS(1U, scheduler.longestChain());
+    }
+
+    TEST(OplogApplyScheduler, NoopsGoByNamespace) {
+        std::deque<OplogEntry> ops;
+        ops.push_back(OplogEntry(BSON("op" << "n" << "ns" << "" << "o" << BSON("msg" << "a"))));
+        ops.push_back(OplogEntry(BSON("op" << "n" << "ns" << "" << "o" << BSON("msg" << "b"))));
+
+        OplogApplyScheduler scheduler(ops, true);
+        ASSERT_EQUALS(1U, scheduler.numChains());
+        ASSERT_EQUALS(2U, scheduler.longestChain());
+    }
+
+} // namespace
+} // namespace repl
+} // namespace mongo
@@ -0,0 +1,77 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/repl/oplog_entry.h"
+
+namespace mongo {
+namespace repl {
+
+    OplogEntry::OplogEntry(const BSONObj& rawInput)
+        : raw(rawInput), hasO2(false) {
+
+        const char* names[] = { "ns", "op", "ts", "v", "o", "o2", "b" };
+        BSONElement fields[7];
+        raw.getFields(7, names, fields);
+
+        ns = fields[0].valuestrsafe();
+        nss = NamespaceString(ns);
+        opType = fields[1].valuestrsafe();
+        ts = fields[2].timestamp();
+        version = fields[3].eoo() ? 1 : fields[3].Int();
+        if (fields[4].isABSONObj()) {
+            o = fields[4].Obj();
+        }
+        if (fields[5].isABSONObj()) {
+            o2 = fields[5].Obj();
+            hasO2 = true;
+        }
+        b = fields[6].booleanSafe();
+
+        if (isCrudOpType()) {
+            id = (opType[0] == 'u' ? o2 : o)["_id"];
+        }
+    }
+
+    bool OplogEntry::isCrudOpType() const {
+        switch (opType[0]) {
+        case 'd':
+        case 'i':
+        case 'u':
+            return opType[1] == 0;
+        }
+        return false;
+    }
+
+    bool OplogEntry::isIndexBuild() const {
+        return opType[0] == 'i' && nss.isSystemDotIndexes();
+    }
+
+} // namespace repl
+} // namespace mongo
@@ -0,0 +1,71 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+
+namespace mongo {
+namespace repl {
+
+    /**
+     * The fields of an oplog entry that batching and applying it look at, parsed once when the
+     * entry is added to a batch instead of by each step on the way.
+     *
+     * All of them point into 'raw', so an entry is only valid as long as the buffer of 'raw' is.
+     */
+    struct OplogEntry {
+        explicit OplogEntry(const BSONObj& raw);
+
+        bool isCommand() const { return opType[0] == 'c'; }
+        bool isNoOp() const { return opType[0] == 'n'; }
+        // Inserts, updates and deletes
+        bool isCrudOpType() const;
+        // Index builds are inserts into system.indexes
+        bool isIndexBuild() const;
+
+        BSONObj raw;
+
+        const char* ns;       // "" if missing
+        NamespaceString nss;
+        const char* opType;   // "" if missing
+        Timestamp ts;
+        int version;          // 1 if missing
+        BSONObj o;            // empty unless 'o' is an object
+        BSONObj o2;           // empty unless 'o2' is an object
+        bool hasO2;           // whether 'o2' is an object
+        bool b;               // the upsert or justOne flag of updates and deletes
+
+        // The _id of the document an insert, update or delete is on, EOO for other entries and
+        // for the rare entry without one.
+        BSONElement id;
+    };
+
+} // namespace repl
+} // namespace mongo
@@ -0,0 +1,85 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/repl/oplog_entry.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace repl {
+namespace {
+
+    TEST(OplogEntry, Insert) {
+        OplogEntry op(BSON("ts" << Timestamp(5, 1) << "h" << 1LL << "v" << 2 << "op" << "i"
+                           << "ns" << "test.a" << "o" << BSON("_id" << 7 << "x" << 1)));
+        ASSERT_EQUALS(StringData("test.a"), StringData(op.ns));
+        ASSERT_EQUALS("test.a", op.nss.ns());
+        ASSERT_EQUALS(Timestamp(5, 1), op.ts);
+        ASSERT_EQUALS(2, op.version);
+        ASSERT(op.isCrudOpType());
+        ASSERT(!op.isCommand());
+        ASSERT(!op.isIndexBuild());
+        ASSERT_EQUALS(BSON("_id" << 7 << "x" << 1), op.o);
+        ASSERT(!op.hasO2);
+        ASSERT_EQUALS(7, op.id.numberInt());
+    }
+
+    TEST(OplogEntry, UpdateTakesIdFromO2) {
+        OplogEntry op(BSON("op" << "u" << "ns" << "test.a" << "b" << true
+                           << "o2" << BSON("_id" << "x")
+                           << "o" << BSON("$set" << BSON("_id" << "y"))));
+        ASSERT(op.hasO2);
+        ASSERT(op.b);
+        ASSERT_EQUALS("x", op.id.String());
+    }
+
+    TEST(OplogEntry, CommandsAndIndexBuilds) {
+        OplogEntry command(BSON("op" << "c" << "ns" << "test.$cmd" << "o" << BSON("drop" << "a")));
+        ASSERT(command.isCommand());
+        ASSERT(!command.isCrudOpType());
+        ASSERT(command.id.eoo());
+
+        OplogEntry indexBuild(BSON("op" << "i" << "ns" << "test.system.indexes"
+                                   << "o" << BSON("ns" << "test.a" << "key" << BSON("x" << 1))));
+        ASSERT(indexBuild.isIndexBuild());
+    }
+
+    TEST(OplogEntry, MissingFields) {
+        OplogEntry op(BSON("op" << "n"));
+        ASSERT(op.isNoOp());
+        ASSERT_EQUALS(StringData(""), StringData(op.ns));
+        ASSERT_EQUALS(1, op.version);
+        ASSERT(op.o.isEmpty());
+        ASSERT(!op.b);
+    }
+
+} // namespace
+} // namespace repl
+} // namespace mongo
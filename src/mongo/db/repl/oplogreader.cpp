@@ -137,6 +137,39 @@ namespace repl {
         tailingQuery(ns, query.done(), fields);
     }
 
+    void OplogReader::takeCurrentBatch(std::vector<BSONObj>* ops) {
+        uassert(28727, "Doesn't have cursor for reading oplog", cursor.get());
+
+        // Entries put back are already owned; the rest point into the reply, one after another.
+        const size_t firstTaken = ops->size();
+        const char* begin = NULL;
+        const char* end = NULL;
+        while (cursor->moreInCurrentBatch()) {
+            BSONObj op = cursor->nextSafe();
+            if (!op.isOwned()) {
+                if (!begin) {
+                    begin = op.objdata();
+                }
+                end = op.objdata() + op.objsize();
+            }
+            ops->push_back(op);
+        }
+        if (!begin) {
+            return;
+        }
+
+        SharedBuffer buffer = SharedBuffer::allocate(end - begin);
+        memcpy(buffer.get(), begin, end - begin);
+        for (size_t i = firstTaken; i < ops->size(); ++i) {
+            BSONObj& op = (*ops)[i];
+            if (op.isOwned()) {
+                continue;
+            }
+            dassert(op.objdata() >= begin && op.objdata() + op.objsize() <= end);
+            op = BSONObj(buffer.get() + (op.objdata() - begin)).shareOwnershipWith(buffer);
+        }
+    }
+
     HostAndPort OplogReader::getHost() const {
         return _host;
     }
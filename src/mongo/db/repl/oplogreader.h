@@ -134,6 +134,21 @@ namespace repl {
         BSONObj next() { return cursor->next(); }
         void putBack(BSONObj op) { cursor->putBack(op); }
 
+        /**
+         * Moves what is left of the current batch to the end of 'ops'. The entries share one
+         * copy of the batch instead of each getting its own.
+         */
+        void takeCurrentBatch(std::vector<BSONObj>* ops);
+
+        /**
+         * Asks the sync source for the next batch while the current one is being processed.
+         * See DBClientCursor::requestMoreAhead().
+         */
+        bool requestMoreAhead() {
+            uassert(28726, "Doesn't have cursor for reading oplog", cursor.get());
+            return cursor->requestMoreAhead();
+        }
+
         HostAndPort getHost() const;
 
         /**
@@ -31,6 +31,7 @@
 #include "mongo/base/init.h"
 #include "mongo/base/status.h"
 #include "mongo/db/server_parameters.h"
+#include "mongo/platform/bits.h"
 
 namespace mongo {
 namespace repl {
@@ -43,5 +44,41 @@ namespace repl {
         return Status::OK();
     }
 
+#if defined(MONGO_PLATFORM_64)
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replWriterThreadCount, int, 16);
+#elif defined(MONGO_PLATFORM_32)
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replWriterThreadCount, int, 2);
+#else
+#error need to include something that defines MONGO_PLATFORM_XX
+#endif
+    MONGO_INITIALIZER(replWriterThreadCountCheck) (InitializerContext*) {
+        if (replWriterThreadCount < 1 || replWriterThreadCount > 256) {
+            return Status(ErrorCodes::BadValue, "replWriterThreadCount must be between 1 and 256");
+        }
+        return Status::OK();
+    }
+
+    MONGO_EXPORT_SERVER_PARAMETER(replPrefetchDuringApply, bool, false);
+
+    MONGO_EXPORT_SERVER_PARAMETER(replOplogFetchAhead, bool, true);
+
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replUpdatePositionIntervalMillis, int, 10);
+    MONGO_INITIALIZER(replUpdatePositionIntervalMillisCheck) (InitializerContext*) {
+        if (replUpdatePositionIntervalMillis < 0 || replUpdatePositionIntervalMillis > 1000) {
+            return Status(ErrorCodes::BadValue,
+                          "replUpdatePositionIntervalMillis must be between 0 and 1000");
+        }
+        return Status::OK();
+    }
+
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(initialSyncCloneThreadCount, int, 4);
+    MONGO_INITIALIZER(initialSyncCloneThreadCountCheck) (InitializerContext*) {
+        if (initialSyncCloneThreadCount < 1 || initialSyncCloneThreadCount > 64) {
+            return Status(ErrorCodes::BadValue,
+                          "initialSyncCloneThreadCount must be between 1 and 64");
+        }
+        return Status::OK();
+    }
+
 }
 }
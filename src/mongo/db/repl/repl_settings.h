@@ -40,6 +40,22 @@ namespace repl {
 
     extern int maxSyncSourceLagSecs;
 
+    // Number of threads a secondary applies oplog entries with.
+    extern int replWriterThreadCount;
+
+    // Whether secondaries on engines with document locking prefetch a batch while applying it.
+    extern bool replPrefetchDuringApply;
+
+    // Whether secondaries ask for the next batch of oplog entries while buffering the current one.
+    extern bool replOplogFetchAhead;
+
+    // Least time between two position updates a secondary sends its sync source. Changes in
+    // between are sent together.
+    extern int replUpdatePositionIntervalMillis;
+
+    // Number of collections of a database initial sync copies at once.
+    extern int initialSyncCloneThreadCount;
+
     bool anyReplEnabled();
 
     /* replication slave? (possibly with slave)
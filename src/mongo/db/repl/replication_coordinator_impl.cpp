@@ -36,11 +36,14 @@
 #include <boost/thread.hpp>
 #include <limits>
 
+#include "mongo/base/counter.h"
 #include "mongo/base/status.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/concurrency/d_concurrency.h"
 #include "mongo/db/global_timestamp.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/operation_context_noop.h"
+#include "mongo/db/repl/apply_budget.h"
 #include "mongo/db/repl/check_quorum_for_config_change.h"
 #include "mongo/db/repl/elect_cmd_runner.h"
 #include "mongo/db/repl/freshness_checker.h"
@@ -106,6 +109,47 @@ namespace {
         return builder.obj();
     }
 
+    /**
+     * Counts waits by how long they took, in power of two buckets of milliseconds.
+     */
+    class WaitTimeHistogram {
+    public:
+        void record(long long millis) {
+            int bucket = 0;
+            while (bucket < kNumBuckets - 1 && millis >= (1LL << bucket)) {
+                ++bucket;
+            }
+            _counts[bucket].increment();
+        }
+
+        BSONObj getReport() const {
+            BSONObjBuilder b;
+            for (int bucket = 0; bucket < kNumBuckets - 1; ++bucket) {
+                b.append(std::string(str::stream() << "lt" << (1LL << bucket)),
+                         _counts[bucket].get());
+            }
+            b.append(std::string(str::stream() << "ge" << (1LL << (kNumBuckets - 2))),
+                     _counts[kNumBuckets - 1].get());
+            return b.obj();
+        }
+        operator BSONObj() const { return getReport(); }
+
+    private:
+        // Up to "lt16384" and then "ge16384".
+        static const int kNumBuckets = 16;
+        Counter64 _counts[kNumBuckets];
+    };
+
+    // The number of clients waiting on replication
+    Counter64 replicationWaiterCount;
+    ServerStatusMetricField<Counter64> displayReplicationWaiterCount(
+            "repl.waiters.replication", &replicationWaiterCount);
+
+    // How long clients waited for their write concern
+    WaitTimeHistogram replicationWaitTimes;
+    ServerStatusMetricField<WaitTimeHistogram> displayReplicationWaitTimes(
+            "repl.waiters.replicationWaitMillis", &replicationWaitTimes);
+
 } //namespace
 
     struct ReplicationCoordinatorImpl::WaiterInfo {
@@ -119,6 +163,7 @@ namespace {
                    const OpTime* _opTime,
                    const WriteConcernOptions* _writeConcern,
                    boost::condition_variable* _condVar) : list(_list),
+                                                          replicationWaiters(NULL),
                                                           master(true),
                                                           opID(_opID),
                                                           opTime(_opTime),
@@ -127,11 +172,47 @@ namespace {
             list->push_back(this);
         }
 
+        /**
+         * Same for the waiters on replication, which are kept ordered by write concern mode and
+         * optime.
+         */
+        WaiterInfo(ReplicationWaiters* _replicationWaiters,
+                   unsigned int _opID,
+                   const OpTime* _opTime,
+                   const WriteConcernOptions* _writeConcern,
+                   boost::condition_variable* _condVar) : list(NULL),
+                                                          replicationWaiters(_replicationWaiters),
+                                                          master(true),
+                                                          opID(_opID),
+                                                          opTime(_opTime),
+                                                          writeConcern(_writeConcern),
+                                                          condVar(_condVar) {
+            const std::pair<std::string, int> mode(
+                    writeConcern->wMode,
+                    writeConcern->wMode.empty() ? writeConcern->wNumNodes : 0);
+            group = replicationWaiters->insert(
+                    std::make_pair(mode, ReplicationWaitersByOpTime())).first;
+            position = group->second.insert(std::make_pair(*opTime, this));
+            replicationWaiterCount.increment();
+        }
+
         ~WaiterInfo() {
-            list->erase(std::remove(list->begin(), list->end(), this), list->end());
+            if (list) {
+                list->erase(std::remove(list->begin(), list->end(), this), list->end());
+                return;
+            }
+
+            group->second.erase(position);
+            if (group->second.empty()) {
+                replicationWaiters->erase(group);
+            }
+            replicationWaiterCount.decrement();
         }
 
         std::vector<WaiterInfo*>* list;
+        ReplicationWaiters* replicationWaiters;
+        ReplicationWaiters::iterator group;
+        ReplicationWaitersByOpTime::iterator position;
         bool master; // Set to false to indicate that stepDown was called while waiting
         const unsigned int opID;
         const OpTime* opTime;
@@ -400,10 +481,10 @@ namespace {
                 return;
             }
             fassert(18823, _rsConfigState != kConfigStartingUp);
-            for (std::vector<WaiterInfo*>::iterator it = _replicationWaiterList.begin();
-                    it != _replicationWaiterList.end(); ++it) {
-                WaiterInfo* waiter = *it;
-                waiter->condVar->notify_all();
+            for (auto& group : _replicationWaiters) {
+                for (auto& waiter : group.second) {
+                    waiter.second->condVar->notify_all();
+                }
             }
         }
 
@@ -917,12 +998,12 @@ namespace {
 
     void ReplicationCoordinatorImpl::interrupt(unsigned opId) {
         boost::lock_guard<boost::mutex> lk(_mutex);
-        for (std::vector<WaiterInfo*>::iterator it = _replicationWaiterList.begin();
-                it != _replicationWaiterList.end(); ++it) {
-            WaiterInfo* info = *it;
-            if (info->opID == opId) {
-                info->condVar->notify_all();
-                return;
+        for (auto& group : _replicationWaiters) {
+            for (auto& waiter : group.second) {
+                if (waiter.second->opID == opId) {
+                    waiter.second->condVar->notify_all();
+                    return;
+                }
             }
         }
 
@@ -941,10 +1022,10 @@ namespace {
 
     void ReplicationCoordinatorImpl::interruptAll() {
         boost::lock_guard<boost::mutex> lk(_mutex);
-        for (std::vector<WaiterInfo*>::iterator it = _replicationWaiterList.begin();
-                it != _replicationWaiterList.end(); ++it) {
-            WaiterInfo* info = *it;
-            info->condVar->notify_all();
+        for (auto& group : _replicationWaiters) {
+            for (auto& waiter : group.second) {
+                waiter.second->condVar->notify_all();
+            }
         }
 
         for (auto& opTimeWaiter : _opTimeWaiterList) {
@@ -1092,10 +1173,11 @@ namespace {
             }
         }
 
-        // Must hold _mutex before constructing waitInfo as it will modify _replicationWaiterList
+        // Must hold _mutex before constructing waitInfo as it will modify _replicationWaiters
         boost::condition_variable condVar;
         WaiterInfo waitInfo(
-                &_replicationWaiterList, txn->getOpID(), &opTime, &writeConcern, &condVar);
+                &_replicationWaiters, txn->getOpID(), &opTime, &writeConcern, &condVar);
+        ON_BLOCK_EXIT([timer] { replicationWaitTimes.record(timer->millis()); });
         while (!_doneWaitingForReplication_inlock(opTime, writeConcern)) {
             const int elapsed = timer->millis();
 
@@ -1506,6 +1588,9 @@ namespace {
         fassert(18640, cbh.getStatus());
         _replExecutor.wait(cbh.getValue());
 
+        if (result.isOK()) {
+            ApplyBudget::get()->append(response);
+        }
         return result;
     }
 
@@ -2034,11 +2119,11 @@ namespace {
         PostMemberStateUpdateAction result;
         if (_memberState.primary() || newState.removed()) {
             // Wake up any threads blocked in awaitReplication, close connections, etc.
-            for (std::vector<WaiterInfo*>::iterator it = _replicationWaiterList.begin();
-                 it != _replicationWaiterList.end(); ++it) {
-                WaiterInfo* info = *it;
-                info->master = false;
-                info->condVar->notify_all();
+            for (auto& group : _replicationWaiters) {
+                for (auto& waiter : group.second) {
+                    waiter.second->master = false;
+                    waiter.second->condVar->notify_all();
+                }
             }
             _isWaitingForDrainToComplete = false;
             _canAcceptNonLocalWrites = false;
@@ -2204,6 +2289,14 @@ namespace {
              log() << "This node is not a member of the config";
          }
 
+         if (_selfIndex >= 0) {
+             const MemberConfig& self = _rsConfig.getMemberAt(_selfIndex);
+             ApplyBudget::get()->configure(self.getApplyMaxLag(), self.getApplyReaderShare());
+         }
+         else {
+             ApplyBudget::get()->configure(Seconds(0), 0);
+         }
+
          const PostMemberStateUpdateAction action =
              _updateMemberStateFromTopologyCoordinator_inlock();
          _updateSlaveInfoFromConfig_inlock();
@@ -2217,10 +2310,13 @@ namespace {
      }
 
     void ReplicationCoordinatorImpl::_wakeReadyWaiters_inlock(){
-        for (std::vector<WaiterInfo*>::iterator it = _replicationWaiterList.begin();
-                it != _replicationWaiterList.end(); ++it) {
-            WaiterInfo* info = *it;
-            if (_doneWaitingForReplication_inlock(*info->opTime, *info->writeConcern)) {
+        for (auto& group : _replicationWaiters) {
+            for (auto& waiter : group.second) {
+                WaiterInfo* info = waiter.second;
+                if (!_doneWaitingForReplication_inlock(*info->opTime, *info->writeConcern)) {
+                    // Nor are the later waiters of this mode.
+                    break;
+                }
                 info->condVar->notify_all();
             }
         }
@@ -32,6 +32,9 @@
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "mongo/base/status.h"
@@ -398,7 +401,7 @@ namespace repl {
                 int myIndex);
 
         /**
-         * Helper to wake waiters in _replicationWaiterList that are doneWaitingForReplication.
+         * Helper to wake waiters in _replicationWaiters that are doneWaitingForReplication.
          */
         void _wakeReadyWaiters_inlock();
 
@@ -877,9 +880,14 @@ namespace repl {
         // TODO: ideally this should only change on rollbacks NOT on mongod restarts also.
         int _rbid;                                                                        // (M)
 
-        // list of information about clients waiting on replication.  Does *not* own the
-        // WaiterInfos.
-        std::vector<WaiterInfo*> _replicationWaiterList;                                  // (M)
+        // Clients waiting on replication, by write concern mode and then by the optime they
+        // wait for. A mode satisfied for an optime is satisfied for all earlier ones too, so
+        // an optime update only looks at each mode's waiters up to the first one it doesn't
+        // satisfy. Does *not* own the WaiterInfos.
+        typedef std::multimap<OpTime, WaiterInfo*> ReplicationWaitersByOpTime;
+        typedef std::map<std::pair<std::string, int>, ReplicationWaitersByOpTime>
+                ReplicationWaiters;
+        ReplicationWaiters _replicationWaiters;                                           // (M)
 
         // list of information about clients waiting for a particular opTime.
         // Does *not* own the WaiterInfos.
@@ -752,6 +752,66 @@ namespace {
         awaiter.reset();
     }
 
+    TEST_F(ReplCoordTest, AwaitReplicationWakesWaitersUpToTheirOpTime) {
+        OperationContextNoop txn;
+        assertStartSuccess(
+                BSON("_id" << "mySet" <<
+                     "version" << 2 <<
+                     "members" << BSON_ARRAY(BSON("host" << "node1:12345" << "_id" << 0) <<
+                                             BSON("host" << "node2:12345" << "_id" << 1) <<
+                                             BSON("host" << "node3:12345" << "_id" << 2))),
+                HostAndPort("node1", 12345));
+        ASSERT(getReplCoord()->setFollowerMode(MemberState::RS_SECONDARY));
+        getReplCoord()->setMyLastOptime(OpTimeWithTermZero(100, 0));
+        simulateSuccessfulElection();
+
+        OpTimeWithTermZero time1(100, 1);
+        OpTimeWithTermZero time2(100, 2);
+        OpTimeWithTermZero time3(100, 3);
+        getReplCoord()->setMyLastOptime(time3);
+
+        WriteConcernOptions twoNodes;
+        twoNodes.wTimeout = WriteConcernOptions::kNoTimeout;
+        twoNodes.wNumNodes = 2;
+        WriteConcernOptions threeNodes = twoNodes;
+        threeNodes.wNumNodes = 3;
+
+        // Waiters for several optimes with each write concern, started out of order.
+        ReplicationAwaiter twoNodesTime3(getReplCoord(), &txn);
+        twoNodesTime3.setOpTime(time3);
+        twoNodesTime3.setWriteConcern(twoNodes);
+        twoNodesTime3.start(&txn);
+        ReplicationAwaiter twoNodesTime1(getReplCoord(), &txn);
+        twoNodesTime1.setOpTime(time1);
+        twoNodesTime1.setWriteConcern(twoNodes);
+        twoNodesTime1.start(&txn);
+        ReplicationAwaiter twoNodesTime2(getReplCoord(), &txn);
+        twoNodesTime2.setOpTime(time2);
+        twoNodesTime2.setWriteConcern(twoNodes);
+        twoNodesTime2.start(&txn);
+        ReplicationAwaiter threeNodesTime1(getReplCoord(), &txn);
+        threeNodesTime1.setOpTime(time1);
+        threeNodesTime1.setWriteConcern(threeNodes);
+        threeNodesTime1.start(&txn);
+        ReplicationAwaiter threeNodesTime2(getReplCoord(), &txn);
+        threeNodesTime2.setOpTime(time2);
+        threeNodesTime2.setWriteConcern(threeNodes);
+        threeNodesTime2.start(&txn);
+
+        ASSERT_OK(getReplCoord()->setLastOptime_forTest(2, 1, time2));
+        ASSERT_OK(twoNodesTime1.getResult().status);
+        ASSERT_OK(twoNodesTime2.getResult().status);
+
+        ASSERT_OK(getReplCoord()->setLastOptime_forTest(2, 2, time1));
+        ASSERT_OK(threeNodesTime1.getResult().status);
+
+        ASSERT_OK(getReplCoord()->setLastOptime_forTest(2, 1, time3));
+        ASSERT_OK(twoNodesTime3.getResult().status);
+
+        ASSERT_OK(getReplCoord()->setLastOptime_forTest(2, 2, time3));
+        ASSERT_OK(threeNodesTime2.getResult().status);
+    }
+
     TEST_F(ReplCoordTest, AwaitReplicationTimeout) {
         OperationContextNoop txn;
         assertStartSuccess(
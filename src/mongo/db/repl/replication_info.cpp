@@ -40,11 +40,13 @@
 #include "mongo/db/lasterror.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/is_master_response.h"
 #include "mongo/db/repl/master_slave.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/repl/sync_tail.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/db/wire_version.h"
 #include "mongo/s/write_ops/batched_command_request.h"
@@ -160,6 +162,14 @@ namespace repl {
             appendReplicationInfo(txn, result, level);
             getGlobalReplicationCoordinator()->processReplSetGetRBID(&result);
 
+            if (getGlobalReplicationCoordinator()->getSettings().usingReplSets()) {
+                BSONObjBuilder pipeline(result.subobjStart("pipeline"));
+                if (BackgroundSync* bgsync = BackgroundSync::get()) {
+                    pipeline.append("fetch", bgsync->getCounters());
+                }
+                SyncTail::appendPipelineStats(&pipeline);
+            }
+
             return result.obj();
         }
 
@@ -53,6 +53,7 @@
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/repl_client_info.h"
+#include "mongo/db/repl/repl_settings.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
@@ -190,6 +191,7 @@ namespace {
             options.mayBeInterrupted = false;
             options.syncData = dataPass;
             options.syncIndexes = ! dataPass;
+            options.cloneThreads = initialSyncCloneThreadCount;
 
             // Make database stable
             ScopedTransaction transaction(txn, MODE_IX);
@@ -167,6 +167,53 @@ namespace {
     }
 
 
+    // Limits on the documents refetched from the sync source with a single query.
+    const size_t kRefetchBatchDocs = 1000;
+    const int kRefetchBatchIdBytes = 1024 * 1024;
+
+    /** Adds a refetched document to the total, which must stay under what we can roll back. */
+    void addRefetchedSize(const BSONObj& good, unsigned long long* totalSize) {
+        *totalSize += good.objsize();
+        uassert(13410, "replSet too much data to roll back",
+                *totalSize < 300 * 1024 * 1024);
+    }
+
+    /**
+     * Fetches the sync source's version of each document in [begin, end), which all belong to one
+     * collection, with a single query. Documents it doesn't have get an empty object, meaning
+     * that we should delete them.
+     */
+    void refetchBatch(DBClientConnection* them,
+                      set<DocID>::const_iterator begin,
+                      set<DocID>::const_iterator end,
+                      list< pair<DocID, BSONObj> >* goodVersions,
+                      unsigned long long* totalSize) {
+        BSONArrayBuilder ids;
+        for (set<DocID>::const_iterator it = begin; it != end; ++it) {
+            ids.append(it->_id);
+        }
+
+        // Keyed by the _id without its field name.
+        map<BSONObj, BSONObj, BSONObjCmp> found;
+        auto_ptr<DBClientCursor> cursor = them->query(begin->ns,
+                                                      BSON("_id" << BSON("$in" << ids.arr())),
+                                                      0, 0, NULL, QueryOption_SlaveOk);
+        uassert(28728, str::stream() << "query for documents to roll back in " << begin->ns
+                                     << " failed",
+                cursor.get());
+        while (cursor->more()) {
+            BSONObj good = cursor->nextSafe().getOwned();
+            addRefetchedSize(good, totalSize);
+            found[good["_id"].wrap("")] = good;
+        }
+
+        for (set<DocID>::const_iterator it = begin; it != end; ++it) {
+            map<BSONObj, BSONObj, BSONObjCmp>::const_iterator good = found.find(it->_id.wrap(""));
+            goodVersions->push_back(pair<DocID, BSONObj>(*it, good == found.end() ? BSONObj()
+                                                                                  : good->second));
+        }
+    }
+
     void refetch(FixUpInfo& fixUpInfo, const BSONObj& ourObj) {
         const char* op = ourObj.getStringField("op");
         if (*op == 'n')
@@ -417,25 +464,43 @@ namespace {
         DocID doc;
         unsigned long long numFetched = 0;
         try {
-            for (set<DocID>::iterator it = fixUpInfo.toRefetch.begin();
-                    it != fixUpInfo.toRefetch.end();
-                    it++) {
+            set<DocID>::const_iterator it = fixUpInfo.toRefetch.begin();
+            while (it != fixUpInfo.toRefetch.end()) {
                 doc = *it;
 
                 verify(!doc._id.eoo());
 
-                {
-                    // TODO : slow.  lots of round trips.
+                if (doc._id.type() == RegEx) {
+                    // $in would take it for a pattern to match.
                     numFetched++;
                     BSONObj good = them->findOne(doc.ns, doc._id.wrap(),
                                                      NULL, QueryOption_SlaveOk).getOwned();
-                    totalSize += good.objsize();
-                    uassert(13410, "replSet too much data to roll back",
-                            totalSize < 300 * 1024 * 1024);
+                    addRefetchedSize(good, &totalSize);
 
                     // note good might be eoo, indicating we should delete it
                     goodVersions.push_back(pair<DocID, BSONObj>(doc,good));
+                    ++it;
+                    continue;
                 }
+
+                // toRefetch is ordered by namespace, so the documents of a collection are next to
+                // each other and can be fetched together.
+                set<DocID>::const_iterator batchEnd = it;
+                size_t batchDocs = 0;
+                int batchIdBytes = 0;
+                while (batchEnd != fixUpInfo.toRefetch.end()
+                        && batchDocs < kRefetchBatchDocs
+                        && batchIdBytes < kRefetchBatchIdBytes
+                        && strcmp(batchEnd->ns, doc.ns) == 0
+                        && batchEnd->_id.type() != RegEx) {
+                    batchIdBytes += batchEnd->_id.size();
+                    ++batchDocs;
+                    ++batchEnd;
+                }
+
+                refetchBatch(them, it, batchEnd, &goodVersions, &totalSize);
+                numFetched += batchDocs;
+                it = batchEnd;
             }
             newMinValid = oplogreader->getLastOp(rsOplogName);
             if (newMinValid.isEmpty()) {
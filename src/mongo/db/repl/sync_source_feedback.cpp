@@ -32,6 +32,7 @@
 
 #include "mongo/db/repl/sync_source_feedback.h"
 
+#include "mongo/base/counter.h"
 #include "mongo/client/constants.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/auth/authorization_manager.h"
@@ -39,9 +40,11 @@
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/internal_user_auth.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/repl_settings.h"
 #include "mongo/db/repl/replica_set_config.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/operation_context.h"
@@ -56,6 +59,17 @@ namespace mongo {
 
 namespace repl {
 
+    // The position updates sent upstream
+    static Counter64 updatesSentStats;
+    static ServerStatusMetricField<Counter64> displayUpdatesSent(
+                                                    "repl.network.updatePosition.sent",
+                                                    &updatesSentStats );
+    // The position changes that went out with an update already pending
+    static Counter64 updatesCoalescedStats;
+    static ServerStatusMetricField<Counter64> displayUpdatesCoalesced(
+                                                    "repl.network.updatePosition.coalesced",
+                                                    &updatesCoalescedStats );
+
     SyncSourceFeedback::SyncSourceFeedback() : _positionChanged(false),
                                                _shutdownSignaled(false) {}
     SyncSourceFeedback::~SyncSourceFeedback() {}
@@ -100,6 +114,10 @@ namespace repl {
 
     void SyncSourceFeedback::forwardSlaveProgress() {
         boost::unique_lock<boost::mutex> lock(_mtx);
+        if (_positionChanged) {
+            updatesCoalescedStats.increment();
+            return;
+        }
         _positionChanged = true;
         _cond.notify_all();
     }
@@ -122,6 +140,8 @@ namespace repl {
 
         LOG(2) << "Sending slave oplog progress to upstream updater: " << cmd.done();
         try {
+            _lastUpdateSent = Date_t::now();
+            updatesSentStats.increment();
             _connection->runCommand("admin", cmd.obj(), res);
         }
         catch (const DBException& e) {
@@ -167,6 +187,14 @@ namespace repl {
                     _cond.wait(lock);
                 }
 
+                // Whatever else changes until the interval is up goes out with this update.
+                const Date_t sendAt =
+                    _lastUpdateSent + Milliseconds(replUpdatePositionIntervalMillis);
+                Date_t now;
+                while (!_shutdownSignaled && (now = Date_t::now()) < sendAt) {
+                    _cond.wait_for(lock, sendAt - now);
+                }
+
                 if (_shutdownSignaled) {
                     break;
                 }
@@ -36,6 +36,7 @@
 #include "mongo/client/constants.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/util/net/hostandport.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
     class OperationContext;
@@ -89,6 +90,8 @@ namespace repl {
         boost::condition _cond;
         // used to indicate a position change which has not yet been pushed along
         bool _positionChanged;
+        // when the last update was sent, to send at most one per replUpdatePositionIntervalMillis
+        Date_t _lastUpdateSent;
         // Once this is set to true the _run method will terminate
         bool _shutdownSignaled;
     };
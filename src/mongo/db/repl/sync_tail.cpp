@@ -33,9 +33,10 @@
 
 #include "mongo/db/repl/sync_tail.h"
 
-#include <boost/functional/hash.hpp>
-#include <boost/ref.hpp>
-#include "third_party/murmurhash3/MurmurHash3.h"
+#include <algorithm>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "mongo/base/counter.h"
 #include "mongo/db/auth/authorization_session.h"
@@ -50,16 +51,22 @@
 #include "mongo/db/service_context.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/prefetch.h"
+#include "mongo/db/repl/apply_budget.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/minvalid.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/oplog_apply_scheduler.h"
 #include "mongo/db/repl/repl_client_info.h"
+#include "mongo/db/repl/repl_settings.h"
 #include "mongo/db/repl/replica_set_config.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/stdx/functional.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
+#include "mongo/util/scopeguard.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -67,10 +74,8 @@ namespace mongo {
 
 namespace repl {
 #if defined(MONGO_PLATFORM_64)
-    const int replWriterThreadCount = 16;
     const int replPrefetcherThreadCount = 16;
 #elif defined(MONGO_PLATFORM_32)
-    const int replWriterThreadCount = 2;
     const int replPrefetcherThreadCount = 2;
 #else
 #error need to include something that defines MONGO_PLATFORM_XX
@@ -89,28 +94,160 @@ namespace repl {
     static ServerStatusMetricField<TimerStats> displayOpBatchesApplied(
                                                     "repl.apply.batches",
                                                     &applyBatchStats );
+
+    // Where the rest of a batch's time goes: prefetching before the writers start and writing
+    // the batch to the local oplog after they are done
+    static TimerStats prefetchBatchStats;
+    static ServerStatusMetricField<TimerStats> displayPrefetchBatches(
+                                                    "repl.apply.prefetch",
+                                                    &prefetchBatchStats );
+    // Ops prefetched while the writers applied their batch, and those the writers got through
+    // before the readers did, which were then skipped
+    static Counter64 prefetchDuringApplyOpsStats;
+    static ServerStatusMetricField<Counter64> displayPrefetchDuringApplyOps(
+                                                    "repl.apply.prefetchDuringApply.ops",
+                                                    &prefetchDuringApplyOpsStats );
+    static Counter64 prefetchDuringApplySkippedStats;
+    static ServerStatusMetricField<Counter64> displayPrefetchDuringApplySkipped(
+                                                    "repl.apply.prefetchDuringApply.skipped",
+                                                    &prefetchDuringApplySkippedStats );
+    static TimerStats oplogWriteStats;
+    static ServerStatusMetricField<TimerStats> displayOplogWrites(
+                                                    "repl.apply.oplogWrites",
+                                                    &oplogWriteStats );
+
+    // Time writers spent with nothing left to take while another writer was still applying the
+    // rest of the batch. Together with the ops on each batch's longest chain, this tells how much
+    // of the apply time is due to entries that had to be applied one after the other.
+    static Counter64 writerIdleMillisStats;
+    static ServerStatusMetricField<Counter64> displayWriterIdleMillis(
+                                                    "repl.apply.writers.idleMillis",
+                                                    &writerIdleMillisStats );
+    static Counter64 chainsAppliedStats;
+    static ServerStatusMetricField<Counter64> displayChainsApplied(
+                                                    "repl.apply.writers.chains",
+                                                    &chainsAppliedStats );
+    static Counter64 longestChainOpsStats;
+    static ServerStatusMetricField<Counter64> displayLongestChainOps(
+                                                    "repl.apply.writers.longestChainOps",
+                                                    &longestChainOpsStats );
+
+    // Apply and local oplog write stages of the secondary pipeline, see appendPipelineStats()
+    static TimerStats applyStageStats;
+    static Counter64 applyStageOpsStats;
+    static Counter64 oplogWriteOpsStats;
+    static Counter64 oplogWriteQueueGauge;
     void initializePrefetchThread() {
         if (!ClientBasic::getCurrent()) {
             Client::initThreadIfNotAlready();
             AuthorizationSession::get(cc())->grantInternalAuthorization();
         }
     }
-    namespace {
-        bool isCrudOpType( const char* field ) {
-            switch ( field[0] ) {
-            case 'd':
-            case 'i':
-            case 'u':
-                return field[1] == 0;
+    /**
+     * Writes batches to the local oplog on its own thread, so that one batch can be written while
+     * the next one is being applied. Holds at most one batch; handing it another waits for the
+     * previous one to be written.
+     */
+    class SyncTail::OplogWriter {
+        MONGO_DISALLOW_COPYING(OplogWriter);
+    public:
+        explicit OplogWriter(SyncTail* syncTail)
+            : _syncTail(syncTail),
+              _busy(false),
+              _shutdown(false),
+              _thread(stdx::bind(&OplogWriter::_run, this)) {}
+
+        ~OplogWriter() {
+            {
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                _shutdown = true;
+                _cond.notify_all();
             }
-            return false;
+            _thread.join();
         }
-    }
+
+        /**
+         * Hands the batch in 'ops' to the writer thread, leaving 'ops' empty.
+         */
+        void write(std::deque<BSONObj>* ops) {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            while (_busy) {
+                _cond.wait(lk);
+            }
+            _batch.swap(*ops);
+            _busy = true;
+            oplogWriteQueueGauge.increment();
+            _cond.notify_all();
+        }
+
+        /**
+         * Waits until every batch handed to write() is in the oplog.
+         */
+        void waitUntilIdle() {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            while (_busy) {
+                _cond.wait(lk);
+            }
+        }
+
+    private:
+        void _run() {
+            Client::initThread("rsSyncOplogWriter");
+            AuthorizationSession::get(cc())->grantInternalAuthorization();
+
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            while (true) {
+                while (!_busy && !_shutdown) {
+                    _cond.wait(lk);
+                }
+                if (!_busy) {
+                    return;
+                }
+
+                lk.unlock();
+                if (!inShutdown()) {
+                    try {
+                        OperationContextImpl txn;
+
+                        // The next batch may already be applying under the parallel batch writer
+                        // lock, which this thread has to get past.
+                        txn.lockState()->setIsBatchWriter(true);
+                        _syncTail->_writeToOplog(&txn, _batch);
+                    }
+                    catch (const DBException& e) {
+                        // The batch has been applied and consumed from the sync source, so it
+                        // can't be retried.
+                        severe() << "failed to write batch to the oplog: " << causedBy(e);
+                        fassertFailedNoTrace(28718);
+                    }
+                }
+                lk.lock();
+
+                _batch.clear();
+                _busy = false;
+                oplogWriteQueueGauge.decrement();
+                _cond.notify_all();
+            }
+        }
+
+        SyncTail* const _syncTail;
+
+        boost::mutex _mutex;
+        boost::condition_variable _cond;
+
+        // The batch to write. Only touched by the writer thread while _busy is set.
+        std::deque<BSONObj> _batch;
+        bool _busy;
+        bool _shutdown;
+
+        boost::thread _thread;
+    };
 
     SyncTail::SyncTail(BackgroundSyncInterface *q, MultiSyncApplyFunc func) :
         Sync(""), 
         _networkQueue(q), 
         _applyFunc(func),
+        _oplogWriter(NULL),
         _writerPool(replWriterThreadCount, "repl writer worker "),
         _prefetcherPool(replPrefetcherThreadCount, "repl prefetch worker ")
     {}
@@ -126,6 +263,12 @@ namespace repl {
     bool SyncTail::syncApply(OperationContext* txn,
                              const BSONObj &op,
                              bool convertUpdateToUpsert) {
+        return syncApply(txn, OplogEntry(op), convertUpdateToUpsert);
+    }
+
+    bool SyncTail::syncApply(OperationContext* txn,
+                             const OplogEntry& entry,
+                             bool convertUpdateToUpsert) {
 
         if (inShutdown()) {
             return true;
@@ -134,13 +277,12 @@ namespace repl {
         // Count each log op application as a separate operation, for reporting purposes
         txn->getCurOp()->reset();
 
-        const char *ns = op.getStringField("ns");
-        verify(ns);
-
-        const char* opType = op["op"].valuestrsafe();
+        const BSONObj& op = entry.raw;
+        const char *ns = entry.ns;
+        const char* opType = entry.opType;
 
-        bool isCommand(opType[0] == 'c');
-        bool isNoOp(opType[0] == 'n');
+        bool isCommand(entry.isCommand());
+        bool isNoOp(entry.isNoOp());
 
         if ( (*ns == '\0') || (*ns == '.') ) {
             // this is ugly
@@ -160,8 +302,7 @@ namespace repl {
                 boost::scoped_ptr<Lock::DBLock> dbLock;
                 boost::scoped_ptr<Lock::CollectionLock> collectionLock;
 
-                bool isIndexBuild = opType[0] == 'i' &&
-                    nsToCollectionSubstring( ns ) == "system.indexes";
+                bool isIndexBuild = entry.isIndexBuild();
 
                 if (isCommand) {
                     // a command may need a global write lock. so we will conservatively go
@@ -177,7 +318,7 @@ namespace repl {
                     dbLock.reset(new Lock::DBLock(txn->lockState(),
                                                   nsToDatabaseSubstring(ns), MODE_X));
                 }
-                else if (isCrudOpType(opType)) {
+                else if (entry.isCrudOpType()) {
                     LockMode mode = createCollection ? MODE_X : MODE_IX;
                     dbLock.reset(new Lock::DBLock(txn->lockState(),
                                                   nsToDatabaseSubstring(ns), mode));
@@ -202,7 +343,7 @@ namespace repl {
 
                 if ( createCollection == 0 &&
                      !isIndexBuild &&
-                     isCrudOpType(opType) &&
+                     entry.isCrudOpType() &&
                      ctx.db()->getCollection(ns) == NULL ) {
                     // uh, oh, we need to create collection
                     // try again
@@ -214,7 +355,7 @@ namespace repl {
                 txn->setReplicatedWrites(false);
                 DisableDocumentValidation validationDisabler(txn);
 
-                Status status = applyOperation_inlock(txn, ctx.db(), op, convertUpdateToUpsert);
+                Status status = applyOperation_inlock(txn, ctx.db(), entry, convertUpdateToUpsert);
                 opsAppliedStats.increment();
                 return status.isOK();
             }
@@ -231,7 +372,7 @@ namespace repl {
     }
 
     // The pool threads call this to prefetch each op
-    void SyncTail::prefetchOp(const BSONObj& op) {
+    void SyncTail::prefetchOp(const BSONObj& op, bool duringApply) {
         initializePrefetchThread();
 
         const char *ns = op.getStringField("ns");
@@ -240,6 +381,10 @@ namespace repl {
                 // one possible tweak here would be to stay in the read lock for this database 
                 // for multiple prefetches if they are for the same database.
                 OperationContextImpl txn;
+                if (duringApply) {
+                    // Get past the parallel batch writer lock like the writers do.
+                    txn.lockState()->setIsBatchWriter(true);
+                }
                 AutoGetCollectionForRead ctx(&txn, ns);
                 Database* db = ctx.getDb();
                 if (db) {
@@ -257,40 +402,127 @@ namespace repl {
     }
 
     // Doles out all the work to the reader pool threads and waits for them to complete
-    void SyncTail::prefetchOps(const std::deque<BSONObj>& ops) {
-        for (std::deque<BSONObj>::const_iterator it = ops.begin();
+    void SyncTail::prefetchOps(const std::deque<OplogEntry>& ops) {
+        for (std::deque<OplogEntry>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
-            _prefetcherPool.schedule(&prefetchOp, *it);
+            _prefetcherPool.schedule(&prefetchOp, it->raw, false);
         }
         _prefetcherPool.join();
     }
+
+    void SyncTail::startPrefetchDuringApply(const OplogApplyScheduler& scheduler,
+                                            std::vector<BSONObj>* order,
+                                            AtomicUInt32* next,
+                                            const AtomicWord<bool>* applyDone) {
+        // The writers start on the first op of each chain right away, so go through the batch
+        // position by position across the chains rather than chain by chain. Chains are sorted
+        // longest first, so the ones still long enough for a position come first.
+        for (size_t pos = 0; pos < scheduler.longestChain(); pos++) {
+            for (size_t i = 0; i < scheduler.numChains(); i++) {
+                const std::vector<OplogEntry>& chain = scheduler.chain(i);
+                if (chain.size() <= pos) {
+                    break;
+                }
+                order->push_back(chain[pos].raw);
+            }
+        }
+
+        for (int i = 0; i < replPrefetcherThreadCount; i++) {
+            _prefetcherPool.schedule(&SyncTail::runPrefetcher, order, next, applyDone);
+        }
+    }
+
+    void SyncTail::runPrefetcher(const std::vector<BSONObj>* order,
+                                 AtomicUInt32* next,
+                                 const AtomicWord<bool>* applyDone) {
+        while (!applyDone->load()) {
+            const unsigned i = next->fetchAndAdd(1);
+            if (i >= order->size()) {
+                return;
+            }
+            prefetchOp((*order)[i], true);
+        }
+    }
     
+    void SyncTail::appendPipelineStats(BSONObjBuilder* builder) {
+        {
+            BSONObjBuilder apply(builder->subobjStart("apply"));
+            apply.appendElements(applyStageStats.getReport());
+            apply.append("ops", applyStageOpsStats.get());
+        }
+        {
+            BSONObjBuilder write(builder->subobjStart("write"));
+            write.append("queueBatches", oplogWriteQueueGauge.get());
+            write.appendElements(oplogWriteStats.getReport());
+            write.append("ops", oplogWriteOpsStats.get());
+        }
+    }
+
+    void SyncTail::runWriter(MultiSyncApplyFunc func,
+                             OplogApplyScheduler* chains,
+                             SyncTail* st,
+                             const Timer* batchTimer,
+                             AtomicInt64* doneMicros) {
+        func(chains, st);
+        doneMicros->fetchAndAdd(batchTimer->micros());
+    }
+
     // Doles out all the work to the writer pool threads and waits for them to complete
-    void SyncTail::applyOps(const std::vector< std::vector<BSONObj> >& writerVectors) {
+    void SyncTail::applyOps(OplogApplyScheduler* scheduler) {
         TimerHolder timer(&applyBatchStats);
-        for (std::vector< std::vector<BSONObj> >::const_iterator it = writerVectors.begin();
-             it != writerVectors.end();
-             ++it) {
-            if (!it->empty()) {
-                _writerPool.schedule(_applyFunc, boost::cref(*it), this);
-            }
+
+        // There is no point in starting more writers than there are chains to apply.
+        const size_t numWriters = std::min(scheduler->numChains(),
+                                           static_cast<size_t>(replWriterThreadCount));
+
+        Timer batchTimer;
+        AtomicInt64 doneMicros(0);
+        for (size_t i = 0; i < numWriters; i++) {
+            _writerPool.schedule(&SyncTail::runWriter,
+                                 _applyFunc,
+                                 scheduler,
+                                 this,
+                                 &batchTimer,
+                                 &doneMicros);
         }
         _writerPool.join();
+
+        const long long idleMicros = numWriters * batchTimer.micros() - doneMicros.load();
+        writerIdleMillisStats.increment(std::max(idleMicros, 0LL) / 1000);
+        chainsAppliedStats.increment(scheduler->numChains());
+        longestChainOpsStats.increment(scheduler->longestChain());
+    }
+
+    Timestamp SyncTail::multiApply(OperationContext* txn, OpQueue* ops) {
+        _applyBatch(txn, *ops);
+
+        if (inShutdown()) {
+            return Timestamp();
+        }
+
+        const OpTime lastOpTime = _writeToOplog(txn, ops->getDeque());
+
+        BackgroundSync::get()->notify(txn);
+
+        return lastOpTime.getTimestamp();
     }
 
     // Doles out all the work to the writer pool threads and waits for them to complete
-    Timestamp SyncTail::multiApply(OperationContext* txn, std::deque<BSONObj>& ops) {
+    void SyncTail::_applyBatch(OperationContext* txn, const OpQueue& ops) {
+        TimerHolder timer(&applyStageStats);
 
-        if (getGlobalServiceContext()->getGlobalStorageEngine()->isMmapV1()) {
+        StorageEngine* storageEngine = getGlobalServiceContext()->getGlobalStorageEngine();
+        if (storageEngine->isMmapV1()) {
             // Use a ThreadPool to prefetch all the operations in a batch.
-            prefetchOps(ops);
+            TimerHolder timer(&prefetchBatchStats);
+            prefetchOps(ops.getEntries());
         }
-        
-        std::vector< std::vector<BSONObj> > writerVectors(replWriterThreadCount);
 
-        fillWriterVectors(ops, &writerVectors);
-        LOG(2) << "replication batch size is " << ops.size() << endl;
+        OplogApplyScheduler scheduler(ops.getEntries(), storageEngine->supportsDocLocking());
+        LOG(2) << "replication batch size is " << ops.getEntries().size() << " in "
+               << scheduler.numChains() << " chains, the longest with "
+               << scheduler.longestChain() << " ops";
         // We must grab this because we're going to grab write locks later.
         // We hold this mutex the entire time we're writing; it doesn't matter
         // because all readers are blocked anyway.
@@ -307,18 +539,50 @@ namespace repl {
             fassertFailed(28527);
         }
 
-        applyOps(writerVectors);
+        // Engines with document locking can prefetch while the writers apply the batch. Whatever
+        // the readers pull into the cache ahead of the writers saves a writer a wait, and the
+        // readers fault in different pages at once, where a chain's writer would do so one after
+        // the other.
+        std::vector<BSONObj> prefetchOrder;
+        AtomicUInt32 nextPrefetch;
+        AtomicWord<bool> applyDone(false);
+
+        // Don't leave the readers going through a batch that failed to apply.
+        ON_BLOCK_EXIT([&] {
+            applyDone.store(true);
+            _prefetcherPool.join();
+        });
+
+        if (replPrefetchDuringApply && storageEngine->supportsDocLocking()) {
+            startPrefetchDuringApply(scheduler, &prefetchOrder, &nextPrefetch, &applyDone);
+        }
+
+        applyOps(&scheduler);
+        applyStageOpsStats.increment(ops.getEntries().size());
 
-        if (inShutdown()) {
-            return Timestamp();
+        if (!prefetchOrder.empty()) {
+            applyDone.store(true);
+            _prefetcherPool.join();
+
+            const size_t prefetched = std::min(static_cast<size_t>(nextPrefetch.load()),
+                                               prefetchOrder.size());
+            prefetchDuringApplyOpsStats.increment(prefetched);
+            prefetchDuringApplySkippedStats.increment(prefetchOrder.size() - prefetched);
         }
+    }
 
+    OpTime SyncTail::_writeToOplog(OperationContext* txn, const std::deque<BSONObj>& ops) {
+        ReplicationCoordinator* replCoord = getGlobalReplicationCoordinator();
         const bool mustAwaitCommit = replCoord->isV1ElectionProtocol() && supportsAwaitingCommit();
         if (mustAwaitCommit) {
             txn->recoveryUnit()->goingToAwaitCommit();
         }
 
-        OpTime lastOpTime = writeOpsToOplog(txn, ops);
+        OpTime lastOpTime;
+        {
+            TimerHolder timer(&oplogWriteStats);
+            lastOpTime = writeOpsToOplog(txn, ops);
+        }
 
         if (mustAwaitCommit) {
             txn->recoveryUnit()->awaitCommit();
@@ -327,46 +591,10 @@ namespace repl {
         replCoord->setMyLastOptime(lastOpTime);
         setNewOptime(lastOpTime.getTimestamp());
 
-        BackgroundSync::get()->notify(txn);
-
-        return lastOpTime.getTimestamp();
+        oplogWriteOpsStats.increment(ops.size());
+        return lastOpTime;
     }
 
-    void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops,
-                                     std::vector< std::vector<BSONObj> >* writerVectors) {
-
-        for (std::deque<BSONObj>::const_iterator it = ops.begin();
-             it != ops.end();
-             ++it) {
-            const BSONElement e = it->getField("ns");
-            verify(e.type() == String);
-            const char* ns = e.valuestr();
-            int len = e.valuestrsize();
-            uint32_t hash = 0;
-            MurmurHash3_x86_32( ns, len, 0, &hash);
-
-            const char* opType = it->getField( "op" ).valuestrsafe();
-
-            if (getGlobalServiceContext()->getGlobalStorageEngine()->supportsDocLocking() &&
-                isCrudOpType(opType)) {
-                BSONElement id;
-                switch (opType[0]) {
-                case 'u':
-                    id = it->getField("o2").Obj()["_id"];
-                    break;
-                case 'd':
-                case 'i':
-                    id = it->getField("o").Obj()["_id"];
-                    break;
-                }
-
-                const size_t idHash = BSONElement::Hasher()( id );
-                MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
-            }
-
-            (*writerVectors)[hash % writerVectors->size()].push_back(*it);
-        }
-    }
     void SyncTail::oplogApplication(OperationContext* txn, const Timestamp& endOpTime) {
         _applyOplogUntil(txn, endOpTime);
     }
@@ -383,8 +611,7 @@ namespace repl {
                 if (ops.empty()) continue;
 
                 // Check if we reached the end
-                const BSONObj currentOp = ops.back();
-                const Timestamp currentOpTime = currentOp["ts"].timestamp();
+                const Timestamp currentOpTime = ops.back().ts;
 
                 // When we reach the end return this batch
                 if (currentOpTime == endOpTime) {
@@ -408,13 +635,11 @@ namespace repl {
                 fassertFailedNoTrace(18692);
             }
 
-            const BSONObj lastOp = ops.back().getOwned();
-
             // Tally operation information
             bytesApplied += ops.getSize();
             entriesApplied += ops.getDeque().size();
 
-            const Timestamp lastOpTime = multiApply(txn, ops.getDeque());
+            const Timestamp lastOpTime = multiApply(txn, &ops);
 
             if (inShutdown()) {
                 return;
@@ -467,6 +692,16 @@ namespace {
     void SyncTail::oplogApplication() {
         ReplicationCoordinator* replCoord = getGlobalReplicationCoordinator();
 
+        // Entries go through three stages: BackgroundSync fetches them into its buffer, this
+        // thread applies them a batch at a time, and the oplog writer thread writes each applied
+        // batch to the local oplog while this thread goes on with the next one. Writing a batch
+        // only after it has been applied keeps the local oplog from getting ahead of the data,
+        // the same as when both were done here, so restarting after a crash needs nothing more
+        // than minValid.
+        OplogWriter oplogWriter(this);
+        _oplogWriter = &oplogWriter;
+        ON_BLOCK_EXIT([this] { _oplogWriter = NULL; });
+
         while(!inShutdown()) {
             OpQueue ops;
             OperationContextImpl txn;
@@ -502,8 +737,7 @@ namespace {
 
                 const int slaveDelaySecs = replCoord->getSlaveDelaySecs().count();
                 if (!ops.empty() && slaveDelaySecs > 0) {
-                    const BSONObj& lastOp = ops.getDeque().back();
-                    const unsigned int opTimestampSecs = lastOp["ts"].timestamp().getSecs();
+                    const unsigned int opTimestampSecs = ops.back().ts.getSecs();
 
                     // Stop the batch as the lastOp is too new to be applied. If we continue
                     // on, we can get ops that are way ahead of the delay and this will
@@ -529,15 +763,44 @@ namespace {
                 continue;
             }
 
-            const BSONObj& lastOp = ops.getDeque().back();
-            handleSlaveDelay(lastOp);
+            const OplogEntry& lastOp = ops.back();
+            handleSlaveDelay(lastOp.raw);
 
             // Set minValid to the last op to be applied in this next batch.
             // This will cause this node to go into RECOVERING state
             // if we should crash and restart before updating the oplog
-            Timestamp minValid = lastOp["ts"].timestamp();
+            Timestamp minValid = lastOp.ts;
             setMinValid(&txn, minValid);
-            multiApply(&txn, ops.getDeque());
+
+            // How far behind the oldest entry of the batch is, beyond any configured delay.
+            ApplyBudget* budget = ApplyBudget::get();
+            const bool budgeted = budget->isEnabled();
+            long long lagSecs = 0;
+            if (budgeted) {
+                lagSecs = std::max(0LL,
+                                   static_cast<long long>(time(0)) -
+                                       replCoord->getSlaveDelaySecs().count() -
+                                       ops.getEntries().front().ts.getSecs());
+            }
+
+            Timer applyTimer;
+            _applyBatch(&txn, ops);
+
+            if (inShutdown()) {
+                return;
+            }
+
+            oplogWriter.write(&ops.getDeque());
+
+            // Readers are blocked while a batch is applied, so leave them their share of the time
+            // before the next one.
+            if (budgeted) {
+                const Milliseconds pause = budget->recordBatch(Seconds(lagSecs),
+                                                               Milliseconds(applyTimer.millis()));
+                if (pause > Milliseconds(0)) {
+                    sleepmillis(durationCount<Milliseconds>(pause));
+                }
+            }
         }
     }
 
@@ -551,16 +814,24 @@ namespace {
     bool SyncTail::tryPopAndWaitForMore(OperationContext* txn,
                                         SyncTail::OpQueue* ops,
                                         ReplicationCoordinator* replCoord) {
-        BSONObj op;
+        BSONObj raw;
         // Check to see if there are ops waiting in the bgsync queue
-        bool peek_success = peek(&op);
+        bool peek_success = peek(&raw);
 
         if (!peek_success) {
             // if we don't have anything in the queue, wait a bit for something to appear
             if (ops->empty()) {
+                if (_oplogWriter) {
+                    // Everything fetched so far has been applied. Once it has been written too,
+                    // let BackgroundSync know, as it will not choose a new sync source or roll
+                    // back before then.
+                    _oplogWriter->waitUntilIdle();
+                    BackgroundSync::get()->notify(txn);
+                }
+
                 if (replCoord->isWaitingForApplierToDrain()) {
                     BackgroundSync::get()->waitUntilPaused();
-                    if (peek(&op)) {
+                    if (peek(&raw)) {
                         // The producer generated a last batch of ops before pausing so return
                         // false so that we'll come back and apply them before signaling the drain
                         // is complete.
@@ -577,13 +848,14 @@ namespace {
             return true;
         }
 
-        const char* ns = op["ns"].valuestrsafe();
+        // Parse the op once here, for everything on its way to being applied.
+        const OplogEntry op(raw);
 
         // check for commands
-        if ((op["op"].valuestrsafe()[0] == 'c') ||
+        if (op.isCommand() ||
             // Index builds are acheived through the use of an insert op, not a command op.
             // The following line is the same as what the insert code uses to detect an index build.
-            ( *ns != '\0' && nsToCollectionSubstring(ns) == "system.indexes" )) {
+            op.nss.isSystemDotIndexes()) {
 
             if (ops->empty()) {
                 // apply commands one-at-a-time
@@ -596,17 +868,9 @@ namespace {
         }
 
         // check for oplog version change
-        BSONElement elemVersion = op["v"];
-        int curVersion = 0;
-        if (elemVersion.eoo())
-            // missing version means version 1
-            curVersion = 1;
-        else
-            curVersion = elemVersion.Int();
-        
-        if (curVersion != OPLOG_VERSION) {
+        if (op.version != OPLOG_VERSION) {
             severe() << "expected oplog version " << OPLOG_VERSION << " but found version " 
-                     << curVersion << " in oplog entry: " << op;
+                     << op.version << " in oplog entry: " << raw;
             fassertFailedNoTrace(18820);
         }
     
@@ -664,7 +928,7 @@ namespace {
     }
 
     // This free function is used by the writer threads to apply each op
-    void multiSyncApply(const std::vector<BSONObj>& ops, SyncTail* st) {
+    void multiSyncApply(OplogApplyScheduler* chains, SyncTail* st) {
         initializeWriterThread();
 
         OperationContextImpl txn;
@@ -676,29 +940,31 @@ namespace {
 
         bool convertUpdatesToUpserts = true;
 
-        for (std::vector<BSONObj>::const_iterator it = ops.begin();
-             it != ops.end();
-             ++it) {
-            try {
-                if (!st->syncApply(&txn, *it, convertUpdatesToUpserts)) {
-                    fassertFailedNoTrace(16359);
+        while (const std::vector<OplogEntry>* ops = chains->next()) {
+            for (std::vector<OplogEntry>::const_iterator it = ops->begin();
+                 it != ops->end();
+                 ++it) {
+                try {
+                    if (!st->syncApply(&txn, *it, convertUpdatesToUpserts)) {
+                        fassertFailedNoTrace(16359);
+                    }
                 }
-            }
-            catch (const DBException& e) {
-                error() << "writer worker caught exception: " << causedBy(e)
-                        << " on: " << it->toString();
+                catch (const DBException& e) {
+                    error() << "writer worker caught exception: " << causedBy(e)
+                            << " on: " << it->raw.toString();
 
-                if (inShutdown()) {
-                    return;
-                }
+                    if (inShutdown()) {
+                        return;
+                    }
 
-                fassertFailedNoTrace(16360);
+                    fassertFailedNoTrace(16360);
+                }
             }
         }
     }
 
     // This free function is used by the initial sync writer threads to apply each op
-    void multiInitialSyncApply(const std::vector<BSONObj>& ops, SyncTail* st) {
+    void multiInitialSyncApply(OplogApplyScheduler* chains, SyncTail* st) {
         initializeWriterThread();
 
         OperationContextImpl txn;
@@ -708,32 +974,34 @@ namespace {
         // allow us to get through the magic barrier
         txn.lockState()->setIsBatchWriter(true);
 
-        for (std::vector<BSONObj>::const_iterator it = ops.begin();
-             it != ops.end();
-             ++it) {
-            try {
-                if (!st->syncApply(&txn, *it)) {
-
-                    if (st->shouldRetry(&txn, *it)) {
-                        if (!st->syncApply(&txn, *it)) {
-                            fassertFailedNoTrace(15915);
+        while (const std::vector<OplogEntry>* ops = chains->next()) {
+            for (std::vector<OplogEntry>::const_iterator it = ops->begin();
+                 it != ops->end();
+                 ++it) {
+                try {
+                    if (!st->syncApply(&txn, *it)) {
+
+                        if (st->shouldRetry(&txn, it->raw)) {
+                            if (!st->syncApply(&txn, *it)) {
+                                fassertFailedNoTrace(15915);
+                            }
                         }
-                    }
 
-                    // If shouldRetry() returns false, fall through.
-                    // This can happen if the document that was moved and missed by Cloner
-                    // subsequently got deleted and no longer exists on the Sync Target at all
+                        // If shouldRetry() returns false, fall through.
+                        // This can happen if the document that was moved and missed by Cloner
+                        // subsequently got deleted and no longer exists on the Sync Target at all
+                    }
                 }
-            }
-            catch (const DBException& e) {
-                error() << "writer worker caught exception: " << causedBy(e)
-                        << " on: " << it->toString();
+                catch (const DBException& e) {
+                    error() << "writer worker caught exception: " << causedBy(e)
+                            << " on: " << it->raw.toString();
 
-                if (inShutdown()) {
-                    return;
-                }
+                    if (inShutdown()) {
+                        return;
+                    }
 
-                fassertFailedNoTrace(16361);
+                    fassertFailedNoTrace(16361);
+                }
             }
         }
     }
@@ -29,30 +29,39 @@
 #pragma once
 
 #include <deque>
+#include <vector>
 
 #include "mongo/db/storage/mmap_v1/dur.h"
+#include "mongo/db/repl/oplog_entry.h"
+#include "mongo/db/repl/optime.h"
 #include "mongo/db/repl/sync.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
 
     class OperationContext;
+    class Timer;
 
 namespace repl {
     class BackgroundSyncInterface;
+    class OplogApplyScheduler;
     class ReplicationCoordinator;
 
     /**
      * "Normal" replica set syncing
      */
     class SyncTail : public Sync {
-        typedef void (*MultiSyncApplyFunc)(const std::vector<BSONObj>& ops, SyncTail* st);
+        typedef void (*MultiSyncApplyFunc)(OplogApplyScheduler* chains, SyncTail* st);
     public:
         SyncTail(BackgroundSyncInterface *q, MultiSyncApplyFunc func);
         virtual ~SyncTail();
         virtual bool syncApply(OperationContext* txn,
                                const BSONObj &o,
                                bool convertUpdateToUpsert = false);
+        bool syncApply(OperationContext* txn,
+                       const OplogEntry& op,
+                       bool convertUpdateToUpsert = false);
 
         /**
          * Runs _applyOplogUntil(stopOpTime)
@@ -66,22 +75,27 @@ namespace repl {
         public:
             OpQueue() : _size(0) {}
             size_t getSize() { return _size; }
+            // The ops as fetched, for writing them to the local oplog
             std::deque<BSONObj>& getDeque() { return _deque; }
-            void push_back(BSONObj& op) {
-                _deque.push_back(op);
-                _size += op.objsize();
+            // The same ops parsed, for applying them
+            const std::deque<OplogEntry>& getEntries() const { return _entries; }
+            void push_back(const OplogEntry& op) {
+                _deque.push_back(op.raw);
+                _entries.push_back(op);
+                _size += op.raw.objsize();
             }
             bool empty() {
-                return _deque.empty();
+                return _entries.empty();
             }
 
-            BSONObj back() {
-                verify(!_deque.empty());
-                return _deque.back();
+            const OplogEntry& back() {
+                verify(!_entries.empty());
+                return _entries.back();
             }
 
         private:
             std::deque<BSONObj> _deque;
+            std::deque<OplogEntry> _entries;
             size_t _size;
         };
 
@@ -91,6 +105,12 @@ namespace repl {
                                   OpQueue* ops,
                                   ReplicationCoordinator* replCoord);
 
+        /**
+         * Appends queue depths and totals for the apply and local oplog write stages of
+         * oplogApplication() to 'builder'.
+         */
+        static void appendPipelineStats(BSONObjBuilder* builder);
+
     protected:
         // Cap the batches using the limit on journal commits.
         // This works out to be 100 MB (64 bit) or 50 MB (32 bit)
@@ -105,7 +125,7 @@ namespace repl {
         // Prefetch and write a deque of operations, using the supplied function.
         // Initial Sync and Sync Tail each use a different function.
         // Returns the last OpTime applied.
-        Timestamp multiApply(OperationContext* txn, std::deque<BSONObj>& ops);
+        Timestamp multiApply(OperationContext* txn, OpQueue* ops);
 
         /**
          * Applies oplog entries until reaching "endOpTime".
@@ -115,21 +135,53 @@ namespace repl {
         void _applyOplogUntil(OperationContext* txn, const Timestamp& endOpTime);
 
     private:
+        class OplogWriter;
+
         BackgroundSyncInterface* _networkQueue;
 
         // Function to use during applyOps
         MultiSyncApplyFunc _applyFunc;
 
+        // Writes applied batches to the local oplog during oplogApplication(), NULL otherwise
+        OplogWriter* _oplogWriter;
+
+        // Prefetches and applies a batch, without writing it to the local oplog
+        void _applyBatch(OperationContext* txn, const OpQueue& ops);
+
+        // Writes an applied batch to the local oplog and advances our last optime to its end
+        OpTime _writeToOplog(OperationContext* txn, const std::deque<BSONObj>& ops);
+
         // Doles out all the work to the reader pool threads and waits for them to complete
-        void prefetchOps(const std::deque<BSONObj>& ops);
-        // Used by the thread pool readers to prefetch an op
-        static void prefetchOp(const BSONObj& op);
+        void prefetchOps(const std::deque<OplogEntry>& ops);
+        // Used by the thread pool readers to prefetch an op. 'duringApply' is set when the
+        // writers may be applying the batch at the same time.
+        static void prefetchOp(const BSONObj& op, bool duringApply);
+
+        // Starts the reader pool threads on the ops of a batch in the order the writers will get
+        // to them, see _applyBatch(). Does not wait for the readers, which stop early once
+        // 'applyDone' is set.
+        void startPrefetchDuringApply(const OplogApplyScheduler& scheduler,
+                                      std::vector<BSONObj>* order,
+                                      AtomicUInt32* next,
+                                      const AtomicWord<bool>* applyDone);
+
+        // Runs on a reader pool thread, prefetching ops from 'order' until there are none left or
+        // the writers are done.
+        static void runPrefetcher(const std::vector<BSONObj>* order,
+                                  AtomicUInt32* next,
+                                  const AtomicWord<bool>* applyDone);
 
         // Doles out all the work to the writer pool threads and waits for them to complete
-        void applyOps(const std::vector< std::vector<BSONObj> >& writerVectors);
+        void applyOps(OplogApplyScheduler* scheduler);
+
+        // Runs 'func' on a writer pool thread and adds the time it finished at, relative to
+        // 'batchTimer', to 'doneMicros'.
+        static void runWriter(MultiSyncApplyFunc func,
+                              OplogApplyScheduler* chains,
+                              SyncTail* st,
+                              const Timer* batchTimer,
+                              AtomicInt64* doneMicros);
 
-        void fillWriterVectors(const std::deque<BSONObj>& ops,
-                               std::vector< std::vector<BSONObj> >* writerVectors);
         void handleSlaveDelay(const BSONObj& op);
 
         // persistent pool of worker threads for writing ops to the databases
@@ -139,9 +191,10 @@ namespace repl {
 
     };
 
-    // These free functions are used by the thread pool workers to write ops to the db.
-    void multiSyncApply(const std::vector<BSONObj>& ops, SyncTail* st);
-    void multiInitialSyncApply(const std::vector<BSONObj>& ops, SyncTail* st);
+    // These free functions are used by the thread pool workers to write ops to the db. Each
+    // keeps taking chains of ops from 'chains' until there are none left.
+    void multiSyncApply(OplogApplyScheduler* chains, SyncTail* st);
+    void multiInitialSyncApply(OplogApplyScheduler* chains, SyncTail* st);
 
 } // namespace repl
 } // namespace mongo
@@ -264,7 +264,12 @@ namespace mongo {
             std::ifstream _file;
         };
 
-        /** Merge-sorts results from 0 or more FileIterators */
+        /**
+         * Merge-sorts results from 0 or more FileIterators using a loser tree (tournament tree).
+         * Each internal node remembers the stream that lost the match played there, so replacing
+         * the winner only replays the matches on its path to the root: at most ceil(log2(k))
+         * comparisons per element, about half of what popping and pushing a binary heap costs.
+         */
         template <typename Key, typename Value, typename Comparator>
         class MergeIterator : public SortIteratorInterface<Key, Value> {
         public:
@@ -278,34 +283,36 @@ namespace mongo {
                 : _opts(opts)
                 , _remaining(opts.limit ? opts.limit : std::numeric_limits<unsigned long long>::max())
                 , _first(true)
-                , _greater(comp)
+                , _comp(comp)
             {
                 for (size_t i = 0; i < iters.size(); i++) {
                     if (iters[i]->more()) {
-                        _heap.push_back(
+                        _streams.push_back(
                             boost::make_shared<Stream>(i, iters[i]->next(), iters[i]));
                     }
                 }
 
-                if (_heap.empty()) {
+                _numLive = _streams.size();
+                if (_streams.empty()) {
                     _remaining = 0;
                     return;
                 }
 
-                std::make_heap(_heap.begin(), _heap.end(), _greater);
-                std::pop_heap(_heap.begin(), _heap.end(), _greater);
-                _current = _heap.back();
-                _heap.pop_back();
+                // _tree[1.._streams.size()-1] are the internal nodes and the leaf for stream i is
+                // node _streams.size() + i. _tree[0] holds the overall winner.
+                _tree.resize(_streams.size());
+                _tree[0] = _playSubtree(1);
             }
 
             bool more() {
-                if (_remaining > 0 && (_first || !_heap.empty() || _current->more()))
+                if (_remaining > 0 && (_first || _numLive > 1 || _winner()->more()))
                     return true;
 
                 // We are done so clean up resources.
                 // Can't do this in next() due to lifetime guarantees of unowned Data.
-                _heap.clear();
-                _current.reset();
+                _streams.clear();
+                _tree.clear();
+                _numLive = 0;
                 _remaining = 0;
 
                 return false;
@@ -318,22 +325,17 @@ namespace mongo {
 
                 if (_first) {
                     _first = false;
-                    return _current->current();
+                    return _winner()->current();
                 }
 
-                if (!_current->advance()) {
-                    verify(!_heap.empty());
-
-                    std::pop_heap(_heap.begin(), _heap.end(), _greater);
-                    _current = _heap.back();
-                    _heap.pop_back();
-                } else if (!_heap.empty() && _greater(_current, _heap.front())) {
-                    std::pop_heap(_heap.begin(), _heap.end(), _greater);
-                    std::swap(_current, _heap.back());
-                    std::push_heap(_heap.begin(), _heap.end(), _greater);
+                if (!_winner()->advance()) {
+                    // An exhausted stream loses every match, so it sinks out of the way.
+                    verify(_numLive > 1);
+                    _numLive--;
                 }
+                _replay(_tree[0]);
 
-                return _current->current();
+                return _winner()->current();
             }
 
 
@@ -342,6 +344,7 @@ namespace mongo {
             public:
                 Stream(size_t fileNum, const Data& first, boost::shared_ptr<Input> rest)
                     : fileNum(fileNum)
+                    , exhausted(false)
                     , _current(first)
                     , _rest(rest)
                 {}
@@ -349,43 +352,73 @@ namespace mongo {
                 const Data& current() const { return _current; }
                 bool more() { return _rest->more(); }
                 bool advance() {
-                    if (!_rest->more())
+                    if (!_rest->more()) {
+                        // Keep _current alive since the caller may still be using it.
+                        exhausted = true;
                         return false;
+                    }
 
                     _current = _rest->next();
                     return true;
                 }
 
                 const size_t fileNum;
+                bool exhausted;
             private:
                 Data _current;
                 boost::shared_ptr<Input> _rest;
             };
 
-            class STLComparator { // uses greater rather than less-than to maintain a MinHeap
-            public:
-                explicit STLComparator(const Comparator& comp) : _comp(comp) {}
-                bool operator () (unowned_ptr<const Stream> lhs,
-                                  unowned_ptr<const Stream> rhs) const {
-                    // first compare data
-                    dassertCompIsSane(_comp, lhs->current(), rhs->current());
-                    int ret = _comp(lhs->current(), rhs->current());
-                    if (ret)
-                        return ret > 0;
-
-                    // then compare fileNums to ensure stability
-                    return lhs->fileNum > rhs->fileNum;
+            Stream* _winner() const { return _streams[_tree[0]].get(); }
+
+            // Returns true if stream 'lhs' should be output before stream 'rhs'.
+            bool _beats(size_t lhs, size_t rhs) const {
+                const Stream& left = *_streams[lhs];
+                const Stream& right = *_streams[rhs];
+                if (left.exhausted || right.exhausted)
+                    return !left.exhausted;
+
+                // first compare data
+                dassertCompIsSane(_comp, left.current(), right.current());
+                int ret = _comp(left.current(), right.current());
+                if (ret)
+                    return ret < 0;
+
+                // then compare fileNums to ensure stability
+                return left.fileNum < right.fileNum;
+            }
+
+            // Plays every match below 'node', recording the losers, and returns the winner.
+            size_t _playSubtree(size_t node) {
+                if (node >= _streams.size())
+                    return node - _streams.size();
+
+                const size_t left = _playSubtree(2 * node);
+                const size_t right = _playSubtree(2 * node + 1);
+                if (_beats(right, left)) {
+                    _tree[node] = left;
+                    return right;
                 }
-            private:
-                const Comparator _comp;
-            };
+                _tree[node] = right;
+                return left;
+            }
+
+            // Replays the matches from the leaf of 'stream' up to the root after it changed.
+            void _replay(size_t stream) {
+                for (size_t node = (_streams.size() + stream) / 2; node > 0; node /= 2) {
+                    if (_beats(_tree[node], stream))
+                        std::swap(_tree[node], stream);
+                }
+                _tree[0] = stream;
+            }
 
             SortOptions _opts;
             unsigned long long _remaining;
             bool _first;
-            boost::shared_ptr<Stream> _current;
-            std::vector<boost::shared_ptr<Stream> > _heap; // MinHeap
-            STLComparator _greater; // named so calls make sense
+            const Comparator _comp;
+            std::vector<boost::shared_ptr<Stream> > _streams;
+            std::vector<size_t> _tree; // indexes into _streams
+            size_t _numLive; // streams that are not exhausted
         };
 
         template <typename Key, typename Value, typename Comparator>
@@ -294,6 +294,21 @@ namespace mongo {
                 ASSERT_ITERATORS_EQUIVALENT(mergeIterators(iterators, DESC),
                                             make_shared<IntIterator>(30,0,-1));
             }
+            { // test a number of inputs that isn't a power of two
+                boost::shared_ptr<IWIterator> iterators[] =
+                    { make_shared<IntIterator>(3, 70, 7) // 3, 10, ... 66
+                    , make_shared<IntIterator>(0, 70, 7) // 0, 7, ... 63
+                    , make_shared<EmptyIterator>()
+                    , make_shared<IntIterator>(6, 70, 7) // 6, 13, ... 69
+                    , make_shared<IntIterator>(1, 70, 7) // 1, 8, ... 64
+                    , make_shared<IntIterator>(5, 70, 7) // 5, 12, ... 68
+                    , make_shared<IntIterator>(2, 70, 7) // 2, 9, ... 65
+                    , make_shared<IntIterator>(4, 70, 7) // 4, 11, ... 67
+                    };
+
+                ASSERT_ITERATORS_EQUIVALENT(mergeIterators(iterators, ASC),
+                                            make_shared<IntIterator>(0,70,1));
+            }
             { // test Limit
                 boost::shared_ptr<IWIterator> iterators[] =
                     { make_shared<IntIterator>(1, 20, 2) // 1, 3, ... 19
@@ -0,0 +1,444 @@
+// in_memory_bplus_tree.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    /**
+     * An ordered map from byte string keys to values of type V, stored as a B+tree.
+     *
+     * Keys compare as unsigned bytes, which is the order KeyString and the record store key
+     * encoding are built for. Every node keeps its keys in one contiguous array, so a lookup
+     * touches a few cache lines per level instead of one node per comparison as a red-black tree
+     * does. Leaves are linked in both directions for scans.
+     *
+     * Erasing never rebalances. A leaf that becomes empty is unlinked and freed, and an interior
+     * node that loses its last child goes with it. Under-full nodes are harmless for lookups and
+     * our workloads refill them quickly.
+     *
+     * Any insert or erase invalidates all iterators. getVersion() changes whenever that happens, so
+     * a caller that keeps an iterator across modifications can tell when it has to seek again.
+     *
+     * Not thread safe.
+     */
+    template <typename V>
+    class InMemoryBPlusTree {
+        MONGO_DISALLOW_COPYING(InMemoryBPlusTree);
+
+        struct Leaf;
+
+    public:
+        static const size_t kMaxLeafEntries = 64;
+        static const size_t kMaxInteriorChildren = 64;
+
+        class iterator {
+        public:
+            iterator() : _leaf(NULL), _pos(0) {}
+
+            const std::string& key() const { return _leaf->keys[_pos]; }
+            V& value() const { return _leaf->values[_pos]; }
+
+            bool operator==(const iterator& other) const {
+                return _leaf == other._leaf && _pos == other._pos;
+            }
+            bool operator!=(const iterator& other) const { return !(*this == other); }
+
+        private:
+            friend class InMemoryBPlusTree;
+
+            iterator(Leaf* leaf, size_t pos) : _leaf(leaf), _pos(pos) {}
+
+            Leaf* _leaf;
+            size_t _pos;
+        };
+
+        InMemoryBPlusTree() : _size(0), _version(0), _numNodes(1) {
+            Leaf* root = new Leaf();
+            _root = root;
+            _head = root;
+            _tail = root;
+        }
+
+        ~InMemoryBPlusTree() {
+            _freeNode(_root);
+        }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        /**
+         * Number of leaf and interior nodes, for memory accounting.
+         */
+        size_t numNodes() const { return _numNodes; }
+
+        unsigned long long getVersion() const { return _version; }
+
+        iterator begin() const {
+            return _head->keys.empty() ? end() : iterator(_head, 0);
+        }
+
+        iterator end() const { return iterator(); }
+
+        /**
+         * The last entry, or end() if the tree is empty.
+         */
+        iterator last() const {
+            return _tail->keys.empty() ? end() : iterator(_tail, _tail->keys.size() - 1);
+        }
+
+        /**
+         * Moves to the next entry, or to end() from the last one.
+         */
+        void advance(iterator* it) const {
+            invariant(it->_leaf);
+            if (++it->_pos < it->_leaf->keys.size())
+                return;
+            *it = it->_leaf->next ? iterator(it->_leaf->next, 0) : end();
+        }
+
+        /**
+         * Moves to the previous entry. Retreating from end() yields the last entry and retreating
+         * from begin() yields end().
+         */
+        void retreat(iterator* it) const {
+            if (!it->_leaf) {
+                *it = last();
+                return;
+            }
+            if (it->_pos > 0) {
+                --it->_pos;
+                return;
+            }
+            Leaf* prev = it->_leaf->prev;
+            *it = prev ? iterator(prev, prev->keys.size() - 1) : end();
+        }
+
+        iterator find(StringData key) const {
+            Leaf* leaf = _findLeaf(key, NULL);
+            const size_t pos = _lowerBoundInLeaf(leaf, key);
+            if (pos < leaf->keys.size() && _compare(leaf->keys[pos], key) == 0)
+                return iterator(leaf, pos);
+            return end();
+        }
+
+        /**
+         * The first entry whose key is >= 'key'.
+         */
+        iterator lowerBound(StringData key) const {
+            Leaf* leaf = _findLeaf(key, NULL);
+            return _normalize(leaf, _lowerBoundInLeaf(leaf, key));
+        }
+
+        /**
+         * The first entry whose key is > 'key'.
+         */
+        iterator upperBound(StringData key) const {
+            Leaf* leaf = _findLeaf(key, NULL);
+            size_t pos = _lowerBoundInLeaf(leaf, key);
+            if (pos < leaf->keys.size() && _compare(leaf->keys[pos], key) == 0)
+                ++pos;
+            return _normalize(leaf, pos);
+        }
+
+        /**
+         * Inserts 'key' unless it is already present. Returns the entry for 'key' and whether it
+         * was inserted.
+         */
+        std::pair<iterator, bool> insert(StringData key, const V& value) {
+            Path path;
+            Leaf* leaf = _findLeaf(key, &path);
+            const size_t pos = _lowerBoundInLeaf(leaf, key);
+            if (pos < leaf->keys.size() && _compare(leaf->keys[pos], key) == 0)
+                return std::make_pair(iterator(leaf, pos), false);
+
+            leaf->keys.insert(leaf->keys.begin() + pos, key.toString());
+            leaf->values.insert(leaf->values.begin() + pos, value);
+            ++_size;
+            ++_version;
+
+            if (leaf->keys.size() <= kMaxLeafEntries)
+                return std::make_pair(iterator(leaf, pos), true);
+
+            // Split the leaf in half. The first key of the new right sibling becomes the
+            // separator in the parent.
+            Leaf* right = new Leaf();
+            ++_numNodes;
+            const size_t mid = leaf->keys.size() / 2;
+            right->keys.assign(std::make_move_iterator(leaf->keys.begin() + mid),
+                               std::make_move_iterator(leaf->keys.end()));
+            right->values.assign(leaf->values.begin() + mid, leaf->values.end());
+            leaf->keys.erase(leaf->keys.begin() + mid, leaf->keys.end());
+            leaf->values.erase(leaf->values.begin() + mid, leaf->values.end());
+
+            right->prev = leaf;
+            right->next = leaf->next;
+            if (right->next)
+                right->next->prev = right;
+            else
+                _tail = right;
+            leaf->next = right;
+
+            _insertIntoParent(&path, leaf, right->keys.front(), right);
+
+            const iterator out = pos < mid ? iterator(leaf, pos) : iterator(right, pos - mid);
+            return std::make_pair(out, true);
+        }
+
+        void erase(iterator it) {
+            Leaf* leaf = it._leaf;
+            invariant(leaf);
+
+            if (leaf->keys.size() > 1 || leaf == _root) {
+                leaf->keys.erase(leaf->keys.begin() + it._pos);
+                leaf->values.erase(leaf->values.begin() + it._pos);
+                --_size;
+                ++_version;
+                return;
+            }
+
+            // The leaf is about to become empty. Unlink it and remove it from its parent, which
+            // may in turn leave interior nodes without children.
+            Path path;
+            invariant(_findLeaf(leaf->keys.front(), &path) == leaf);
+
+            if (leaf->prev)
+                leaf->prev->next = leaf->next;
+            else
+                _head = leaf->next;
+            if (leaf->next)
+                leaf->next->prev = leaf->prev;
+            else
+                _tail = leaf->prev;
+            delete leaf;
+            --_numNodes;
+            --_size;
+            ++_version;
+
+            while (!path.empty()) {
+                Interior* parent = path.back().first;
+                const size_t idx = path.back().second;
+                path.pop_back();
+
+                parent->children.erase(parent->children.begin() + idx);
+                if (!parent->separators.empty())
+                    parent->separators.erase(parent->separators.begin() + (idx ? idx - 1 : 0));
+
+                if (!parent->children.empty())
+                    break;
+
+                // Only a non-root interior node can run out of children, since the root is
+                // collapsed below as soon as it is down to one.
+                invariant(parent != _root);
+                delete parent;
+                --_numNodes;
+            }
+
+            while (!_root->isLeaf) {
+                Interior* root = static_cast<Interior*>(_root);
+                if (root->children.size() != 1)
+                    break;
+                _root = root->children.front();
+                delete root;
+                --_numNodes;
+            }
+        }
+
+        bool erase(StringData key) {
+            const iterator it = find(key);
+            if (it == end())
+                return false;
+            erase(it);
+            return true;
+        }
+
+        void clear() {
+            _freeNode(_root);
+            Leaf* root = new Leaf();
+            _root = root;
+            _head = root;
+            _tail = root;
+            _size = 0;
+            _numNodes = 1;
+            ++_version;
+        }
+
+    private:
+        struct Node {
+            explicit Node(bool isLeaf) : isLeaf(isLeaf) {}
+            const bool isLeaf;
+        };
+
+        struct Leaf : public Node {
+            Leaf() : Node(true), prev(NULL), next(NULL) {}
+
+            std::vector<std::string> keys;
+            std::vector<V> values;
+            Leaf* prev;
+            Leaf* next;
+        };
+
+        struct Interior : public Node {
+            Interior() : Node(false) {}
+
+            // children[i] holds the keys in [separators[i - 1], separators[i]).
+            std::vector<std::string> separators;
+            std::vector<Node*> children;
+        };
+
+        // The interior nodes visited on the way down and the child index taken in each.
+        typedef std::vector<std::pair<Interior*, size_t> > Path;
+
+        static int _compare(const std::string& a, StringData b) {
+            const size_t len = std::min(a.size(), b.size());
+            const int res = len ? memcmp(a.data(), b.rawData(), len) : 0;
+            if (res)
+                return res;
+            return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+        }
+
+        static size_t _lowerBoundInLeaf(const Leaf* leaf, StringData key) {
+            size_t lo = 0;
+            size_t hi = leaf->keys.size();
+            while (lo < hi) {
+                const size_t mid = (lo + hi) / 2;
+                if (_compare(leaf->keys[mid], key) < 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        // Index of the child of 'node' that covers 'key'.
+        static size_t _childFor(const Interior* node, StringData key) {
+            size_t lo = 0;
+            size_t hi = node->separators.size();
+            while (lo < hi) {
+                const size_t mid = (lo + hi) / 2;
+                if (_compare(node->separators[mid], key) <= 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        Leaf* _findLeaf(StringData key, Path* path) const {
+            Node* node = _root;
+            while (!node->isLeaf) {
+                Interior* interior = static_cast<Interior*>(node);
+                const size_t idx = _childFor(interior, key);
+                if (path)
+                    path->push_back(std::make_pair(interior, idx));
+                node = interior->children[idx];
+            }
+            return static_cast<Leaf*>(node);
+        }
+
+        // Turns a position one past the end of a leaf into the start of the next one.
+        iterator _normalize(Leaf* leaf, size_t pos) const {
+            if (pos < leaf->keys.size())
+                return iterator(leaf, pos);
+            return leaf->next ? iterator(leaf->next, 0) : end();
+        }
+
+        void _insertIntoParent(Path* path, Node* left, std::string separator, Node* right) {
+            while (true) {
+                if (path->empty()) {
+                    invariant(left == _root);
+                    Interior* root = new Interior();
+                    ++_numNodes;
+                    root->separators.push_back(separator);
+                    root->children.push_back(left);
+                    root->children.push_back(right);
+                    _root = root;
+                    return;
+                }
+
+                Interior* parent = path->back().first;
+                const size_t idx = path->back().second;
+                path->pop_back();
+
+                parent->separators.insert(parent->separators.begin() + idx, separator);
+                parent->children.insert(parent->children.begin() + idx + 1, right);
+                if (parent->children.size() <= kMaxInteriorChildren)
+                    return;
+
+                // Split the interior node. The separator between the two halves moves up.
+                Interior* sibling = new Interior();
+                ++_numNodes;
+                const size_t mid = parent->children.size() / 2;
+                separator = parent->separators[mid - 1];
+                sibling->separators.assign(
+                    std::make_move_iterator(parent->separators.begin() + mid),
+                    std::make_move_iterator(parent->separators.end()));
+                sibling->children.assign(parent->children.begin() + mid, parent->children.end());
+                parent->separators.erase(parent->separators.begin() + mid - 1,
+                                         parent->separators.end());
+                parent->children.erase(parent->children.begin() + mid, parent->children.end());
+
+                left = parent;
+                right = sibling;
+            }
+        }
+
+        static void _freeNode(Node* node) {
+            if (node->isLeaf) {
+                delete static_cast<Leaf*>(node);
+                return;
+            }
+            Interior* interior = static_cast<Interior*>(node);
+            for (size_t i = 0; i < interior->children.size(); i++) {
+                _freeNode(interior->children[i]);
+            }
+            delete interior;
+        }
+
+        Node* _root;
+        Leaf* _head;
+        Leaf* _tail;
+        size_t _size;
+        unsigned long long _version;
+        size_t _numNodes;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,211 @@
+// in_memory_bplus_tree_test.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_bplus_tree.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+    typedef InMemoryBPlusTree<int> Tree;
+
+    // Zero padded so that byte order matches numeric order.
+    std::string makeKey(int i) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%08d", i);
+        return buf;
+    }
+
+    void assertMatches(const Tree& tree, const std::map<std::string, int>& expected) {
+        ASSERT_EQUALS(expected.size(), tree.size());
+
+        Tree::iterator it = tree.begin();
+        for (std::map<std::string, int>::const_iterator e = expected.begin();
+             e != expected.end(); ++e) {
+            ASSERT(it != tree.end());
+            ASSERT_EQUALS(e->first, it.key());
+            ASSERT_EQUALS(e->second, it.value());
+            tree.advance(&it);
+        }
+        ASSERT(it == tree.end());
+
+        it = tree.last();
+        for (std::map<std::string, int>::const_reverse_iterator e = expected.rbegin();
+             e != expected.rend(); ++e) {
+            ASSERT(it != tree.end());
+            ASSERT_EQUALS(e->first, it.key());
+            tree.retreat(&it);
+        }
+        ASSERT(it == tree.end());
+    }
+
+    TEST(InMemoryBPlusTree, Empty) {
+        Tree tree;
+        ASSERT(tree.empty());
+        ASSERT(tree.begin() == tree.end());
+        ASSERT(tree.last() == tree.end());
+        ASSERT(tree.find("a") == tree.end());
+        ASSERT(tree.lowerBound("a") == tree.end());
+        ASSERT_FALSE(tree.erase("a"));
+    }
+
+    TEST(InMemoryBPlusTree, InsertAndFind) {
+        Tree tree;
+        ASSERT(tree.insert("b", 2).second);
+        ASSERT(tree.insert("a", 1).second);
+        ASSERT(tree.insert("c", 3).second);
+
+        // Existing keys are left alone.
+        std::pair<Tree::iterator, bool> res = tree.insert("b", 20);
+        ASSERT_FALSE(res.second);
+        ASSERT_EQUALS(2, res.first.value());
+
+        ASSERT_EQUALS(3U, tree.size());
+        ASSERT_EQUALS(1, tree.find("a").value());
+        ASSERT_EQUALS(3, tree.find("c").value());
+        ASSERT(tree.find("d") == tree.end());
+    }
+
+    TEST(InMemoryBPlusTree, Bounds) {
+        Tree tree;
+        for (int i = 0; i < 1000; i += 2) {
+            tree.insert(makeKey(i), i);
+        }
+
+        ASSERT_EQUALS(makeKey(10), tree.lowerBound(makeKey(10)).key());
+        ASSERT_EQUALS(makeKey(12), tree.upperBound(makeKey(10)).key());
+        ASSERT_EQUALS(makeKey(12), tree.lowerBound(makeKey(11)).key());
+        ASSERT_EQUALS(makeKey(12), tree.upperBound(makeKey(11)).key());
+        ASSERT(tree.lowerBound(makeKey(999)) == tree.end());
+        ASSERT(tree.upperBound(makeKey(998)) == tree.end());
+        ASSERT_EQUALS(makeKey(0), tree.lowerBound("").key());
+    }
+
+    TEST(InMemoryBPlusTree, SplitsKeepOrder) {
+        Tree tree;
+        std::map<std::string, int> expected;
+
+        // Interleave the insertion order so splits happen in the middle of nodes too.
+        const int n = 20 * Tree::kMaxLeafEntries * Tree::kMaxInteriorChildren / 8;
+        for (int i = 0; i < n; i++) {
+            const int k = (i * 7919) % n;
+            tree.insert(makeKey(k), k);
+            expected[makeKey(k)] = k;
+        }
+
+        ASSERT_GREATER_THAN(tree.numNodes(), 1U);
+        assertMatches(tree, expected);
+    }
+
+    TEST(InMemoryBPlusTree, EraseShrinksTree) {
+        Tree tree;
+        std::map<std::string, int> expected;
+
+        const int n = 10000;
+        for (int i = 0; i < n; i++) {
+            tree.insert(makeKey(i), i);
+            expected[makeKey(i)] = i;
+        }
+        const size_t fullNodes = tree.numNodes();
+
+        // Leaves are only freed once they are empty, so erase a contiguous range.
+        for (int i = n / 10; i < n; i++) {
+            ASSERT(tree.erase(makeKey(i)));
+            expected.erase(makeKey(i));
+        }
+
+        ASSERT_LESS_THAN(tree.numNodes(), fullNodes);
+        assertMatches(tree, expected);
+
+        for (int i = 0; i < n / 10; i++) {
+            ASSERT(tree.erase(makeKey(i)));
+        }
+        ASSERT(tree.empty());
+        ASSERT_EQUALS(1U, tree.numNodes());
+        ASSERT(tree.begin() == tree.end());
+    }
+
+    TEST(InMemoryBPlusTree, EraseByIterator) {
+        Tree tree;
+        for (int i = 0; i < 500; i++) {
+            tree.insert(makeKey(i), i);
+        }
+
+        Tree::iterator it = tree.begin();
+        while (it != tree.end()) {
+            const std::string key = it.key();
+            tree.advance(&it);
+            if (tree.find(key).value() % 2)
+                tree.erase(tree.find(key));
+        }
+
+        ASSERT_EQUALS(250U, tree.size());
+        for (it = tree.begin(); it != tree.end(); tree.advance(&it)) {
+            ASSERT_EQUALS(0, it.value() % 2);
+        }
+    }
+
+    TEST(InMemoryBPlusTree, VersionChangesOnModification) {
+        Tree tree;
+        const unsigned long long v0 = tree.getVersion();
+        tree.insert("a", 1);
+        const unsigned long long v1 = tree.getVersion();
+        ASSERT_NOT_EQUALS(v0, v1);
+
+        // Neither a failed insert nor changing a value moves existing entries.
+        tree.insert("a", 2);
+        tree.find("a").value() = 3;
+        ASSERT_EQUALS(v1, tree.getVersion());
+
+        tree.erase("a");
+        ASSERT_NOT_EQUALS(v1, tree.getVersion());
+    }
+
+    TEST(InMemoryBPlusTree, Clear) {
+        Tree tree;
+        for (int i = 0; i < 1000; i++) {
+            tree.insert(makeKey(i), i);
+        }
+        tree.clear();
+        ASSERT(tree.empty());
+        ASSERT(tree.begin() == tree.end());
+        ASSERT(tree.insert("a", 1).second);
+        ASSERT_EQUALS(1U, tree.size());
+    }
+
+} // namespace
+} // namespace mongo
@@ -0,0 +1,64 @@
+// in_memory_global_options.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/base/status.h"
+#include "mongo/db/storage/in_memory/in_memory_global_options.h"
+#include "mongo/util/options_parser/constraints.h"
+
+namespace mongo {
+
+    InMemoryGlobalOptions inMemoryGlobalOptions;
+
+    Status InMemoryGlobalOptions::add(moe::OptionSection* options) {
+        moe::OptionSection inMemoryOptions("InMemory options");
+
+        inMemoryOptions.addOptionChaining("storage.inMemory.engineConfig.inMemorySizeGB",
+                                          "inMemorySizeGB",
+                                          moe::Int,
+                                          "maximum amount of memory the inMemory storage engine "
+                                          "may use for data and indexes; unlimited by default")
+            .validRange(1, 10000);
+
+        return options->addSection(inMemoryOptions);
+    }
+
+    Status InMemoryGlobalOptions::store(const moe::Environment& params,
+                                        const std::vector<std::string>& args) {
+        if (params.count("storage.inMemory.engineConfig.inMemorySizeGB")) {
+            inMemoryGlobalOptions.inMemorySizeGB =
+                params["storage.inMemory.engineConfig.inMemorySizeGB"].as<int>();
+        }
+
+        return Status::OK();
+    }
+
+}  // namespace mongo
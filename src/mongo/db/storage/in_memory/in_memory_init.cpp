@@ -32,6 +32,9 @@
 #include "mongo/base/init.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/in_memory/in_memory_engine.h"
+#include "mongo/db/storage/in_memory/in_memory_global_options.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_engine.h"
+#include "mongo/db/storage/in_memory/in_memory_server_status.h"
 #include "mongo/db/storage/kv/kv_storage_engine.h"
 #include "mongo/db/storage_options.h"
 
@@ -64,6 +67,38 @@ namespace mongo {
             }
         };
 
+        class InMemoryMVCCFactory : public StorageEngine::Factory {
+        public:
+            virtual ~InMemoryMVCCFactory() { }
+            virtual StorageEngine* create(const StorageGlobalParams& params,
+                                          const StorageEngineLockFile& lockFile) const {
+                const int64_t maxBytes =
+                    static_cast<int64_t>(inMemoryGlobalOptions.inMemorySizeGB) << 30;
+                InMemoryMVCCEngine* engine = new InMemoryMVCCEngine(maxBytes);
+
+                // Intentionally leaked.
+                new InMemoryServerStatusSection(engine);
+
+                KVStorageEngineOptions options;
+                options.directoryPerDB = params.directoryperdb;
+                options.forRepair = params.repair;
+                return new KVStorageEngine(engine, options);
+            }
+
+            virtual StringData getCanonicalName() const {
+                return "inMemory";
+            }
+
+            virtual Status validateMetadata(const StorageEngineMetadata& metadata,
+                                            const StorageGlobalParams& params) const {
+                return Status::OK();
+            }
+
+            virtual BSONObj createMetadataOptions(const StorageGlobalParams& params) const {
+                return BSONObj();
+            }
+        };
+
     } // namespace
 
     MONGO_INITIALIZER_WITH_PREREQUISITES(InMemoryEngineInit,
@@ -71,6 +106,7 @@ namespace mongo {
                                          (InitializerContext* context) {
 
         getGlobalServiceContext()->registerStorageEngine("inMemoryExperiment", new InMemoryFactory());
+        getGlobalServiceContext()->registerStorageEngine("inMemory", new InMemoryMVCCFactory());
         return Status::OK();
     }
 
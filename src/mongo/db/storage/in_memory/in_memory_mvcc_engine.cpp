@@ -0,0 +1,215 @@
+// in_memory_mvcc_engine.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_engine.h"
+
+#include <boost/thread/locks.hpp>
+
+#include "mongo/db/catalog/collection_options.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_index.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_record_store.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_recovery_unit.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
+
+namespace mongo {
+
+    using boost::shared_ptr;
+
+namespace {
+
+    // How often the sweeper frees garbage that commits left behind.
+    const int kSweepIntervalMillis = 100;
+
+} // namespace
+
+    InMemoryMVCCEngine::InMemoryMVCCEngine(int64_t maxBytes)
+        : _txnManager(maxBytes),
+          _sweeperShouldStop(false) {
+        _sweeperThread.reset(new boost::thread(stdx::bind(&InMemoryMVCCEngine::_sweeperThreadMain,
+                                                          this)));
+    }
+
+    InMemoryMVCCEngine::~InMemoryMVCCEngine() {
+        _stopSweeper();
+    }
+
+    void InMemoryMVCCEngine::cleanShutdown() {
+        _stopSweeper();
+    }
+
+    void InMemoryMVCCEngine::_stopSweeper() {
+        if (!_sweeperThread)
+            return;
+
+        {
+            boost::lock_guard<boost::mutex> lk(_sweeperMutex);
+            _sweeperShouldStop = true;
+        }
+        _sweeperCondVar.notify_one();
+        _sweeperThread->join();
+        _sweeperThread.reset();
+    }
+
+    void InMemoryMVCCEngine::_sweeperThreadMain() {
+        setThreadName("InMemoryGC");
+
+        while (true) {
+            {
+                boost::unique_lock<boost::mutex> lk(_sweeperMutex);
+                if (!_sweeperShouldStop) {
+                    _sweeperCondVar.timed_wait(lk,
+                                               boost::posix_time::milliseconds(
+                                                   kSweepIntervalMillis));
+                }
+                if (_sweeperShouldStop)
+                    return;
+            }
+
+            collectAllGarbage();
+        }
+    }
+
+    void InMemoryMVCCEngine::collectAllGarbage() {
+        std::vector<shared_ptr<InMemoryMVCCTable> > tables;
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            for (IdentMap::const_iterator it = _idents.begin(); it != _idents.end(); ++it) {
+                tables.push_back(it->second.table);
+                if (it->second.uniqueGuard)
+                    tables.push_back(it->second.uniqueGuard);
+            }
+        }
+
+        // Each call only holds the table's mutex for a bounded number of keys, so writers to the
+        // table are not held up for long.
+        const uint64_t oldest = _txnManager.oldestActiveSnapshot();
+        for (size_t i = 0; i < tables.size(); i++) {
+            while (tables[i]->collectGarbage(oldest)) {
+            }
+        }
+    }
+
+    RecoveryUnit* InMemoryMVCCEngine::newRecoveryUnit() {
+        return new InMemoryMVCCRecoveryUnit(&_txnManager);
+    }
+
+    InMemoryMVCCEngine::Ident InMemoryMVCCEngine::_getIdent(StringData ident,
+                                                            bool withUniqueGuard) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        Ident& entry = _idents[ident];
+        if (!entry.table)
+            entry.table.reset(new InMemoryMVCCTable(&_txnManager));
+        if (withUniqueGuard && !entry.uniqueGuard)
+            entry.uniqueGuard.reset(new InMemoryMVCCTable(&_txnManager));
+        return entry;
+    }
+
+    Status InMemoryMVCCEngine::createRecordStore(OperationContext* opCtx,
+                                                 StringData ns,
+                                                 StringData ident,
+                                                 const CollectionOptions& options) {
+        _getIdent(ident, false);
+        return Status::OK();
+    }
+
+    RecordStore* InMemoryMVCCEngine::getRecordStore(OperationContext* opCtx,
+                                                    StringData ns,
+                                                    StringData ident,
+                                                    const CollectionOptions& options) {
+        const Ident entry = _getIdent(ident, false);
+        if (options.capped) {
+            return new InMemoryMVCCRecordStore(ns,
+                                               entry.table,
+                                               true,
+                                               options.cappedSize ? options.cappedSize : 4096,
+                                               options.cappedMaxDocs ? options.cappedMaxDocs : -1);
+        }
+        return new InMemoryMVCCRecordStore(ns, entry.table);
+    }
+
+    Status InMemoryMVCCEngine::createSortedDataInterface(OperationContext* opCtx,
+                                                         StringData ident,
+                                                         const IndexDescriptor* desc) {
+        _getIdent(ident, desc->unique());
+        return Status::OK();
+    }
+
+    SortedDataInterface* InMemoryMVCCEngine::getSortedDataInterface(OperationContext* opCtx,
+                                                                    StringData ident,
+                                                                    const IndexDescriptor* desc) {
+        const Ident entry = _getIdent(ident, desc->unique());
+        return new InMemoryMVCCIndex(Ordering::make(desc->keyPattern()),
+                                     desc->unique(),
+                                     desc->parentNS(),
+                                     desc->indexName(),
+                                     entry.table,
+                                     entry.uniqueGuard);
+    }
+
+    Status InMemoryMVCCEngine::dropIdent(OperationContext* opCtx, StringData ident) {
+        // Open transactions hold their own references, so the memory is reclaimed once the
+        // last of them finishes.
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        _idents.erase(ident);
+        return Status::OK();
+    }
+
+    int64_t InMemoryMVCCEngine::getIdentSize(OperationContext* opCtx, StringData ident) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        IdentMap::const_iterator it = _idents.find(ident);
+        if (it == _idents.end())
+            return 0;
+
+        const Ident& entry = it->second;
+        return entry.table->bytesInUse() +
+               (entry.uniqueGuard ? entry.uniqueGuard->bytesInUse() : 0);
+    }
+
+    bool InMemoryMVCCEngine::hasIdent(OperationContext* opCtx, StringData ident) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        return _idents.find(ident) != _idents.end();
+    }
+
+    std::vector<std::string> InMemoryMVCCEngine::getAllIdents(OperationContext* opCtx) const {
+        std::vector<std::string> all;
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            for (IdentMap::const_iterator it = _idents.begin(); it != _idents.end(); ++it) {
+                all.push_back(it->first);
+            }
+        }
+        return all;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,140 @@
+// in_memory_mvcc_engine.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_table.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_txn_manager.h"
+#include "mongo/db/storage/kv/kv_engine.h"
+#include "mongo/util/string_map.h"
+
+namespace mongo {
+
+    /**
+     * A KVEngine that keeps every collection and index in an InMemoryMVCCTable.
+     *
+     * Unlike InMemoryEngine it supports document level locking: readers see a consistent
+     * snapshot, and writers conflict only when they touch the same record or index key.
+     * Nothing is persisted, and the total memory used by all tables can be capped.
+     */
+    class InMemoryMVCCEngine : public KVEngine {
+    public:
+        /**
+         * 'maxBytes' bounds the memory used by all tables. Zero means unlimited.
+         */
+        explicit InMemoryMVCCEngine(int64_t maxBytes = 0);
+        virtual ~InMemoryMVCCEngine();
+
+        virtual RecoveryUnit* newRecoveryUnit();
+
+        virtual Status createRecordStore(OperationContext* opCtx,
+                                         StringData ns,
+                                         StringData ident,
+                                         const CollectionOptions& options);
+
+        virtual RecordStore* getRecordStore(OperationContext* opCtx,
+                                            StringData ns,
+                                            StringData ident,
+                                            const CollectionOptions& options);
+
+        virtual Status createSortedDataInterface(OperationContext* opCtx,
+                                                 StringData ident,
+                                                 const IndexDescriptor* desc);
+
+        virtual SortedDataInterface* getSortedDataInterface(OperationContext* opCtx,
+                                                            StringData ident,
+                                                            const IndexDescriptor* desc);
+
+        virtual Status dropIdent(OperationContext* opCtx, StringData ident);
+
+        virtual bool supportsDocLocking() const { return true; }
+
+        virtual bool supportsDirectoryPerDB() const { return false; }
+
+        // There is nothing to lose on a crash that a restart wouldn't lose anyway, so writes
+        // never need to wait for a journal.
+        virtual bool isDurable() const { return true; }
+
+        virtual int64_t getIdentSize(OperationContext* opCtx, StringData ident);
+
+        virtual Status repairIdent(OperationContext* opCtx, StringData ident) {
+            return Status::OK();
+        }
+
+        virtual void cleanShutdown();
+
+        virtual bool hasIdent(OperationContext* opCtx, StringData ident) const;
+
+        std::vector<std::string> getAllIdents(OperationContext* opCtx) const;
+
+        InMemoryMVCCTxnManager* getTxnManager() { return &_txnManager; }
+
+        /**
+         * Frees everything no open snapshot can see anymore, on every table. Commits only collect
+         * a bounded amount on the tables they write to, so without this the garbage of a table
+         * that stops being written to would count against the memory limit forever. The sweeper
+         * thread calls it periodically.
+         */
+        void collectAllGarbage();
+
+    private:
+        struct Ident {
+            boost::shared_ptr<InMemoryMVCCTable> table;
+            boost::shared_ptr<InMemoryMVCCTable> uniqueGuard; // only set for unique indexes
+        };
+
+        typedef StringMap<Ident> IdentMap;
+
+        // Returns the ident, creating its tables if needed.
+        Ident _getIdent(StringData ident, bool withUniqueGuard);
+
+        void _stopSweeper();
+        void _sweeperThreadMain();
+
+        // Must outlive every table, so it is declared first.
+        InMemoryMVCCTxnManager _txnManager;
+
+        mutable boost::mutex _mutex;
+        IdentMap _idents;
+
+        // Guards _sweeperShouldStop.
+        boost::mutex _sweeperMutex;
+        boost::condition_variable _sweeperCondVar;
+        bool _sweeperShouldStop;
+        boost::scoped_ptr<boost::thread> _sweeperThread;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,445 @@
+// in_memory_mvcc_index.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_index.h"
+
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_recovery_unit.h"
+#include "mongo/db/storage/index_entry_comparison.h"
+#include "mongo/db/storage/key_string.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/util/bufreader.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using boost::shared_ptr;
+    using std::string;
+
+namespace {
+
+    const int TempKeyMaxSize = 1024; // this goes away with SERVER-3372
+
+    bool hasFieldNames(const BSONObj& obj) {
+        BSONForEach(e, obj) {
+            if (e.fieldName()[0])
+                return true;
+        }
+        return false;
+    }
+
+    BSONObj stripFieldNames(const BSONObj& query) {
+        if (!hasFieldNames(query))
+            return query;
+
+        BSONObjBuilder bb;
+        BSONForEach(e, query) {
+            bb.appendAs(e, StringData());
+        }
+        return bb.obj();
+    }
+
+    Status checkKeySize(const BSONObj& key) {
+        if (key.objsize() >= TempKeyMaxSize) {
+            string msg = mongoutils::str::stream()
+                << "InMemoryMVCCIndex::insert: key too large to index, failing "
+                << ' ' << key.objsize() << ' ' << key;
+            return Status(ErrorCodes::KeyTooLong, msg);
+        }
+        return Status::OK();
+    }
+
+    StringData toStringData(const KeyString& ks) {
+        return StringData(ks.getBuffer(), ks.getSize());
+    }
+
+    /**
+     * Walks the entries of an InMemoryMVCCIndex. Positions are kept as full KeyStrings, including
+     * the RecordId, so restore() can find its way back after the snapshot has moved on.
+     */
+    class InMemoryMVCCIndexCursor final : public SortedDataInterface::Cursor {
+    public:
+        InMemoryMVCCIndexCursor(const InMemoryMVCCIndex& idx, OperationContext* txn, bool forward)
+            : _txn(txn),
+              _idx(idx),
+              _forward(forward),
+              _cursor(idx.table().get(), forward) {
+        }
+
+        boost::optional<IndexKeyEntry> next(RequestedInfo parts) override {
+            // Advance on a cursor at the end is a no-op
+            if (_eof) return {};
+
+            if (!_lastMoveWasRestore) _cursor.next(_ru());
+            updatePosition();
+            return curr(parts);
+        }
+
+        void setEndPosition(const BSONObj& key, bool inclusive) override {
+            if (key.isEmpty()) {
+                // This means scan to end of index.
+                _endPosition.reset();
+                return;
+            }
+
+            // NOTE: this uses the opposite rules as a normal seek because a forward scan should
+            // end after the key if inclusive and before if exclusive.
+            const auto discriminator = _forward == inclusive ? KeyString::kExclusiveAfter
+                                                             : KeyString::kExclusiveBefore;
+            _endPosition = stdx::make_unique<KeyString>();
+            _endPosition->resetToKey(stripFieldNames(key), _idx.ordering(), discriminator);
+        }
+
+        boost::optional<IndexKeyEntry> seek(const BSONObj& key, bool inclusive,
+                                            RequestedInfo parts) override {
+            const auto discriminator = _forward == inclusive ? KeyString::kExclusiveBefore
+                                                             : KeyString::kExclusiveAfter;
+            _query.resetToKey(stripFieldNames(key), _idx.ordering(), discriminator);
+            seekCursor(_query);
+            updatePosition();
+            return curr(parts);
+        }
+
+        boost::optional<IndexKeyEntry> seek(const IndexSeekPoint& seekPoint,
+                                            RequestedInfo parts) override {
+            BSONObj key = IndexEntryComparison::makeQueryObject(seekPoint, _forward);
+
+            // makeQueryObject handles the discriminator in the real exclusive cases.
+            const auto discriminator = _forward ? KeyString::kExclusiveBefore
+                                                : KeyString::kExclusiveAfter;
+            _query.resetToKey(key, _idx.ordering(), discriminator);
+            seekCursor(_query);
+            updatePosition();
+            return curr(parts);
+        }
+
+        void savePositioned() override {
+            _txn = NULL;
+        }
+
+        void saveUnpositioned() override {
+            savePositioned();
+            _eof = true;
+        }
+
+        void restore(OperationContext* txn) override {
+            _txn = txn;
+
+            // Our saved position is wherever we were when we last called updatePosition().
+            if (!_eof) {
+                _lastMoveWasRestore = !seekCursor(_key);
+            }
+        }
+
+    private:
+        InMemoryMVCCRecoveryUnit* _ru() const {
+            return InMemoryMVCCRecoveryUnit::get(_txn);
+        }
+
+        boost::optional<IndexKeyEntry> curr(RequestedInfo parts) const {
+            if (_eof) return {};
+
+            dassert(!atOrPastEndPointAfterSeeking());
+            dassert(!_loc.isNull());
+
+            BSONObj bson;
+            if (parts & kWantKey) {
+                bson = KeyString::toBson(_key.getBuffer(), _key.getSize(), _idx.ordering(),
+                                         _typeBits);
+            }
+
+            return {{std::move(bson), _loc}};
+        }
+
+        bool atOrPastEndPointAfterSeeking() const {
+            if (_eof) return true;
+            if (!_endPosition) return false;
+
+            // _endPosition never equals a legal index key.
+            const int cmp = _key.compare(*_endPosition);
+            return _forward ? cmp > 0 : cmp < 0;
+        }
+
+        // Seeks to query. Returns true on exact match.
+        bool seekCursor(const KeyString& query) {
+            const StringData target = toStringData(query);
+            return _cursor.seek(_ru(), target) && StringData(_cursor.key()) == target;
+        }
+
+        /**
+         * This must be called after moving the cursor to update our cached position. It should not
+         * be called after a restore that did not restore to original state since that does not
+         * logically move the cursor until the following call to next().
+         */
+        void updatePosition() {
+            _lastMoveWasRestore = false;
+            if (_cursor.isEOF()) {
+                _eof = true;
+                _loc = RecordId();
+                return;
+            }
+
+            _eof = false;
+            _key.resetFromBuffer(_cursor.key().data(), _cursor.key().size());
+
+            if (atOrPastEndPointAfterSeeking()) {
+                _eof = true;
+                return;
+            }
+
+            _loc = KeyString::decodeRecordIdAtEnd(_key.getBuffer(), _key.getSize());
+            BufReader br(_cursor.value().data(), _cursor.value().size());
+            _typeBits.resetFromBuffer(&br);
+        }
+
+        OperationContext* _txn;
+        const InMemoryMVCCIndex& _idx; // not owned
+        const bool _forward;
+        InMemoryMVCCTable::Cursor _cursor;
+
+        // These are where this cursor instance is. They are not changed in the face of a failing
+        // next().
+        KeyString _key;
+        KeyString::TypeBits _typeBits;
+        RecordId _loc;
+        bool _eof = true;
+
+        // Used by next to decide to return current position rather than moving. Should be reset to
+        // false by any operation that moves the cursor, other than subsequent save/restore pairs.
+        bool _lastMoveWasRestore = false;
+
+        KeyString _query;
+
+        std::unique_ptr<KeyString> _endPosition;
+    };
+
+} // namespace
+
+    /**
+     * There is no bulk loading path into the tree, so this checks the ordering and uniqueness of
+     * the input and then inserts normally.
+     */
+    class InMemoryMVCCIndex::BulkBuilder : public SortedDataBuilderInterface {
+    public:
+        BulkBuilder(InMemoryMVCCIndex* idx, OperationContext* txn, bool dupsAllowed)
+            : _idx(idx), _txn(txn), _dupsAllowed(dupsAllowed) {
+        }
+
+        virtual Status addKey(const BSONObj& key, const RecordId& loc) {
+            if (!_lastKey.isEmpty()) {
+                const int cmp = key.woCompare(_lastKey, _idx->ordering(), false);
+                if (cmp < 0 || (cmp == 0 && loc <= _lastLoc)) {
+                    return Status(ErrorCodes::InternalError,
+                                  "expected ascending (key, RecordId) order in bulk builder");
+                }
+                if (cmp == 0 && _idx->_unique && !_dupsAllowed) {
+                    return _idx->dupKeyError(key);
+                }
+            }
+
+            Status status = _idx->insert(_txn, key, loc, true);
+            if (!status.isOK())
+                return status;
+
+            _lastKey = key.getOwned();
+            _lastLoc = loc;
+            return Status::OK();
+        }
+
+    private:
+        InMemoryMVCCIndex* const _idx;
+        OperationContext* const _txn;
+        const bool _dupsAllowed;
+        BSONObj _lastKey;
+        RecordId _lastLoc;
+    };
+
+    InMemoryMVCCIndex::InMemoryMVCCIndex(const Ordering& ordering,
+                                         bool unique,
+                                         const string& collectionNamespace,
+                                         const string& indexName,
+                                         shared_ptr<InMemoryMVCCTable> table,
+                                         shared_ptr<InMemoryMVCCTable> uniqueGuard)
+        : _ordering(ordering),
+          _unique(unique),
+          _collectionNamespace(collectionNamespace),
+          _indexName(indexName),
+          _table(table),
+          _uniqueGuard(uniqueGuard) {
+        invariant(!_unique || _uniqueGuard);
+    }
+
+    Status InMemoryMVCCIndex::dupKeyError(const BSONObj& key) const {
+        StringBuilder sb;
+        sb << "E11000 duplicate key error";
+        sb << " collection: " << _collectionNamespace;
+        sb << " index: " << _indexName;
+        sb << " dup key: " << key;
+        return Status(ErrorCodes::DuplicateKey, sb.str());
+    }
+
+    SortedDataBuilderInterface* InMemoryMVCCIndex::getBulkBuilder(OperationContext* txn,
+                                                                  bool dupsAllowed) {
+        return new BulkBuilder(this, txn, dupsAllowed);
+    }
+
+    bool InMemoryMVCCIndex::_hasOtherLoc(OperationContext* txn,
+                                         const BSONObj& key,
+                                         const RecordId& loc) const {
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+
+        // Without a RecordId the key's KeyString is a prefix of all of its entries.
+        const KeyString prefix(key, _ordering);
+        const StringData prefixData = toStringData(prefix);
+
+        InMemoryMVCCTable::Cursor cursor(_table.get(), true);
+        for (cursor.seek(ru, prefixData);
+             !cursor.isEOF() && StringData(cursor.key()).startsWith(prefixData);
+             cursor.next(ru)) {
+            const string& entry = cursor.key();
+            if (KeyString::decodeRecordIdAtEnd(entry.data(), entry.size()) != loc)
+                return true;
+        }
+        return false;
+    }
+
+    Status InMemoryMVCCIndex::insert(OperationContext* txn,
+                                     const BSONObj& key,
+                                     const RecordId& loc,
+                                     bool dupsAllowed) {
+        invariant(loc.isNormal());
+        dassert(!hasFieldNames(key));
+
+        Status status = checkKeySize(key);
+        if (!status.isOK())
+            return status;
+
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+
+        if (_unique) {
+            // Claim the key first so a concurrent insert of it conflicts with this one.
+            const KeyString guard(key, _ordering);
+            status = _uniqueGuard->put(ru, toStringData(guard), NULL, 0);
+            if (!status.isOK())
+                return status;
+
+            if (!dupsAllowed && _hasOtherLoc(txn, key, loc))
+                return dupKeyError(key);
+        }
+
+        const KeyString entry(key, _ordering, loc);
+        const KeyString::TypeBits& typeBits = entry.getTypeBits();
+        if (typeBits.isAllZeros())
+            return _table->put(ru, toStringData(entry), NULL, 0);
+
+        return _table->put(ru,
+                           toStringData(entry),
+                           reinterpret_cast<const char*>(typeBits.getBuffer()),
+                           typeBits.getSize());
+    }
+
+    void InMemoryMVCCIndex::unindex(OperationContext* txn,
+                                    const BSONObj& key,
+                                    const RecordId& loc,
+                                    bool dupsAllowed) {
+        invariant(loc.isNormal());
+        dassert(!hasFieldNames(key));
+
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+
+        const KeyString entry(key, _ordering, loc);
+        if (!_table->remove(ru, toStringData(entry)))
+            return;
+
+        if (_unique && !_hasOtherLoc(txn, key, loc)) {
+            const KeyString guard(key, _ordering);
+            _uniqueGuard->remove(ru, toStringData(guard));
+        }
+    }
+
+    Status InMemoryMVCCIndex::dupKeyCheck(OperationContext* txn,
+                                          const BSONObj& key,
+                                          const RecordId& loc) {
+        invariant(!hasFieldNames(key));
+        invariant(_unique);
+
+        if (_hasOtherLoc(txn, key, loc))
+            return dupKeyError(key);
+        return Status::OK();
+    }
+
+    void InMemoryMVCCIndex::fullValidate(OperationContext* txn,
+                                         bool full,
+                                         long long* numKeysOut,
+                                         BSONObjBuilder* output) const {
+        if (output) *output << "valid" << true;
+
+        auto cursor = newCursor(txn, true);
+        long long count = 0;
+        for (auto kv = cursor->seek(minKey, true, Cursor::kJustExistance); kv;
+             kv = cursor->next(Cursor::kJustExistance)) {
+            count++;
+        }
+
+        if (numKeysOut) {
+            *numKeysOut = count;
+        }
+    }
+
+    bool InMemoryMVCCIndex::appendCustomStats(OperationContext* txn,
+                                              BSONObjBuilder* output,
+                                              double scale) const {
+        BSONObjBuilder mvcc(output->subobjStart("inMemory"));
+        _table->appendStats(&mvcc);
+        if (_uniqueGuard) {
+            BSONObjBuilder guard(mvcc.subobjStart("uniqueGuard"));
+            _uniqueGuard->appendStats(&guard);
+        }
+        return true;
+    }
+
+    long long InMemoryMVCCIndex::getSpaceUsedBytes(OperationContext* txn) const {
+        return _table->bytesInUse() + (_uniqueGuard ? _uniqueGuard->bytesInUse() : 0);
+    }
+
+    bool InMemoryMVCCIndex::isEmpty(OperationContext* txn) {
+        InMemoryMVCCTable::Cursor cursor(_table.get(), true);
+        return !cursor.seekToStart(InMemoryMVCCRecoveryUnit::get(txn));
+    }
+
+    std::unique_ptr<SortedDataInterface::Cursor> InMemoryMVCCIndex::newCursor(
+            OperationContext* txn,
+            bool isForward) const {
+        return stdx::make_unique<InMemoryMVCCIndexCursor>(*this, txn, isForward);
+    }
+
+}  // namespace mongo
@@ -0,0 +1,117 @@
+// in_memory_mvcc_index.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+#include "mongo/bson/ordering.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_table.h"
+#include "mongo/db/storage/sorted_data_interface.h"
+
+namespace mongo {
+
+    /**
+     * A SortedDataInterface over an InMemoryMVCCTable.
+     *
+     * Every entry is stored under the KeyString of its key followed by its RecordId, with the
+     * TypeBits as the value, so unique and standard indexes share one format.
+     *
+     * Unique indexes additionally write the bare key KeyString to a second table on every insert.
+     * Two transactions adding the same key under different RecordIds write the same guard entry,
+     * and the second one gets a WriteConflictException rather than silently creating a duplicate.
+     */
+    class InMemoryMVCCIndex : public SortedDataInterface {
+    public:
+        InMemoryMVCCIndex(const Ordering& ordering,
+                          bool unique,
+                          const std::string& collectionNamespace,
+                          const std::string& indexName,
+                          boost::shared_ptr<InMemoryMVCCTable> table,
+                          boost::shared_ptr<InMemoryMVCCTable> uniqueGuard);
+
+        virtual SortedDataBuilderInterface* getBulkBuilder(OperationContext* txn,
+                                                           bool dupsAllowed);
+
+        virtual Status insert(OperationContext* txn,
+                              const BSONObj& key,
+                              const RecordId& loc,
+                              bool dupsAllowed);
+
+        virtual void unindex(OperationContext* txn,
+                             const BSONObj& key,
+                             const RecordId& loc,
+                             bool dupsAllowed);
+
+        virtual Status dupKeyCheck(OperationContext* txn, const BSONObj& key, const RecordId& loc);
+
+        virtual void fullValidate(OperationContext* txn,
+                                  bool full,
+                                  long long* numKeysOut,
+                                  BSONObjBuilder* output) const;
+
+        virtual bool appendCustomStats(OperationContext* txn,
+                                       BSONObjBuilder* output,
+                                       double scale) const;
+
+        virtual long long getSpaceUsedBytes(OperationContext* txn) const;
+
+        virtual bool isEmpty(OperationContext* txn);
+
+        virtual Status touch(OperationContext* txn) const { return Status::OK(); }
+
+        virtual std::unique_ptr<SortedDataInterface::Cursor> newCursor(OperationContext* txn,
+                                                                       bool isForward) const;
+
+        virtual Status initAsEmpty(OperationContext* txn) { return Status::OK(); }
+
+        const Ordering& ordering() const { return _ordering; }
+
+        const boost::shared_ptr<InMemoryMVCCTable>& table() const { return _table; }
+
+        Status dupKeyError(const BSONObj& key) const;
+
+    private:
+        class BulkBuilder;
+
+        // Returns true if an entry for 'key' with a RecordId other than 'loc' is visible.
+        bool _hasOtherLoc(OperationContext* txn, const BSONObj& key, const RecordId& loc) const;
+
+        const Ordering _ordering;
+        const bool _unique;
+        const std::string _collectionNamespace;
+        const std::string _indexName;
+
+        const boost::shared_ptr<InMemoryMVCCTable> _table;
+        const boost::shared_ptr<InMemoryMVCCTable> _uniqueGuard; // NULL unless _unique
+    };
+
+}  // namespace mongo
@@ -0,0 +1,163 @@
+// in_memory_mvcc_index_test.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_index.h"
+
+#include <boost/make_shared.hpp>
+
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_recovery_unit.h"
+#include "mongo/db/storage/sorted_data_interface_test_harness.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    class InMemoryMVCCIndexHarnessHelper final : public HarnessHelper {
+    public:
+        InMemoryMVCCIndexHarnessHelper()
+            : _order(Ordering::make(BSONObj())),
+              _txnManager(0) {
+        }
+
+        std::unique_ptr<SortedDataInterface> newSortedDataInterface(bool unique) final {
+            boost::shared_ptr<InMemoryMVCCTable> guard;
+            if (unique)
+                guard = boost::make_shared<InMemoryMVCCTable>(&_txnManager);
+
+            return stdx::make_unique<InMemoryMVCCIndex>(
+                _order, unique, "test.ns", "idx",
+                boost::make_shared<InMemoryMVCCTable>(&_txnManager), guard);
+        }
+
+        std::unique_ptr<RecoveryUnit> newRecoveryUnit() final {
+            return stdx::make_unique<InMemoryMVCCRecoveryUnit>(&_txnManager);
+        }
+
+    private:
+        Ordering _order;
+        InMemoryMVCCTxnManager _txnManager;
+    };
+
+    std::unique_ptr<HarnessHelper> newHarnessHelper() {
+        return stdx::make_unique<InMemoryMVCCIndexHarnessHelper>();
+    }
+
+    TEST(InMemoryMVCCIndex, ConcurrentUniqueInsertsConflict) {
+        const auto harnessHelper = newHarnessHelper();
+        const std::unique_ptr<SortedDataInterface> sorted(
+            harnessHelper->newSortedDataInterface(/*unique*/ true));
+
+        const auto first = harnessHelper->newOperationContext();
+        const auto second = harnessHelper->newOperationContext();
+        const BSONObj key = BSON("" << 1);
+
+        WriteUnitOfWork firstUow(first.get());
+        ASSERT_OK(sorted->insert(first.get(), key, RecordId(1), false));
+
+        // Neither transaction can see the other's entry, so only the guard catches this.
+        {
+            WriteUnitOfWork secondUow(second.get());
+            ASSERT_THROWS(sorted->insert(second.get(), key, RecordId(2), false),
+                          WriteConflictException);
+        }
+
+        firstUow.commit();
+
+        {
+            WriteUnitOfWork secondUow(second.get());
+            ASSERT_EQUALS(ErrorCodes::DuplicateKey,
+                          sorted->insert(second.get(), key, RecordId(2), false));
+        }
+    }
+
+    TEST(InMemoryMVCCIndex, UnindexReleasesUniqueKey) {
+        const auto harnessHelper = newHarnessHelper();
+        const std::unique_ptr<SortedDataInterface> sorted(
+            harnessHelper->newSortedDataInterface(/*unique*/ true));
+
+        const auto txn = harnessHelper->newOperationContext();
+        const BSONObj key = BSON("" << 1);
+        {
+            WriteUnitOfWork uow(txn.get());
+            ASSERT_OK(sorted->insert(txn.get(), key, RecordId(1), false));
+            uow.commit();
+        }
+        {
+            WriteUnitOfWork uow(txn.get());
+            sorted->unindex(txn.get(), key, RecordId(1), false);
+            ASSERT_OK(sorted->insert(txn.get(), key, RecordId(2), false));
+            uow.commit();
+        }
+
+        ASSERT_EQUALS(1, sorted->numEntries(txn.get()));
+        ASSERT_OK(sorted->dupKeyCheck(txn.get(), key, RecordId(2)));
+        ASSERT_EQUALS(ErrorCodes::DuplicateKey,
+                      sorted->dupKeyCheck(txn.get(), key, RecordId(3)));
+    }
+
+    TEST(InMemoryMVCCIndex, CursorKeepsSnapshotUntilRestore) {
+        const auto harnessHelper = newHarnessHelper();
+        const std::unique_ptr<SortedDataInterface> sorted(
+            harnessHelper->newSortedDataInterface(/*unique*/ false));
+
+        const auto writer = harnessHelper->newOperationContext();
+        const auto reader = harnessHelper->newOperationContext();
+        {
+            WriteUnitOfWork uow(writer.get());
+            ASSERT_OK(sorted->insert(writer.get(), BSON("" << 1), RecordId(1), true));
+            ASSERT_OK(sorted->insert(writer.get(), BSON("" << 3), RecordId(3), true));
+            uow.commit();
+        }
+
+        auto cursor = sorted->newCursor(reader.get());
+        ASSERT_EQ(cursor->seek(BSON("" << 1), true),
+                  IndexKeyEntry(BSON("" << 1), RecordId(1)));
+
+        {
+            WriteUnitOfWork uow(writer.get());
+            ASSERT_OK(sorted->insert(writer.get(), BSON("" << 2), RecordId(2), true));
+            uow.commit();
+        }
+
+        // Still on the old snapshot.
+        ASSERT_EQ(cursor->next(), IndexKeyEntry(BSON("" << 3), RecordId(3)));
+
+        cursor->savePositioned();
+        reader->recoveryUnit()->commitAndRestart();
+        cursor->restore(reader.get());
+
+        ASSERT_EQ(cursor->seek(BSON("" << 1), false),
+                  IndexKeyEntry(BSON("" << 2), RecordId(2)));
+    }
+
+}  // namespace mongo
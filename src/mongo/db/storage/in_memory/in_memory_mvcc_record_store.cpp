@@ -0,0 +1,580 @@
+// in_memory_mvcc_record_store.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_record_store.h"
+
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <cstring>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_recovery_unit.h"
+#include "mongo/db/storage/oplog_hack.h"
+#include "mongo/platform/endian.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using boost::shared_ptr;
+    using std::string;
+
+    class InMemoryMVCCRecordStore::CappedInsertChange : public RecoveryUnit::Change {
+    public:
+        CappedInsertChange(InMemoryMVCCRecordStore* rs, const RecordId& loc)
+            : _rs(rs), _loc(loc) {
+        }
+
+        virtual void commit() { _done(); }
+        virtual void rollback() { _done(); }
+
+    private:
+        void _done() {
+            boost::lock_guard<boost::mutex> lk(_rs->_uncommittedMutex);
+            _rs->_uncommitted.erase(_loc);
+        }
+
+        InMemoryMVCCRecordStore* const _rs;
+        const RecordId _loc;
+    };
+
+    class InMemoryMVCCRecordStore::RecordCountsChange : public RecoveryUnit::Change {
+    public:
+        RecordCountsChange(InMemoryMVCCTable* table, long long numRecords, long long dataSize)
+            : _table(table), _numRecords(numRecords), _dataSize(dataSize) {
+        }
+
+        virtual void commit() {}
+        virtual void rollback() { _table->adjustRecordCounts(-_numRecords, -_dataSize); }
+
+    private:
+        InMemoryMVCCTable* const _table;
+        const long long _numRecords;
+        const long long _dataSize;
+    };
+
+    /**
+     * Iterates over the records visible in the caller's snapshot. The snapshot is only held
+     * while the caller's recovery unit keeps it, so positions are re-established by RecordId
+     * after a yield.
+     */
+    class InMemoryMVCCRecordStore::Iterator : public RecordIterator {
+    public:
+        Iterator(const InMemoryMVCCRecordStore& rs,
+                 OperationContext* txn,
+                 const RecordId& start,
+                 bool forward)
+            : _rs(rs),
+              _txn(txn),
+              _forward(forward),
+              _cursor(rs._table.get(), forward),
+              _eof(true) {
+            if (start.isNull()) {
+                _cursor.seekToStart(_ru());
+                _setPosition();
+            }
+            else {
+                // An explicit start position must exist.
+                _cursor.seek(_ru(), makeKey(start));
+                _setPosition();
+                if (!_eof && _loc != start) {
+                    _eof = true;
+                    _loc = RecordId();
+                }
+            }
+        }
+
+        virtual bool isEOF() { return _eof; }
+
+        virtual RecordId curr() { return _loc; }
+
+        virtual RecordId getNext() {
+            const RecordId toReturn = _loc;
+            if (!_eof) {
+                _cursor.next(_ru());
+                _setPosition();
+            }
+            _lastLoc = toReturn;
+            return toReturn;
+        }
+
+        virtual void invalidate(const RecordId& dl) {
+            // Deletes are versioned, so iterators never need to be told about them.
+        }
+
+        virtual void saveState() {
+            _txn = NULL;
+        }
+
+        virtual bool restoreState(OperationContext* txn) {
+            _txn = txn;
+
+            if (_eof)
+                return true;
+
+            const RecordId saved = _lastLoc;
+            if (saved.isNull()) {
+                // Yielded before the first getNext(); start over from the current position.
+                _cursor.seek(_ru(), makeKey(_loc));
+                _setPosition();
+                return true;
+            }
+
+            _cursor.seek(_ru(), makeKey(saved));
+            _setPosition();
+            if (_eof) {
+                _lastLoc = RecordId();
+            }
+            else if (_loc != saved) {
+                if (_rs._isCapped) {
+                    // The record we were on was deleted by a capped delete or
+                    // temp_cappedTruncateAfter(). Don't let the caller silently skip over it.
+                    _eof = true;
+                    return false;
+                }
+                // Otherwise 'saved' was deleted and we're already on the following record.
+            }
+            else {
+                _cursor.next(_ru());
+                _setPosition();
+            }
+            return true;
+        }
+
+        virtual RecordData dataFor(const RecordId& loc) const {
+            if (!_eof && loc == _loc)
+                return _cursor.value();
+            return _rs.dataFor(_txn, loc);
+        }
+
+    private:
+        InMemoryMVCCRecoveryUnit* _ru() const {
+            return InMemoryMVCCRecoveryUnit::get(_txn);
+        }
+
+        void _setPosition() {
+            _eof = _cursor.isEOF();
+            if (!_eof) {
+                _loc = fromKey(_cursor.key());
+                if (_forward && _rs._isCapped && _rs.isCappedHidden(_loc))
+                    _eof = true;
+            }
+            if (_eof)
+                _loc = RecordId();
+        }
+
+        const InMemoryMVCCRecordStore& _rs;
+        OperationContext* _txn;
+        const bool _forward;
+        InMemoryMVCCTable::Cursor _cursor;
+        bool _eof;
+        RecordId _loc;
+        RecordId _lastLoc;
+    };
+
+    InMemoryMVCCRecordStore::InMemoryMVCCRecordStore(StringData ns,
+                                                     shared_ptr<InMemoryMVCCTable> table,
+                                                     bool isCapped,
+                                                     int64_t cappedMaxSize,
+                                                     int64_t cappedMaxDocs,
+                                                     CappedDocumentDeleteCallback* cappedDeleteCallback)
+        : RecordStore(ns),
+          _table(table),
+          _isCapped(isCapped),
+          _isOplog(NamespaceString::oplog(ns)),
+          _cappedMaxSize(cappedMaxSize),
+          _cappedMaxDocs(cappedMaxDocs),
+          _cappedDeleteCallback(cappedDeleteCallback) {
+
+        if (_isCapped) {
+            invariant(_cappedMaxSize > 0);
+            invariant(_cappedMaxDocs == -1 || _cappedMaxDocs > 0);
+        }
+        else {
+            invariant(_cappedMaxSize == -1);
+            invariant(_cappedMaxDocs == -1);
+        }
+
+        string last;
+        _nextIdNum.store(_table->lastKey(&last) ? fromKey(last).repr() + 1 : 1);
+    }
+
+    const char* InMemoryMVCCRecordStore::name() const { return "inMemoryMVCC"; }
+
+    string InMemoryMVCCRecordStore::makeKey(const RecordId& loc) {
+        // Flipping the sign bit makes the big-endian bytes sort like the signed values.
+        const uint64_t value =
+            endian::nativeToBig(static_cast<uint64_t>(loc.repr()) ^ (1ULL << 63));
+        return string(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    RecordId InMemoryMVCCRecordStore::fromKey(const string& key) {
+        invariant(key.size() == sizeof(uint64_t));
+        uint64_t value;
+        std::memcpy(&value, key.data(), sizeof(value));
+        return RecordId(static_cast<int64_t>(endian::bigToNative(value) ^ (1ULL << 63)));
+    }
+
+    RecordId InMemoryMVCCRecordStore::_nextId() {
+        invariant(!_isOplog);
+        return RecordId(_nextIdNum.fetchAndAdd(1));
+    }
+
+    int64_t InMemoryMVCCRecordStore::storageSize(OperationContext* txn,
+                                                 BSONObjBuilder* extraInfo,
+                                                 int infoLevel) const {
+        return _table->bytesInUse();
+    }
+
+    RecordData InMemoryMVCCRecordStore::dataFor(OperationContext* txn,
+                                                const RecordId& loc) const {
+        RecordData data;
+        uassert(28716, "Didn't find RecordId in InMemoryMVCCRecordStore",
+                findRecord(txn, loc, &data));
+        return data;
+    }
+
+    bool InMemoryMVCCRecordStore::findRecord(OperationContext* txn,
+                                             const RecordId& loc,
+                                             RecordData* out) const {
+        return _table->get(InMemoryMVCCRecoveryUnit::get(txn), makeKey(loc), out);
+    }
+
+    void InMemoryMVCCRecordStore::deleteRecord(OperationContext* txn, const RecordId& loc) {
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+        const string key = makeKey(loc);
+
+        RecordData old;
+        invariant(_table->get(ru, key, &old));
+        invariant(_table->remove(ru, key));
+        _changeRecordCounts(txn, -1, -old.size());
+    }
+
+    void InMemoryMVCCRecordStore::_changeRecordCounts(OperationContext* txn,
+                                                      long long numRecordsDelta,
+                                                      long long dataSizeDelta) {
+        _table->adjustRecordCounts(numRecordsDelta, dataSizeDelta);
+        txn->recoveryUnit()->registerChange(
+            new RecordCountsChange(_table.get(), numRecordsDelta, dataSizeDelta));
+    }
+
+    void InMemoryMVCCRecordStore::_addUncommitted(OperationContext* txn, const RecordId& loc) {
+        {
+            boost::lock_guard<boost::mutex> lk(_uncommittedMutex);
+            _uncommitted.insert(loc);
+        }
+        txn->recoveryUnit()->registerChange(new CappedInsertChange(this, loc));
+    }
+
+    bool InMemoryMVCCRecordStore::isCappedHidden(const RecordId& loc) const {
+        boost::lock_guard<boost::mutex> lk(_uncommittedMutex);
+        return !_uncommitted.empty() && *_uncommitted.begin() <= loc;
+    }
+
+    bool InMemoryMVCCRecordStore::_cappedAndNeedDelete() const {
+        if (!_isCapped)
+            return false;
+
+        if (_table->dataSize() > _cappedMaxSize)
+            return true;
+
+        return _cappedMaxDocs != -1 && _table->numRecords() > _cappedMaxDocs;
+    }
+
+    void InMemoryMVCCRecordStore::_cappedDeleteAsNeeded(OperationContext* txn,
+                                                        const RecordId& justInserted) {
+        if (!_cappedAndNeedDelete())
+            return;
+
+        // Concurrent deleters would only conflict with each other. Whoever loses the race leaves
+        // the work to the current deleter or to the next insert.
+        boost::unique_lock<boost::mutex> lock(_cappedDeleterMutex, boost::try_to_lock);
+        if (!lock.owns_lock())
+            return;
+
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+
+        const long long dataSize = _table->dataSize();
+        const long long numRecords = _table->numRecords();
+        long long sizeOverCap = dataSize > _cappedMaxSize ? dataSize - _cappedMaxSize : 0;
+        long long docsOverCap = (_cappedMaxDocs != -1 && numRecords > _cappedMaxDocs)
+                                    ? numRecords - _cappedMaxDocs
+                                    : 0;
+
+        InMemoryMVCCTable::Cursor cursor(_table.get(), true);
+        for (cursor.seekToStart(ru);
+             !cursor.isEOF() && (sizeOverCap > 0 || docsOverCap > 0);
+             cursor.next(ru)) {
+
+            const RecordId loc = fromKey(cursor.key());
+            if (loc == justInserted)
+                break;
+
+            const RecordData data = cursor.value();
+            if (_cappedDeleteCallback) {
+                uassertStatusOK(_cappedDeleteCallback->aboutToDeleteCapped(txn, loc, data));
+            }
+
+            deleteRecord(txn, loc);
+            sizeOverCap -= data.size();
+            docsOverCap--;
+        }
+    }
+
+    StatusWith<RecordId> InMemoryMVCCRecordStore::_insert(OperationContext* txn,
+                                                          const char* data,
+                                                          int len) {
+        if (_isCapped && len > _cappedMaxSize) {
+            return StatusWith<RecordId>(ErrorCodes::BadValue,
+                                        "object to insert exceeds cappedMaxSize");
+        }
+
+        RecordId loc;
+        if (_isOplog) {
+            StatusWith<RecordId> status = oploghack::extractKey(data, len);
+            if (!status.isOK())
+                return status;
+            loc = status.getValue();
+        }
+        else {
+            loc = _nextId();
+        }
+
+        if (_isCapped)
+            _addUncommitted(txn, loc);
+
+        Status status = _table->put(InMemoryMVCCRecoveryUnit::get(txn), makeKey(loc), data, len);
+        if (!status.isOK())
+            return StatusWith<RecordId>(status);
+
+        _changeRecordCounts(txn, 1, len);
+        _cappedDeleteAsNeeded(txn, loc);
+        return StatusWith<RecordId>(loc);
+    }
+
+    StatusWith<RecordId> InMemoryMVCCRecordStore::insertRecord(OperationContext* txn,
+                                                               const char* data,
+                                                               int len,
+                                                               bool enforceQuota) {
+        return _insert(txn, data, len);
+    }
+
+    StatusWith<RecordId> InMemoryMVCCRecordStore::insertRecord(OperationContext* txn,
+                                                               const DocWriter* doc,
+                                                               bool enforceQuota) {
+        const int len = doc->documentSize();
+        boost::scoped_array<char> buf(new char[len]);
+        doc->writeDocument(buf.get());
+        return _insert(txn, buf.get(), len);
+    }
+
+    StatusWith<RecordId> InMemoryMVCCRecordStore::updateRecord(OperationContext* txn,
+                                                               const RecordId& loc,
+                                                               const char* data,
+                                                               int len,
+                                                               bool enforceQuota,
+                                                               UpdateNotifier* notifier) {
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+        const string key = makeKey(loc);
+
+        RecordData old;
+        invariant(_table->get(ru, key, &old));
+
+        if (_isCapped && len > old.size()) {
+            return StatusWith<RecordId>(ErrorCodes::BadValue,
+                                        "failing update: objects in a capped ns cannot grow");
+        }
+
+        Status status = _table->put(ru, key, data, len);
+        if (!status.isOK())
+            return StatusWith<RecordId>(status);
+
+        _changeRecordCounts(txn, 0, len - old.size());
+        return StatusWith<RecordId>(loc);
+    }
+
+    bool InMemoryMVCCRecordStore::updateWithDamagesSupported() const {
+        // Every write makes a new version of the whole record anyway.
+        return false;
+    }
+
+    Status InMemoryMVCCRecordStore::updateWithDamages(OperationContext* txn,
+                                                      const RecordId& loc,
+                                                      const RecordData& oldRec,
+                                                      const char* damageSource,
+                                                      const mutablebson::DamageVector& damages) {
+        invariant(false);
+    }
+
+    RecordIterator* InMemoryMVCCRecordStore::getIterator(
+            OperationContext* txn,
+            const RecordId& start,
+            const CollectionScanParams::Direction& dir) const {
+        return new Iterator(*this, txn, start, dir == CollectionScanParams::FORWARD);
+    }
+
+    std::vector<RecordIterator*> InMemoryMVCCRecordStore::getManyIterators(
+            OperationContext* txn) const {
+        std::vector<RecordIterator*> out;
+        out.push_back(getIterator(txn));
+        return out;
+    }
+
+    Status InMemoryMVCCRecordStore::truncate(OperationContext* txn) {
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+
+        long long numRecords = 0;
+        long long dataSize = 0;
+        InMemoryMVCCTable::Cursor cursor(_table.get(), true);
+        for (cursor.seekToStart(ru); !cursor.isEOF(); cursor.next(ru)) {
+            numRecords++;
+            dataSize += cursor.value().size();
+            invariant(_table->remove(ru, cursor.key()));
+        }
+
+        _changeRecordCounts(txn, -numRecords, -dataSize);
+        return Status::OK();
+    }
+
+    void InMemoryMVCCRecordStore::temp_cappedTruncateAfter(OperationContext* txn,
+                                                           RecordId end,
+                                                           bool inclusive) {
+        WriteUnitOfWork wuow(txn);
+        boost::scoped_ptr<RecordIterator> iter(getIterator(txn, end));
+        while (!iter->isEOF()) {
+            RecordId loc = iter->getNext();
+            if (end < loc || (inclusive && end == loc)) {
+                deleteRecord(txn, loc);
+            }
+        }
+        wuow.commit();
+    }
+
+    Status InMemoryMVCCRecordStore::validate(OperationContext* txn,
+                                             bool full,
+                                             bool scanData,
+                                             ValidateAdaptor* adaptor,
+                                             ValidateResults* results,
+                                             BSONObjBuilder* output) {
+        InMemoryMVCCRecoveryUnit* ru = InMemoryMVCCRecoveryUnit::get(txn);
+
+        long long nrecords = 0;
+        long long dataSizeTotal = 0;
+        results->valid = true;
+
+        InMemoryMVCCTable::Cursor cursor(_table.get(), true);
+        for (cursor.seekToStart(ru); !cursor.isEOF(); cursor.next(ru)) {
+            ++nrecords;
+            if (full && scanData) {
+                size_t dataSize;
+                Status status = adaptor->validate(cursor.value(), &dataSize);
+                if (!status.isOK()) {
+                    results->valid = false;
+                    results->errors.push_back(str::stream() << fromKey(cursor.key())
+                                                            << " is corrupted");
+                }
+                dataSizeTotal += static_cast<long long>(dataSize);
+            }
+        }
+
+        if (full && scanData && results->valid) {
+            if (nrecords != _table->numRecords() || dataSizeTotal != _table->dataSize()) {
+                warning() << ns() << ": Existing record and data size counters ("
+                          << _table->numRecords() << " records " << _table->dataSize()
+                          << " bytes) are inconsistent with full validation results ("
+                          << nrecords << " records " << dataSizeTotal << " bytes). "
+                          << "Updating counters with new values.";
+                _table->setRecordCounts(nrecords, dataSizeTotal);
+            }
+        }
+
+        output->appendNumber("nrecords", nrecords);
+        return Status::OK();
+    }
+
+    void InMemoryMVCCRecordStore::appendCustomStats(OperationContext* txn,
+                                                    BSONObjBuilder* result,
+                                                    double scale) const {
+        result->appendBool("capped", _isCapped);
+        if (_isCapped) {
+            result->appendIntOrLL("max", _cappedMaxDocs);
+            result->appendIntOrLL("maxSize", static_cast<long long>(_cappedMaxSize / scale));
+        }
+
+        BSONObjBuilder mvcc(result->subobjStart("inMemory"));
+        _table->appendStats(&mvcc);
+    }
+
+    Status InMemoryMVCCRecordStore::touch(OperationContext* txn, BSONObjBuilder* output) const {
+        if (output) {
+            output->append("numRanges", 1);
+            output->append("millis", 0);
+        }
+        return Status::OK();
+    }
+
+    boost::optional<RecordId> InMemoryMVCCRecordStore::oplogStartHack(
+            OperationContext* txn,
+            const RecordId& startingPosition) const {
+
+        if (!_isOplog)
+            return boost::none;
+
+        InMemoryMVCCTable::Cursor cursor(_table.get(), false);
+        if (!cursor.seek(InMemoryMVCCRecoveryUnit::get(txn), makeKey(startingPosition)))
+            return RecordId(); // nothing <= startingPosition
+
+        return fromKey(cursor.key());
+    }
+
+    Status InMemoryMVCCRecordStore::oplogDiskLocRegister(OperationContext* txn,
+                                                         const Timestamp& opTime) {
+        StatusWith<RecordId> loc = oploghack::keyForOptime(opTime);
+        if (!loc.isOK())
+            return loc.getStatus();
+
+        _addUncommitted(txn, loc.getValue());
+        return Status::OK();
+    }
+
+    void InMemoryMVCCRecordStore::updateStatsAfterRepair(OperationContext* txn,
+                                                         long long numRecords,
+                                                         long long dataSize) {
+        _table->setRecordCounts(numRecords, dataSize);
+    }
+
+}  // namespace mongo
@@ -0,0 +1,188 @@
+// in_memory_mvcc_record_store.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <set>
+#include <string>
+
+#include "mongo/db/storage/capped_callback.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_table.h"
+#include "mongo/db/storage/record_store.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    class InMemoryMVCCRecoveryUnit;
+
+    /**
+     * A RecordStore over an InMemoryMVCCTable. Records are keyed by their RecordId in a fixed
+     * width, order preserving encoding.
+     *
+     * Capped collections hide everything from the oldest uncommitted insert onwards from
+     * iterators, so that readers tailing them never skip over a record that commits late.
+     */
+    class InMemoryMVCCRecordStore : public RecordStore {
+    public:
+        InMemoryMVCCRecordStore(StringData ns,
+                                boost::shared_ptr<InMemoryMVCCTable> table,
+                                bool isCapped = false,
+                                int64_t cappedMaxSize = -1,
+                                int64_t cappedMaxDocs = -1,
+                                CappedDocumentDeleteCallback* cappedDeleteCallback = NULL);
+
+        virtual const char* name() const;
+
+        virtual long long dataSize(OperationContext* txn) const { return _table->dataSize(); }
+
+        virtual long long numRecords(OperationContext* txn) const {
+            return _table->numRecords();
+        }
+
+        virtual bool isCapped() const { return _isCapped; }
+
+        virtual void setCappedDeleteCallback(CappedDocumentDeleteCallback* cb) {
+            _cappedDeleteCallback = cb;
+        }
+
+        virtual int64_t storageSize(OperationContext* txn,
+                                    BSONObjBuilder* extraInfo = NULL,
+                                    int infoLevel = 0) const;
+
+        virtual RecordData dataFor(OperationContext* txn, const RecordId& loc) const;
+
+        virtual bool findRecord(OperationContext* txn, const RecordId& loc, RecordData* out) const;
+
+        virtual void deleteRecord(OperationContext* txn, const RecordId& loc);
+
+        virtual StatusWith<RecordId> insertRecord(OperationContext* txn,
+                                                  const char* data,
+                                                  int len,
+                                                  bool enforceQuota);
+
+        virtual StatusWith<RecordId> insertRecord(OperationContext* txn,
+                                                  const DocWriter* doc,
+                                                  bool enforceQuota);
+
+        virtual StatusWith<RecordId> updateRecord(OperationContext* txn,
+                                                  const RecordId& oldLocation,
+                                                  const char* data,
+                                                  int len,
+                                                  bool enforceQuota,
+                                                  UpdateNotifier* notifier);
+
+        virtual bool updateWithDamagesSupported() const;
+
+        virtual Status updateWithDamages(OperationContext* txn,
+                                         const RecordId& loc,
+                                         const RecordData& oldRec,
+                                         const char* damageSource,
+                                         const mutablebson::DamageVector& damages);
+
+        virtual RecordIterator* getIterator(OperationContext* txn,
+                                            const RecordId& start = RecordId(),
+                                            const CollectionScanParams::Direction& dir =
+                                                    CollectionScanParams::FORWARD) const;
+
+        virtual std::vector<RecordIterator*> getManyIterators(OperationContext* txn) const;
+
+        virtual Status truncate(OperationContext* txn);
+
+        virtual void temp_cappedTruncateAfter(OperationContext* txn,
+                                              RecordId end,
+                                              bool inclusive);
+
+        virtual Status validate(OperationContext* txn,
+                                bool full,
+                                bool scanData,
+                                ValidateAdaptor* adaptor,
+                                ValidateResults* results,
+                                BSONObjBuilder* output);
+
+        virtual void appendCustomStats(OperationContext* txn,
+                                       BSONObjBuilder* result,
+                                       double scale) const;
+
+        virtual Status touch(OperationContext* txn, BSONObjBuilder* output) const;
+
+        virtual boost::optional<RecordId> oplogStartHack(OperationContext* txn,
+                                                         const RecordId& startingPosition) const;
+
+        virtual Status oplogDiskLocRegister(OperationContext* txn, const Timestamp& opTime);
+
+        virtual void updateStatsAfterRepair(OperationContext* txn,
+                                            long long numRecords,
+                                            long long dataSize);
+
+        bool isCappedHidden(const RecordId& loc) const;
+
+        static std::string makeKey(const RecordId& loc);
+        static RecordId fromKey(const std::string& key);
+
+    private:
+        class Iterator;
+        class CappedInsertChange;
+        class RecordCountsChange;
+
+        StatusWith<RecordId> _insert(OperationContext* txn, const char* data, int len);
+
+        RecordId _nextId();
+
+        void _changeRecordCounts(OperationContext* txn,
+                                 long long numRecordsDelta,
+                                 long long dataSizeDelta);
+
+        // Hides 'loc' from capped iterators until the current transaction ends.
+        void _addUncommitted(OperationContext* txn, const RecordId& loc);
+
+        bool _cappedAndNeedDelete() const;
+        void _cappedDeleteAsNeeded(OperationContext* txn, const RecordId& justInserted);
+
+        const boost::shared_ptr<InMemoryMVCCTable> _table;
+
+        const bool _isCapped;
+        const bool _isOplog;
+        const int64_t _cappedMaxSize;
+        const int64_t _cappedMaxDocs;
+        CappedDocumentDeleteCallback* _cappedDeleteCallback;
+
+        // Only one thread deletes from a capped collection at a time; they would conflict
+        // otherwise.
+        boost::mutex _cappedDeleterMutex;
+
+        mutable boost::mutex _uncommittedMutex;
+        std::set<RecordId> _uncommitted; // guarded by _uncommittedMutex
+
+        AtomicInt64 _nextIdNum;
+    };
+
+}  // namespace mongo
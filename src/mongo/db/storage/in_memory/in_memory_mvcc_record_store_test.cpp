@@ -0,0 +1,364 @@
+// in_memory_mvcc_record_store_test.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_record_store.h"
+
+#include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <string>
+
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/operation_context_noop.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_recovery_unit.h"
+#include "mongo/db/storage/record_store_test_harness.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    using boost::scoped_ptr;
+    using std::string;
+
+    class InMemoryMVCCHarnessHelper : public HarnessHelper {
+    public:
+        explicit InMemoryMVCCHarnessHelper(int64_t maxBytes = 0) : _txnManager(maxBytes) {}
+
+        virtual RecordStore* newNonCappedRecordStore() {
+            return new InMemoryMVCCRecordStore("a.b", newTable());
+        }
+
+        RecordStore* newCappedRecordStore(int64_t cappedMaxSize, int64_t cappedMaxDocs) {
+            return new InMemoryMVCCRecordStore("a.b", newTable(), true,
+                                               cappedMaxSize, cappedMaxDocs);
+        }
+
+        virtual RecoveryUnit* newRecoveryUnit() {
+            return new InMemoryMVCCRecoveryUnit(&_txnManager);
+        }
+
+        boost::shared_ptr<InMemoryMVCCTable> newTable() {
+            return boost::make_shared<InMemoryMVCCTable>(&_txnManager);
+        }
+
+        InMemoryMVCCTxnManager* txnManager() { return &_txnManager; }
+
+    private:
+        InMemoryMVCCTxnManager _txnManager;
+    };
+
+    HarnessHelper* newHarnessHelper() {
+        return new InMemoryMVCCHarnessHelper();
+    }
+
+namespace {
+
+    RecordId insertCommitted(OperationContext* txn, RecordStore* rs, const string& data) {
+        WriteUnitOfWork uow(txn);
+        StatusWith<RecordId> res = rs->insertRecord(txn, data.c_str(), data.size() + 1, false);
+        ASSERT_OK(res.getStatus());
+        uow.commit();
+        return res.getValue();
+    }
+
+    string readRecord(OperationContext* txn, RecordStore* rs, const RecordId& loc) {
+        return rs->dataFor(txn, loc).data();
+    }
+
+} // namespace
+
+    TEST(InMemoryMVCCRecordStore, KeysSortLikeRecordIds) {
+        const RecordId ids[] = {RecordId::min(), RecordId(-5), RecordId(0), RecordId(1),
+                                RecordId(1LL << 40), RecordId::max()};
+        for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+            const string key = InMemoryMVCCRecordStore::makeKey(ids[i]);
+            ASSERT_EQUALS(ids[i], InMemoryMVCCRecordStore::fromKey(key));
+            if (i > 0) {
+                ASSERT_LESS_THAN(InMemoryMVCCRecordStore::makeKey(ids[i - 1]), key);
+            }
+        }
+    }
+
+    TEST(InMemoryMVCCRecordStore, ReadersKeepTheirSnapshot) {
+        InMemoryMVCCHarnessHelper harness;
+        scoped_ptr<RecordStore> rs(harness.newNonCappedRecordStore());
+
+        scoped_ptr<OperationContext> writer(harness.newOperationContext());
+        const RecordId loc = insertCommitted(writer.get(), rs.get(), "old");
+
+        scoped_ptr<OperationContext> reader(harness.newOperationContext());
+        ASSERT_EQUALS("old", readRecord(reader.get(), rs.get(), loc));
+
+        RecordId other;
+        {
+            WriteUnitOfWork uow(writer.get());
+            ASSERT_OK(rs->updateRecord(writer.get(), loc, "new", 4, false, NULL).getStatus());
+            uow.commit();
+        }
+        other = insertCommitted(writer.get(), rs.get(), "other");
+
+        // The reader's snapshot predates both writes.
+        ASSERT_EQUALS("old", readRecord(reader.get(), rs.get(), loc));
+        RecordData data;
+        ASSERT_FALSE(rs->findRecord(reader.get(), other, &data));
+
+        // Until it lets go of it, as queries do when they yield.
+        reader->recoveryUnit()->commitAndRestart();
+        ASSERT_EQUALS("new", readRecord(reader.get(), rs.get(), loc));
+        ASSERT(rs->findRecord(reader.get(), other, &data));
+    }
+
+    TEST(InMemoryMVCCRecordStore, UncommittedWritesAreInvisible) {
+        InMemoryMVCCHarnessHelper harness;
+        scoped_ptr<RecordStore> rs(harness.newNonCappedRecordStore());
+
+        scoped_ptr<OperationContext> writer(harness.newOperationContext());
+        scoped_ptr<OperationContext> reader(harness.newOperationContext());
+
+        WriteUnitOfWork uow(writer.get());
+        StatusWith<RecordId> res = rs->insertRecord(writer.get(), "a", 2, false);
+        ASSERT_OK(res.getStatus());
+
+        // Visible to the writer only.
+        RecordData data;
+        ASSERT(rs->findRecord(writer.get(), res.getValue(), &data));
+        ASSERT_FALSE(rs->findRecord(reader.get(), res.getValue(), &data));
+
+        scoped_ptr<RecordIterator> it(rs->getIterator(reader.get()));
+        ASSERT(it->isEOF());
+    }
+
+    TEST(InMemoryMVCCRecordStore, AbortRollsBack) {
+        InMemoryMVCCHarnessHelper harness;
+        scoped_ptr<RecordStore> rs(harness.newNonCappedRecordStore());
+
+        scoped_ptr<OperationContext> txn(harness.newOperationContext());
+        const RecordId kept = insertCommitted(txn.get(), rs.get(), "kept");
+
+        RecordId dropped;
+        {
+            WriteUnitOfWork uow(txn.get());
+            StatusWith<RecordId> res = rs->insertRecord(txn.get(), "dropped", 8, false);
+            ASSERT_OK(res.getStatus());
+            dropped = res.getValue();
+            rs->deleteRecord(txn.get(), kept);
+            ASSERT_EQUALS(1, rs->numRecords(txn.get()));
+        }
+
+        ASSERT_EQUALS(1, rs->numRecords(txn.get()));
+        ASSERT_EQUALS(5, rs->dataSize(txn.get()));
+        ASSERT_EQUALS("kept", readRecord(txn.get(), rs.get(), kept));
+        RecordData data;
+        ASSERT_FALSE(rs->findRecord(txn.get(), dropped, &data));
+    }
+
+    TEST(InMemoryMVCCRecordStore, ConcurrentUpdatesConflict) {
+        InMemoryMVCCHarnessHelper harness;
+        scoped_ptr<RecordStore> rs(harness.newNonCappedRecordStore());
+
+        scoped_ptr<OperationContext> first(harness.newOperationContext());
+        scoped_ptr<OperationContext> second(harness.newOperationContext());
+        const RecordId loc = insertCommitted(first.get(), rs.get(), "a");
+
+        WriteUnitOfWork firstUow(first.get());
+        ASSERT_OK(rs->updateRecord(first.get(), loc, "b", 2, false, NULL).getStatus());
+
+        {
+            WriteUnitOfWork secondUow(second.get());
+            ASSERT_THROWS(rs->updateRecord(second.get(), loc, "c", 2, false, NULL),
+                          WriteConflictException);
+        }
+
+        // Aborting released the snapshot, so this read opens a new one from before the commit.
+        ASSERT_EQUALS("a", readRecord(second.get(), rs.get(), loc));
+        firstUow.commit();
+
+        {
+            WriteUnitOfWork secondUow(second.get());
+            ASSERT_THROWS(rs->deleteRecord(second.get(), loc), WriteConflictException);
+        }
+
+        // The retry runs on a snapshot that includes the first commit.
+        {
+            WriteUnitOfWork secondUow(second.get());
+            rs->deleteRecord(second.get(), loc);
+            secondUow.commit();
+        }
+        ASSERT_EQUALS(0, rs->numRecords(second.get()));
+    }
+
+    TEST(InMemoryMVCCRecordStore, IteratorRestoresAcrossSnapshots) {
+        InMemoryMVCCHarnessHelper harness;
+        scoped_ptr<RecordStore> rs(harness.newNonCappedRecordStore());
+
+        scoped_ptr<OperationContext> txn(harness.newOperationContext());
+        RecordId locs[4];
+        for (int i = 0; i < 4; i++) {
+            locs[i] = insertCommitted(txn.get(), rs.get(), "x");
+        }
+
+        scoped_ptr<OperationContext> reader(harness.newOperationContext());
+        scoped_ptr<RecordIterator> it(rs->getIterator(reader.get()));
+        ASSERT_EQUALS(locs[0], it->getNext());
+
+        it->saveState();
+        reader->recoveryUnit()->commitAndRestart();
+        {
+            WriteUnitOfWork uow(txn.get());
+            rs->deleteRecord(txn.get(), locs[1]);
+            uow.commit();
+        }
+        ASSERT(it->restoreState(reader.get()));
+
+        ASSERT_EQUALS(locs[2], it->getNext());
+        ASSERT_EQUALS(locs[3], it->getNext());
+        ASSERT(it->isEOF());
+    }
+
+    TEST(InMemoryMVCCRecordStore, MemoryLimit) {
+        InMemoryMVCCHarnessHelper harness(64 * 1024);
+        scoped_ptr<RecordStore> rs(harness.newNonCappedRecordStore());
+        scoped_ptr<OperationContext> txn(harness.newOperationContext());
+
+        const string data(1000, 'x');
+        std::vector<RecordId> locs;
+        for (;;) {
+            WriteUnitOfWork uow(txn.get());
+            StatusWith<RecordId> res = rs->insertRecord(txn.get(), data.c_str(), data.size(),
+                                                        false);
+            if (!res.isOK()) {
+                ASSERT_EQUALS(ErrorCodes::ExceededMemoryLimit, res.getStatus().code());
+                break;
+            }
+            locs.push_back(res.getValue());
+            uow.commit();
+            ASSERT_LESS_THAN(locs.size(), 1000U);
+        }
+
+        ASSERT_FALSE(locs.empty());
+        ASSERT_LESS_THAN_OR_EQUALS(harness.txnManager()->bytesInUse(), 64 * 1024);
+
+        // Deletes are never refused, and free enough memory for new inserts once collected.
+        for (size_t i = 0; i < locs.size(); i++) {
+            WriteUnitOfWork uow(txn.get());
+            rs->deleteRecord(txn.get(), locs[i]);
+            uow.commit();
+        }
+        txn->recoveryUnit()->commitAndRestart();
+
+        insertCommitted(txn.get(), rs.get(), data);
+    }
+
+    TEST(InMemoryMVCCRecordStore, GarbageOfIdleTablesCanBeCollected) {
+        InMemoryMVCCHarnessHelper harness;
+        const boost::shared_ptr<InMemoryMVCCTable> table = harness.newTable();
+        scoped_ptr<RecordStore> rs(new InMemoryMVCCRecordStore("a.b", table));
+        scoped_ptr<OperationContext> txn(harness.newOperationContext());
+
+        std::vector<RecordId> locs;
+        for (int i = 0; i < 1000; i++) {
+            locs.push_back(insertCommitted(txn.get(), rs.get(), "x"));
+        }
+
+        // A reader keeps the deleted records alive past the commit that deleted them.
+        scoped_ptr<OperationContext> reader(harness.newOperationContext());
+        ASSERT_EQUALS("x", readRecord(reader.get(), rs.get(), locs[0]));
+        {
+            WriteUnitOfWork uow(txn.get());
+            for (size_t i = 0; i < locs.size(); i++) {
+                rs->deleteRecord(txn.get(), locs[i]);
+            }
+            uow.commit();
+        }
+        reader->recoveryUnit()->commitAndRestart();
+
+        // Nothing writes to the table again, so only an explicit collection frees the records,
+        // and it takes more than one call.
+        ASSERT_GREATER_THAN(table->bytesInUse(), 0);
+        const uint64_t oldest = harness.txnManager()->oldestActiveSnapshot();
+        ASSERT_TRUE(table->collectGarbage(oldest));
+        while (table->collectGarbage(oldest)) {
+        }
+        ASSERT_EQUALS(0, table->bytesInUse());
+        ASSERT_EQUALS(0, harness.txnManager()->bytesInUse());
+    }
+
+    TEST(InMemoryMVCCRecordStore, CappedDeletesOldest) {
+        InMemoryMVCCHarnessHelper harness;
+        scoped_ptr<RecordStore> rs(harness.newCappedRecordStore(100000, 3));
+        scoped_ptr<OperationContext> txn(harness.newOperationContext());
+
+        RecordId locs[5];
+        for (int i = 0; i < 5; i++) {
+            locs[i] = insertCommitted(txn.get(), rs.get(), "x");
+        }
+
+        ASSERT_EQUALS(3, rs->numRecords(txn.get()));
+        scoped_ptr<RecordIterator> it(rs->getIterator(txn.get()));
+        ASSERT_EQUALS(locs[2], it->getNext());
+        ASSERT_EQUALS(locs[3], it->getNext());
+        ASSERT_EQUALS(locs[4], it->getNext());
+        ASSERT(it->isEOF());
+    }
+
+    TEST(InMemoryMVCCRecordStore, CappedHidesUncommittedInserts) {
+        InMemoryMVCCHarnessHelper harness;
+        scoped_ptr<RecordStore> rs(harness.newCappedRecordStore(100000, -1));
+
+        scoped_ptr<OperationContext> first(harness.newOperationContext());
+        scoped_ptr<OperationContext> second(harness.newOperationContext());
+        scoped_ptr<OperationContext> reader(harness.newOperationContext());
+
+        const RecordId visible = insertCommitted(first.get(), rs.get(), "a");
+
+        WriteUnitOfWork firstUow(first.get());
+        ASSERT_OK(rs->insertRecord(first.get(), "b", 2, false).getStatus());
+
+        // Commits behind an uncommitted insert stay hidden until it is resolved.
+        const RecordId later = insertCommitted(second.get(), rs.get(), "c");
+        {
+            scoped_ptr<RecordIterator> it(rs->getIterator(reader.get()));
+            ASSERT_EQUALS(visible, it->getNext());
+            ASSERT(it->isEOF());
+        }
+
+        firstUow.commit();
+        reader->recoveryUnit()->commitAndRestart();
+        {
+            scoped_ptr<RecordIterator> it(rs->getIterator(reader.get()));
+            ASSERT_EQUALS(visible, it->getNext());
+            ASSERT(!it->isEOF());
+            it->getNext();
+            ASSERT_EQUALS(later, it->getNext());
+            ASSERT(it->isEOF());
+        }
+    }
+
+}  // namespace mongo
@@ -0,0 +1,197 @@
+// in_memory_mvcc_recovery_unit.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_recovery_unit.h"
+
+#include <algorithm>
+
+#include "mongo/base/checked_cast.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_table.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    InMemoryMVCCRecoveryUnit::InMemoryMVCCRecoveryUnit(InMemoryMVCCTxnManager* txnManager)
+        : _txnManager(txnManager),
+          _depth(0),
+          _hasSnapshot(false),
+          _snapshot(0),
+          _txnId(0),
+          _mySnapshotCount(1) {
+    }
+
+    InMemoryMVCCRecoveryUnit::~InMemoryMVCCRecoveryUnit() {
+        invariant(_depth == 0);
+        invariant(_writes.empty());
+        _closeTxn();
+    }
+
+    void InMemoryMVCCRecoveryUnit::reportState(BSONObjBuilder* b) const {
+        b->append("inMemory_depth", _depth);
+        b->append("inMemory_hasSnapshot", _hasSnapshot);
+        if (_hasSnapshot)
+            b->appendNumber("inMemory_snapshot", static_cast<long long>(_snapshot));
+        b->appendNumber("inMemory_pendingWrites", static_cast<long long>(_writes.size()));
+    }
+
+    InMemoryMVCCRecoveryUnit* InMemoryMVCCRecoveryUnit::get(OperationContext* txn) {
+        invariant(txn);
+        return checked_cast<InMemoryMVCCRecoveryUnit*>(txn->recoveryUnit());
+    }
+
+    void InMemoryMVCCRecoveryUnit::beginUnitOfWork(OperationContext* opCtx) {
+        _depth++;
+    }
+
+    void InMemoryMVCCRecoveryUnit::commitUnitOfWork() {
+        if (_depth > 1)
+            return; // only outermost WUOW gets committed.
+        _commit();
+    }
+
+    void InMemoryMVCCRecoveryUnit::endUnitOfWork() {
+        _depth--;
+        if (_depth == 0)
+            _abort();
+    }
+
+    void InMemoryMVCCRecoveryUnit::commitAndRestart() {
+        invariant(_depth == 0);
+        invariant(_writes.empty());
+        _closeTxn();
+    }
+
+    void InMemoryMVCCRecoveryUnit::registerChange(Change* change) {
+        invariant(_depth > 0);
+        _changes.push_back(ChangePtr(change));
+    }
+
+    uint64_t InMemoryMVCCRecoveryUnit::getSnapshot() {
+        if (!_hasSnapshot) {
+            _snapshot = _txnManager->openSnapshot();
+            _hasSnapshot = true;
+        }
+        return _snapshot;
+    }
+
+    uint64_t InMemoryMVCCRecoveryUnit::getTxnId() {
+        if (!_txnId)
+            _txnId = _txnManager->newTxnId();
+        return _txnId;
+    }
+
+    void InMemoryMVCCRecoveryUnit::registerWrite(const boost::shared_ptr<InMemoryMVCCTable>& table,
+                                                 StringData key,
+                                                 InMemoryMVCCVersion* version) {
+        invariant(_depth > 0);
+        InMemoryMVCCWrite write;
+        write.table = table;
+        write.key = key.toString();
+        write.version = version;
+        _writes.push_back(write);
+    }
+
+    void InMemoryMVCCRecoveryUnit::_commit() {
+        try {
+            std::vector<boost::shared_ptr<InMemoryMVCCTable> > touched;
+            if (!_writes.empty()) {
+                _txnManager->commit(_writes);
+                for (InMemoryMVCCWriteSet::const_iterator it = _writes.begin();
+                        it != _writes.end(); ++it) {
+                    if (touched.empty() || touched.back() != it->table)
+                        touched.push_back(it->table);
+                }
+                _writes.clear();
+            }
+
+            for (Changes::iterator it = _changes.begin(), end = _changes.end(); it != end; ++it) {
+                (*it)->commit();
+            }
+            _changes.clear();
+
+            _closeTxn();
+
+            // Our own snapshot is gone now, so it no longer holds back garbage collection.
+            if (!touched.empty()) {
+                std::sort(touched.begin(), touched.end());
+                touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+                const uint64_t oldest = _txnManager->oldestActiveSnapshot();
+                for (size_t i = 0; i < touched.size(); i++) {
+                    touched[i]->collectGarbage(oldest);
+                }
+            }
+        }
+        catch (...) {
+            std::terminate();
+        }
+    }
+
+    void InMemoryMVCCRecoveryUnit::_abort() {
+        try {
+            if (!_writes.empty()) {
+                for (InMemoryMVCCWriteSet::reverse_iterator it = _writes.rbegin();
+                        it != _writes.rend(); ++it) {
+                    it->table->rollback(*it);
+                }
+                _writes.clear();
+                _txnManager->noteRollback();
+            }
+
+            for (Changes::reverse_iterator it = _changes.rbegin(), end = _changes.rend();
+                    it != end; ++it) {
+                ChangePtr change = *it;
+                LOG(2) << "CUSTOM ROLLBACK " << demangleName(typeid(*change));
+                change->rollback();
+            }
+            _changes.clear();
+
+            _closeTxn();
+        }
+        catch (...) {
+            std::terminate();
+        }
+    }
+
+    void InMemoryMVCCRecoveryUnit::_closeTxn() {
+        if (_hasSnapshot) {
+            _txnManager->closeSnapshot(_snapshot);
+            _hasSnapshot = false;
+            _mySnapshotCount++;
+        }
+        _txnId = 0;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,129 @@
+// in_memory_mvcc_recovery_unit.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+#include "mongo/base/string_data.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_txn_manager.h"
+#include "mongo/db/storage/recovery_unit.h"
+
+namespace mongo {
+
+    class OperationContext;
+
+    /**
+     * The transaction of one operation against the MVCC in-memory engine.
+     *
+     * A snapshot is opened on the first read or write and held until the unit of work commits or
+     * rolls back, or until commitAndRestart() for reads outside of one, which is where queries
+     * yield. Writes go straight into the tables as versions owned by this transaction and are
+     * stamped or unlinked when it ends.
+     */
+    class InMemoryMVCCRecoveryUnit : public RecoveryUnit {
+    public:
+        explicit InMemoryMVCCRecoveryUnit(InMemoryMVCCTxnManager* txnManager);
+        virtual ~InMemoryMVCCRecoveryUnit();
+
+        virtual void reportState(BSONObjBuilder* b) const;
+
+        virtual void beginUnitOfWork(OperationContext* opCtx);
+        virtual void commitUnitOfWork();
+        virtual void endUnitOfWork();
+
+        virtual bool awaitCommit() {
+            return true;
+        }
+
+        virtual void commitAndRestart();
+
+        virtual void registerChange(Change* change);
+
+        virtual void* writingPtr(void* data, size_t len) {
+            invariant(!"don't call writingPtr");
+        }
+
+        virtual void setRollbackWritesDisabled() {}
+
+        virtual SnapshotId getSnapshotId() const {
+            return SnapshotId(_mySnapshotCount);
+        }
+
+        static InMemoryMVCCRecoveryUnit* get(OperationContext* txn);
+
+        /**
+         * The timestamp this transaction reads at. Opens the snapshot if needed.
+         */
+        uint64_t getSnapshot();
+
+        /**
+         * The id that marks this transaction's uncommitted versions. Allocated on first use.
+         */
+        uint64_t getTxnId();
+
+        /**
+         * Like getTxnId() but returns 0 rather than allocating, for readers.
+         */
+        uint64_t peekTxnId() const { return _txnId; }
+
+        /**
+         * Called by InMemoryMVCCTable for each new version written by this transaction.
+         */
+        void registerWrite(const boost::shared_ptr<InMemoryMVCCTable>& table,
+                           StringData key,
+                           InMemoryMVCCVersion* version);
+
+    private:
+        typedef boost::shared_ptr<Change> ChangePtr;
+        typedef std::vector<ChangePtr> Changes;
+
+        void _commit();
+        void _abort();
+
+        // Releases the snapshot and forgets the transaction id.
+        void _closeTxn();
+
+        InMemoryMVCCTxnManager* const _txnManager;
+
+        int _depth;
+        bool _hasSnapshot;
+        uint64_t _snapshot;
+        uint64_t _txnId;
+
+        // Bumped every time the snapshot is released. Starts at 1 since 0 is the null SnapshotId.
+        uint64_t _mySnapshotCount;
+
+        InMemoryMVCCWriteSet _writes;
+        Changes _changes;
+    };
+
+}  // namespace mongo
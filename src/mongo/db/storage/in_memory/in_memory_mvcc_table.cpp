@@ -0,0 +1,420 @@
+// in_memory_mvcc_table.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_table.h"
+
+#include <boost/thread/locks.hpp>
+#include <cstring>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_recovery_unit.h"
+
+namespace mongo {
+
+namespace {
+
+    // Caps the work collectGarbage() does per call.
+    const size_t kMaxKeysPerCollection = 256;
+
+} // namespace
+
+    InMemoryMVCCTable::InMemoryMVCCTable(InMemoryMVCCTxnManager* txnManager)
+        : _txnManager(txnManager),
+          _numVersions(0) {
+    }
+
+    InMemoryMVCCTable::~InMemoryMVCCTable() {
+        // Nothing can be uncommitted here since every write set holds a reference to its tables.
+        for (Tree::iterator it = _tree.begin(); it != _tree.end(); _tree.advance(&it)) {
+            InMemoryMVCCVersion* version = it.value();
+            while (version) {
+                InMemoryMVCCVersion* older = version->older;
+                invariant(version->txnId == 0);
+                delete version;
+                version = older;
+            }
+        }
+        _txnManager->release(_bytesInUse.load());
+    }
+
+    const InMemoryMVCCVersion* InMemoryMVCCTable::_visible(const InMemoryMVCCVersion* head,
+                                                           uint64_t snapshot,
+                                                           uint64_t txnId) {
+        for (const InMemoryMVCCVersion* version = head; version; version = version->older) {
+            if (version->txnId) {
+                // Only the newest version can be uncommitted.
+                if (txnId && version->txnId == txnId)
+                    return version;
+            }
+            else if (version->ts <= snapshot) {
+                return version;
+            }
+        }
+        return NULL;
+    }
+
+    bool InMemoryMVCCTable::get(InMemoryMVCCRecoveryUnit* ru,
+                                StringData key,
+                                RecordData* out) const {
+        const uint64_t snapshot = ru->getSnapshot();
+        const uint64_t txnId = ru->peekTxnId();
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        const Tree::iterator it = _tree.find(key);
+        if (it == _tree.end())
+            return false;
+
+        const InMemoryMVCCVersion* version = _visible(it.value(), snapshot, txnId);
+        if (!version || version->deleted)
+            return false;
+
+        *out = RecordData(version->data, version->size);
+        return true;
+    }
+
+    Status InMemoryMVCCTable::put(InMemoryMVCCRecoveryUnit* ru,
+                                  StringData key,
+                                  const char* data,
+                                  int size) {
+        bool wrote;
+        return _write(ru, key, data, size, false, &wrote);
+    }
+
+    bool InMemoryMVCCTable::remove(InMemoryMVCCRecoveryUnit* ru, StringData key) {
+        bool wrote;
+        const Status status = _write(ru, key, NULL, 0, true, &wrote);
+        invariant(status.isOK()); // deletes are never refused for lack of memory
+        return wrote;
+    }
+
+    Status InMemoryMVCCTable::_write(InMemoryMVCCRecoveryUnit* ru,
+                                     StringData key,
+                                     const char* data,
+                                     int size,
+                                     bool isDelete,
+                                     bool* wrote) {
+        *wrote = false;
+
+        // Open the snapshot before taking _mutex; the txn manager's mutex is always acquired
+        // first.
+        const uint64_t snapshot = ru->getSnapshot();
+        const uint64_t txnId = ru->getTxnId();
+
+        SharedBuffer buffer;
+        if (!isDelete) {
+            buffer = SharedBuffer::allocate(size);
+            if (size)
+                memcpy(buffer.get(), data, size);
+        }
+        else {
+            size = 0;
+        }
+
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        Tree::iterator it = _tree.find(key);
+        InMemoryMVCCVersion* head = it == _tree.end() ? NULL : it.value();
+
+        if (head && (head->txnId ? head->txnId != txnId : head->ts > snapshot)) {
+            _txnManager->noteWriteConflict();
+            throw WriteConflictException();
+        }
+
+        if (isDelete) {
+            const InMemoryMVCCVersion* visible = _visible(head, snapshot, txnId);
+            if (!visible || visible->deleted)
+                return Status::OK();
+        }
+
+        if (head && head->txnId == txnId) {
+            // This transaction already wrote the key, so its version can be replaced in place.
+            const int64_t delta = static_cast<int64_t>(size) - head->size;
+            if (delta > 0) {
+                Status status = _reserve(delta);
+                if (!status.isOK())
+                    return status;
+            }
+            else {
+                _release(-delta);
+            }
+
+            head->data = std::move(buffer);
+            head->size = size;
+            head->deleted = isDelete;
+            *wrote = true;
+            return Status::OK();
+        }
+
+        const int64_t bytes = _versionBytes(size) + (head ? 0 : _keyBytes(key.size()));
+        if (isDelete) {
+            _forceReserve(bytes);
+        }
+        else {
+            Status status = _reserve(bytes);
+            if (!status.isOK())
+                return status;
+        }
+
+        InMemoryMVCCVersion* version =
+            new InMemoryMVCCVersion(txnId, isDelete, std::move(buffer), size, head);
+        if (head) {
+            it.value() = version;
+        }
+        else {
+            _tree.insert(key, version);
+        }
+        _numVersions++;
+
+        ru->registerWrite(shared_from_this(), key, version);
+        *wrote = true;
+        return Status::OK();
+    }
+
+    bool InMemoryMVCCTable::lastKey(std::string* out) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        const Tree::iterator it = _tree.last();
+        if (it == _tree.end())
+            return false;
+        *out = it.key();
+        return true;
+    }
+
+    void InMemoryMVCCTable::stampCommitted(InMemoryMVCCWriteSet::const_iterator begin,
+                                           InMemoryMVCCWriteSet::const_iterator end,
+                                           uint64_t ts) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        for (InMemoryMVCCWriteSet::const_iterator it = begin; it != end; ++it) {
+            InMemoryMVCCVersion* version = it->version;
+            invariant(version->txnId);
+            version->txnId = 0;
+            version->ts = ts;
+            if (version->older || version->deleted)
+                _gcQueue.push_back(std::make_pair(ts, it->key));
+        }
+    }
+
+    void InMemoryMVCCTable::rollback(const InMemoryMVCCWrite& write) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        Tree::iterator it = _tree.find(write.key);
+        invariant(it != _tree.end());
+        invariant(it.value() == write.version);
+
+        it.value() = write.version->older;
+        _freeVersion_inlock(write.version);
+        if (!it.value())
+            _eraseKey_inlock(it);
+    }
+
+    bool InMemoryMVCCTable::collectGarbage(uint64_t oldestSnapshot) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        for (size_t i = 0; i < kMaxKeysPerCollection; i++) {
+            if (_gcQueue.empty() || _gcQueue.front().first > oldestSnapshot)
+                return false;
+
+            const Tree::iterator it = _tree.find(_gcQueue.front().second);
+            if (it != _tree.end())
+                _prune_inlock(it, oldestSnapshot);
+            _gcQueue.pop_front();
+        }
+        return !_gcQueue.empty() && _gcQueue.front().first <= oldestSnapshot;
+    }
+
+    void InMemoryMVCCTable::_prune_inlock(Tree::iterator it, uint64_t oldestSnapshot) {
+        // Find the newest version every open snapshot can see.
+        InMemoryMVCCVersion* newer = NULL;
+        InMemoryMVCCVersion* base = it.value();
+        while (base && (base->txnId || base->ts > oldestSnapshot)) {
+            newer = base;
+            base = base->older;
+        }
+        if (!base)
+            return;
+
+        // Nothing older than it can be read by anyone.
+        InMemoryMVCCVersion* older = base->older;
+        base->older = NULL;
+        while (older) {
+            InMemoryMVCCVersion* next = older->older;
+            _freeVersion_inlock(older);
+            older = next;
+        }
+
+        if (!base->deleted)
+            return;
+
+        // A tombstone at the end of the chain reads the same as no version at all.
+        _freeVersion_inlock(base);
+        if (newer) {
+            newer->older = NULL;
+        }
+        else {
+            _eraseKey_inlock(it);
+        }
+    }
+
+    void InMemoryMVCCTable::_freeVersion_inlock(InMemoryMVCCVersion* version) {
+        _release(_versionBytes(version->size));
+        _numVersions--;
+        delete version;
+    }
+
+    void InMemoryMVCCTable::_eraseKey_inlock(Tree::iterator it) {
+        _release(_keyBytes(it.key().size()));
+        _tree.erase(it);
+    }
+
+    Status InMemoryMVCCTable::_reserve(int64_t bytes) {
+        Status status = _txnManager->reserve(bytes);
+        if (status.isOK())
+            _bytesInUse.fetchAndAdd(bytes);
+        return status;
+    }
+
+    void InMemoryMVCCTable::_forceReserve(int64_t bytes) {
+        _txnManager->forceReserve(bytes);
+        _bytesInUse.fetchAndAdd(bytes);
+    }
+
+    void InMemoryMVCCTable::_release(int64_t bytes) {
+        _txnManager->release(bytes);
+        _bytesInUse.fetchAndSubtract(bytes);
+    }
+
+    void InMemoryMVCCTable::adjustRecordCounts(long long numRecordsDelta,
+                                               long long dataSizeDelta) {
+        _numRecords.fetchAndAdd(numRecordsDelta);
+        _dataSize.fetchAndAdd(dataSizeDelta);
+    }
+
+    void InMemoryMVCCTable::setRecordCounts(long long numRecords, long long dataSize) {
+        _numRecords.store(numRecords);
+        _dataSize.store(dataSize);
+    }
+
+    void InMemoryMVCCTable::appendStats(BSONObjBuilder* builder) const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        builder->appendNumber("keys", static_cast<long long>(_tree.size()));
+        builder->appendNumber("versions", _numVersions);
+        builder->appendNumber("treeNodes", static_cast<long long>(_tree.numNodes()));
+        builder->appendNumber("pendingGarbage", static_cast<long long>(_gcQueue.size()));
+        builder->appendNumber("bytesInUse", _bytesInUse.load());
+    }
+
+    //
+    // Cursor
+    //
+
+    InMemoryMVCCTable::Cursor::Cursor(const InMemoryMVCCTable* table, bool forward)
+        : _table(table),
+          _forward(forward),
+          _eof(true),
+          _treeVersion(0) {
+    }
+
+    void InMemoryMVCCTable::Cursor::_step(Tree::iterator* it) const {
+        if (_forward)
+            _table->_tree.advance(it);
+        else
+            _table->_tree.retreat(it);
+    }
+
+    bool InMemoryMVCCTable::Cursor::seek(InMemoryMVCCRecoveryUnit* ru, StringData key) {
+        const uint64_t snapshot = ru->getSnapshot();
+        const uint64_t txnId = ru->peekTxnId();
+
+        boost::lock_guard<boost::mutex> lk(_table->_mutex);
+        Tree::iterator it;
+        if (_forward) {
+            it = _table->_tree.lowerBound(key);
+        }
+        else {
+            it = _table->_tree.upperBound(key);
+            _table->_tree.retreat(&it);
+        }
+        return _scanFrom_inlock(it, snapshot, txnId);
+    }
+
+    bool InMemoryMVCCTable::Cursor::seekToStart(InMemoryMVCCRecoveryUnit* ru) {
+        const uint64_t snapshot = ru->getSnapshot();
+        const uint64_t txnId = ru->peekTxnId();
+
+        boost::lock_guard<boost::mutex> lk(_table->_mutex);
+        return _scanFrom_inlock(_forward ? _table->_tree.begin() : _table->_tree.last(),
+                                snapshot,
+                                txnId);
+    }
+
+    bool InMemoryMVCCTable::Cursor::next(InMemoryMVCCRecoveryUnit* ru) {
+        if (_eof)
+            return false;
+
+        const uint64_t snapshot = ru->getSnapshot();
+        const uint64_t txnId = ru->peekTxnId();
+
+        boost::lock_guard<boost::mutex> lk(_table->_mutex);
+        Tree::iterator it;
+        if (_treeVersion == _table->_tree.getVersion()) {
+            it = _it;
+            _step(&it);
+        }
+        else if (_forward) {
+            it = _table->_tree.upperBound(_key);
+        }
+        else {
+            it = _table->_tree.lowerBound(_key);
+            _table->_tree.retreat(&it);
+        }
+        return _scanFrom_inlock(it, snapshot, txnId);
+    }
+
+    bool InMemoryMVCCTable::Cursor::_scanFrom_inlock(Tree::iterator it,
+                                                     uint64_t snapshot,
+                                                     uint64_t txnId) {
+        for (; it != _table->_tree.end(); _step(&it)) {
+            const InMemoryMVCCVersion* version = _visible(it.value(), snapshot, txnId);
+            if (!version || version->deleted)
+                continue;
+
+            _eof = false;
+            _key = it.key();
+            _value = RecordData(version->data, version->size);
+            _it = it;
+            _treeVersion = _table->_tree.getVersion();
+            return true;
+        }
+
+        _eof = true;
+        _value = RecordData();
+        return false;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,260 @@
+// in_memory_mvcc_table.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/base/string_data.h"
+#include "mongo/db/storage/in_memory/in_memory_bplus_tree.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_txn_manager.h"
+#include "mongo/db/storage/record_data.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/shared_buffer.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+    class InMemoryMVCCRecoveryUnit;
+
+    /**
+     * One version of the value stored under a key.
+     */
+    struct InMemoryMVCCVersion {
+        InMemoryMVCCVersion(uint64_t txnId,
+                            bool deleted,
+                            SharedBuffer data,
+                            int size,
+                            InMemoryMVCCVersion* older)
+            : txnId(txnId),
+              ts(0),
+              deleted(deleted),
+              size(size),
+              data(std::move(data)),
+              older(older) {
+        }
+
+        // The transaction that wrote this version while it is uncommitted, 0 once committed.
+        uint64_t txnId;
+
+        // The commit timestamp. Only meaningful once txnId is 0.
+        uint64_t ts;
+
+        // Tombstones record deletes so that older snapshots still see the deleted value.
+        bool deleted;
+
+        int size;
+        SharedBuffer data;
+
+        InMemoryMVCCVersion* older;
+    };
+
+    /**
+     * A multi-version ordered key/value table, the storage behind every record store and index of
+     * the MVCC in-memory engine.
+     *
+     * Each key maps to a chain of versions, newest first. A version starts out owned by the
+     * transaction that wrote it and is stamped with a commit timestamp when that transaction
+     * commits. A reader whose snapshot is at T sees its own uncommitted version of a key if it has
+     * one, and otherwise the newest version committed at or before T.
+     *
+     * Writers follow first-writer-wins: writing a key whose newest version belongs to another
+     * open transaction, or was committed after the writer's snapshot, throws
+     * WriteConflictException. That gives snapshot isolation at the granularity of a key. _mutex
+     * only protects the tree for the duration of a single call.
+     *
+     * Versions that no snapshot can see anymore are freed by collectGarbage(), which works through
+     * the keys queued up by commits once the oldest open snapshot has moved past them. Commits
+     * collect a little on the tables they touched, and the engine sweeps every table in the
+     * background so that garbage left on tables nobody writes to anymore is freed as well.
+     */
+    class InMemoryMVCCTable : public boost::enable_shared_from_this<InMemoryMVCCTable> {
+        MONGO_DISALLOW_COPYING(InMemoryMVCCTable);
+
+        typedef InMemoryBPlusTree<InMemoryMVCCVersion*> Tree;
+
+    public:
+        explicit InMemoryMVCCTable(InMemoryMVCCTxnManager* txnManager);
+        ~InMemoryMVCCTable();
+
+        /**
+         * Returns false if 'key' has no value visible to 'ru'. The returned data owns a reference
+         * to the version's buffer and stays valid after the version is gone.
+         */
+        bool get(InMemoryMVCCRecoveryUnit* ru, StringData key, RecordData* out) const;
+
+        /**
+         * Inserts or overwrites 'key' as part of the transaction in 'ru'. Throws
+         * WriteConflictException as described above and returns ExceededMemoryLimit if the engine
+         * is full.
+         */
+        Status put(InMemoryMVCCRecoveryUnit* ru, StringData key, const char* data, int size);
+
+        /**
+         * Deletes 'key' as part of the transaction in 'ru'. Returns false, writing nothing, if the
+         * key has no value visible to 'ru'. Throws WriteConflictException like put().
+         */
+        bool remove(InMemoryMVCCRecoveryUnit* ru, StringData key);
+
+        /**
+         * The largest key present in any version, committed or not. Returns false if the table
+         * is empty. Used to seed RecordId allocation.
+         */
+        bool lastKey(std::string* out) const;
+
+        //
+        // Called by InMemoryMVCCTxnManager and InMemoryMVCCRecoveryUnit when a transaction ends.
+        //
+
+        void stampCommitted(InMemoryMVCCWriteSet::const_iterator begin,
+                            InMemoryMVCCWriteSet::const_iterator end,
+                            uint64_t ts);
+
+        void rollback(const InMemoryMVCCWrite& write);
+
+        /**
+         * Frees versions of queued keys that are hidden from every snapshot at or after
+         * 'oldestSnapshot'. Bounded so a single commit never pays for a large backlog. Returns
+         * true if the bound cut it short, in which case calling it again frees more.
+         */
+        bool collectGarbage(uint64_t oldestSnapshot);
+
+        //
+        // Counters kept on behalf of the record store using this table, so that they outlive
+        // any one RecordStore object.
+        //
+
+        long long numRecords() const { return _numRecords.load(); }
+        long long dataSize() const { return _dataSize.load(); }
+        void adjustRecordCounts(long long numRecordsDelta, long long dataSizeDelta);
+        void setRecordCounts(long long numRecords, long long dataSize);
+
+        long long bytesInUse() const { return _bytesInUse.load(); }
+
+        void appendStats(BSONObjBuilder* builder) const;
+
+        /**
+         * Iterates over the keys visible to a transaction. The cursor keeps its tree position
+         * between calls while the tree does not change shape and otherwise seeks again from the
+         * last key it returned, so it survives concurrent writes, yields and snapshot changes.
+         */
+        class Cursor {
+        public:
+            Cursor(const InMemoryMVCCTable* table, bool forward);
+
+            /**
+             * Positions on the first visible key at or after 'key' in the cursor's direction.
+             * Returns false if there is none.
+             */
+            bool seek(InMemoryMVCCRecoveryUnit* ru, StringData key);
+
+            /**
+             * Positions on the first visible key in the cursor's direction.
+             */
+            bool seekToStart(InMemoryMVCCRecoveryUnit* ru);
+
+            /**
+             * Moves to the next visible key after the current one.
+             */
+            bool next(InMemoryMVCCRecoveryUnit* ru);
+
+            bool isEOF() const { return _eof; }
+
+            const std::string& key() const { return _key; }
+
+            const RecordData& value() const { return _value; }
+
+        private:
+            void _step(Tree::iterator* it) const;
+
+            // Positions on the first visible entry starting at 'it'. Caller holds the table mutex.
+            bool _scanFrom_inlock(Tree::iterator it, uint64_t snapshot, uint64_t txnId);
+
+            const InMemoryMVCCTable* const _table;
+            const bool _forward;
+
+            bool _eof;
+            std::string _key;
+            RecordData _value;
+
+            Tree::iterator _it;
+            unsigned long long _treeVersion;
+        };
+
+    private:
+        static const InMemoryMVCCVersion* _visible(const InMemoryMVCCVersion* head,
+                                                   uint64_t snapshot,
+                                                   uint64_t txnId);
+
+        Status _write(InMemoryMVCCRecoveryUnit* ru,
+                      StringData key,
+                      const char* data,
+                      int size,
+                      bool isDelete,
+                      bool* wrote);
+
+        Status _reserve(int64_t bytes);
+        void _forceReserve(int64_t bytes);
+        void _release(int64_t bytes);
+
+        void _prune_inlock(Tree::iterator it, uint64_t oldestSnapshot);
+        void _freeVersion_inlock(InMemoryMVCCVersion* version);
+        void _eraseKey_inlock(Tree::iterator it);
+
+        static int64_t _versionBytes(int size) {
+            return sizeof(InMemoryMVCCVersion) + size;
+        }
+
+        static int64_t _keyBytes(size_t keySize) {
+            return sizeof(std::string) + sizeof(InMemoryMVCCVersion*) + keySize;
+        }
+
+        InMemoryMVCCTxnManager* const _txnManager;
+
+        mutable boost::mutex _mutex;
+        Tree _tree;
+        long long _numVersions;
+
+        // (commit timestamp, key) of committed writes that left an older version or a tombstone
+        // behind.
+        std::deque<std::pair<uint64_t, std::string> > _gcQueue;
+
+        AtomicInt64 _bytesInUse;
+        AtomicInt64 _numRecords;
+        AtomicInt64 _dataSize;
+    };
+
+}  // namespace mongo
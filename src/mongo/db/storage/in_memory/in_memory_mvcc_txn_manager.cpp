@@ -0,0 +1,127 @@
+// in_memory_mvcc_txn_manager.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/in_memory/in_memory_mvcc_txn_manager.h"
+
+#include <boost/thread/locks.hpp>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/storage/in_memory/in_memory_mvcc_table.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    InMemoryMVCCTxnManager::InMemoryMVCCTxnManager(int64_t maxBytes)
+        : _maxBytes(maxBytes),
+          _lastCommitted(0),
+          _nextTxnId(1) {
+    }
+
+    uint64_t InMemoryMVCCTxnManager::openSnapshot() {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        _activeSnapshots.insert(_lastCommitted);
+        return _lastCommitted;
+    }
+
+    void InMemoryMVCCTxnManager::closeSnapshot(uint64_t snapshot) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        std::multiset<uint64_t>::iterator it = _activeSnapshots.find(snapshot);
+        invariant(it != _activeSnapshots.end());
+        _activeSnapshots.erase(it);
+    }
+
+    uint64_t InMemoryMVCCTxnManager::oldestActiveSnapshot() const {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        return _activeSnapshots.empty() ? _lastCommitted : *_activeSnapshots.begin();
+    }
+
+    uint64_t InMemoryMVCCTxnManager::commit(const InMemoryMVCCWriteSet& writes) {
+        boost::lock_guard<boost::mutex> lk(_mutex);
+        const uint64_t ts = _lastCommitted + 1;
+
+        // Writes to the same table are usually adjacent, so stamp them in runs to take each
+        // table's mutex once per run.
+        InMemoryMVCCWriteSet::const_iterator runStart = writes.begin();
+        while (runStart != writes.end()) {
+            InMemoryMVCCWriteSet::const_iterator runEnd = runStart;
+            while (runEnd != writes.end() && runEnd->table == runStart->table) {
+                ++runEnd;
+            }
+            runStart->table->stampCommitted(runStart, runEnd, ts);
+            runStart = runEnd;
+        }
+
+        _lastCommitted = ts;
+        _commits.fetchAndAdd(1);
+        return ts;
+    }
+
+    Status InMemoryMVCCTxnManager::reserve(int64_t bytes) {
+        const int64_t inUse = _bytesInUse.fetchAndAdd(bytes) + bytes;
+        if (_maxBytes && bytes > 0 && inUse > _maxBytes) {
+            _bytesInUse.fetchAndSubtract(bytes);
+            _memoryLimitRejections.fetchAndAdd(1);
+            return Status(ErrorCodes::ExceededMemoryLimit,
+                          str::stream() << "in-memory storage engine is full: "
+                                        << inUse - bytes << " bytes in use, limit is "
+                                        << _maxBytes);
+        }
+        return Status::OK();
+    }
+
+    void InMemoryMVCCTxnManager::appendStats(BSONObjBuilder* builder) const {
+        uint64_t lastCommitted;
+        uint64_t oldestSnapshot;
+        size_t activeSnapshots;
+        {
+            boost::lock_guard<boost::mutex> lk(_mutex);
+            lastCommitted = _lastCommitted;
+            activeSnapshots = _activeSnapshots.size();
+            oldestSnapshot = _activeSnapshots.empty() ? _lastCommitted
+                                                      : *_activeSnapshots.begin();
+        }
+
+        builder->appendNumber("bytesInUse", static_cast<long long>(_bytesInUse.load()));
+        builder->appendNumber("maxBytes", static_cast<long long>(_maxBytes));
+        builder->appendNumber("activeSnapshots", static_cast<long long>(activeSnapshots));
+        // How many commits the oldest open snapshot is behind. Versions newer than it are kept
+        // alive for its sake.
+        builder->appendNumber("oldestSnapshotLag",
+                              static_cast<long long>(lastCommitted - oldestSnapshot));
+        builder->appendNumber("commits", static_cast<long long>(_commits.load()));
+        builder->appendNumber("rollbacks", static_cast<long long>(_rollbacks.load()));
+        builder->appendNumber("writeConflicts", static_cast<long long>(_writeConflicts.load()));
+        builder->appendNumber("memoryLimitRejections",
+                              static_cast<long long>(_memoryLimitRejections.load()));
+    }
+
+}  // namespace mongo
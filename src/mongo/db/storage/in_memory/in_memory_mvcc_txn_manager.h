@@ -0,0 +1,136 @@
+// in_memory_mvcc_txn_manager.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+    class InMemoryMVCCTable;
+    struct InMemoryMVCCVersion;
+
+    /**
+     * A key written by a transaction that has not finished yet.
+     */
+    struct InMemoryMVCCWrite {
+        boost::shared_ptr<InMemoryMVCCTable> table;
+        std::string key;
+        InMemoryMVCCVersion* version;
+    };
+
+    typedef std::vector<InMemoryMVCCWrite> InMemoryMVCCWriteSet;
+
+    /**
+     * Engine-wide state of the MVCC in-memory engine: the commit clock, the open snapshots and
+     * the memory accounting.
+     *
+     * Timestamps come from a logical counter. A snapshot taken at T sees exactly the transactions
+     * that committed at or before T. Commits are serialized on _mutex, which is also where
+     * snapshots read the clock, so no snapshot can observe half of a transaction.
+     */
+    class InMemoryMVCCTxnManager {
+        MONGO_DISALLOW_COPYING(InMemoryMVCCTxnManager);
+    public:
+        /**
+         * 'maxBytes' bounds the memory held by the keys and versions of all tables. 0 means no
+         * limit.
+         */
+        explicit InMemoryMVCCTxnManager(int64_t maxBytes);
+
+        uint64_t openSnapshot();
+
+        void closeSnapshot(uint64_t snapshot);
+
+        /**
+         * Every open snapshot can see the newest version committed at or before this timestamp,
+         * so anything older than that version can be freed.
+         */
+        uint64_t oldestActiveSnapshot() const;
+
+        uint64_t newTxnId() { return _nextTxnId.fetchAndAdd(1); }
+
+        /**
+         * Stamps 'writes' with the next commit timestamp, which makes them visible to snapshots
+         * opened from then on. Returns the commit timestamp.
+         */
+        uint64_t commit(const InMemoryMVCCWriteSet& writes);
+
+        void noteRollback() { _rollbacks.fetchAndAdd(1); }
+
+        void noteWriteConflict() { _writeConflicts.fetchAndAdd(1); }
+
+        /**
+         * Accounts for 'bytes' of new data, or returns ExceededMemoryLimit without accounting
+         * anything if that would take the engine over its limit.
+         */
+        Status reserve(int64_t bytes);
+
+        /**
+         * Like reserve() but never fails. Deletes use this so they can always make progress on a
+         * full engine.
+         */
+        void forceReserve(int64_t bytes) { _bytesInUse.fetchAndAdd(bytes); }
+
+        void release(int64_t bytes) { _bytesInUse.fetchAndSubtract(bytes); }
+
+        int64_t bytesInUse() const { return _bytesInUse.load(); }
+
+        int64_t maxBytes() const { return _maxBytes; }
+
+        void appendStats(BSONObjBuilder* builder) const;
+
+    private:
+        const int64_t _maxBytes;
+
+        mutable boost::mutex _mutex;
+        uint64_t _lastCommitted; // guarded by _mutex
+        std::multiset<uint64_t> _activeSnapshots; // guarded by _mutex
+
+        AtomicUInt64 _nextTxnId;
+        AtomicInt64 _bytesInUse;
+
+        AtomicUInt64 _commits;
+        AtomicUInt64 _rollbacks;
+        AtomicUInt64 _writeConflicts;
+        AtomicUInt64 _memoryLimitRejections;
+    };
+
+}  // namespace mongo
@@ -33,6 +33,7 @@
 #include "mongo/db/storage/kv/kv_catalog.h"
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include <stdlib.h>
 
 #include "mongo/db/concurrency/d_concurrency.h"
@@ -67,6 +68,7 @@ namespace {
         virtual void rollback() {
             boost::lock_guard<boost::mutex> lk(_catalog->_identsLock);
             _catalog->_idents.erase(_ident);
+            _catalog->_identRemoved_inlock();
         }
 
         KVCatalog* const _catalog;
@@ -83,6 +85,7 @@ namespace {
         virtual void rollback() {
             boost::lock_guard<boost::mutex> lk(_catalog->_identsLock);
             _catalog->_idents[_ident] = _entry;
+            _catalog->_identAdded_inlock();
         }
 
         KVCatalog* const _catalog;
@@ -99,10 +102,13 @@ namespace {
         , _directoryPerDb(directoryPerDb)
         , _directoryForIndexes(directoryForIndexes)
         , _rand(_newRand())
+        , _publishedIdents(new NSToIdentMap())
+        , _publishedIdentsStale(false)
     {}
 
     KVCatalog::~KVCatalog() {
         _rs = NULL;
+        delete _publishedIdents.load();
     }
 
     std::string KVCatalog::_newRand() {
@@ -150,6 +156,62 @@ namespace {
         while (_hasEntryCollidingWithRand()) {
             _rand = _newRand();
         }
+
+        boost::lock_guard<boost::mutex> lk( _identsLock );
+        _publishIdents_inlock();
+    }
+
+    bool KVCatalog::_findIdent( StringData ns, Entry* out ) const {
+        const std::string nsString = ns.toString();
+
+        while (true) {
+            const unsigned epoch = _readerEpoch.load();
+            StripedCounter& readers = _readers[epoch & 1];
+            readers.add(1);
+
+            // If a publish moved the epoch on after we registered, it may not wait for us, so
+            // start over under the new epoch.
+            const NSToIdentMap* idents = _publishedIdents.load();
+            if (_readerEpoch.load() != epoch) {
+                readers.add(-1);
+                continue;
+            }
+
+            NSToIdentMap::const_iterator it = idents->find( nsString );
+            const bool found = it != idents->end();
+            if ( found )
+                *out = it->second;
+            readers.add(-1);
+
+            if ( found )
+                return true;
+            break;
+        }
+
+        // Either it doesn't exist or it was added since the last publish.
+        boost::lock_guard<boost::mutex> lk( _identsLock );
+        NSToIdentMap::const_iterator it = _idents.find( nsString );
+        if ( it == _idents.end() )
+            return false;
+        *out = it->second;
+
+        if ( _publishedIdentsStale )
+            _publishIdents_inlock();
+        return true;
+    }
+
+    void KVCatalog::_publishIdents_inlock() const {
+        const NSToIdentMap* old = _publishedIdents.load();
+        _publishedIdents.store(new NSToIdentMap(_idents));
+        _publishedIdentsStale = false;
+
+        // Readers that register from here on see the new epoch, so only the ones registered
+        // under the old epoch can still be using 'old'. Lookups are short, so spin.
+        const unsigned oldEpoch = _readerEpoch.fetchAndAdd(1);
+        while (_readers[oldEpoch & 1].load() != 0) {
+            boost::this_thread::yield();
+        }
+        delete old;
     }
 
     void KVCatalog::getAllCollections( std::vector<std::string>* out ) const {
@@ -181,6 +243,7 @@ namespace {
         }
 
         opCtx->recoveryUnit()->registerChange(new AddIdentChange(this, ns));
+        _identAdded_inlock();
 
         BSONObj obj;
         {
@@ -204,10 +267,9 @@ namespace {
     }
 
     std::string KVCatalog::getCollectionIdent( StringData ns ) const {
-        boost::lock_guard<boost::mutex> lk( _identsLock );
-        NSToIdentMap::const_iterator it = _idents.find( ns.toString() );
-        invariant( it != _idents.end() );
-        return it->second.ident;
+        Entry entry;
+        invariant( _findIdent( ns, &entry ) );
+        return entry.ident;
     }
 
     std::string KVCatalog::getIndexIdent( OperationContext* opCtx,
@@ -229,13 +291,9 @@ namespace {
                                              MODE_S));
         }
 
-        RecordId dl;
-        {
-            boost::lock_guard<boost::mutex> lk( _identsLock );
-            NSToIdentMap::const_iterator it = _idents.find( ns.toString() );
-            invariant( it != _idents.end() );
-            dl = it->second.storedLoc;
-        }
+        Entry entry;
+        invariant( _findIdent( ns, &entry ) );
+        const RecordId dl = entry.storedLoc;
 
         LOG(1) << "looking up metadata for: " << ns << " @ " << dl;
         RecordData data;
@@ -366,6 +424,7 @@ namespace {
 
         _idents.erase(fromIt);
         _idents[toNS.toString()] = Entry( old["ident"].String(), loc );
+        _identRemoved_inlock();
 
         return Status::OK();
     }
@@ -392,6 +451,7 @@ namespace {
         LOG(1) << "deleting metadata for " << ns << " @ " << it->second.storedLoc;
         _rs->deleteRecord( opCtx, it->second.storedLoc );
         _idents.erase(it);
+        _identRemoved_inlock();
 
         return Status::OK();
     }
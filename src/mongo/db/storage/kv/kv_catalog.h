@@ -40,6 +40,8 @@
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/record_id.h"
 #include "mongo/db/storage/bson_collection_catalog_entry.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/striped_counter.h"
 
 namespace mongo {
 
@@ -128,8 +130,36 @@ namespace mongo {
             RecordId storedLoc;
         };
         typedef std::map<std::string,Entry> NSToIdentMap;
+
+        /**
+         * Looks 'ns' up without taking _identsLock if it has been published, otherwise falls back
+         * to _idents under the lock.
+         */
+        bool _findIdent( StringData ns, Entry* out ) const;
+
+        /**
+         * Replaces the published copy of _idents and frees the old one once no reader can be
+         * using it. Caller must hold _identsLock.
+         */
+        void _publishIdents_inlock() const;
+
+        // Removals are published right away so that a stale ident is never returned. Additions
+        // only mark the published copy stale, and it is rebuilt by the first lookup that misses,
+        // so creating many collections at once copies the map once rather than once per create.
+        void _identRemoved_inlock() const { _publishIdents_inlock(); }
+        void _identAdded_inlock() const { _publishedIdentsStale = true; }
+
+        // The authoritative map. Only touched with _identsLock held.
         NSToIdentMap _idents;
         mutable boost::mutex _identsLock;
+
+        // Immutable copy of _idents read without any lock. Readers register in _readers for the
+        // parity of _readerEpoch they saw, and a publish waits for the readers of the previous
+        // epoch to drain before freeing the copy they may be reading.
+        mutable AtomicWord<const NSToIdentMap*> _publishedIdents;
+        mutable bool _publishedIdentsStale; // protected by _identsLock
+        mutable AtomicUInt32 _readerEpoch;
+        mutable StripedCounter _readers[2];
     };
 
 }
@@ -185,6 +185,13 @@ namespace mongo {
         _catalog->putMetaData(txn, ns().toString(), md);
     }
 
+    void KVCollectionCatalogEntry::updateCompression(OperationContext* txn,
+                                                     const std::string& compression) {
+        MetaData md = _getMetaData(txn);
+        md.options.compression = compression;
+        _catalog->putMetaData(txn, ns().toString(), md);
+    }
+
     BSONCollectionCatalogEntry::MetaData KVCollectionCatalogEntry::_getMetaData( OperationContext* txn ) const {
         return _catalog->getMetaData( txn, ns().toString() );
     }
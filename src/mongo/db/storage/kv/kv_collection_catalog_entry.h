@@ -76,6 +76,8 @@ namespace mongo {
 
         void updateValidator(OperationContext* txn, const BSONObj& validator) final;
 
+        void updateCompression(OperationContext* txn, const std::string& compression) final;
+
         RecordStore* getRecordStore() { return _recordStore.get(); }
         const RecordStore* getRecordStore() const { return _recordStore.get(); }
 
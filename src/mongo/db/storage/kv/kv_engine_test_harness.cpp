@@ -31,6 +31,7 @@
 #include "mongo/db/storage/kv/kv_engine_test_harness.h"
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/db/index/index_descriptor.h"
@@ -38,7 +39,9 @@
 #include "mongo/db/storage/kv/kv_engine.h"
 #include "mongo/db/storage/record_store.h"
 #include "mongo/db/storage/sorted_data_interface.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
@@ -210,6 +213,91 @@ namespace mongo {
         ASSERT_NOT_EQUALS( ident, catalog->getCollectionIdent( "a.b" ) );
     }
 
+    namespace {
+        void lookUpUntilDone( KVCatalog* catalog,
+                              const string& expectedIdent,
+                              AtomicUInt32* done,
+                              AtomicUInt32* mismatches ) {
+            while ( !done->load() ) {
+                if ( catalog->getCollectionIdent( "a.stable" ) != expectedIdent )
+                    mismatches->fetchAndAdd( 1 );
+            }
+        }
+    }
+
+    TEST( KVCatalogTest, LookupsDuringCreateRenameDrop ) {
+        scoped_ptr<KVHarnessHelper> helper( KVHarnessHelper::create() );
+        KVEngine* engine = helper->getEngine();
+
+        scoped_ptr<RecordStore> rs;
+        scoped_ptr<KVCatalog> catalog;
+        {
+            MyOperationContext opCtx( engine );
+            WriteUnitOfWork uow( &opCtx );
+            ASSERT_OK( engine->createRecordStore( &opCtx, "catalog", "catalog", CollectionOptions() ) );
+            rs.reset( engine->getRecordStore( &opCtx, "catalog", "catalog", CollectionOptions() ) );
+            catalog.reset( new KVCatalog( rs.get(), true, false, false) );
+            ASSERT_OK( catalog->newCollection( &opCtx, "a.stable", CollectionOptions() ) );
+            uow.commit();
+        }
+        const string stableIdent = catalog->getCollectionIdent( "a.stable" );
+
+        AtomicUInt32 done;
+        AtomicUInt32 mismatches;
+        std::vector<boost::thread*> readers;
+        for ( int i = 0; i < 4; i++ ) {
+            readers.push_back( new boost::thread( lookUpUntilDone, catalog.get(), stableIdent,
+                                                  &done, &mismatches ) );
+        }
+
+        // Many creates in one unit of work, each visible right away.
+        {
+            MyOperationContext opCtx( engine );
+            WriteUnitOfWork uow( &opCtx );
+            for ( int i = 0; i < 100; i++ ) {
+                const string ns = str::stream() << "a.c" << i;
+                ASSERT_OK( catalog->newCollection( &opCtx, ns, CollectionOptions() ) );
+                ASSERT_TRUE( catalog->isUserDataIdent( catalog->getCollectionIdent( ns ) ) );
+            }
+            uow.commit();
+        }
+
+        const string renamedIdent = catalog->getCollectionIdent( "a.c0" );
+        {
+            MyOperationContext opCtx( engine );
+            WriteUnitOfWork uow( &opCtx );
+            ASSERT_OK( catalog->renameCollection( &opCtx, "a.c0", "a.renamed", false ) );
+            uow.commit();
+        }
+        ASSERT_EQUALS( renamedIdent, catalog->getCollectionIdent( "a.renamed" ) );
+
+        for ( int i = 1; i < 100; i++ ) {
+            MyOperationContext opCtx( engine );
+            WriteUnitOfWork uow( &opCtx );
+            const string ns = str::stream() << "a.c" << i;
+            ASSERT_OK( catalog->dropCollection( &opCtx, ns ) );
+            uow.commit();
+        }
+
+        {
+            MyOperationContext opCtx( engine );
+            WriteUnitOfWork uow( &opCtx );
+            ASSERT_OK( catalog->newCollection( &opCtx, "a.c1", CollectionOptions() ) );
+            uow.commit();
+        }
+
+        done.store( 1 );
+        for ( size_t i = 0; i < readers.size(); i++ ) {
+            readers[i]->join();
+            delete readers[i];
+        }
+        ASSERT_EQUALS( 0U, mismatches.load() );
+
+        std::vector<string> all;
+        catalog->getAllCollections( &all );
+        ASSERT_EQUALS( 3U, all.size() );
+    }
+
 
     TEST( KVCatalogTest, Idx1 ) {
         scoped_ptr<KVHarnessHelper> helper( KVHarnessHelper::create() );
@@ -397,4 +397,10 @@ namespace {
         updateSystemNamespaces(txn, _namespacesRecordStore, ns(),
                                BSON("$set" << BSON("options.validator" << validator)));
     }
+
+    void NamespaceDetailsCollectionCatalogEntry::updateCompression(
+            OperationContext* txn, const std::string& compression) {
+        updateSystemNamespaces(txn, _namespacesRecordStore, ns(),
+                               BSON("$set" << BSON("options.compression" << compression)));
+    }
 }
@@ -105,6 +105,8 @@ namespace mongo {
 
         void updateValidator(OperationContext* txn, const BSONObj& validator) final;
 
+        void updateCompression(OperationContext* txn, const std::string& compression) final;
+
         // not part of interface, but available to my storage engine
 
         int _findIndexNumber( OperationContext* txn, StringData indexName) const;
@@ -77,7 +77,9 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/thread.hpp>
+#include <algorithm>
 #include <iomanip>
+#include <limits>
 #include <utility>
 
 #include "mongo/db/client.h"
@@ -135,9 +137,12 @@ namespace {
         NumCommitsBeforeRemap = 10,
 
         // How many outstanding journal flushes should be allowed before applying writer back
-        // pressure. Size of 1 allows two journal blocks to be in the process of being written -
-        // one on the journal writer's buffer and one blocked waiting to be picked up.
-        NumAsyncJournalWrites = 1,
+        // pressure. Size of 2 lets the next commit be prepared while the previous one is being
+        // written and fsynced.
+        NumAsyncJournalWrites = 2,
+
+        // Lower bound for the adaptive commit interval, see durThread.
+        MinAdaptiveCommitIntervalMillis = 2,
     };
 
     // Remap loop state
@@ -454,7 +459,7 @@ namespace {
            << _journaledBytes / 1000000.0 << '\t'
            << _writeToDataFilesBytes / 1000000.0 << '\t'
            << _commitsInWriteLock << '\t'
-           << 0 << '\t'
+           << _earlyCommits << '\t'
            << (unsigned) (_prepLogBufferMicros / 1000) << '\t'
            << (unsigned) (_writeToJournalMicros / 1000) << '\t'
            << (unsigned) (_writeToDataFilesMicros / 1000) << '\t'
@@ -472,7 +477,7 @@ namespace {
           << "writeToDataFilesMB" << _writeToDataFilesBytes / 1000000.0
           << "compression" << _journaledBytes / (_uncompressedBytes + 1.0)
           << "commitsInWriteLock" << _commitsInWriteLock
-          << "earlyCommits" << 0
+          << "earlyCommits" << _earlyCommits
           << "timeMs" << BSON("dt" << _durationMillis <<
                               "prepLogBuffer" << (unsigned) (_prepLogBufferMicros / 1000) <<
                               "writeToJournal" << (unsigned) (_writeToJournalMicros / 1000) <<
@@ -485,6 +490,8 @@ namespace {
         if (mmapv1GlobalOptions.journalCommitInterval != 0) {
             b << "journalCommitIntervalMs" << mmapv1GlobalOptions.journalCommitInterval;
         }
+
+        b << "adaptiveCommitIntervalMs" << _commitIntervalMillis;
     }
 
 
@@ -683,20 +690,30 @@ namespace {
         uint64_t estimatedPrivateMapSize(0);
         uint64_t remapLastTimestamp(0);
 
+        // The commit interval actually waited. It is halved after every commit that j:true
+        // writers were waiting for and doubled back after every commit nobody waited for, so a
+        // steady stream of j:true writers is acknowledged within a few milliseconds while other
+        // workloads keep the configured interval and the larger group commits that come with it.
+        unsigned adaptiveMs = std::numeric_limits<unsigned>::max();
+
         while (shutdownRequested.loadRelaxed() == 0) {
             unsigned ms = mmapv1GlobalOptions.journalCommitInterval;
             if (ms == 0) {
                 ms = samePartition ? 100 : 30;
             }
 
+            adaptiveMs = std::min(adaptiveMs, ms);
+
             // +1 so it never goes down to zero
-            const unsigned oneThird = (ms / 3) + 1;
+            const unsigned oneThird = (adaptiveMs / 3) + 1;
 
             // Reset the stats based on the reset interval
             if (stats.curr()->getCurrentDurationMillis() > DurStatsResetIntervalMillis) {
                 stats.reset();
             }
 
+            stats.curr()->_commitIntervalMillis = adaptiveMs;
+
             try {
                 boost::unique_lock<boost::mutex> lock(flushMutex);
 
@@ -709,6 +726,7 @@ namespace {
 
                     if (commitNotify.nWaiting()) {
                         // One or more getLastError j:true is pending
+                        stats.curr()->_earlyCommits++;
                         break;
                     }
 
@@ -718,6 +736,14 @@ namespace {
                     }
                 }
 
+                if (commitNotify.nWaiting()) {
+                    adaptiveMs = std::max(adaptiveMs / 2,
+                                          static_cast<unsigned>(MinAdaptiveCommitIntervalMillis));
+                }
+                else if (adaptiveMs < ms) {
+                    adaptiveMs *= 2;
+                }
+
                 // The commit logic itself
                 LOG(4) << "groupCommit begin";
 
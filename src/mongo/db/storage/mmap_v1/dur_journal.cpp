@@ -757,30 +757,36 @@ namespace mongo {
             verify( compressedLength < max );
             b.skip(compressedLength);
 
-            // footer
-            unsigned L = 0xffffffff;
-            {
-                // pad to alignment, and set the total section length in the JSectHeader
-                verify( 0xffffe000 == (~(Alignment-1)) );
-                unsigned lenUnpadded = b.len() + sizeof(JSectFooter);
-                L = (lenUnpadded + Alignment-1) & (~(Alignment-1));
-                dassert( L >= lenUnpadded );
+            try {
+                SimpleMutex::scoped_lock lk(_curLogFileMutex);
 
-                ((JSectHeader*)b.atOfs(0))->setSectionLen(lenUnpadded);
+                if (!_curLogFile) {
+                    _open();
+                }
 
-                JSectFooter f(b.buf(), b.len()); // computes checksum
-                b.appendStruct(f);
-                dassert( b.len() == lenUnpadded );
+                // The section is stamped with the file it goes into here rather than when the
+                // buffer was prepared, because the next buffer is prepared while the previous one
+                // is still being written and that write may rotate the journal file.
+                ((JSectHeader*)b.atOfs(0))->fileId = _curFileId;
 
-                b.skip(L - lenUnpadded);
-                dassert( b.len() % Alignment == 0 );
-            }
+                // footer
+                unsigned L = 0xffffffff;
+                {
+                    // pad to alignment, and set the total section length in the JSectHeader
+                    verify( 0xffffe000 == (~(Alignment-1)) );
+                    unsigned lenUnpadded = b.len() + sizeof(JSectFooter);
+                    L = (lenUnpadded + Alignment-1) & (~(Alignment-1));
+                    dassert( L >= lenUnpadded );
 
-            try {
-                SimpleMutex::scoped_lock lk(_curLogFileMutex);
+                    ((JSectHeader*)b.atOfs(0))->setSectionLen(lenUnpadded);
 
-                // must already be open -- so that _curFileId is correct for previous buffer building
-                verify( _curLogFile );
+                    JSectFooter f(b.buf(), b.len()); // computes checksum
+                    b.appendStruct(f);
+                    dassert( b.len() == lenUnpadded );
+
+                    b.skip(L - lenUnpadded);
+                    dassert( b.len() % Alignment == 0 );
+                }
 
                 stats.curr()->_uncompressedBytes += uncompressed.len();
                 unsigned w = b.len();
@@ -40,9 +40,15 @@ namespace mongo {
 namespace dur {
 
     /**
-     * Manages the thread and queues used for writing the journal to disk and notify parties with
+     * Manages the threads and queues used for writing the journal to disk and notify parties with
      * are waiting on the write concern.
      *
+     * Buffers go through two stages, each on its own thread: the journal writer thread compresses
+     * a buffer, appends it to the journal and fsyncs, and then hands it to the apply thread, which
+     * writes it to the shared view. With more than one buffer, the next commit can be prepared
+     * while the previous one is still being fsynced and the apply of one commit overlaps the
+     * journal write of the next.
+     *
      * NOTE: Not thread-safe and must not be used from more than one thread.
      */
     class JournalWriter {
@@ -161,6 +167,7 @@ namespace dur {
 
 
         void _journalWriterThread();
+        void _applyToDataFilesThread();
 
 
         // This gets notified as journal buffers are written. It is not owned and needs to outlive
@@ -170,8 +177,9 @@ namespace dur {
         // This gets notified as journal buffers are done being applied to the shared view
         NotifyAll* const _applyToDataFilesNotify;
 
-        // Wraps and controls the journal writer thread
+        // Wraps and controls the journal writer and apply threads
         boost::thread _journalWriterThreadHandle;
+        boost::thread _applyThreadHandle;
 
         // Indicates that shutdown has been requested. Used for idempotency of the shutdown call.
         bool _shutdownRequested;
@@ -180,7 +188,11 @@ namespace dur {
         BufferQueue _journalQueue;
         NotifyAll::When _lastCommitNumber;
 
-        // Queue of buffers, whose write has been completed by the journal writer thread.
+        // Queue of buffers, which have been written to the journal and need to be applied to the
+        // shared view by the apply thread.
+        BufferQueue _applyQueue;
+
+        // Queue of buffers, whose write and apply have been completed.
         BufferQueue _readyQueue;
     };
 
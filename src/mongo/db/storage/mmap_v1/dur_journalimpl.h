@@ -62,14 +62,6 @@ namespace mongo {
             unsigned long long lastFlushTime() const { return _lastFlushTime; }
             void cleanup(bool log); // closes and removes journal files
 
-            unsigned long long curFileId() const { return _curFileId; }
-
-            void assureLogFileOpen() {
-                SimpleMutex::scoped_lock lk(_curLogFileMutex);
-                if( _curLogFile == 0 )
-                    _open();
-            }
-
             /** open a journal file to journal operations to. */
             void open();
 
@@ -178,7 +178,9 @@ namespace mongo {
             // Invalidate the total length, we will fill it in later.
             h.setSectionLen(0xffffffff);
             h.seqNumber = getLastDataFileFlushTime();
-            h.fileId = j.curFileId();
+
+            // Filled in by the journal writer, see Journal::journal.
+            h.fileId = 0;
 
             // Ops other than basic writes (DurOp's) go first
             const std::vector<boost::shared_ptr<DurOp> >& durOps = commitJob.ops();
@@ -198,7 +200,6 @@ namespace mongo {
 
         void PREPLOGBUFFER(/*out*/ JSectHeader& outHeader, AlignedBuilder& outBuffer) {
             Timer t;
-            j.assureLogFileOpen(); // so fileId is set
             _PREPLOGBUFFER(outHeader, outBuffer);
             stats.curr()->_prepLogBufferMicros += t.micros();
         }
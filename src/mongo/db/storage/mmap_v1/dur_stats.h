@@ -60,6 +60,11 @@ namespace mongo {
                 unsigned _commits;
                 unsigned _commitsInWriteLock;
 
+                // Commits started before the commit interval was up because j:true writers were
+                // waiting, and the commit interval last used by the durability thread.
+                unsigned _earlyCommits;
+                unsigned _commitIntervalMillis;
+
                 uint64_t _journaledBytes;
                 uint64_t _uncompressedBytes;
                 uint64_t _writeToDataFilesBytes;
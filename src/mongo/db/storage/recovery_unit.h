@@ -32,8 +32,10 @@
 #include <string>
 
 #include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
 #include "mongo/db/storage/snapshot.h"
 #include "mongo/platform/cstdint.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
@@ -102,6 +104,26 @@ namespace mongo {
 
         virtual SnapshotId getSnapshotId() const = 0;
 
+        /**
+         * Asks that every read until 'expiration' see the same point in time, so that a long
+         * query stays consistent across yields and getMores. commitAndRestart() then keeps the
+         * current snapshot instead of starting a new one. Once 'expiration' has passed, or if the
+         * snapshot had to be given up for any other reason, reads fail with ExceededTimeLimit
+         * rather than silently moving to a newer snapshot.
+         *
+         * Must be called outside of a WriteUnitOfWork. Returns CommandNotSupported if the engine
+         * can't hold a snapshot open.
+         */
+        virtual Status setReadAtSnapshot(Date_t expiration) {
+            return Status(ErrorCodes::CommandNotSupported,
+                          "this storage engine does not support snapshot reads");
+        }
+
+        /**
+         * True once a snapshot requested with setReadAtSnapshot() has outlived its expiration.
+         */
+        virtual bool isReadAtSnapshotExpired() const { return false; }
+
         /**
          * A Change is an action that is registerChange()'d while a WriteUnitOfWork exists. The
          * change is either rollback()'d or commit()'d when the WriteUnitOfWork goes out of scope.
@@ -0,0 +1,154 @@
+// wiredtiger_capped_visibility.cpp
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_capped_visibility.h"
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    const int64_t WiredTigerCappedVisibility::kNone = std::numeric_limits<int64_t>::max();
+
+    WiredTigerCappedVisibility::WiredTigerCappedVisibility() {
+        for (size_t i = 0; i < kNumSlots; i++) {
+            _slots[i].store(kNone);
+        }
+    }
+
+    WiredTigerCappedVisibility::Slot WiredTigerCappedVisibility::reserve(int64_t lowerBound) {
+        invariant(lowerBound != kNone);
+
+        // Readers check this before scanning, so it must go up before the slot is filled.
+        _numPending.fetchAndAdd(1);
+        _totalRegistered.fetchAndAdd(1);
+
+        Slot slot;
+        slot._key = lowerBound;
+
+        const size_t start = _nextSlotHint.fetchAndAdd(1);
+        for (size_t i = 0; i < kNumSlots; i++) {
+            const size_t index = (start + i) % kNumSlots;
+            if (_slots[index].load() != kNone)
+                continue;
+            if (_slots[index].compareAndSwap(kNone, lowerBound) == kNone) {
+                slot._index = index;
+                return slot;
+            }
+        }
+
+        _totalOverflowed.fetchAndAdd(1);
+        boost::lock_guard<boost::mutex> lk(_overflowMutex);
+        _overflow.insert(lowerBound);
+        _numOverflowPending.fetchAndAdd(1);
+        return slot;
+    }
+
+    void WiredTigerCappedVisibility::publish(Slot* slot, int64_t key) {
+        invariant(key >= slot->_key);
+        if (key != slot->_key) {
+            if (slot->_index < kNumSlots) {
+                _slots[slot->_index].store(key);
+            }
+            else {
+                boost::lock_guard<boost::mutex> lk(_overflowMutex);
+                _overflow.erase(_overflow.find(slot->_key));
+                _overflow.insert(key);
+            }
+            slot->_key = key;
+        }
+
+        // Only raise the high-water mark once the key is hidden, so that a reader who sees the
+        // new mark also sees the slot.
+        noteHighest(key);
+    }
+
+    void WiredTigerCappedVisibility::release(const Slot& slot) {
+        if (slot._index < kNumSlots) {
+            dassert(_slots[slot._index].load() == slot._key);
+            _slots[slot._index].store(kNone);
+        }
+        else {
+            boost::lock_guard<boost::mutex> lk(_overflowMutex);
+            _overflow.erase(_overflow.find(slot._key));
+            _numOverflowPending.fetchAndSubtract(1);
+        }
+        _numPending.fetchAndSubtract(1);
+    }
+
+    void WiredTigerCappedVisibility::noteHighest(int64_t key) {
+        int64_t current = _highestSeen.load();
+        while (key > current) {
+            const int64_t previous = _highestSeen.compareAndSwap(current, key);
+            if (previous == current)
+                return;
+            current = previous;
+        }
+    }
+
+    int64_t WiredTigerCappedVisibility::lowestHidden() const {
+        if (_numPending.load() == 0)
+            return kNone;
+
+        int64_t lowest = kNone;
+        for (size_t i = 0; i < kNumSlots; i++) {
+            lowest = std::min<int64_t>(lowest, _slots[i].load());
+        }
+
+        if (_numOverflowPending.load() != 0) {
+            boost::lock_guard<boost::mutex> lk(_overflowMutex);
+            if (!_overflow.empty())
+                lowest = std::min<int64_t>(lowest, *_overflow.begin());
+        }
+        return lowest;
+    }
+
+    int64_t WiredTigerCappedVisibility::readTill() const {
+        // Read the high-water mark first. Any key at or below it was published before this
+        // point, so if it is still uncommitted the scan below will find it.
+        const int64_t highest = highestSeen();
+        const int64_t lowest = lowestHidden();
+        return lowest == kNone ? highest : lowest;
+    }
+
+    void WiredTigerCappedVisibility::appendStats(BSONObjBuilder* builder) const {
+        builder->appendNumber("pendingInserts", static_cast<long long>(_numPending.load()));
+        builder->appendNumber("totalInserts", static_cast<long long>(_totalRegistered.load()));
+        builder->appendNumber("overflowInserts",
+                              static_cast<long long>(_totalOverflowed.load()));
+    }
+
+} // namespace mongo
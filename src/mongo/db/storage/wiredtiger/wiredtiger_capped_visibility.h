@@ -0,0 +1,143 @@
+// wiredtiger_capped_visibility.h
+
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <limits>
+#include <set>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * Tracks which keys of a capped collection or oplog belong to uncommitted inserts, so readers
+     * can stop before the first one. Otherwise a tailing reader could skip a key that commits
+     * after a higher one.
+     *
+     * Each in-flight insert holds a slot containing its key. Writers claim and release slots with
+     * a compare-and-swap, and readers take the minimum over all slots, so neither side takes a
+     * lock. If every slot is taken, for example by a transaction inserting many documents, the
+     * extra keys go into a mutex-protected overflow set.
+     *
+     * Keys must become visible to readers in the order they are allocated. When the caller
+     * allocates keys itself, it should reserve() a slot with a lower bound on the key first and
+     * publish() the key after. When the caller already serializes key allocation, as the oplog
+     * does, registerKey() does both at once.
+     */
+    class WiredTigerCappedVisibility {
+        MONGO_DISALLOW_COPYING(WiredTigerCappedVisibility);
+    public:
+        // Returned by lowestHidden() when nothing is hidden.
+        static const int64_t kNone;
+
+        static const size_t kNumSlots = 128;
+
+        class Slot {
+        public:
+            Slot() : _index(kNumSlots), _key(kNone) {}
+        private:
+            friend class WiredTigerCappedVisibility;
+            size_t _index; // kNumSlots for an overflow entry
+            int64_t _key;
+        };
+
+        WiredTigerCappedVisibility();
+
+        /**
+         * Hides every key >= 'lowerBound' until the slot is published and released.
+         */
+        Slot reserve(int64_t lowerBound);
+
+        /**
+         * Narrows a reserved slot down to 'key', which must be >= the reserved lower bound.
+         */
+        void publish(Slot* slot, int64_t key);
+
+        Slot registerKey(int64_t key) {
+            Slot slot = reserve(key);
+            publish(&slot, key);
+            return slot;
+        }
+
+        /**
+         * Called when the insert holding 'slot' commits or rolls back.
+         */
+        void release(const Slot& slot);
+
+        /**
+         * Records a key that was inserted without being tracked, such as an oplog entry written
+         * on a secondary.
+         */
+        void noteHighest(int64_t key);
+
+        int64_t highestSeen() const { return _highestSeen.load(); }
+
+        /**
+         * Returns the lowest key that may still be uncommitted, or kNone.
+         */
+        int64_t lowestHidden() const;
+
+        bool isHidden(int64_t key) const { return lowestHidden() <= key; }
+
+        /**
+         * Returns the key a new reader may read up to: the lowest hidden key, which it may read
+         * once committed, or else the highest key seen.
+         */
+        int64_t readTill() const;
+
+        void appendStats(BSONObjBuilder* builder) const;
+
+    private:
+        // Free slots hold kNone so that they never lower the minimum.
+        AtomicInt64 _slots[kNumSlots];
+
+        // Where the next reserve() starts looking, to spread writers across the slots.
+        AtomicUInt32 _nextSlotHint;
+
+        // Number of slots and overflow entries in use. Lets readers skip the scan entirely.
+        AtomicInt64 _numPending;
+
+        mutable boost::mutex _overflowMutex;
+        std::multiset<int64_t> _overflow;
+        AtomicInt64 _numOverflowPending;
+
+        AtomicInt64 _highestSeen;
+
+        AtomicInt64 _totalRegistered;
+        AtomicInt64 _totalOverflowed;
+    };
+
+} // namespace mongo
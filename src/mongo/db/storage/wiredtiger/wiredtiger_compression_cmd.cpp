@@ -0,0 +1,179 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/collection_catalog_entry.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/query/internal_plans.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_compression_sampler.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    using boost::scoped_ptr;
+    using std::string;
+    using std::stringstream;
+
+namespace {
+
+    const long long kDefaultSampleSize = 1000;
+    const long long kMaxSampleSize = 100 * 1000;
+
+    // The sample is held in memory, so stop once it has this many bytes however many documents
+    // were asked for.
+    const long long kMaxSampleBytes = 32 * 1024 * 1024;
+
+    // Bounds the length of the scan. On larger collections the sample is drawn from the records
+    // at the start of the collection.
+    const long long kMaxRecordsScanned = 10 * kMaxSampleSize;
+
+} // namespace
+
+    /**
+     * { sampleCompression: <collection>, sampleSize: <n> }
+     *
+     * Compresses 'sampleSize' documents picked at random across the first kMaxRecordsScanned
+     * records of a collection, or as many as fit in kMaxSampleBytes, with every block compressor
+     * and reports the sizes and timings along with a recommended 'compression' setting.
+     */
+    class SampleCompressionCmd : public Command {
+    public:
+        SampleCompressionCmd() : Command("sampleCompression") {}
+        virtual bool slaveOk() const { return true; }
+        virtual bool isWriteCommandForConfigServer() const { return false; }
+        virtual void help(stringstream& help) const {
+            help << "estimate how well a collection compresses with each block compressor\n"
+                    "{ sampleCompression: <collection>, sampleSize: <n> }";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::collStats);
+            out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+        }
+
+        virtual bool run(OperationContext* txn,
+                         const string& dbname,
+                         BSONObj& cmdObj,
+                         int,
+                         string& errmsg,
+                         BSONObjBuilder& result) {
+            const NamespaceString nss(parseNsCollectionRequired(dbname, cmdObj));
+
+            long long sampleSize = kDefaultSampleSize;
+            BSONElement sampleSizeElem = cmdObj["sampleSize"];
+            if (!sampleSizeElem.eoo()) {
+                if (!sampleSizeElem.isNumber() || sampleSizeElem.numberLong() <= 0 ||
+                    sampleSizeElem.numberLong() > kMaxSampleSize) {
+                    errmsg = str::stream() << "sampleSize must be a number between 1 and "
+                                           << kMaxSampleSize;
+                    return false;
+                }
+                sampleSize = sampleSizeElem.numberLong();
+            }
+
+            WiredTigerCompressionSampler sampler;
+            {
+                AutoGetCollectionForRead ctx(txn, nss);
+                Collection* collection = ctx.getCollection();
+                if (!collection) {
+                    errmsg = "Collection [" + nss.toString() + "] not found.";
+                    return false;
+                }
+
+                const string current =
+                    collection->getCatalogEntry()->getCollectionOptions(txn).compression;
+                result.append("current", current.empty() ? "default" : current);
+
+                // Split the scanned records into 'sampleSize' runs and take one record at random
+                // from each, so the sample covers the whole collection rather than just the
+                // oldest documents.
+                const long long numRecords =
+                    std::min(static_cast<long long>(collection->numRecords(txn)),
+                             kMaxRecordsScanned);
+                const long long runLength = std::max(1LL, numRecords / sampleSize);
+                PseudoRandom random(static_cast<int64_t>(curTimeMicros64()));
+
+                scoped_ptr<PlanExecutor> exec(InternalPlanner::collectionScan(txn,
+                                                                              nss.ns(),
+                                                                              collection));
+                exec->setYieldPolicy(PlanExecutor::YIELD_AUTO);
+
+                long long scanned = 0;
+                long long pick = 0;
+                BSONObj doc;
+                PlanExecutor::ExecState state = PlanExecutor::ADVANCED;
+                while (sampler.numDocuments() < sampleSize &&
+                       sampler.uncompressedBytes() < kMaxSampleBytes &&
+                       scanned < kMaxRecordsScanned &&
+                       PlanExecutor::ADVANCED == (state = exec->getNext(&doc, NULL))) {
+                    txn->checkForInterrupt();
+
+                    const long long i = scanned++ % runLength;
+                    if (i == 0) {
+                        pick = static_cast<long long>(static_cast<uint64_t>(random.nextInt64()) %
+                                                      runLength);
+                    }
+                    if (i == pick) {
+                        sampler.addDocument(doc);
+                    }
+                }
+
+                if (PlanExecutor::DEAD == state || PlanExecutor::FAILURE == state) {
+                    errmsg = str::stream() << "sampleCompression scan of " << nss.ns()
+                                           << " failed: "
+                                           << WorkingSetCommon::toStatusString(doc);
+                    return false;
+                }
+                result.appendNumber("scannedRecords", scanned);
+            }
+
+            // Compression is CPU only, so do it after the collection lock is released.
+            sampler.finish();
+            sampler.appendResults(&result);
+            return true;
+        }
+
+    } sampleCompressionCmd;
+
+} // namespace mongo
@@ -0,0 +1,173 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_compression_sampler.h"
+
+#include <snappy.h>
+#include <zlib.h>
+
+#include "mongo/util/assert_util.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    namespace {
+
+        const WiredTigerCompressionSampler::Result* findResult(
+                const std::vector<WiredTigerCompressionSampler::Result>& results,
+                StringData compressor) {
+            for (size_t i = 0; i < results.size(); i++) {
+                if (results[i].compressor == compressor)
+                    return &results[i];
+            }
+            return NULL;
+        }
+
+        double ratio(long long uncompressed, long long compressed) {
+            return compressed ? double(uncompressed) / compressed : 1.0;
+        }
+
+    } // namespace
+
+    WiredTigerCompressionSampler::WiredTigerCompressionSampler()
+        : _numDocuments(0),
+          _uncompressedBytes(0) {
+    }
+
+    void WiredTigerCompressionSampler::addDocument(const BSONObj& doc) {
+        _currentPage.append(doc.objdata(), doc.objsize());
+        _numDocuments++;
+        _uncompressedBytes += doc.objsize();
+        if (_currentPage.size() >= kPageBytes)
+            _flushPage();
+    }
+
+    void WiredTigerCompressionSampler::_flushPage() {
+        if (_currentPage.empty())
+            return;
+        _pages.push_back(std::string());
+        _pages.back().swap(_currentPage);
+    }
+
+    void WiredTigerCompressionSampler::finish() {
+        invariant(_results.empty());
+        _flushPage();
+
+        Result none = { "none", _uncompressedBytes, 0, 0 };
+        Result snappyResult = { "snappy", 0, 0, 0 };
+        Result zlibResult = { "zlib", 0, 0, 0 };
+
+        std::string compressed;
+        std::vector<char> uncompressed(kPageBytes);
+        for (size_t i = 0; i < _pages.size(); i++) {
+            const std::string& page = _pages[i];
+            if (uncompressed.size() < page.size())
+                uncompressed.resize(page.size());
+
+            Timer timer;
+            snappy::Compress(page.data(), page.size(), &compressed);
+            snappyResult.compressMicros += timer.micros();
+            snappyResult.compressedBytes += compressed.size();
+
+            timer.reset();
+            invariant(snappy::RawUncompress(compressed.data(), compressed.size(),
+                                            &uncompressed[0]));
+            snappyResult.decompressMicros += timer.micros();
+
+            // Level 6 is what WiredTiger's zlib extension uses by default.
+            uLongf zlibBytes = compressBound(page.size());
+            compressed.resize(zlibBytes);
+            timer.reset();
+            int ret = compress2(reinterpret_cast<Bytef*>(&compressed[0]), &zlibBytes,
+                                reinterpret_cast<const Bytef*>(page.data()), page.size(), 6);
+            zlibResult.compressMicros += timer.micros();
+            invariant(ret == Z_OK);
+            zlibResult.compressedBytes += zlibBytes;
+
+            uLongf uncompressedBytes = uncompressed.size();
+            timer.reset();
+            ret = uncompress(reinterpret_cast<Bytef*>(&uncompressed[0]), &uncompressedBytes,
+                             reinterpret_cast<const Bytef*>(compressed.data()), zlibBytes);
+            zlibResult.decompressMicros += timer.micros();
+            invariant(ret == Z_OK);
+        }
+
+        _results.push_back(none);
+        _results.push_back(snappyResult);
+        _results.push_back(zlibResult);
+    }
+
+    std::string WiredTigerCompressionSampler::recommend(std::string* reason) const {
+        invariant(!_results.empty());
+        const Result* snappyResult = findResult(_results, "snappy");
+        const Result* zlibResult = findResult(_results, "zlib");
+
+        const double snappyRatio = ratio(_uncompressedBytes, snappyResult->compressedBytes);
+        if (_uncompressedBytes == 0 || snappyRatio < 1.1) {
+            *reason = str::stream() << "sampled data barely compresses (snappy ratio "
+                                    << snappyRatio << "), compression would only cost CPU";
+            return "none";
+        }
+
+        if (zlibResult->compressedBytes <= snappyResult->compressedBytes * 0.8) {
+            *reason = str::stream() << "zlib is at least 20% smaller than snappy (ratio "
+                                    << ratio(_uncompressedBytes, zlibResult->compressedBytes)
+                                    << " vs " << snappyRatio << ")";
+            return "zlib";
+        }
+
+        *reason = str::stream() << "zlib saves less than 20% over snappy (snappy ratio "
+                                << snappyRatio << "), so the faster compressor wins";
+        return "snappy";
+    }
+
+    void WiredTigerCompressionSampler::appendResults(BSONObjBuilder* builder) const {
+        builder->appendNumber("sampledDocuments", _numDocuments);
+        builder->appendNumber("sampledBytes", _uncompressedBytes);
+
+        BSONObjBuilder compressors(builder->subobjStart("compressors"));
+        for (size_t i = 0; i < _results.size(); i++) {
+            const Result& r = _results[i];
+            BSONObjBuilder sub(compressors.subobjStart(r.compressor));
+            sub.appendNumber("compressedBytes", r.compressedBytes);
+            sub.append("ratio", ratio(_uncompressedBytes, r.compressedBytes));
+            sub.appendNumber("compressMicros", r.compressMicros);
+            sub.appendNumber("decompressMicros", r.decompressMicros);
+            sub.done();
+        }
+        compressors.done();
+
+        std::string reason;
+        builder->append("recommended", recommend(&reason));
+        builder->append("reason", reason);
+    }
+
+} // namespace mongo
@@ -0,0 +1,91 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * Estimates how well a set of documents would compress with each block compressor WiredTiger
+     * supports, so that a per-collection 'compression' setting can be chosen from real data
+     * rather than guessed.
+     *
+     * Documents are packed into pages of roughly the size WiredTiger writes to disk and each page
+     * is compressed and decompressed on its own, which keeps the ratios close to what the table
+     * would actually get.
+     */
+    class WiredTigerCompressionSampler {
+        MONGO_DISALLOW_COPYING(WiredTigerCompressionSampler);
+    public:
+        static const size_t kPageBytes = 32 * 1024;
+
+        struct Result {
+            std::string compressor;
+            long long compressedBytes;
+            long long compressMicros;
+            long long decompressMicros;
+        };
+
+        WiredTigerCompressionSampler();
+
+        void addDocument(const BSONObj& doc);
+
+        /**
+         * Compresses whatever has been added. May only be called once.
+         */
+        void finish();
+
+        long long numDocuments() const { return _numDocuments; }
+        long long uncompressedBytes() const { return _uncompressedBytes; }
+        const std::vector<Result>& results() const { return _results; }
+
+        /**
+         * Picks a compressor from the results: "none" if snappy barely helps, "zlib" if it saves
+         * at least a fifth more than snappy does, otherwise "snappy". 'reason' says why.
+         */
+        std::string recommend(std::string* reason) const;
+
+        void appendResults(BSONObjBuilder* builder) const;
+
+    private:
+        void _flushPage();
+
+        std::vector<std::string> _pages;
+        std::string _currentPage;
+        long long _numDocuments;
+        long long _uncompressedBytes;
+        std::vector<Result> _results;
+    };
+
+} // namespace mongo
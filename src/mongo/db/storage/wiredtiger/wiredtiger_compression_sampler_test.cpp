@@ -0,0 +1,95 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/storage/wiredtiger/wiredtiger_compression_sampler.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+    TEST(WiredTigerCompressionSamplerTest, Empty) {
+        WiredTigerCompressionSampler sampler;
+        sampler.finish();
+        ASSERT_EQUALS(0, sampler.numDocuments());
+        std::string reason;
+        ASSERT_EQUALS("none", sampler.recommend(&reason));
+    }
+
+    TEST(WiredTigerCompressionSamplerTest, RepetitiveDocuments) {
+        WiredTigerCompressionSampler sampler;
+        for (int i = 0; i < 1000; i++) {
+            sampler.addDocument(BSON("_id" << i
+                                     << "name" << "a fairly long and very repetitive string"
+                                     << "status" << "active"));
+        }
+        sampler.finish();
+        ASSERT_EQUALS(1000, sampler.numDocuments());
+
+        const std::vector<WiredTigerCompressionSampler::Result>& results = sampler.results();
+        ASSERT_EQUALS(3U, results.size());
+        ASSERT_EQUALS("none", results[0].compressor);
+        ASSERT_EQUALS(sampler.uncompressedBytes(), results[0].compressedBytes);
+        for (size_t i = 1; i < results.size(); i++) {
+            ASSERT_LESS_THAN(results[i].compressedBytes * 2, sampler.uncompressedBytes());
+        }
+
+        std::string reason;
+        ASSERT_NOT_EQUALS("none", sampler.recommend(&reason));
+        ASSERT_FALSE(reason.empty());
+
+        BSONObjBuilder builder;
+        sampler.appendResults(&builder);
+        BSONObj obj = builder.obj();
+        ASSERT_EQUALS(1000, obj["sampledDocuments"].numberLong());
+        ASSERT(obj["compressors"]["zlib"].isABSONObj());
+        ASSERT_EQUALS(String, obj["recommended"].type());
+    }
+
+    TEST(WiredTigerCompressionSamplerTest, IncompressibleDocuments) {
+        WiredTigerCompressionSampler sampler;
+        unsigned int seed = 12345;
+        for (int i = 0; i < 200; i++) {
+            char bytes[512];
+            for (size_t j = 0; j < sizeof(bytes); j++) {
+                seed = seed * 1103515245 + 12345;
+                bytes[j] = static_cast<char>(seed >> 16);
+            }
+            BSONObjBuilder doc;
+            doc.appendBinData("data", sizeof(bytes), BinDataGeneral, bytes);
+            sampler.addDocument(doc.obj());
+        }
+        sampler.finish();
+
+        std::string reason;
+        ASSERT_EQUALS("none", sampler.recommend(&reason));
+    }
+
+} // namespace mongo
@@ -157,6 +157,20 @@ namespace {
         }
 
         ss << "block_compressor=" << wiredTigerGlobalOptions.indexBlockCompressor << ",";
+
+        // A per-index setting overrides the global defaults above. "prefix" keeps only the key
+        // prefix compression, which is cheap to decode since it needs no block decompression.
+        const std::string compression = desc.getInfoElement("compression").str();
+        if (compression == "prefix") {
+            ss << "prefix_compression=true,block_compressor=none,";
+        }
+        else if (compression == "none") {
+            ss << "prefix_compression=false,block_compressor=none,";
+        }
+        else if (!compression.empty()) {
+            ss << "block_compressor=" << compression << ",";
+        }
+
         ss << extraConfig;
 
         // Validate configuration object.
@@ -58,6 +58,8 @@ namespace mongo {
          *     built-in defaults
          *     'extraConfig'
          *     storageEngine.wiredTiger.configString in index descriptor's info object.
+         * Indexes whose keys share long leading values can be made smaller with a configString
+         * such as "prefix_compression=true,prefix_compression_min=1,leaf_page_max=64k".
          * Performs simple validation on the supplied parameters.
          * Returns error status if validation fails.
          * Note that even if this function returns an OK status, WT_SESSION:create() may still
@@ -38,6 +38,7 @@
 #include "mongo/db/json.h"
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/db/storage/sorted_data_interface_test_harness.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_global_options.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_index.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
@@ -140,4 +141,22 @@ namespace mongo {
         ASSERT_EQ(result.getValue(), "abc=def,");
     }
 
+    TEST(WiredTigerIndexTest, GenerateCreateStringCompression) {
+        IndexDescriptor desc(NULL, "", fromjson("{key: {a: 1}, name: 'a_1', ns: 'test.wt',"
+                                                " compression: 'zlib'}"));
+        StatusWith<std::string> result = WiredTigerIndex::generateCreateString("", desc);
+        ASSERT_OK(result.getStatus());
+        const std::string& config = result.getValue();
+        ASSERT_LESS_THAN(config.find("block_compressor=" +
+                                     wiredTigerGlobalOptions.indexBlockCompressor),
+                         config.find("block_compressor=zlib"));
+
+        IndexDescriptor prefixDesc(NULL, "", fromjson("{key: {a: 1}, name: 'a_1',"
+                                                      " ns: 'test.wt', compression: 'prefix'}"));
+        result = WiredTigerIndex::generateCreateString("", prefixDesc);
+        ASSERT_OK(result.getStatus());
+        ASSERT_NOT_EQUALS(std::string::npos,
+                          result.getValue().find("prefix_compression=true,block_compressor=none"));
+    }
+
 }  // namespace mongo
@@ -48,6 +48,7 @@
 #include "mongo/util/log.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/scopeguard.h"
+#include "mongo/util/timer.h"
 
 #if !defined(__has_feature)
 #define __has_feature(x) 0
@@ -65,8 +66,7 @@ namespace mongo {
                                             bool repair )
         : _eventHandler(WiredTigerUtil::defaultEventHandlers()),
           _path( path ),
-          _durable( durable ),
-          _sizeStorerSyncTracker( 100000, 60 * 1000 ) {
+          _durable( durable ) {
 
         size_t cacheSizeGB = wiredTigerGlobalOptions.cacheSizeGB;
         if (cacheSizeGB == 0) {
@@ -112,6 +112,7 @@ namespace mongo {
         ss << extraOpenOptions;
         string config = ss.str();
         log() << "wiredtiger_open config: " << config;
+        Timer openTimer;
         int ret = wiredtiger_open(path.c_str(), &_eventHandler, config.c_str(), &_conn);
         // Invalid argument (EINVAL) is usually caused by invalid configuration string.
         // We still fassert() but without a stack trace.
@@ -122,6 +123,7 @@ namespace mongo {
             Status s(wtRCToStatus(ret));
             msgassertedNoTrace(28595, s.reason());
         }
+        const int openMillis = openTimer.millis();
 
         _sessionCache.reset( new WiredTigerSessionCache( this ) );
 
@@ -132,8 +134,12 @@ namespace mongo {
                 log() << "Repairing size cache";
                 fassertNoTrace(28577, _salvageIfNeeded(_sizeStorerUri.c_str()));
             }
+            Timer sizeCacheTimer;
             _sizeStorer.reset(new WiredTigerSizeStorer(_conn, _sizeStorerUri));
             _sizeStorer->fillCache();
+            _sizeStorer->startFlushThread();
+            log() << "WiredTiger startup: opened in " << openMillis << "ms, loaded the size cache"
+                  << " in " << sizeCacheTimer.millis() << "ms";
         }
     }
 
@@ -148,6 +154,8 @@ namespace mongo {
 
     void WiredTigerKVEngine::cleanShutdown() {
         log() << "WiredTigerKVEngine shutting down";
+        if (_sizeStorer)
+            _sizeStorer->stopFlushThread();
         syncSizeInfo(true);
         if (_conn) {
             // these must be the last things we do before _conn->close();
@@ -350,10 +358,6 @@ namespace mongo {
     }
 
     bool WiredTigerKVEngine::haveDropsQueued() const {
-        if ( _sizeStorerSyncTracker.intervalHasElapsed() ) {
-            _sizeStorerSyncTracker.resetLastTime();
-            syncSizeInfo(false);
-        }
         boost::lock_guard<boost::mutex> lk( _identToDropMutex );
         return !_identToDrop.empty();
     }
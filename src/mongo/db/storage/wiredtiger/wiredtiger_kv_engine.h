@@ -42,7 +42,6 @@
 #include "mongo/bson/ordering.h"
 #include "mongo/db/storage/kv/kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
-#include "mongo/util/elapsed_tracker.h"
 
 namespace mongo {
 
@@ -152,7 +151,6 @@ namespace mongo {
 
         boost::scoped_ptr<WiredTigerSizeStorer> _sizeStorer;
         std::string _sizeStorerUri;
-        mutable ElapsedTracker _sizeStorerSyncTracker;
     };
 
 }
@@ -43,6 +43,7 @@
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/operation_context_noop.h"
 #include "mongo/db/storage/oplog_hack.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_global_options.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
@@ -137,6 +138,11 @@ namespace {
 
         ss << "block_compressor=" << wiredTigerGlobalOptions.collectionBlockCompressor << ",";
 
+        // The names accepted by CollectionOptions are also WiredTiger compressor names.
+        if (!options.compression.empty()) {
+            ss << "block_compressor=" << options.compression << ",";
+        }
+
         ss << extraStrings << ",";
 
         StatusWith<std::string> customOptions =
@@ -188,7 +194,7 @@ namespace {
               _cappedDeleteCheckCount(0),
               _useOplogHack(shouldUseOplogHack(ctx, _uri)),
               _sizeStorer( sizeStorer ),
-              _sizeStorerCounter(0),
+              _sessionCache( WiredTigerRecoveryUnit::get(ctx)->getSessionCache() ),
               _shuttingDown(false)
     {
         Status versionStatus = WiredTigerUtil::checkApplicationMetadataFormatVersion(
@@ -206,6 +212,31 @@ namespace {
             invariant(_cappedMaxDocs == -1);
         }
 
+        // Capped collections need the largest RecordId for their visibility tracking before
+        // anything can read them. Everything else waits for its first write or count, so that
+        // starting up with many collections doesn't open every table.
+        if (_isCapped)
+            _load(ctx);
+
+        _hasBackgroundThread = WiredTigerKVEngine::initRsOplogBackgroundThread(ns);
+    }
+
+    void WiredTigerRecordStore::_ensureLoaded() const {
+        if (MONGO_likely(_loaded.load()))
+            return;
+
+        boost::lock_guard<boost::mutex> lk(_loadMutex);
+        if (_loaded.load())
+            return;
+
+        // Use a separate transaction so that the caller's snapshot and writes don't affect the
+        // counts. The caller already holds a ticket.
+        OperationContextNoop txn(new WiredTigerRecoveryUnit(_sessionCache));
+        WiredTigerRecoveryUnit::get(&txn)->markNoTicketRequired();
+        const_cast<WiredTigerRecordStore*>(this)->_load(&txn);
+    }
+
+    void WiredTigerRecordStore::_load(OperationContext* ctx) {
         // Find the largest RecordId currently in use and estimate the number of records.
         scoped_ptr<RecordIterator> iterator( getIterator( ctx, RecordId(),
                                                           CollectionScanParams::BACKWARD ) );
@@ -214,26 +245,26 @@ namespace {
             _numRecords.store(0);
             // Need to start at 1 so we are always higher than RecordId::min()
             _nextIdNum.store( 1 );
-            if ( sizeStorer )
+            if ( _sizeStorer )
                 _sizeStorer->onCreate( this, 0, 0 );
         }
         else {
             RecordId maxLoc = iterator->curr();
             int64_t max = _makeKey( maxLoc );
-            _oplog_highestSeen = maxLoc;
+            _cappedVisibility.noteHighest( max );
             _nextIdNum.store( 1 + max );
 
             if ( _sizeStorer ) {
                 long long numRecords;
                 long long dataSize;
-                _sizeStorer->loadFromCache( uri, &numRecords, &dataSize );
+                _sizeStorer->loadFromCache( _uri, &numRecords, &dataSize );
                 _numRecords.store( numRecords );
                 _dataSize.store( dataSize );
                 _sizeStorer->onCreate( this, numRecords, dataSize );
             }
 
             if (_sizeStorer == NULL || _numRecords.load() < kCollectionScanOnCreationThreshold) {
-                LOG(1) << "doing scan of collection " << ns << " to get info";
+                LOG(1) << "doing scan of collection " << ns() << " to get info";
 
                 _numRecords.store(0);
                 _dataSize.store(0);
@@ -241,8 +272,8 @@ namespace {
                 while( !iterator->isEOF() ) {
                     RecordId loc = iterator->getNext();
                     RecordData data = iterator->dataFor( loc );
-                    _numRecords.fetchAndAdd(1);
-                    _dataSize.fetchAndAdd(data.size());
+                    _numRecords.add(1);
+                    _dataSize.add(data.size());
                 }
 
                 if ( _sizeStorer ) {
@@ -252,7 +283,7 @@ namespace {
 
         }
 
-        _hasBackgroundThread = WiredTigerKVEngine::initRsOplogBackgroundThread(ns);
+        _loaded.store(1);
     }
 
     WiredTigerRecordStore::~WiredTigerRecordStore() {
@@ -262,7 +293,8 @@ namespace {
         }
 
         LOG(1) << "~WiredTigerRecordStore for: " << ns();
-        if ( _sizeStorer ) {
+        // A record store that was never loaded has nothing newer than what the size storer has.
+        if ( _sizeStorer && _loaded.load() ) {
             _sizeStorer->onDestroy( this );
         }
     }
@@ -277,11 +309,13 @@ namespace {
     }
 
     long long WiredTigerRecordStore::dataSize( OperationContext *txn ) const {
-        return _dataSize.load();
+        _ensureLoaded();
+        return _dataSize.loadNonNegative();
     }
 
     long long WiredTigerRecordStore::numRecords( OperationContext *txn ) const {
-        return _numRecords.load();
+        _ensureLoaded();
+        return _numRecords.loadNonNegative();
     }
 
     bool WiredTigerRecordStore::isCapped() const {
@@ -355,6 +389,7 @@ namespace {
     }
 
     void WiredTigerRecordStore::deleteRecord( OperationContext* txn, const RecordId& loc ) {
+        _ensureLoaded();
         WiredTigerCursor cursor( _uri, _instanceId, true, txn );
         cursor.assertInActiveTxn();
         WT_CURSOR *c = cursor.get();
@@ -560,23 +595,24 @@ namespace {
                                          "object to insert exceeds cappedMaxSize" );
         }
 
+        _ensureLoaded();
+
         RecordId loc;
         if ( _useOplogHack ) {
             StatusWith<RecordId> status = extractAndCheckLocForOplog(data, len);
             if (!status.isOK())
                 return status;
             loc = status.getValue();
-            if ( loc > _oplog_highestSeen ) {
-                boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
-                if ( loc > _oplog_highestSeen ) {
-                    _oplog_highestSeen = loc;
-                }
-            }
+            _cappedVisibility.noteHighest( _makeKey( loc ) );
         }
         else if ( _isCapped ) {
-            boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
+            // Hide everything from the next id up before taking it, so that no reader can see a
+            // higher id commit while this one is still being inserted.
+            WiredTigerCappedVisibility::Slot slot =
+                _cappedVisibility.reserve( _nextIdNum.load() );
             loc = _nextId();
-            _addUncommitedDiskLoc_inlock( txn, loc );
+            _cappedVisibility.publish( &slot, _makeKey( loc ) );
+            _registerCappedInsert( txn, slot );
         }
         else {
             loc = _nextId();
@@ -603,21 +639,8 @@ namespace {
         return StatusWith<RecordId>( loc );
     }
 
-    void WiredTigerRecordStore::dealtWithCappedLoc( const RecordId& loc ) {
-        boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
-        SortedDiskLocs::iterator it = std::find(_uncommittedDiskLocs.begin(),
-                                                _uncommittedDiskLocs.end(),
-                                                loc);
-        invariant(it != _uncommittedDiskLocs.end());
-        _uncommittedDiskLocs.erase(it);
-    }
-
     bool WiredTigerRecordStore::isCappedHidden( const RecordId& loc ) const {
-        boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
-        if (_uncommittedDiskLocs.empty()) {
-            return false;
-        }
-        return _uncommittedDiskLocs.front() <= loc;
+        return _cappedVisibility.isHidden( _makeKey( loc ) );
     }
 
     StatusWith<RecordId> WiredTigerRecordStore::insertRecord( OperationContext* txn,
@@ -637,6 +660,8 @@ namespace {
                                                               int len,
                                                               bool enforceQuota,
                                                               UpdateNotifier* notifier ) {
+        _ensureLoaded();
+
         WiredTigerCursor curwrap( _uri, _instanceId, true, txn);
         curwrap.assertInActiveTxn();
         WT_CURSOR *c = curwrap.get();
@@ -677,13 +702,7 @@ namespace {
     }
 
     void WiredTigerRecordStore::_oplogSetStartHack( WiredTigerRecoveryUnit* wru ) const {
-        boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
-        if ( _uncommittedDiskLocs.empty() ) {
-            wru->setOplogReadTill( _oplog_highestSeen );
-        }
-        else {
-            wru->setOplogReadTill( _uncommittedDiskLocs.front() );
-        }
+        wru->setOplogReadTill( _fromKey( _cappedVisibility.readTill() ) );
     }
 
     RecordIterator* WiredTigerRecordStore::getIterator(
@@ -716,6 +735,7 @@ namespace {
     }
 
     Status WiredTigerRecordStore::truncate( OperationContext* txn ) {
+        _ensureLoaded();
         WiredTigerCursor startWrap( _uri, _instanceId, true, txn);
         WT_CURSOR* start = startWrap.get();
         int ret = WT_OP_CHECK(start->next(start));
@@ -752,6 +772,7 @@ namespace {
                                             ValidateAdaptor* adaptor,
                                             ValidateResults* results,
                                             BSONObjBuilder* output ) {
+        _ensureLoaded();
 
         {
             int err = WiredTigerUtil::verifyTable(txn, _uri, &results->errors);
@@ -829,6 +850,31 @@ namespace {
         if ( _isCapped ) {
             result->appendIntOrLL( "max", _cappedMaxDocs );
             result->appendIntOrLL( "maxSize", static_cast<long long>(_cappedMaxSize / scale) );
+
+            // How far behind the newest insert readers are held by uncommitted ones.
+            BSONObjBuilder visibility( result->subobjStart( "visibility" ) );
+            _cappedVisibility.appendStats( &visibility );
+            const int64_t highest = _cappedVisibility.highestSeen();
+            const int64_t lowest = _cappedVisibility.lowestHidden();
+            const bool lagging = lowest != WiredTigerCappedVisibility::kNone && lowest <= highest;
+            if ( _isOplog ) {
+                const Timestamp highestTs( static_cast<unsigned long long>( highest ) );
+                visibility.append( "highestSeen", highestTs );
+                if ( lagging ) {
+                    const Timestamp lowestTs( static_cast<unsigned long long>( lowest ) );
+                    visibility.append( "oldestUncommitted", lowestTs );
+                    visibility.appendNumber( "lagSecs", static_cast<long long>(
+                                                 highestTs.getSecs() - lowestTs.getSecs() ) );
+                }
+                else {
+                    visibility.appendNumber( "lagSecs", 0 );
+                }
+            }
+            else {
+                visibility.appendNumber( "lagRecords",
+                                         lagging ? static_cast<long long>( highest - lowest + 1 )
+                                                 : 0LL );
+            }
         }
         WiredTigerSession* session = WiredTigerRecoveryUnit::get(txn)->getSession(txn);
         WT_SESSION* s = session->getSession();
@@ -875,38 +921,36 @@ namespace {
         if ( !loc.isOK() )
             return loc.getStatus();
 
-        boost::lock_guard<boost::mutex> lk( _uncommittedDiskLocsMutex );
-        _addUncommitedDiskLoc_inlock( txn, loc.getValue() );
+        // Callers allocate optimes in order under their own lock, so the key can be published
+        // right away.
+        _registerCappedInsert( txn, _cappedVisibility.registerKey( _makeKey( loc.getValue() ) ) );
         return Status::OK();
     }
 
     class WiredTigerRecordStore::CappedInsertChange : public RecoveryUnit::Change {
     public:
-        CappedInsertChange( WiredTigerRecordStore* rs, const RecordId& loc )
-            : _rs( rs ), _loc( loc ) {
+        CappedInsertChange( WiredTigerCappedVisibility* visibility,
+                            const WiredTigerCappedVisibility::Slot& slot )
+            : _visibility( visibility ), _slot( slot ) {
         }
 
         virtual void commit() {
-            _rs->dealtWithCappedLoc( _loc );
+            _visibility->release( _slot );
         }
 
         virtual void rollback() {
-            _rs->dealtWithCappedLoc( _loc );
+            _visibility->release( _slot );
         }
 
     private:
-        WiredTigerRecordStore* _rs;
-        RecordId _loc;
+        WiredTigerCappedVisibility* _visibility;
+        const WiredTigerCappedVisibility::Slot _slot;
     };
 
-    void WiredTigerRecordStore::_addUncommitedDiskLoc_inlock( OperationContext* txn,
-                                                              const RecordId& loc ) {
-        // todo: make this a dassert at some point
-        invariant( _uncommittedDiskLocs.empty() ||
-                   _uncommittedDiskLocs.back() < loc );
-        _uncommittedDiskLocs.push_back( loc );
-        txn->recoveryUnit()->registerChange( new CappedInsertChange( this, loc ) );
-        _oplog_highestSeen = loc;
+    void WiredTigerRecordStore::_registerCappedInsert(
+            OperationContext* txn,
+            const WiredTigerCappedVisibility::Slot& slot ) {
+        txn->recoveryUnit()->registerChange( new CappedInsertChange( &_cappedVisibility, slot ) );
     }
 
     boost::optional<RecordId> WiredTigerRecordStore::oplogStartHack(
@@ -940,6 +984,7 @@ namespace {
     void WiredTigerRecordStore::updateStatsAfterRepair(OperationContext* txn,
                                                        long long numRecords,
                                                        long long dataSize) {
+        _ensureLoaded();
         _numRecords.store(numRecords);
         _dataSize.store(dataSize);
         _sizeStorer->storeToCache(_uri, numRecords, dataSize);
@@ -961,7 +1006,7 @@ namespace {
         NumRecordsChange(WiredTigerRecordStore* rs, int64_t diff) :_rs(rs), _diff(diff) {}
         virtual void commit() {}
         virtual void rollback() {
-            _rs->_numRecords.fetchAndAdd( -_diff );
+            _rs->_numRecords.add( -_diff );
         }
 
     private:
@@ -971,12 +1016,8 @@ namespace {
 
     void WiredTigerRecordStore::_changeNumRecords( OperationContext* txn, int64_t diff ) {
         txn->recoveryUnit()->registerChange(new NumRecordsChange(this, diff));
-        if ( diff > 0 ) {
-            if ( _numRecords.fetchAndAdd( diff ) < diff )
-                    _numRecords.store( diff );
-        } else if ( _numRecords.fetchAndAdd( diff ) < 0 ) {
-            _numRecords.store( 0 );
-        }
+        // A count that went negative is reset by the next numRecords().
+        _numRecords.add( diff );
     }
 
     class WiredTigerRecordStore::DataSizeChange : public RecoveryUnit::Change {
@@ -989,25 +1030,15 @@ namespace {
 
     private:
         WiredTigerRecordStore* _rs;
-        bool _amount;
+        int _amount;
     };
 
     void WiredTigerRecordStore::_increaseDataSize( OperationContext* txn, int amount ) {
         if ( txn )
             txn->recoveryUnit()->registerChange(new DataSizeChange(this, amount));
 
-        if ( _dataSize.fetchAndAdd(amount) < 0 ) {
-            if ( amount > 0 ) {
-                _dataSize.store( amount );
-            }
-            else {
-                _dataSize.store( 0 );
-            }
-        }
-
-        if ( _sizeStorer && _sizeStorerCounter++ % 1000 == 0 ) {
-            _sizeStorer->storeToCache( _uri, _numRecords.load(), _dataSize.load() );
-        }
+        // A size that went negative is reset by the next dataSize().
+        _dataSize.add( amount );
     }
 
     int64_t WiredTigerRecordStore::_makeKey( const RecordId& loc ) {
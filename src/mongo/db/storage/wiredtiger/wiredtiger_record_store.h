@@ -40,7 +40,9 @@
 #include "mongo/db/catalog/collection_options.h"
 #include "mongo/db/storage/record_store.h"
 #include "mongo/db/storage/capped_callback.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_capped_visibility.h"
 #include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/striped_counter.h"
 #include "mongo/util/fail_point_service.h"
 
 /**
@@ -54,6 +56,7 @@ namespace mongo {
     class RecoveryUnit;
     class WiredTigerCursor;
     class WiredTigerRecoveryUnit;
+    class WiredTigerSessionCache;
     class WiredTigerSizeStorer;
 
     extern const std::string kWiredTigerEngineName;
@@ -202,7 +205,6 @@ namespace mongo {
 
         void setSizeStorer( WiredTigerSizeStorer* ss ) { _sizeStorer = ss; }
 
-        void dealtWithCappedLoc( const RecordId& loc );
         bool isCappedHidden( const RecordId& loc ) const;
 
         bool inShutdown() const;
@@ -260,7 +262,20 @@ namespace mongo {
         static int64_t _makeKey(const RecordId &loc);
         static RecordId _fromKey(int64_t k);
 
-        void _addUncommitedDiskLoc_inlock( OperationContext* txn, const RecordId& loc );
+        void _registerCappedInsert( OperationContext* txn,
+                                    const WiredTigerCappedVisibility::Slot& slot );
+
+        /**
+         * Makes sure _load() has run. Capped collections load in the constructor, all others on
+         * their first write or count.
+         */
+        void _ensureLoaded() const;
+
+        /**
+         * Finds the largest RecordId in use and, unless the size storer has trustworthy values,
+         * counts the records.
+         */
+        void _load(OperationContext* txn);
 
         RecordId _nextId();
         void _setId(RecordId loc);
@@ -286,18 +301,20 @@ namespace mongo {
 
         const bool _useOplogHack;
 
-        typedef std::vector<RecordId> SortedDiskLocs;
-        SortedDiskLocs _uncommittedDiskLocs;
-        RecordId _oplog_visibleTo;
-        RecordId _oplog_highestSeen;
-        mutable boost::mutex _uncommittedDiskLocsMutex;
+        WiredTigerCappedVisibility _cappedVisibility;
 
         AtomicInt64 _nextIdNum;
-        AtomicInt64 _dataSize;
-        AtomicInt64 _numRecords;
+
+        // Updated by every insert and delete, so these are striped to keep writers on different
+        // cores from contending. The size storer picks them up from its own thread.
+        mutable StripedCounter _dataSize;
+        mutable StripedCounter _numRecords;
 
         WiredTigerSizeStorer* _sizeStorer; // not owned, can be NULL
-        int _sizeStorerCounter;
+        WiredTigerSessionCache* _sessionCache; // not owned, for the transaction _load() uses
+
+        mutable AtomicUInt32 _loaded; // Used as boolean - 0 = false, 1 = true
+        mutable boost::mutex _loadMutex;
 
         bool _shuttingDown;
         bool _hasBackgroundThread;
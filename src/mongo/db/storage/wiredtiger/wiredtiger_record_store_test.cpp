@@ -41,6 +41,8 @@
 #include "mongo/db/json.h"
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/db/storage/record_store_test_harness.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_capped_visibility.h"
+#include "mongo/db/storage/wiredtiger/wiredtiger_global_options.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
@@ -189,6 +191,20 @@ namespace mongo {
         ASSERT_EQ(result.getValue(), "abc=def,");
     }
 
+    TEST(WiredTigerRecordStoreTest, GenerateCreateStringCompression) {
+        CollectionOptions options;
+        ASSERT_OK(options.parse(fromjson("{compression: 'zlib'}")));
+        StatusWith<std::string> result =
+            WiredTigerRecordStore::generateCreateString("test.wt", options, "");
+        ASSERT_OK(result.getStatus());
+        const std::string& config = result.getValue();
+
+        // Comes after the global default, so it wins.
+        ASSERT_LESS_THAN(config.find("block_compressor=" +
+                                     wiredTigerGlobalOptions.collectionBlockCompressor),
+                         config.find("block_compressor=zlib"));
+    }
+
     TEST(WiredTigerRecordStoreTest, Isolation1 ) {
         scoped_ptr<HarnessHelper> harnessHelper( newHarnessHelper() );
         scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
@@ -294,6 +310,51 @@ namespace mongo {
         }
     }
 
+    TEST(WiredTigerRecordStoreTest, LoadDeferredUntilFirstUse) {
+        scoped_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
+        scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
+        const string uri = checked_cast<WiredTigerRecordStore*>( rs.get() )->getURI();
+
+        RecordId lastLoc;
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            WriteUnitOfWork uow( opCtx.get() );
+            for ( int i = 0; i < 5; i++ ) {
+                StatusWith<RecordId> res = rs->insertRecord( opCtx.get(), "a", 2, false );
+                ASSERT_OK( res.getStatus() );
+                lastLoc = res.getValue();
+            }
+            uow.commit();
+        }
+
+        // Reopening doesn't read the table, the first insert does, and it must still pick an id
+        // above every existing one.
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            rs.reset( new WiredTigerRecordStore( opCtx.get(), "a.b", uri ) );
+        }
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            WriteUnitOfWork uow( opCtx.get() );
+            StatusWith<RecordId> res = rs->insertRecord( opCtx.get(), "b", 2, false );
+            ASSERT_OK( res.getStatus() );
+            ASSERT_GREATER_THAN( res.getValue(), lastLoc );
+            uow.commit();
+        }
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            ASSERT_EQUALS( 6, rs->numRecords( opCtx.get() ) );
+            ASSERT_EQUALS( 12, rs->dataSize( opCtx.get() ) );
+        }
+
+        // Counting first works too, even without an OperationContext.
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+            rs.reset( new WiredTigerRecordStore( opCtx.get(), "a.b", uri ) );
+        }
+        ASSERT_EQUALS( 6, rs->numRecords( NULL ) );
+    }
+
     TEST(WiredTigerRecordStoreTest, SizeStorer1 ) {
         scoped_ptr<WiredTigerHarnessHelper> harnessHelper(new WiredTigerHarnessHelper());
         scoped_ptr<RecordStore> rs( harnessHelper->newNonCappedRecordStore() );
@@ -887,4 +948,189 @@ namespace {
         ASSERT_TRUE(it->isEOF());
     }
 
+    TEST(WiredTigerCappedVisibilityTest, RegisterAndRelease) {
+        WiredTigerCappedVisibility visibility;
+        ASSERT_EQ(WiredTigerCappedVisibility::kNone, visibility.lowestHidden());
+
+        WiredTigerCappedVisibility::Slot five = visibility.registerKey(5);
+        WiredTigerCappedVisibility::Slot six = visibility.registerKey(6);
+        ASSERT_EQ(5, visibility.lowestHidden());
+        ASSERT_EQ(5, visibility.readTill());
+        ASSERT_EQ(6, visibility.highestSeen());
+        ASSERT_FALSE(visibility.isHidden(4));
+        ASSERT_TRUE(visibility.isHidden(6));
+
+        // Committing out of order leaves the lower key hiding the higher one.
+        visibility.release(six);
+        ASSERT_EQ(5, visibility.lowestHidden());
+
+        visibility.release(five);
+        ASSERT_EQ(WiredTigerCappedVisibility::kNone, visibility.lowestHidden());
+        ASSERT_EQ(6, visibility.readTill());
+    }
+
+    TEST(WiredTigerCappedVisibilityTest, ReserveHidesBeforePublish) {
+        WiredTigerCappedVisibility visibility;
+        visibility.noteHighest(9);
+
+        WiredTigerCappedVisibility::Slot slot = visibility.reserve(10);
+        ASSERT_EQ(10, visibility.readTill());
+        ASSERT_TRUE(visibility.isHidden(11));
+        ASSERT_EQ(9, visibility.highestSeen());
+
+        visibility.publish(&slot, 12);
+        ASSERT_FALSE(visibility.isHidden(11));
+        ASSERT_TRUE(visibility.isHidden(12));
+        ASSERT_EQ(12, visibility.highestSeen());
+
+        visibility.release(slot);
+        ASSERT_EQ(12, visibility.readTill());
+    }
+
+    TEST(WiredTigerCappedVisibilityTest, Overflow) {
+        WiredTigerCappedVisibility visibility;
+        const size_t numKeys = WiredTigerCappedVisibility::kNumSlots + 10;
+
+        std::vector<WiredTigerCappedVisibility::Slot> slots;
+        for (size_t i = 1; i <= numKeys; i++) {
+            slots.push_back(visibility.registerKey(i));
+        }
+        ASSERT_EQ(1, visibility.lowestHidden());
+
+        // Release everything but the last key, which went to the overflow set.
+        for (size_t i = 0; i + 1 < numKeys; i++) {
+            visibility.release(slots[i]);
+            ASSERT_EQ(static_cast<int64_t>(i + 2), visibility.lowestHidden());
+        }
+        visibility.release(slots.back());
+        ASSERT_EQ(WiredTigerCappedVisibility::kNone, visibility.lowestHidden());
+
+        BSONObjBuilder builder;
+        visibility.appendStats(&builder);
+        BSONObj stats = builder.obj();
+        ASSERT_EQ(0, stats["pendingInserts"].numberLong());
+        ASSERT_EQ(static_cast<long long>(numKeys), stats["totalInserts"].numberLong());
+        ASSERT_EQ(10, stats["overflowInserts"].numberLong());
+    }
+
+    TEST(WiredTigerRecordStoreTest, CappedVisibilityStats) {
+        scoped_ptr<WiredTigerHarnessHelper> harnessHelper( new WiredTigerHarnessHelper() );
+        scoped_ptr<RecordStore> rs(harnessHelper->newCappedRecordStore("a.b", 100000, 10000));
+
+        scoped_ptr<OperationContext> opCtx( harnessHelper->newOperationContext() );
+        WriteUnitOfWork uow( opCtx.get() );
+        ASSERT_OK( rs->insertRecord( opCtx.get(), "a", 2, false ).getStatus() );
+        ASSERT_OK( rs->insertRecord( opCtx.get(), "b", 2, false ).getStatus() );
+
+        {
+            scoped_ptr<OperationContext> statsCtx( harnessHelper->newOperationContext() );
+            BSONObjBuilder builder;
+            rs->appendCustomStats( statsCtx.get(), &builder, 1 );
+            BSONObj visibility = builder.obj()["visibility"].Obj();
+            ASSERT_EQ(2, visibility["pendingInserts"].numberLong());
+            ASSERT_EQ(2, visibility["lagRecords"].numberLong());
+        }
+
+        uow.commit();
+
+        BSONObjBuilder builder;
+        rs->appendCustomStats( opCtx.get(), &builder, 1 );
+        BSONObj visibility = builder.obj()["visibility"].Obj();
+        ASSERT_EQ(0, visibility["pendingInserts"].numberLong());
+        ASSERT_EQ(0, visibility["lagRecords"].numberLong());
+    }
+
+    namespace {
+        long long sessionCacheStat(StringData name) {
+            BSONObjBuilder builder;
+            WiredTigerSessionCache::appendGlobalStats(&builder);
+            return builder.obj()["sessionCache"].Obj()[name].numberLong();
+        }
+    }
+
+    TEST(WiredTigerSessionCacheTest, ReusesSessionsAndCursors) {
+        WiredTigerHarnessHelper harnessHelper;
+        scoped_ptr<RecordStore> rs( harnessHelper.newNonCappedRecordStore() );
+        WiredTigerSessionCache cache( harnessHelper.conn() );
+        const uint64_t id = WiredTigerSession::genCursorId();
+
+        const long long opened = sessionCacheStat("cursorsOpened");
+        const long long reused = sessionCacheStat("cursorsReused");
+
+        WiredTigerSession* session = cache.getSession();
+        WT_CURSOR* cursor = session->getCursor( "table:a.b", id, true );
+        ASSERT( cursor );
+        session->releaseCursor( id, cursor );
+        ASSERT_EQUALS( cursor, session->getCursor( "table:a.b", id, true ) );
+        session->releaseCursor( id, cursor );
+        cache.releaseSession( session );
+
+        // The same thread gets the same session back, cursor included.
+        ASSERT_EQUALS( session, cache.getSession() );
+        ASSERT_EQUALS( cursor, session->getCursor( "table:a.b", id, true ) );
+        session->releaseCursor( id, cursor );
+        cache.releaseSession( session );
+
+        ASSERT_EQUALS( opened + 1, sessionCacheStat("cursorsOpened") );
+        ASSERT_EQUALS( reused + 2, sessionCacheStat("cursorsReused") );
+    }
+
+    TEST(WiredTigerSessionCacheTest, EvictsLeastRecentlyUsedCursor) {
+        WiredTigerHarnessHelper harnessHelper;
+        scoped_ptr<RecordStore> rs( harnessHelper.newNonCappedRecordStore() );
+        WiredTigerSessionCache cache( harnessHelper.conn() );
+        WiredTigerSession* session = cache.getSession();
+
+        const long long cacheSize = sessionCacheStat("cursorCacheSize");
+        const long long closed = sessionCacheStat("cursorsClosed");
+
+        std::vector<uint64_t> ids;
+        for ( long long i = 0; i <= cacheSize; i++ ) {
+            ids.push_back( WiredTigerSession::genCursorId() );
+            session->releaseCursor( ids.back(),
+                                    session->getCursor( "table:a.b", ids.back(), true ) );
+        }
+        ASSERT_EQUALS( closed + 1, sessionCacheStat("cursorsClosed") );
+
+        // The first cursor was evicted, the last one is still cached.
+        const long long opened = sessionCacheStat("cursorsOpened");
+        session->releaseCursor( ids.back(), session->getCursor( "table:a.b", ids.back(), true ) );
+        ASSERT_EQUALS( opened, sessionCacheStat("cursorsOpened") );
+        session->releaseCursor( ids[0], session->getCursor( "table:a.b", ids[0], true ) );
+        ASSERT_EQUALS( opened + 1, sessionCacheStat("cursorsOpened") );
+
+        cache.releaseSession( session );
+    }
+
+    TEST(WiredTigerSizeStorerTest, FlushThreadSyncsOnStop) {
+        WiredTigerHarnessHelper harnessHelper;
+        WiredTigerSizeStorer sizeStorer( harnessHelper.conn(), "table:sizeStorer" );
+        scoped_ptr<RecordStore> rs( harnessHelper.newNonCappedRecordStore() );
+        WiredTigerRecordStore* wtrs = checked_cast<WiredTigerRecordStore*>( rs.get() );
+        wtrs->setSizeStorer( &sizeStorer );
+        sizeStorer.onCreate( wtrs, 0, 0 );
+        sizeStorer.startFlushThread();
+
+        {
+            scoped_ptr<OperationContext> opCtx( harnessHelper.newOperationContext() );
+            WriteUnitOfWork uow( opCtx.get() );
+            for ( int i = 0; i < 10; i++ ) {
+                ASSERT_OK( rs->insertRecord( opCtx.get(), "abc", 4, false ).getStatus() );
+            }
+            uow.commit();
+        }
+
+        // Stopping the thread writes the live counts to the table, where fillCache() reads them.
+        sizeStorer.stopFlushThread();
+        sizeStorer.fillCache();
+
+        long long numRecords;
+        long long dataSize;
+        sizeStorer.loadFromCache( wtrs->getURI(), &numRecords, &dataSize );
+        ASSERT_EQUALS( 10, numRecords );
+        ASSERT_EQUALS( 40, dataSize );
+
+        wtrs->setSizeStorer( NULL );
+    }
+
 }  // namespace mongo
@@ -32,6 +32,7 @@
 
 #include <boost/thread/condition.hpp>
 #include <boost/thread/mutex.hpp>
+#include <map>
 
 #include "mongo/base/checked_cast.h"
 #include "mongo/base/init.h"
@@ -77,6 +78,117 @@ namespace mongo {
             boost::condition condvar;
             long long lastSyncTime;
         } awaitCommitData;
+
+        // Longest a snapshot may be held open through setReadAtSnapshot(). Each pinned snapshot
+        // keeps WiredTiger from discarding old versions of anything written after it was taken.
+        MONGO_EXPORT_SERVER_PARAMETER(wiredTigerMaxSnapshotReadMillis, int, 5 * 60 * 1000);
+
+        // Transactions committed by any RecoveryUnit. How far this has moved since a snapshot was
+        // pinned approximates how much history WiredTiger is retaining for it.
+        AtomicUInt64 globalCommitCount;
+
+        class PinnedSnapshotRegistry {
+        public:
+            PinnedSnapshotRegistry() : _totalPinned(0), _expired(0), _interrupted(0) {}
+
+            void add(const WiredTigerRecoveryUnit* ru, Date_t expiration) {
+                Pin pin;
+                pin.pinnedAt = Date_t::now();
+                pin.expiration = expiration;
+                pin.commitCountAtPin = globalCommitCount.load();
+
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                _pinned[ru] = pin;
+                _totalPinned++;
+            }
+
+            void remove(const WiredTigerRecoveryUnit* ru) {
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                _pinned.erase(ru);
+            }
+
+            // Counts a read refused because its snapshot was gone.
+            void noteRefusedRead(bool expired) {
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                if (expired)
+                    _expired++;
+                else
+                    _interrupted++;
+            }
+
+            void appendPin(const WiredTigerRecoveryUnit* ru, BSONObjBuilder* b) const {
+                const Date_t now = Date_t::now();
+                const uint64_t commitCount = globalCommitCount.load();
+
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                Pins::const_iterator it = _pinned.find(ru);
+                if (it != _pinned.end())
+                    it->second.append(now, commitCount, b);
+            }
+
+            void append(BSONObjBuilder* b) const {
+                // Listing every pin could make serverStatus huge, so only the oldest are shown.
+                const size_t kMaxListed = 100;
+
+                const Date_t now = Date_t::now();
+                const uint64_t commitCount = globalCommitCount.load();
+
+                boost::lock_guard<boost::mutex> lk(_mutex);
+                long long oldestMillis = 0;
+                long long maxCommitsSincePin = 0;
+                std::multimap<Date_t, const Pin*> byAge;
+                for (Pins::const_iterator it = _pinned.begin(); it != _pinned.end(); ++it) {
+                    const Pin& pin = it->second;
+                    oldestMillis = std::max(oldestMillis,
+                                            durationCount<Milliseconds>(now - pin.pinnedAt));
+                    maxCommitsSincePin =
+                        std::max(maxCommitsSincePin,
+                                 static_cast<long long>(commitCount - pin.commitCountAtPin));
+                    byAge.insert(std::make_pair(pin.pinnedAt, &pin));
+                }
+
+                b->appendNumber("pinned", static_cast<long long>(_pinned.size()));
+                b->appendNumber("oldestPinnedMillis", oldestMillis);
+                b->appendNumber("maxCommitsSincePin", maxCommitsSincePin);
+                b->appendNumber("totalPinned", _totalPinned);
+                b->appendNumber("expired", _expired);
+                b->appendNumber("interrupted", _interrupted);
+
+                BSONArrayBuilder arr(b->subarrayStart("snapshots"));
+                size_t listed = 0;
+                for (std::multimap<Date_t, const Pin*>::const_iterator it = byAge.begin();
+                     it != byAge.end() && listed < kMaxListed; ++it, ++listed) {
+                    BSONObjBuilder pinBuilder(arr.subobjStart());
+                    it->second->append(now, commitCount, &pinBuilder);
+                    pinBuilder.done();
+                }
+                arr.done();
+            }
+
+        private:
+            struct Pin {
+                void append(Date_t now, uint64_t commitCount, BSONObjBuilder* b) const {
+                    b->appendNumber("pinnedMillis",
+                                    durationCount<Milliseconds>(now - pinnedAt));
+                    b->appendNumber("expiresInMillis",
+                                    durationCount<Milliseconds>(expiration - now));
+                    b->appendNumber("commitsSincePin",
+                                    static_cast<long long>(commitCount - commitCountAtPin));
+                }
+
+                Date_t pinnedAt;
+                Date_t expiration;
+                uint64_t commitCountAtPin;
+            };
+
+            typedef std::map<const WiredTigerRecoveryUnit*, Pin> Pins;
+
+            mutable boost::mutex _mutex;
+            Pins _pinned;
+            long long _totalPinned;
+            long long _expired;
+            long long _interrupted;
+        } pinnedSnapshots;
     }
 
     WiredTigerRecoveryUnit::WiredTigerRecoveryUnit(WiredTigerSessionCache* sc) :
@@ -88,11 +200,16 @@ namespace mongo {
         _everStartedWrite( false ),
         _currentlySquirreled( false ),
         _syncing( false ),
-        _noTicketNeeded( false ) {
+        _noTicketNeeded( false ),
+        _readAtSnapshot( false ),
+        _snapshotPinned( false ),
+        _snapshotGivenUp( false ) {
     }
 
     WiredTigerRecoveryUnit::~WiredTigerRecoveryUnit() {
         invariant( _depth == 0 );
+        if ( _snapshotPinned )
+            _unpinSnapshot(false);
         _abort();
         if ( _session ) {
             _sessionCache->releaseSession( _session );
@@ -108,6 +225,13 @@ namespace mongo {
         b->appendNumber("wt_myTransactionCount", static_cast<long long>(_myTransactionCount));
         if (_active)
             b->append("wt_millisSinceCommit", _timer.millis());
+        if (_readAtSnapshot) {
+            BSONObjBuilder snapshot(b->subobjStart("wt_readAtSnapshot"));
+            snapshot.append("pinned", _snapshotPinned);
+            snapshot.append("givenUp", _snapshotGivenUp);
+            pinnedSnapshots.appendPin(this, &snapshot);
+            snapshot.done();
+        }
     }
 
     void WiredTigerRecoveryUnit::_commit() {
@@ -152,6 +276,11 @@ namespace mongo {
 
     void WiredTigerRecoveryUnit::beginUnitOfWork(OperationContext* opCtx) {
         invariant( !_currentlySquirreled );
+        if ( _depth == 0 && _snapshotPinned ) {
+            // Writing from an old snapshot would only produce write conflicts. Any further
+            // reads will fail instead.
+            _txnClose(false);
+        }
         _depth++;
         _everStartedWrite = true;
         _getTicket(opCtx);
@@ -208,19 +337,65 @@ namespace mongo {
         }
 
         if ( !_active ) {
+            if ( _snapshotGivenUp && _depth == 0 ) {
+                const bool expired = Date_t::now() >= _snapshotExpiration;
+                pinnedSnapshots.noteRefusedRead(expired);
+                uasserted(ErrorCodes::ExceededTimeLimit,
+                          expired ? "snapshot read expired"
+                                  : "snapshot read was interrupted by a write");
+            }
             _txnOpen(opCtx);
         }
+        else if ( _snapshotPinned ) {
+            // The ticket was given back while yielding, see commitAndRestart().
+            _getTicket(opCtx);
+        }
         return _session;
     }
 
     void WiredTigerRecoveryUnit::commitAndRestart() {
         invariant(_depth == 0);
         if (_active) {
+            if (_snapshotPinned && Date_t::now() < _snapshotExpiration) {
+                // Keep reading from the same snapshot, but don't hold a ticket while yielded
+                // or between getMores, so idle cursors can't starve other readers.
+                _ticket.reset(NULL);
+                return;
+            }
+
             // Can't be in a WriteUnitOfWork, so safe to rollback
             _txnClose(false);
         }
     }
 
+    Status WiredTigerRecoveryUnit::setReadAtSnapshot(Date_t expiration) {
+        invariant(_depth == 0);
+
+        const Date_t now = Date_t::now();
+        const long long maxMillis = wiredTigerMaxSnapshotReadMillis;
+        if (expiration - now > Milliseconds(maxMillis)) {
+            return Status(ErrorCodes::BadValue,
+                          str::stream() << "snapshot reads may last at most " << maxMillis
+                                        << "ms, see wiredTigerMaxSnapshotReadMillis");
+        }
+
+        // Reads done before this point saw an earlier snapshot.
+        if (_active) {
+            if (_snapshotPinned)
+                _unpinSnapshot(false);
+            _txnClose(false);
+        }
+
+        _readAtSnapshot = true;
+        _snapshotGivenUp = false;
+        _snapshotExpiration = expiration;
+        return Status::OK();
+    }
+
+    bool WiredTigerRecoveryUnit::isReadAtSnapshotExpired() const {
+        return _readAtSnapshot && Date_t::now() >= _snapshotExpiration;
+    }
+
     void WiredTigerRecoveryUnit::setOplogReadTill( const RecordId& loc ) {
         _oplogReadTill = loc;
     }
@@ -298,6 +473,10 @@ namespace mongo {
             bbb.done();
         }
         bb.done();
+
+        BSONObjBuilder snapshotReads(b.subobjStart("snapshotReads"));
+        pinnedSnapshots.append(&snapshotReads);
+        snapshotReads.done();
     }
 
     void WiredTigerRecoveryUnit::_txnClose( bool commit ) {
@@ -308,11 +487,14 @@ namespace mongo {
             LOG(2) << "WT commit_transaction";
             if ( _syncing )
                 awaitCommitData.syncHappend();
+            globalCommitCount.fetchAndAdd(1);
         }
         else {
             invariantWTOK( s->rollback_transaction(s, NULL) );
             LOG(2) << "WT rollback_transaction";
         }
+        if (_snapshotPinned)
+            _unpinSnapshot(true);
         _active = false;
         _myTransactionCount++;
         _ticket.reset(NULL);
@@ -365,6 +547,22 @@ namespace mongo {
         LOG(2) << "WT begin_transaction";
         _timer.reset();
         _active = true;
+
+        if (_readAtSnapshot)
+            _pinSnapshot();
+    }
+
+    void WiredTigerRecoveryUnit::_pinSnapshot() {
+        invariant(!_snapshotPinned);
+        pinnedSnapshots.add(this, _snapshotExpiration);
+        _snapshotPinned = true;
+    }
+
+    void WiredTigerRecoveryUnit::_unpinSnapshot(bool giveUp) {
+        invariant(_snapshotPinned);
+        pinnedSnapshots.remove(this);
+        _snapshotPinned = false;
+        _snapshotGivenUp = giveUp;
     }
 
     void WiredTigerRecoveryUnit::beingReleasedFromOperationContext() {
@@ -80,6 +80,10 @@ namespace mongo {
 
         virtual SnapshotId getSnapshotId() const;
 
+        virtual Status setReadAtSnapshot(Date_t expiration);
+
+        virtual bool isReadAtSnapshotExpired() const;
+
         // ---- WT STUFF
 
         WiredTigerSession* getSession(OperationContext* opCtx);
@@ -106,6 +110,11 @@ namespace mongo {
         void _txnClose( bool commit );
         void _txnOpen(OperationContext* opCtx);
 
+        // Registers the open transaction as a pinned snapshot, or removes it again. If 'giveUp'
+        // is set, later reads fail rather than open a newer snapshot.
+        void _pinSnapshot();
+        void _unpinSnapshot(bool giveUp);
+
         WiredTigerSessionCache* _sessionCache; // not owned
         WiredTigerSession* _session; // owned, but from pool
         bool _defaultCommit;
@@ -124,6 +133,14 @@ namespace mongo {
         bool _noTicketNeeded;
         void _getTicket(OperationContext* opCtx);
         TicketHolderReleaser _ticket;
+
+        // Set by setReadAtSnapshot(). While set, commitAndRestart() keeps the transaction open
+        // until _snapshotExpiration. _snapshotPinned is true while that transaction is open and
+        // _snapshotGivenUp once it has been closed, after which no new one may be started.
+        bool _readAtSnapshot;
+        bool _snapshotPinned;
+        bool _snapshotGivenUp;
+        Date_t _snapshotExpiration;
     };
 
     /**
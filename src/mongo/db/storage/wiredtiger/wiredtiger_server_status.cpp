@@ -79,6 +79,7 @@ namespace mongo {
         }
 
         WiredTigerRecoveryUnit::appendGlobalStats(bob);
+        WiredTigerSessionCache::appendGlobalStats(&bob);
 
         return bob.obj();
     }
@@ -31,16 +31,65 @@
 
 #define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
 
+#include <boost/functional/hash.hpp>
 #include <boost/thread.hpp>
 
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 
+#include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
 
+    // Upper bound on the cursors each session keeps open for reuse. 0 disables caching.
+    MONGO_EXPORT_SERVER_PARAMETER(wiredTigerCursorCacheSize, int, 64);
+
+    namespace {
+        AtomicUInt64 nextCursorId(1);
+
+        /**
+         * Counters are striped by thread so that the hot path never shares a cache line with
+         * another core.
+         */
+        struct CacheStats {
+            AtomicUInt64 sessionsOpened;
+            AtomicUInt64 sessionsReused;
+            AtomicUInt64 cursorsOpened;
+            AtomicUInt64 cursorsReused;
+            AtomicUInt64 cursorsClosed;
+            char pad[64];
+        };
+
+        enum { NumStatsStripes = 16 };
+        CacheStats cacheStats[NumStatsStripes];
+
+        size_t threadHash() {
+            return boost::hash<boost::thread::id>()(boost::this_thread::get_id());
+        }
+
+        CacheStats& statsForThisThread() {
+            return cacheStats[threadHash() % NumStatsStripes];
+        }
+
+        /**
+         * Marks a thread as being inside getSession()/releaseSession().
+         */
+        class ActiveOp {
+        public:
+            explicit ActiveOp(AtomicUInt32* counter) : _counter(counter) {
+                _counter->fetchAndAdd(1);
+            }
+            ~ActiveOp() {
+                _counter->fetchAndSubtract(1);
+            }
+        private:
+            AtomicUInt32* const _counter;
+        };
+    }
+
     WiredTigerSession::WiredTigerSession(WT_CONNECTION* conn, int cachePartition, int epoch)
         : _cachePartition(cachePartition),
           _epoch(epoch),
@@ -61,15 +110,17 @@ namespace mongo {
     WT_CURSOR* WiredTigerSession::getCursor(const std::string& uri,
                                             uint64_t id,
                                             bool forRecordStore) {
-        {
-            Cursors& cursors = _curmap[id];
-            if ( !cursors.empty() ) {
-                WT_CURSOR* save = cursors.back();
-                cursors.pop_back();
+        // Search from the most recently released end, where hot tables are.
+        for (CursorCache::reverse_iterator it = _cursors.rbegin(); it != _cursors.rend(); ++it) {
+            if (it->id == id) {
+                WT_CURSOR* save = it->cursor;
+                _cursors.erase(--it.base());
                 _cursorsOut++;
+                statsForThisThread().cursorsReused.fetchAndAdd(1);
                 return save;
             }
         }
+
         WT_CURSOR* c = NULL;
         int ret = _session->open_cursor(_session,
                                         uri.c_str(),
@@ -78,7 +129,10 @@ namespace mongo {
                                         &c);
         if (ret != ENOENT)
             invariantWTOK(ret);
-        if ( c ) _cursorsOut++;
+        if ( c ) {
+            _cursorsOut++;
+            statsForThisThread().cursorsOpened.fetchAndAdd(1);
+        }
         return c;
     }
 
@@ -87,35 +141,43 @@ namespace mongo {
         invariant( cursor );
         _cursorsOut--;
 
-        Cursors& cursors = _curmap[id];
-        if ( cursors.size() > 10u ) {
+        const int cacheSize = wiredTigerCursorCacheSize;
+        if ( cacheSize <= 0 ) {
             invariantWTOK( cursor->close(cursor) );
+            statsForThisThread().cursorsClosed.fetchAndAdd(1);
+            return;
         }
-        else {
-            invariantWTOK( cursor->reset( cursor ) );
-            cursors.push_back( cursor );
+
+        invariantWTOK( cursor->reset( cursor ) );
+        _cursors.push_back( CachedCursor( id, cursor ) );
+
+        // Evict the least recently released cursors. The bound may have been lowered at runtime,
+        // so this can close more than one.
+        size_t numToClose = 0;
+        while ( _cursors.size() - numToClose > static_cast<size_t>( cacheSize ) ) {
+            WT_CURSOR* evicted = _cursors[numToClose].cursor;
+            invariantWTOK( evicted->close(evicted) );
+            numToClose++;
+        }
+        if ( numToClose ) {
+            _cursors.erase( _cursors.begin(), _cursors.begin() + numToClose );
+            statsForThisThread().cursorsClosed.fetchAndAdd(numToClose);
         }
     }
 
     void WiredTigerSession::closeAllCursors() {
         invariant( _session );
-        for (CursorMap::iterator i = _curmap.begin(); i != _curmap.end(); ++i ) {
-            Cursors& cursors = i->second;
-            for ( size_t j = 0; j < cursors.size(); j++ ) {
-                WT_CURSOR *cursor = cursors[j];
-                if (cursor) {
-                    int ret = cursor->close(cursor);
-                    invariantWTOK(ret);
-                }
+        for ( size_t i = 0; i < _cursors.size(); i++ ) {
+            WT_CURSOR *cursor = _cursors[i].cursor;
+            if (cursor) {
+                int ret = cursor->close(cursor);
+                invariantWTOK(ret);
             }
         }
-        _curmap.clear();
+        statsForThisThread().cursorsClosed.fetchAndAdd(_cursors.size());
+        _cursors.clear();
     }
 
-    namespace {
-        AtomicUInt64 nextCursorId(1);
-        AtomicUInt64 cachePartitionGen(0);
-    }
     // static
     uint64_t WiredTigerSession::genCursorId() {
         return nextCursorId.fetchAndAdd(1);
@@ -141,11 +203,13 @@ namespace mongo {
         if (_shuttingDown.load()) return;
         _shuttingDown.store(1);
 
-        {
-            // This ensures that any calls, which are currently inside of getSession/releaseSession
-            // will be able to complete before we start cleaning up the pool. Any others, which are
-            // about to enter will return immediately because of _shuttingDown == true.
-            boost::lock_guard<boost::shared_mutex> lk(_shutdownLock);
+        // Let any calls which are currently inside of getSession/releaseSession complete before
+        // we start cleaning up the pool. Any others, which are about to enter, will see
+        // _shuttingDown == true.
+        for (int i = 0; i < NumSessionCachePartitions; i++) {
+            while (_cache[i].activeOps.load()) {
+                boost::this_thread::yield();
+            }
         }
 
         closeAll();
@@ -153,48 +217,78 @@ namespace mongo {
 
     void WiredTigerSessionCache::closeAll() {
         for (int i = 0; i < NumSessionCachePartitions; i++) {
-            SessionPool swapPool;
+            _closePartition(&_cache[i]);
+        }
+    }
 
-            {
-                boost::unique_lock<SpinLock> scopedLock(_cache[i].lock);
-                _cache[i].pool.swap(swapPool);
-                _cache[i].epoch++;
-            }
+    // static
+    void WiredTigerSessionCache::_closePartition(SessionCachePartition* partition) {
+        SessionPool swapPool;
 
-            // New sessions will be created if need be outside of the lock
-            for (size_t i = 0; i < swapPool.size(); i++) {
-                delete swapPool[i];
-            }
+        {
+            boost::unique_lock<SpinLock> scopedLock(partition->lock);
+            partition->pool.swap(swapPool);
+            partition->epoch.fetchAndAdd(1);
+        }
 
-            swapPool.clear();
+        // The epoch has moved on, so anything put in a fast slot from here on is stale and will
+        // be discarded by whoever takes it next.
+        for (int i = 0; i < NumFastSlots; i++) {
+            WiredTigerSession* session = partition->fastSlots[i].swap(NULL);
+            if (session)
+                swapPool.push_back(session);
         }
+
+        // New sessions will be created if need be outside of the lock
+        for (size_t i = 0; i < swapPool.size(); i++) {
+            delete swapPool[i];
+        }
+    }
+
+    // static
+    int WiredTigerSessionCache::_partitionForThisThread() {
+        // Keeping a thread on one partition means it usually gets back the session it released
+        // last, with that session's cursors still cached.
+        return static_cast<int>(threadHash() % NumSessionCachePartitions);
     }
 
     WiredTigerSession* WiredTigerSessionCache::getSession() {
-        boost::shared_lock<boost::shared_mutex> shutdownLock(_shutdownLock);
+        const int cachePartition = _partitionForThisThread();
+        SessionCachePartition& partition = _cache[cachePartition];
+        ActiveOp activeOp(&partition.activeOps);
 
         // We should never be able to get here after _shuttingDown is set, because no new
         // operations should be allowed to start.
-        invariant(!_shuttingDown.loadRelaxed());
-
-        // Spread sessions uniformly across the cache partitions
-        const int cachePartition = cachePartitionGen.addAndFetch(1) % NumSessionCachePartitions;
-
-        int epoch;
+        invariant(!_shuttingDown.load());
+
+        const int epoch = partition.epoch.load();
+
+        for (int i = 0; i < NumFastSlots; i++) {
+            if (!partition.fastSlots[i].loadRelaxed())
+                continue;
+            WiredTigerSession* cachedSession = partition.fastSlots[i].swap(NULL);
+            if (!cachedSession)
+                continue;
+            if (cachedSession->_getEpoch() == epoch) {
+                statsForThisThread().sessionsReused.fetchAndAdd(1);
+                return cachedSession;
+            }
+            // Returned while closeAll() was running.
+            delete cachedSession;
+        }
 
         {
-            boost::unique_lock<SpinLock> cachePartitionLock(_cache[cachePartition].lock);
-            epoch = _cache[cachePartition].epoch;
-
-            if (!_cache[cachePartition].pool.empty()) {
-                WiredTigerSession* cachedSession = _cache[cachePartition].pool.back();
-                _cache[cachePartition].pool.pop_back();
-
+            boost::unique_lock<SpinLock> cachePartitionLock(partition.lock);
+            if (!partition.pool.empty()) {
+                WiredTigerSession* cachedSession = partition.pool.back();
+                partition.pool.pop_back();
+                statsForThisThread().sessionsReused.fetchAndAdd(1);
                 return cachedSession;
             }
         }
 
         // Outside of the cache partition lock, but on release will be put back on the cache
+        statsForThisThread().sessionsOpened.fetchAndAdd(1);
         return new WiredTigerSession(_conn, cachePartition, epoch);
     }
 
@@ -202,8 +296,8 @@ namespace mongo {
         invariant( session );
         invariant(session->cursorsOut() == 0);
 
-        boost::shared_lock<boost::shared_mutex> shutdownLock(_shutdownLock);
-        if (_shuttingDown.loadRelaxed()) {
+        ActiveOp activeOp(&_cache[_partitionForThisThread()].activeOps);
+        if (_shuttingDown.load()) {
             // Leak the session in order to avoid race condition with clean shutdown, where the
             // storage engine is ripped from underneath transactions, which are not "active"
             // (i.e., do not have any locks), but are just about to delete the recovery unit.
@@ -224,13 +318,33 @@ namespace mongo {
         bool returnedToCache = false;
 
         if (cachePartition >= 0) {
-            boost::unique_lock<SpinLock> cachePartitionLock(_cache[cachePartition].lock);
-
-            invariant(session->_getEpoch() <= _cache[cachePartition].epoch);
+            SessionCachePartition& partition = _cache[cachePartition];
+
+            invariant(session->_getEpoch() <= partition.epoch.load());
+
+            if (session->_getEpoch() == partition.epoch.load()) {
+                for (int i = 0; i < NumFastSlots && !returnedToCache; i++) {
+                    returnedToCache = !partition.fastSlots[i].loadRelaxed()
+                        && partition.fastSlots[i].compareAndSwap(NULL, session) == NULL;
+
+                    // closeAll() may have moved the epoch on and swept the fast slots since the
+                    // check above, which would leave a stale session, with its cursors, in the
+                    // slot until the partition is next used. Take it back out if nobody else has.
+                    if (returnedToCache
+                            && session->_getEpoch() != partition.epoch.load()
+                            && partition.fastSlots[i].compareAndSwap(session, NULL) == session) {
+                        returnedToCache = false;
+                        break;
+                    }
+                }
 
-            if (session->_getEpoch() == _cache[cachePartition].epoch) {
-                _cache[cachePartition].pool.push_back(session);
-                returnedToCache = true;
+                if (!returnedToCache) {
+                    boost::unique_lock<SpinLock> cachePartitionLock(partition.lock);
+                    if (session->_getEpoch() == partition.epoch.load()) {
+                        partition.pool.push_back(session);
+                        returnedToCache = true;
+                    }
+                }
             }
         }
 
@@ -243,4 +357,29 @@ namespace mongo {
             _engine->dropAllQueued();
         }
     }
+
+    // static
+    void WiredTigerSessionCache::appendGlobalStats(BSONObjBuilder* builder) {
+        long long sessionsOpened = 0;
+        long long sessionsReused = 0;
+        long long cursorsOpened = 0;
+        long long cursorsReused = 0;
+        long long cursorsClosed = 0;
+        for (int i = 0; i < NumStatsStripes; i++) {
+            sessionsOpened += cacheStats[i].sessionsOpened.loadRelaxed();
+            sessionsReused += cacheStats[i].sessionsReused.loadRelaxed();
+            cursorsOpened += cacheStats[i].cursorsOpened.loadRelaxed();
+            cursorsReused += cacheStats[i].cursorsReused.loadRelaxed();
+            cursorsClosed += cacheStats[i].cursorsClosed.loadRelaxed();
+        }
+
+        BSONObjBuilder bb(builder->subobjStart("sessionCache"));
+        bb.appendNumber("sessionsOpened", sessionsOpened);
+        bb.appendNumber("sessionsReused", sessionsReused);
+        bb.appendNumber("cursorsOpened", cursorsOpened);
+        bb.appendNumber("cursorsReused", cursorsReused);
+        bb.appendNumber("cursorsClosed", cursorsClosed);
+        bb.append("cursorCacheSize", wiredTigerCursorCacheSize);
+        bb.done();
+    }
 }
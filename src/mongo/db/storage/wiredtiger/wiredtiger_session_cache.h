@@ -31,13 +31,9 @@
 
 #pragma once
 
-#include <map>
 #include <string>
 #include <vector>
 
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/shared_mutex.hpp>
-
 #include <wiredtiger.h>
 
 #include "mongo/platform/atomic_word.h"
@@ -45,10 +41,13 @@
 
 namespace mongo {
 
+    class BSONObjBuilder;
     class WiredTigerKVEngine;
 
     /**
-     * This is a structure that caches 1 cursor for each uri.
+     * This is a structure that caches released cursors, so that the next operation using the
+     * same table does not need to open one. At most wiredTigerCursorCacheSize cursors are kept,
+     * and the least recently released one is closed first.
      * The idea is that there is a pool of these somewhere.
      * NOT THREADSAFE
      */
@@ -90,8 +89,15 @@ namespace mongo {
     private:
         friend class WiredTigerSessionCache;
 
-        typedef std::vector<WT_CURSOR*> Cursors;
-        typedef std::map<uint64_t, Cursors> CursorMap;
+        struct CachedCursor {
+            CachedCursor(uint64_t id, WT_CURSOR* cursor) : id(id), cursor(cursor) {}
+            uint64_t id;
+            WT_CURSOR* cursor;
+        };
+
+        // Ordered from least to most recently released. Small enough that a linear scan from the
+        // back beats a map, and reused without allocating.
+        typedef std::vector<CachedCursor> CursorCache;
 
 
         // Used internally by WiredTigerSessionCache
@@ -102,7 +108,7 @@ namespace mongo {
         const int _cachePartition;
         const int _epoch;
         WT_SESSION* _session; // owned
-        CursorMap _curmap; // owned
+        CursorCache _cursors; // owned
         int _cursorsOut;
     };
 
@@ -113,6 +119,10 @@ namespace mongo {
         WiredTigerSessionCache( WT_CONNECTION* conn );
         ~WiredTigerSessionCache();
 
+        /**
+         * Hands out an idle session, preferring one last used by the calling thread's partition.
+         * The common case takes no lock.
+         */
         WiredTigerSession* getSession();
         void releaseSession( WiredTigerSession* session );
 
@@ -122,10 +132,16 @@ namespace mongo {
 
         WT_CONNECTION* conn() const { return _conn; }
 
+        /**
+         * Appends session and cursor reuse counters for serverStatus.
+         */
+        static void appendGlobalStats(BSONObjBuilder* builder);
+
     private:
         typedef std::vector<WiredTigerSession*> SessionPool;
 
         enum { NumSessionCachePartitions = 64 };
+        enum { NumFastSlots = 4 };
 
         struct SessionCachePartition {
             SessionCachePartition() : epoch(0) { }
@@ -133,11 +149,26 @@ namespace mongo {
                 invariant(pool.empty());
             }
 
+            // Idle sessions that can be taken and returned with a single atomic swap. The pool
+            // below only holds what does not fit here.
+            AtomicWord<WiredTigerSession*> fastSlots[NumFastSlots];
+
+            // Number of threads inside getSession()/releaseSession() that picked this partition.
+            // Shutdown waits for all of these to drain.
+            AtomicUInt32 activeOps;
+
             SpinLock lock;
-            int epoch;
+            AtomicInt32 epoch; // only incremented with 'lock' held
             SessionPool pool;
         };
 
+        static int _partitionForThisThread();
+
+        /**
+         * Deletes and clears every idle session in 'partition'.
+         */
+        static void _closePartition(SessionCachePartition* partition);
+
 
         WiredTigerKVEngine* _engine; // not owned, might be NULL
         WT_CONNECTION* _conn; // not owned
@@ -147,10 +178,8 @@ namespace mongo {
         // to have some form of balance between the partitions.
         SessionCachePartition _cache[NumSessionCachePartitions];
 
-        // Regular operations take it in shared mode. Shutdown sets the _shuttingDown flag and
-        // then takes it in exclusive mode. This ensures that all threads, which would return
-        // sessions to the cache would leak them.
-        boost::shared_mutex _shutdownLock;
+        // Shutdown sets this and then waits for every partition's activeOps to drain. Threads
+        // returning sessions after that see the flag and leak them.
         AtomicUInt32 _shuttingDown; // Used as boolean - 0 = false, 1 = true
     };
 
@@ -31,6 +31,7 @@
 
 #define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
 
+#include <algorithm>
 #include <boost/thread.hpp>
 #include <wiredtiger.h>
 
@@ -39,7 +40,11 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_record_store.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_size_storer.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/log.h"
 #include "mongo/util/scopeguard.h"
 
@@ -49,10 +54,13 @@ namespace mongo {
 
     namespace {
         int MAGIC = 123123;
+
+        MONGO_EXPORT_SERVER_PARAMETER(wiredTigerSizeStorerFlushMillis, int, 60 * 1000);
     }
 
     WiredTigerSizeStorer::WiredTigerSizeStorer(WT_CONNECTION* conn, const std::string& storageUri)
-            : _session(conn)
+            : _session(conn),
+              _flushThreadShouldStop(false)
     {
         WT_SESSION* session = _session.getSession();
         int ret = session->open_cursor(session, storageUri.c_str(), NULL,
@@ -70,6 +78,8 @@ namespace mongo {
     }
 
     WiredTigerSizeStorer::~WiredTigerSizeStorer() {
+        stopFlushThread();
+
         // This shouldn't be necessary, but protects us if we screw up.
         boost::lock_guard<boost::mutex> cursorLock( _cursorMutex );
 
@@ -235,5 +245,54 @@ namespace mongo {
         }
     }
 
+    void WiredTigerSizeStorer::startFlushThread() {
+        invariant(!_flushThread);
+        _flushThreadShouldStop = false;
+        _flushThread.reset(new boost::thread(stdx::bind(&WiredTigerSizeStorer::_flushThreadMain,
+                                                        this)));
+    }
+
+    void WiredTigerSizeStorer::stopFlushThread() {
+        if (!_flushThread)
+            return;
+
+        {
+            boost::lock_guard<boost::mutex> lk(_flushThreadMutex);
+            _flushThreadShouldStop = true;
+        }
+        _flushThreadCondVar.notify_one();
+        _flushThread->join();
+        _flushThread.reset();
+    }
+
+    void WiredTigerSizeStorer::_flushThreadMain() {
+        setThreadName("WTSizeStorer");
+
+        while (true) {
+            bool stopping;
+            {
+                boost::unique_lock<boost::mutex> lk(_flushThreadMutex);
+                const int millis = std::max(wiredTigerSizeStorerFlushMillis, 1);
+                if (!_flushThreadShouldStop) {
+                    _flushThreadCondVar.timed_wait(lk, boost::posix_time::milliseconds(millis));
+                }
+                stopping = _flushThreadShouldStop;
+            }
+
+            try {
+                syncCache(stopping);
+            }
+            catch (const WriteConflictException&) {
+                // ignore, we'll try again later.
+            }
+            catch (const DBException& e) {
+                warning() << "WiredTigerSizeStorer failed to write record store sizes: "
+                          << e.toString();
+            }
+
+            if (stopping)
+                return;
+        }
+    }
 
 }
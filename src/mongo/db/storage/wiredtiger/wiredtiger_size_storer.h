@@ -31,7 +31,10 @@
 
 #pragma once
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <map>
 #include <string>
 #include <wiredtiger.h>
@@ -66,9 +69,23 @@ namespace mongo {
          */
         void syncCache(bool syncToDisk);
 
+        /**
+         * Starts a thread which calls syncCache() every wiredTigerSizeStorerFlushMillis, so that
+         * the sizes of live record stores are written without slowing down any operation.
+         */
+        void startFlushThread();
+
+        /**
+         * Stops the flush thread, after it has done a final syncCache(true). Does nothing if the
+         * thread isn't running.
+         */
+        void stopFlushThread();
+
     private:
         void _checkMagic() const;
 
+        void _flushThreadMain();
+
         struct Entry {
             Entry() : numRecords(0), dataSize(0), dirty(false), rs(NULL){}
             long long numRecords;
@@ -88,6 +105,12 @@ namespace mongo {
         Map _entries;
         mutable boost::mutex _entriesMutex;
 
+        // Guards _flushThreadShouldStop.
+        boost::mutex _flushThreadMutex;
+        boost::condition_variable _flushThreadCondVar;
+        bool _flushThreadShouldStop;
+        boost::scoped_ptr<boost::thread> _flushThread;
+
     };
 
 }
@@ -40,6 +40,7 @@ namespace AccumulatorTests {
     using boost::intrusive_ptr;
     using std::numeric_limits;
     using std::string;
+    using std::vector;
 
     class Base {
     protected:
@@ -841,6 +842,188 @@ namespace AccumulatorTests {
         
     } // namespace Sum
 
+    namespace ApproxCountDistinct {
+
+        class Base : public AccumulatorTests::Base {
+        protected:
+            intrusive_ptr<Accumulator> createAccumulator() {
+                intrusive_ptr<Accumulator> accumulator = AccumulatorApproxCountDistinct::create();
+                ASSERT_EQUALS(string("$approxCountDistinct"), accumulator->getOpName());
+                return accumulator;
+            }
+            /** Asserts 'actual' is within 2% of 'expected'. */
+            void assertClose(long long expected, const Value& actual) {
+                ASSERT_EQUALS(NumberLong, actual.getType());
+                ASSERT_LESS_THAN(std::abs(actual.getLong() - expected), expected / 50);
+            }
+        };
+
+        /** No documents evaluated. */
+        class None : public Base {
+        public:
+            void run() {
+                ASSERT_EQUALS(0, createAccumulator()->getValue(false).getLong());
+            }
+        };
+
+        /** Small counts are exact, and equal numbers of different types are one value. */
+        class Exact : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = createAccumulator();
+                accumulator->process(Value(1), false);
+                accumulator->process(Value(1.0), false);
+                accumulator->process(Value(1LL), false);
+                accumulator->process(Value("a"), false);
+                accumulator->process(Value(BSONNULL), false);
+                accumulator->process(Value(), false);
+                ASSERT_EQUALS(3, accumulator->getValue(false).getLong());
+            }
+        };
+
+        /** Past the exact limit the sketch estimates the count. */
+        class Estimate : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = createAccumulator();
+                for (int i = 0; i < 100000; i++) {
+                    accumulator->process(Value(i), false);
+                    accumulator->process(Value(i), false);
+                }
+                assertClose(100000, accumulator->getValue(false));
+                ASSERT_LESS_THAN(accumulator->memUsageForSorter(), 64 * 1024);
+            }
+        };
+
+        /** Exact partial results from two shards are merged exactly. */
+        class MergeExact : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> shard1 = createAccumulator();
+                intrusive_ptr<Accumulator> shard2 = createAccumulator();
+                for (int i = 0; i < 100; i++) {
+                    shard1->process(Value(i), false);
+                    shard2->process(Value(i + 50), false);
+                }
+                intrusive_ptr<Accumulator> router = createAccumulator();
+                router->process(shard1->getValue(true), true);
+                router->process(shard2->getValue(true), true);
+                ASSERT_EQUALS(150, router->getValue(false).getLong());
+            }
+        };
+
+        /** An exact partial result merged with a sketch, and two sketches merged. */
+        class MergeSketches : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> shard1 = createAccumulator();
+                intrusive_ptr<Accumulator> shard2 = createAccumulator();
+                intrusive_ptr<Accumulator> shard3 = createAccumulator();
+                for (int i = 0; i < 60000; i++) {
+                    shard1->process(Value(i), false);
+                    shard2->process(Value(i + 30000), false);
+                }
+                for (int i = 0; i < 1000; i++) {
+                    shard3->process(Value(i + 100000), false);
+                }
+                intrusive_ptr<Accumulator> router = createAccumulator();
+                router->process(shard3->getValue(true), true);
+                router->process(shard1->getValue(true), true);
+                router->process(shard2->getValue(true), true);
+                assertClose(91000, router->getValue(false));
+            }
+        };
+
+        /** A partial result that is not a sketch. */
+        class BadPartial : public Base {
+        public:
+            void run() {
+                ASSERT_THROWS(createAccumulator()->process(Value(5), true), UserException);
+            }
+        };
+
+    } // namespace ApproxCountDistinct
+
+    namespace Percentile {
+
+        class Base : public AccumulatorTests::Base {
+        protected:
+            intrusive_ptr<Accumulator> createAccumulator() {
+                intrusive_ptr<Accumulator> accumulator = AccumulatorPercentile::create();
+                ASSERT_EQUALS(string("$percentile"), accumulator->getOpName());
+                return accumulator;
+            }
+            static Value input(const Value& x, const Value& p) {
+                return Value(DOC("input" << x << "p" << p));
+            }
+        };
+
+        /** No numeric input. */
+        class None : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = createAccumulator();
+                accumulator->process(input(Value("a"), Value(0.5)), false);
+                ASSERT_EQUALS(jstNULL, accumulator->getValue(false).getType());
+            }
+        };
+
+        /** Percentiles interpolate between the inputs. */
+        class Small : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> accumulator = createAccumulator();
+                vector<Value> ps;
+                ps.push_back(Value(0));
+                ps.push_back(Value(0.5));
+                ps.push_back(Value(1));
+                for (int i = 100; i >= 1; i--) {
+                    accumulator->process(input(Value(i), Value(ps)), false);
+                    accumulator->process(input(Value(), Value(ps)), false);
+                }
+                const vector<Value> result = accumulator->getValue(false).getArray();
+                ASSERT_EQUALS(3U, result.size());
+                ASSERT_EQUALS(1, result[0].getDouble());
+                ASSERT_EQUALS(50.5, result[1].getDouble());
+                ASSERT_EQUALS(100, result[2].getDouble());
+            }
+        };
+
+        /** Partial results from two shards are merged into one digest. */
+        class Merge : public Base {
+        public:
+            void run() {
+                intrusive_ptr<Accumulator> shard1 = createAccumulator();
+                intrusive_ptr<Accumulator> shard2 = createAccumulator();
+                for (int i = 0; i < 50000; i++) {
+                    shard1->process(input(Value(2 * i), Value(0.99)), false);
+                    shard2->process(input(Value(2 * i + 1), Value(0.99)), false);
+                }
+                ASSERT_LESS_THAN(shard1->memUsageForSorter(), 64 * 1024);
+
+                intrusive_ptr<Accumulator> router = createAccumulator();
+                router->process(shard1->getValue(true), true);
+                router->process(shard2->getValue(true), true);
+                ASSERT_LESS_THAN(std::abs(router->getValue(false).getDouble() - 99000), 100);
+            }
+        };
+
+        /** p must be between 0 and 1. */
+        class BadP : public Base {
+        public:
+            void run() {
+                ASSERT_THROWS(createAccumulator()->process(input(Value(1), Value(1.5)), false),
+                              UserException);
+                ASSERT_THROWS(createAccumulator()->process(input(Value(1), Value("a")), false),
+                              UserException);
+                ASSERT_THROWS(createAccumulator()->process(input(Value(1), Value(vector<Value>())),
+                                                           false),
+                              UserException);
+            }
+        };
+
+    } // namespace Percentile
+
     class All : public Suite {
     public:
         All() : Suite( "accumulator" ) {
@@ -917,6 +1100,18 @@ namespace AccumulatorTests {
             add<Sum::IntNull>();
             add<Sum::IntUndefined>();
             add<Sum::NoOverflowBeforeDouble>();
+
+            add<ApproxCountDistinct::None>();
+            add<ApproxCountDistinct::Exact>();
+            add<ApproxCountDistinct::Estimate>();
+            add<ApproxCountDistinct::MergeExact>();
+            add<ApproxCountDistinct::MergeSketches>();
+            add<ApproxCountDistinct::BadPartial>();
+
+            add<Percentile::None>();
+            add<Percentile::Small>();
+            add<Percentile::Merge>();
+            add<Percentile::BadP>();
         }
     };
 
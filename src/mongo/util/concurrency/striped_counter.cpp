@@ -0,0 +1,105 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/striped_counter.h"
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/platform/compiler.h"
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+namespace {
+
+    // More stripes than this only cost memory; each counter takes a cache line per stripe.
+    const size_t kMaxStripes = 16;
+
+    AtomicUInt32 nextStripe;
+
+    struct StripeIndex {
+        StripeIndex() : value(nextStripe.fetchAndAdd(1)) {}
+        const unsigned value;
+    };
+
+    size_t computeNumStripes() {
+        size_t n = 1;
+        const size_t cores = boost::thread::hardware_concurrency();
+        while (n < cores && n < kMaxStripes)
+            n *= 2;
+        return n;
+    }
+
+} // namespace
+
+    TSP_DECLARE(StripeIndex, stripeIndex);
+    TSP_DEFINE(StripeIndex, stripeIndex);
+
+    StripedCounter::StripedCounter(int64_t initial)
+        : _stripes(new Stripe[numStripes()]) {
+        for (size_t i = 0; i < numStripes(); i++)
+            _stripes[i].value.store(0);
+        _stripes[0].value.store(initial);
+    }
+
+    int64_t StripedCounter::load() const {
+        int64_t sum = 0;
+        for (size_t i = 0; i < numStripes(); i++)
+            sum += _stripes[i].value.load();
+        return sum;
+    }
+
+    int64_t StripedCounter::loadNonNegative() {
+        int64_t sum = load();
+        if (MONGO_likely(sum >= 0))
+            return sum;
+
+        boost::lock_guard<boost::mutex> lk(_clampMutex);
+        sum = load();
+        if (sum < 0) {
+            add(-sum);
+            sum = 0;
+        }
+        return sum;
+    }
+
+    // static
+    size_t StripedCounter::numStripes() {
+        static const size_t n = computeNumStripes();
+        return n;
+    }
+
+    // static
+    size_t StripedCounter::_myStripe() {
+        return stripeIndex.getMake()->value & (numStripes() - 1);
+    }
+
+} // namespace mongo
@@ -0,0 +1,89 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/scoped_array.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * A counter for values that are updated far more often than they are read, such as the
+     * number of records in a collection. Each thread adds to one of several stripes, each on its
+     * own cache line, so concurrent writers on different cores don't contend. Reading sums the
+     * stripes.
+     *
+     * A sum taken while other threads are adding is not a snapshot, but it never loses an update.
+     */
+    class StripedCounter {
+        MONGO_DISALLOW_COPYING(StripedCounter);
+    public:
+        explicit StripedCounter(int64_t initial = 0);
+
+        void add(int64_t delta) {
+            _stripes[_myStripe()].value.fetchAndAdd(delta);
+        }
+
+        int64_t load() const;
+
+        /**
+         * Like load(), but if the sum is negative the counter is first reset to 0, so that later
+         * additions aren't swallowed by an earlier error in the count.
+         */
+        int64_t loadNonNegative();
+
+        /**
+         * Adds whatever brings the sum to 'value'. Additions racing with this are kept.
+         */
+        void store(int64_t value) {
+            add(value - load());
+        }
+
+        static size_t numStripes();
+
+    private:
+        struct Stripe {
+            AtomicInt64 value;
+            char pad[64 - sizeof(AtomicInt64)];
+        };
+
+        static size_t _myStripe();
+
+        boost::scoped_array<Stripe> _stripes;
+
+        // Only taken by loadNonNegative() when the sum is negative, so that two readers don't
+        // both correct it.
+        boost::mutex _clampMutex;
+    };
+
+} // namespace mongo
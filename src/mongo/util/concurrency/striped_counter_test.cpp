@@ -0,0 +1,92 @@
+/**
+ *    Copyright (C) 2015 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+#include "mongo/stdx/functional.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/striped_counter.h"
+
+namespace {
+
+    using mongo::StripedCounter;
+
+    TEST(StripedCounterTest, AddAndLoad) {
+        StripedCounter counter(5);
+        ASSERT_EQUALS(5, counter.load());
+        counter.add(3);
+        counter.add(-10);
+        ASSERT_EQUALS(-2, counter.load());
+    }
+
+    TEST(StripedCounterTest, Store) {
+        StripedCounter counter;
+        counter.add(7);
+        counter.store(42);
+        ASSERT_EQUALS(42, counter.load());
+        counter.store(-1);
+        ASSERT_EQUALS(-1, counter.load());
+    }
+
+    TEST(StripedCounterTest, LoadNonNegativeResetsNegativeSum) {
+        StripedCounter counter;
+        counter.add(-4);
+        ASSERT_EQUALS(0, counter.loadNonNegative());
+        ASSERT_EQUALS(0, counter.load());
+        counter.add(2);
+        ASSERT_EQUALS(2, counter.loadNonNegative());
+    }
+
+    void addMany(StripedCounter* counter, int n) {
+        for (int i = 0; i < n; i++)
+            counter->add(1);
+    }
+
+    TEST(StripedCounterTest, ConcurrentAddsAreNotLost) {
+        const int kThreads = 8;
+        const int kAddsPerThread = 100000;
+
+        StripedCounter counter;
+        std::vector<boost::thread*> threads;
+        for (int i = 0; i < kThreads; i++) {
+            threads.push_back(new boost::thread(mongo::stdx::bind(addMany,
+                                                                  &counter,
+                                                                  kAddsPerThread)));
+        }
+        for (int i = 0; i < kThreads; i++) {
+            threads[i]->join();
+            delete threads[i];
+        }
+
+        ASSERT_EQUALS(static_cast<int64_t>(kThreads) * kAddsPerThread, counter.load());
+    }
+
+} // namespace